@@ -0,0 +1,457 @@
+#!/bin/sh
+#
+# Runs every host check against a synthetic NAND, and compares the results against the golden fixtures.
+# Usage: check.sh <host binary> <work directory>. Set UPDATE_FIXTURES=1 to regenerate the golden fixtures instead.
+# Exits with a non-zero status if any check fails.
+#
+
+BIN="$1"
+WORK="$2"
+FIXTURES="$(cd "$(dirname "$0")" && pwd)/fixtures"
+
+NAND="$WORK/nand"
+SD="$WORK/sd"
+CONTENT_DIR="title/00000001/00000002/content"
+INDEX="$SD/ww-43db-patcher/u8index.bin"
+TRACE="$SD/ww-43db-patcher/iotrace.csv"
+
+FAILED=0
+
+if [ -z "$BIN" ] || [ -z "$WORK" ]; then
+    echo "Usage: $0 <host binary> <work directory>"
+    exit 2
+fi
+
+BIN="$(cd "$(dirname "$BIN")" && pwd)/$(basename "$BIN")"
+
+pass() {
+    echo "PASS: $1"
+}
+
+fail() {
+    echo "FAIL: $1"
+    FAILED=$((FAILED + 1))
+}
+
+# Runs the host binary, and checks its exit status. Output is saved to $WORK/<name>.log.
+# Usage: run <name> <expected status: 0 or fail> [arguments...].
+run() {
+    name="$1"
+    expected="$2"
+    shift 2
+
+    "$BIN" nand="$NAND" sd="$SD" "$@" > "$WORK/$name.log" 2>&1
+    rc=$?
+
+    if { [ "$expected" = "0" ] && [ $rc -eq 0 ]; } || { [ "$expected" = "fail" ] && [ $rc -ne 0 ]; }; then
+        pass "$name (exit status $rc)"
+        return 0
+    fi
+
+    fail "$name (exit status $rc, see $WORK/$name.log)"
+    return 1
+}
+
+# Compares a generated file against a golden fixture, or updates the fixture.
+# Usage: compare <name> <generated file> <fixture name>.
+compare() {
+    if [ -n "$UPDATE_FIXTURES" ]; then
+        cp "$2" "$FIXTURES/$3"
+        echo "UPDATED: $FIXTURES/$3"
+    elif cmp -s "$2" "$FIXTURES/$3"; then
+        pass "$1"
+    else
+        fail "$1 (differs from $3)"
+        diff "$FIXTURES/$3" "$2" | head -20
+    fi
+}
+
+# Prints SHA-1 checksums for all files within a directory, using relative and sorted paths.
+hash_dir() {
+    (cd "$1" && find . -type f | LC_ALL=C sort | xargs sha1sum)
+}
+
+# Copies the original synthetic NAND to $WORK/<name>-nand and creates an empty SD card at $WORK/<name>-sd, for checks that need their own copies.
+# Usage: isolate <name>. Sets ISO_NAND and ISO_SD.
+isolate() {
+    ISO_NAND="$WORK/$1-nand"
+    ISO_SD="$WORK/$1-sd"
+    rm -rf "$ISO_NAND" "$ISO_SD"
+    cp -r "$ORIG_NAND" "$ISO_NAND"
+    mkdir -p "$ISO_SD/ww-43db-patcher"
+}
+
+rm -rf "$WORK"
+mkdir -p "$SD"
+
+# Synthetic NAND generation must be deterministic.
+run mknand 0 mknand="$NAND" || exit 1
+hash_dir "$NAND" > "$WORK/nand.sha1"
+compare "synthetic NAND contents" "$WORK/nand.sha1" nand.sha1
+ORIG_NAND="$WORK/nand-orig"
+cp -r "$NAND" "$ORIG_NAND"
+
+run verify 0 action=verify
+
+# A large non-U8 content is probed first, by reading its U8 header alone. The U8 archive content must still be picked, and the result is cached. A U8 index is saved for it.
+# The probing result cached by the verification run is discarded first.
+rm -f "$SD/ww-43db-patcher/contentcache.bin"
+run dryrun 0 action=dryrun
+grep ",isfs_open," "$TRACE" | head -1 | grep -q "00000010.app" && pass "largest content probed first" || fail "largest content probed first"
+[ "$(grep ",isfs_read,\"/$CONTENT_DIR/00000010.app\"" "$TRACE" | awk -F, '{ sum += $6 } END { print sum + 0 }')" = "16" ] && pass "probing only reads the U8 header" || fail "probing only reads the U8 header"
+grep -q "sd_write,\"sd:/ww-43db-patcher/contentcache.bin\"" "$TRACE" && pass "probing result cached" || fail "probing result cached"
+grep -q "sd_write,\"sd:/ww-43db-patcher/u8index.bin\"" "$TRACE" && pass "U8 index saved" || fail "U8 index saved"
+grep -q "Removing 43DB entry #0: HAJ" "$WORK/dryrun.log" && grep -q "Removing 43DB entry #1: HAP" "$WORK/dryrun.log" && pass "dryrun entries" || fail "dryrun entries"
+hash_dir "$NAND" > "$WORK/dryrun.sha1"
+cmp -s "$WORK/nand.sha1" "$WORK/dryrun.sha1" && pass "dryrun leaves the NAND untouched" || fail "dryrun leaves the NAND untouched"
+
+# The cached probing result must be used on the next run, without opening any other content.
+run dryrun-cached 0 action=dryrun
+grep -q "sd_read,\"sd:/ww-43db-patcher/contentcache.bin\"" "$TRACE" && ! grep -q "00000010.app" "$TRACE" && pass "cached U8 archive content used" || fail "cached U8 archive content used"
+grep "43DB entry" "$WORK/dryrun.log" > "$WORK/dryrun-entries.txt"
+grep "43DB entry" "$WORK/dryrun-cached.log" > "$WORK/dryrun-cached-entries.txt"
+cmp -s "$WORK/dryrun-entries.txt" "$WORK/dryrun-cached-entries.txt" && pass "cached U8 archive content yields the same 43DB edits" || fail "cached U8 archive content yields the same 43DB edits"
+
+# The read pipeline overlaps NAND reads with backup writes: the first backup chunk is written while the second one is still being read. The U8 archive spans two chunks.
+# Pipeline checks use their own NAND and SD card copies.
+PIPELINE_NAND="$WORK/pipeline-nand"
+PIPELINE_SD="$WORK/pipeline-sd"
+cp -r "$NAND" "$PIPELINE_NAND"
+mkdir -p "$PIPELINE_SD"
+run pipeline-overlap 0 action=patch nand="$PIPELINE_NAND" sd="$PIPELINE_SD" model=nand:latency=50000 model=sd:latency=50000
+awk -F, '$3 == "isfs_read" && $4 ~ /00000011.app/ && $5 == 262144 && !read_end { read_end = $1 + $2 } $3 == "sd_write" && $4 ~ /_bkp\/00000011.app.tmp/ && $5 == 0 && !write_start { write_start = $1 } \
+    END { exit !(read_end && write_start && write_start < read_end) }' "$PIPELINE_SD/ww-43db-patcher/iotrace.csv" && pass "pipeline overlaps NAND reads and backup writes" || fail "pipeline overlaps NAND reads and backup writes"
+cmp -s "$PIPELINE_SD/ww-43db-patcher_bkp/00000011.app" "$NAND/$CONTENT_DIR/00000011.app" && pass "pipelined backup matches the original content" || fail "pipelined backup matches the original content"
+
+# A backup write failure after the first chunk must abort the pipeline, remove the partial backup and leave the NAND untouched.
+rm -rf "$PIPELINE_NAND" "$PIPELINE_SD"
+cp -r "$NAND" "$PIPELINE_NAND"
+mkdir -p "$PIPELINE_SD"
+run pipeline-write-fault fail action=patch nand="$PIPELINE_NAND" sd="$PIPELINE_SD" model=sd:fault-op=write,fault-nth=3
+grep -q "write() failed for chunk #1" "$WORK/pipeline-write-fault.log" && [ -z "$(ls -A "$PIPELINE_SD/ww-43db-patcher_bkp" 2>/dev/null)" ] && pass "partial pipelined backup removed" || fail "partial pipelined backup removed"
+hash_dir "$PIPELINE_NAND" > "$WORK/pipeline-write-fault.sha1"
+cmp -s "$WORK/nand.sha1" "$WORK/pipeline-write-fault.sha1" && pass "pipeline failure leaves the NAND untouched" || fail "pipeline failure leaves the NAND untouched"
+rm -rf "$PIPELINE_NAND" "$PIPELINE_SD"
+
+# Rules files replace the built-in WC24 rules. Wildcards, additions and every database section are covered, and the resulting edits must match the golden fixtures.
+isolate rules
+cat > "$ISO_SD/ww-43db-patcher/rules.txt" << 'RULES'
+# Comments and blank lines are ignored.
+
+[discdb]
+-RA!
+-R?$    # '?' matches any character.
++RB0
+[vcadb]
++FA"
+-FA'
+[wwdb]
+-WA*    # A trailing '*' matches any suffix.
++HAX
+RULES
+run rules-dryrun 0 action=dryrun nand="$ISO_NAND" sd="$ISO_SD"
+grep -q "Loading rules from \"sd:/ww-43db-patcher/rules.txt\"" "$WORK/rules-dryrun.log" && pass "rules file loaded" || fail "rules file loaded"
+grep -E "^Loaded |43DB entry" "$WORK/rules-dryrun.log" | LC_ALL=C tr -c "[:print:]\n" "." > "$WORK/rules-entries.txt"
+compare "rules file edits" "$WORK/rules-entries.txt" rules-entries.txt
+run rules-patch 0 action=patch nand="$ISO_NAND" sd="$ISO_SD"
+sha1sum < "$ISO_NAND/$CONTENT_DIR/00000011.app" > "$WORK/rules-patched.sha1"
+compare "U8 archive patched using a rules file" "$WORK/rules-patched.sha1" rules-patched.sha1
+run rules-patch-again 0 action=patch nand="$ISO_NAND" sd="$ISO_SD"
+grep -q "already patched" "$WORK/rules-patch-again.log" && pass "repeated patch using a rules file" || fail "repeated patch using a rules file"
+rm -rf "$ISO_NAND" "$ISO_SD"
+
+# Patches the isolated NAND copy, which must fail with the provided error message before anything gets written to the NAND. The copies are removed afterwards.
+# Usage: patch_error <name> <expected error message>.
+patch_error() {
+    run "$1" fail action=patch nand="$ISO_NAND" sd="$ISO_SD"
+    hash_dir "$ISO_NAND" > "$WORK/$1.sha1"
+    grep -qF "$2" "$WORK/$1.log" && cmp -s "$WORK/nand.sha1" "$WORK/$1.sha1" && pass "$1 rejected" || fail "$1 rejected"
+    rm -rf "$ISO_NAND" "$ISO_SD"
+}
+
+# Invalid rules files must be rejected.
+# Usage: rules_error <name> <expected error message> <rules file contents>.
+rules_error() {
+    isolate "$1"
+    printf "%b" "$3" > "$ISO_SD/ww-43db-patcher/rules.txt"
+    patch_error "$1" "$2"
+}
+
+rules_error rules-no-section "Rule at line #2 doesn't belong to any section!" "# Missing section.\n-HAJ\n"
+rules_error rules-unknown-section "Unknown section \"titledb\" at line #1!" "[titledb]\n-HAJ\n"
+rules_error rules-invalid-header "Invalid section header at line #1!" "[wwdb\n-HAJ\n"
+rules_error rules-invalid-removal "Invalid removal rule at line #2!" "[wwdb]\n-H*J\n"
+rules_error rules-invalid-addition "Invalid addition rule at line #2!" "[wwdb]\n+HA?\n"
+rules_error rules-invalid-rule "Invalid rule at line #2!" "[wwdb]\nHAJ\n"
+rules_error rules-conflict "Addition rule \"+HAJ\" matches a removal rule from the [wwdb] section!" "[wwdb]\n-HA?\n+HAJ\n"
+rules_error rules-empty-database "Empty databases aren't supported." "[vcadb]\n-FA*\n"
+
+# Additions are merged into the sorted database, before, between and after existing entries. Removing both WC24 entries makes room for four additions, which fill the
+# WiiWare database up to its U8 archive capacity (52 entries). The merged database must match the golden fixture.
+isolate merge
+printf "[wwdb]\n-HA?\n+WZZ\n+WA%%\n+GAA\n+WA\"\n" > "$ISO_SD/ww-43db-patcher/rules.txt"
+run merge-patch 0 action=patch nand="$ISO_NAND" sd="$ISO_SD"
+run merge-extract 0 action=extract nand="$ISO_NAND" sd="$ISO_SD"
+od -An -v -tx1 -w4 "$ISO_SD/ww-43db-patcher_ext/00000011/titlelist/wwdb.bin" > "$WORK/merged-wwdb.txt"
+compare "merged WiiWare database" "$WORK/merged-wwdb.txt" merged-wwdb.txt
+rm -rf "$ISO_NAND" "$ISO_SD"
+
+# One more addition doesn't fit in the U8 archive.
+rules_error merge-capacity "Modified \"/titlelist/wwdb.bin\" needs 0xE4 bytes, but only 0xE0 bytes are available in the U8 archive!" "[wwdb]\n+GAA\n+GAB\n+GAC\n"
+
+# U8 archive patches are loaded from the [patch] section of a rules file. The IPS patch holds regular and RLE records, and grows "/layout/common.bin" in place
+# (0x42345 to 0x42350 bytes) within its U8 archive capacity. It's checked using SHA-1 checksums. The BPS patch uses every action type, and is checked using its own CRC32 checksums.
+COMMON_SHA1="d5d4c536ed0bdb5bed73f2b0463b54b9242a9736"
+COMMON_PATCHED_SHA1="8d894ed4f6debcbd9a0aaaf7e16503e35204e2cf"
+PATCHES="sd:/ww-43db-patcher/patches"
+
+# Copies the patch fixtures to the isolated SD card, and writes a rules file holding the provided [patch] section entries.
+# Usage: isolate_patch <name> <[patch] section contents>.
+isolate_patch() {
+    isolate "$1"
+    mkdir -p "$ISO_SD/ww-43db-patcher/patches"
+    cp "$FIXTURES/common.ips" "$FIXTURES/vcadb.bps" "$ISO_SD/ww-43db-patcher/patches"
+    printf "[patch]\n%b" "$2" > "$ISO_SD/ww-43db-patcher/rules.txt"
+}
+
+isolate_patch patch-resources "/layout/common.bin $PATCHES/common.ips - $COMMON_PATCHED_SHA1\n/titlelist/vcadb.bin $PATCHES/vcadb.bps\n"
+run patch-resources 0 action=patch nand="$ISO_NAND" sd="$ISO_SD"
+grep -q "Applied IPS patch \"$PATCHES/common.ips\" to \"/layout/common.bin\" (0x42350 bytes)." "$WORK/patch-resources.log" && \
+    grep -q "Applied BPS patch \"$PATCHES/vcadb.bps\" to \"/titlelist/vcadb.bin\" (0x98 bytes)." "$WORK/patch-resources.log" && pass "IPS and BPS patches applied" || fail "IPS and BPS patches applied"
+sha1sum < "$ISO_NAND/$CONTENT_DIR/00000011.app" > "$WORK/patched-resources.sha1"
+compare "U8 archive patched using IPS and BPS patches" "$WORK/patched-resources.sha1" patched-resources.sha1
+run patch-resources-extract 0 action=extract nand="$ISO_NAND" sd="$ISO_SD"
+od -An -v -tx1 -w4 "$ISO_SD/ww-43db-patcher_ext/00000011/titlelist/vcadb.bin" > "$WORK/patched-vcadb.txt"
+compare "BPS-patched VC database" "$WORK/patched-vcadb.txt" patched-vcadb.txt
+
+# Patching again must skip both patches: the IPS one by its target SHA-1 checksum, and the BPS one by its target CRC32 checksum.
+run patch-resources-again 0 action=patch nand="$ISO_NAND" sd="$ISO_SD"
+[ "$(grep -c "^\".*\" is already patched.$" "$WORK/patch-resources-again.log")" = "2" ] && grep -q "The System Menu U8 archive is already patched." "$WORK/patch-resources-again.log" && \
+    pass "repeated IPS and BPS patches skipped" || fail "repeated IPS and BPS patches skipped"
+sha1sum < "$ISO_NAND/$CONTENT_DIR/00000011.app" > "$WORK/patched-resources-again.sha1"
+cmp -s "$WORK/patched-resources.sha1" "$WORK/patched-resources-again.sha1" && pass "repeated patch using IPS and BPS patches" || fail "repeated patch using IPS and BPS patches"
+rm -rf "$ISO_NAND" "$ISO_SD"
+
+# Checksum mismatches must be caught before anything gets written to the NAND.
+isolate_patch patch-source-sha1 "/layout/common.bin $PATCHES/common.ips $COMMON_PATCHED_SHA1\n"
+patch_error patch-source-sha1 "Source SHA-1 checksum mismatch for \"/layout/common.bin\"!"
+isolate_patch patch-target-sha1 "/layout/common.bin $PATCHES/common.ips $COMMON_SHA1 0000000000000000000000000000000000000000\n"
+patch_error patch-target-sha1 "Target SHA-1 checksum mismatch for \"/layout/common.bin\"!"
+isolate_patch patch-bps-source "/titlelist/discdb.bin $PATCHES/vcadb.bps\n"
+patch_error patch-bps-source "BPS patch source mismatch!"
+isolate_patch patch-bps-crc "/titlelist/vcadb.bin $PATCHES/vcadb.bps\n"
+printf "\377" | dd of="$ISO_SD/ww-43db-patcher/patches/vcadb.bps" bs=1 seek=8 conv=notrunc 2>/dev/null
+patch_error patch-bps-crc "BPS patch CRC32 mismatch!"
+
+# Options can be loaded from the SD card config file alone, which selects the action, the databases and a custom rules file.
+isolate config
+printf "# Unattended dry run.\naction=dryrun\ndb=vcadb\nrules=sd:/ww-43db-patcher/custom.txt  # Custom rules file.\n" > "$ISO_SD/ww-43db-patcher/config.txt"
+printf "[vcadb]\n-FA!\n[wwdb]\n-WA!\n" > "$ISO_SD/ww-43db-patcher/custom.txt"
+run config 0 nand="$ISO_NAND" sd="$ISO_SD"
+hash_dir "$ISO_NAND" > "$WORK/config.sha1"
+grep -q "Loading options from \"sd:/ww-43db-patcher/config.txt\"" "$WORK/config.log" && grep -q "Loading rules from \"sd:/ww-43db-patcher/custom.txt\"" "$WORK/config.log" && \
+    [ "$(grep "43DB entry" "$WORK/config.log")" = "Removing 43DB entry #11: FA!. (0x464121)." ] && cmp -s "$WORK/nand.sha1" "$WORK/config.sha1" && \
+    pass "options loaded from the config file" || fail "options loaded from the config file"
+
+# Command line arguments take precedence over the config file.
+run config-override 0 nand="$ISO_NAND" sd="$ISO_SD" action=patch db=wwdb
+hash_dir "$ISO_NAND" > "$WORK/config-override.sha1"
+[ "$(grep "43DB entry" "$WORK/config-override.log")" = "Removing 43DB entry #13: WA!. (0x574121)." ] && ! cmp -s "$WORK/nand.sha1" "$WORK/config-override.sha1" && \
+    pass "command line arguments override the config file" || fail "command line arguments override the config file"
+rm -rf "$ISO_NAND" "$ISO_SD"
+
+# Invalid config files must be rejected.
+isolate config-invalid
+printf "action=frobnicate\n" > "$ISO_SD/ww-43db-patcher/config.txt"
+run config-invalid fail nand="$ISO_NAND" sd="$ISO_SD"
+grep -q "Invalid config file!" "$WORK/config-invalid.log" && pass "invalid config file rejected" || fail "invalid config file rejected"
+rm -rf "$ISO_NAND" "$ISO_SD"
+
+# The backup checksum is cached while patching and restoring, so patching again after restoring the backup skips its generation. The cached checksum is only trusted
+# while the backup size and modification timestamp are unchanged.
+HASH_CACHE="$WORK/hash-cache-sd/ww-43db-patcher/hashcache.bin"
+HASH_CACHE_BACKUP="$WORK/hash-cache-sd/ww-43db-patcher_bkp/00000011.app"
+
+# Restores the isolated NAND copy. Usage: hash_cache_restore <name>.
+hash_cache_restore() {
+    run "$1-restore" 0 action=restore nand="$ISO_NAND" sd="$ISO_SD"
+}
+
+# Patches the isolated NAND copy, and checks if the backup was regenerated. Usage: hash_cache_patch <name> <expected result: cached or saved>.
+hash_cache_patch() {
+    run "$1" 0 action=patch nand="$ISO_NAND" sd="$ISO_SD"
+    if [ "$2" = "cached" ]; then
+        grep -q "Found a valid System Menu U8 archive backup" "$WORK/$1.log" && ! grep -q "sd_write,\"sd:/ww-43db-patcher_bkp/" "$ISO_SD/ww-43db-patcher/iotrace.csv" && \
+            pass "$1: backup generation skipped" || fail "$1: backup generation skipped"
+    else
+        grep -q "Saved System Menu U8 archive backup" "$WORK/$1.log" && pass "$1: backup regenerated" || fail "$1: backup regenerated"
+    fi
+}
+
+isolate hash-cache
+hash_cache_patch hash-cache saved
+hash_cache_restore hash-cache
+hash_cache_patch hash-cache-hit cached
+
+hash_cache_restore hash-cache-mtime
+touch -d "2001-01-01 00:00:00" "$HASH_CACHE_BACKUP"
+hash_cache_patch hash-cache-mtime saved
+
+hash_cache_restore hash-cache-size
+printf "x" >> "$HASH_CACHE_BACKUP"
+hash_cache_patch hash-cache-size saved
+
+hash_cache_restore hash-cache-refreshed
+hash_cache_patch hash-cache-refreshed cached
+
+# A corrupted hash cache is discarded.
+hash_cache_restore hash-cache-corrupted
+printf "x" >> "$HASH_CACHE"
+hash_cache_patch hash-cache-corrupted saved
+grep -q "Discarding invalid hash cache." "$WORK/hash-cache-corrupted.log" && pass "corrupted hash cache discarded" || fail "corrupted hash cache discarded"
+
+# A full hash cache drops its oldest entry. It's filled with 32 dummy entries first, using the host byte order (magic, version 2, entry count, reserved).
+[ "$(printf "\001\000" | od -An -tu2 | tr -d ' ')" = "1" ] && HASH_CACHE_HEADER="EHCH\002\000\000\000\040\000\000\000" || HASH_CACHE_HEADER="HCHE\000\000\000\002\000\000\000\040"
+{
+    printf "$HASH_CACHE_HEADER\000\000\000\000"
+    for i in $(seq -w 0 31); do
+        printf "sd:/dummy-%s" "$i"
+        head -c $((0x68 - 12)) /dev/zero
+    done
+} > "$HASH_CACHE"
+hash_cache_restore hash-cache-full
+[ "$(wc -c < "$HASH_CACHE")" = "$((0x10 + (32 * 0x68)))" ] && ! grep -aq "sd:/dummy-00" "$HASH_CACHE" && grep -aq "sd:/dummy-01" "$HASH_CACHE" && \
+    grep -aq "sd:/ww-43db-patcher_bkp/00000011.app" "$HASH_CACHE" && pass "full hash cache drops its oldest entry" || fail "full hash cache drops its oldest entry"
+hash_cache_patch hash-cache-full cached
+rm -rf "$ISO_NAND" "$ISO_SD"
+
+# Patching writes a backup of the original content, and the patched content. The System Menu TMD is fetched once per run, and then served from the title metadata cache.
+run patch 0 action=patch
+[ "$(grep -c ",es_get_tmd," "$TRACE")" = "1" ] && [ "$(grep -c ",es_get_tmd_size," "$TRACE")" = "1" ] && pass "patching fetches the TMD once" || fail "patching fetches the TMD once"
+sha1sum < "$NAND/$CONTENT_DIR/00000011.app" > "$WORK/patched.sha1"
+compare "patched U8 archive" "$WORK/patched.sha1" patched.sha1
+cmp -s "$SD/ww-43db-patcher_bkp/00000011.app" "$WORK/nand/$CONTENT_DIR/00000011.app" && fail "backup holds the patched archive" || pass "backup differs from the patched archive"
+
+# Patching again must be a no-op.
+run patch-again 0 action=patch
+sha1sum < "$NAND/$CONTENT_DIR/00000011.app" > "$WORK/patched-again.sha1"
+cmp -s "$WORK/patched.sha1" "$WORK/patched-again.sha1" && pass "repeated patch" || fail "repeated patch"
+
+run extract 0 action=extract
+hash_dir "$SD/ww-43db-patcher_ext" > "$WORK/extract.sha1"
+compare "extracted files" "$WORK/extract.sha1" extract.sha1
+
+# Parallel extraction must yield the exact same files.
+rm -rf "$SD/ww-43db-patcher_ext"
+run extract-parallel 0 action=extract jobs=4
+hash_dir "$SD/ww-43db-patcher_ext" > "$WORK/extract-parallel.sha1"
+cmp -s "$WORK/extract.sha1" "$WORK/extract-parallel.sha1" && pass "parallel extraction" || fail "parallel extraction"
+
+run inventory 0 action=inventory
+compare "inventory" "$SD/ww-43db-patcher/inventory.csv" inventory.csv
+
+# Hundreds of dumps (hard links to the original and patched U8 archives, plus an invalid one) are loaded in parallel, and must yield the same inventory as a serial run.
+INVENTORY_DUMPS="$SD/ww-43db-patcher/dumps"
+mkdir -p "$INVENTORY_DUMPS"
+for i in $(seq -w 0 199); do
+    ln "$SD/ww-43db-patcher_bkp/00000011.app" "$INVENTORY_DUMPS/orig-$i.app"
+    ln "$NAND/$CONTENT_DIR/00000011.app" "$INVENTORY_DUMPS/patched-$i.app"
+done
+echo "invalid" > "$INVENTORY_DUMPS/invalid.app"
+run inventory-dumps 0 action=inventory
+cp "$SD/ww-43db-patcher/inventory.csv" "$WORK/inventory-dumps.csv"
+grep -q "Processed 401 U8 archives" "$WORK/inventory-dumps.log" && grep -q "Skipping \".*/invalid.app\"" "$WORK/inventory-dumps.log" && pass "inventory dumps loaded" || fail "inventory dumps loaded"
+[ "$(head -1 "$WORK/inventory-dumps.csv" | tr ',' '\n' | sed -n '4p;204p')" = "$(printf "orig-000.app\npatched-000.app")" ] && pass "inventory columns sorted" || fail "inventory columns sorted"
+run inventory-dumps-parallel 0 action=inventory jobs=4
+cmp -s "$WORK/inventory-dumps.csv" "$SD/ww-43db-patcher/inventory.csv" && pass "parallel inventory" || fail "parallel inventory"
+rm -rf "$INVENTORY_DUMPS"
+
+# Restoring must bring back the original content, which then passes verification. Only the NAND cluster holding the patched 43DB is rewritten.
+run restore 0 action=restore
+[ "$(grep -c ",es_get_tmd," "$TRACE")" = "1" ] && [ "$(grep -c ",es_get_tmd_size," "$TRACE")" = "1" ] && pass "restoring fetches the TMD once" || fail "restoring fetches the TMD once"
+grep -q "Rewrote 0x4000 out of 0x426C0 bytes" "$WORK/restore.log" && pass "restore only rewrites modified clusters" || fail "restore only rewrites modified clusters"
+hash_dir "$NAND" > "$WORK/restore.sha1"
+cmp -s "$WORK/nand.sha1" "$WORK/restore.sha1" && pass "restored NAND matches the original one" || fail "restored NAND matches the original one"
+run verify-restored 0 action=verify
+
+# The U8 index saved while patching must be reused once the original U8 archive is back, without being written again.
+cp "$INDEX" "$WORK/u8index.bin"
+run index-reuse 0 action=dryrun
+grep -q "^[0-9]*,[0-9]*,sd_read,\"sd:/ww-43db-patcher/u8index.bin\"" "$TRACE" && ! grep -q "sd_write,\"sd:/ww-43db-patcher/u8index.bin\"" "$TRACE" && pass "U8 index reused" || fail "U8 index reused"
+grep "43DB entry" "$WORK/index-reuse.log" > "$WORK/index-reuse-entries.txt"
+cmp -s "$WORK/dryrun-entries.txt" "$WORK/index-reuse-entries.txt" && pass "U8 index yields the same 43DB edits" || fail "U8 index yields the same 43DB edits"
+
+# A corrupted U8 index must be rejected, and replaced by a freshly generated one.
+byte="$(od -An -tu1 -j 200 -N 1 "$INDEX" | tr -d ' ')"
+[ "$byte" = "0" ] && byte="\\377" || byte="\\000"
+printf "$byte" | dd of="$INDEX" bs=1 seek=200 conv=notrunc 2>/dev/null
+run index-corrupted 0 action=dryrun
+grep -q "U8 index checksum mismatch!" "$WORK/index-corrupted.log" && pass "corrupted U8 index rejected" || fail "corrupted U8 index rejected"
+cmp -s "$INDEX" "$WORK/u8index.bin" && pass "corrupted U8 index regenerated" || fail "corrupted U8 index regenerated"
+grep "43DB entry" "$WORK/index-corrupted.log" > "$WORK/index-corrupted-entries.txt"
+cmp -s "$WORK/dryrun-entries.txt" "$WORK/index-corrupted-entries.txt" && pass "regenerated U8 index yields the same 43DB edits" || fail "regenerated U8 index yields the same 43DB edits"
+
+# Phase timings are saved as CSV. Spans are timed with the host clock, so they must cover the modeled NAND latency, and SHA-1 spans must cover every hashed byte.
+run profile 0 action=verify model=nand:latency=20000 profile="$WORK/profile.csv" memprofile="$WORK/memprofile.csv"
+hashed="$(printf "%d" "$(sed -n 's/.*Hashed \(0x[0-9A-F]*\) bytes.*/\1/p' "$WORK/profile.log")")"
+head -1 "$WORK/profile.csv" | grep -q "^timestamp,phase,spans,bytes,usec,kib_per_sec$" && head -1 "$WORK/memprofile.csv" | grep -q "^timestamp,phase,allocs," && pass "profile CSV files saved" || fail "profile CSV files saved"
+awk -F, '$2 == "ISFS read" && $5 >= 20000 { found = 1 } END { exit !found }' "$WORK/profile.csv" && pass "ISFS read spans cover the modeled latency" || fail "ISFS read spans cover the modeled latency"
+awk -F, -v hashed="$hashed" '$2 == "SHA-1" && $4 == hashed { found = 1 } END { exit !found }' "$WORK/profile.csv" && pass "SHA-1 spans cover every hashed byte" || fail "SHA-1 spans cover every hashed byte"
+
+# Faults must never go unnoticed.
+run verify-read-error fail action=verify model=nand:fault-every=3
+run verify-corrupt-read fail action=verify model=nand:fault-nth=1,fault=corrupt
+
+# Corrupted and failed NAND writes must be caught by reading the written content back. The backup must still bring back the original content afterwards.
+run patch-corrupt-write fail action=patch model=nand:fault-op=write,fault-nth=1,fault=corrupt
+grep -q "Modified U8 archive verification failed!" "$WORK/patch-corrupt-write.log" && pass "corrupted patch write detected" || fail "corrupted patch write detected"
+run restore-corrupt-write fail action=restore model=nand:fault-op=write,fault-nth=1,fault=corrupt
+run patch-write-error fail action=patch model=nand:fault-op=write,fault-nth=1
+run restore-after-faults 0 action=restore
+hash_dir "$NAND" > "$WORK/restore-after-faults.sha1"
+cmp -s "$WORK/nand.sha1" "$WORK/restore-after-faults.sha1" && pass "NAND restored after faulty writes" || fail "NAND restored after faulty writes"
+
+# NAND dumps are verified in parallel, and a single corrupted content must be reported for the right dump.
+mkdir -p "$WORK/dumps"
+for dump in a b c d; do cp -r "$NAND" "$WORK/dumps/$dump"; done
+run verify-dumps 0 action=verify dumps="$WORK/dumps" jobs=4
+printf "\377" | dd of="$WORK/dumps/c/$CONTENT_DIR/00000012.app" bs=1 seek=5 conv=notrunc 2>/dev/null
+run verify-dumps-corrupted fail action=verify dumps="$WORK/dumps" jobs=4
+grep -q "dumps/c: v[0-9]*, 2 passed, 1 failed, 0 skipped .* - FAILED" "$WORK/verify-dumps-corrupted.log" && [ "$(grep -c " - OK" "$WORK/verify-dumps-corrupted.log")" = "3" ] && pass "corrupted NAND dump reported" || fail "corrupted NAND dump reported"
+
+# Benchmark gate: results are compared against the baselines stored for the host profiles, which are the median of several runs.
+# Host timings are noisy, so the budget defaults to 200% and can be overridden with BENCHMARK_BUDGET. A failed run is repeated once,
+# so that a single preempted measurement isn't reported as a regression. Delete the baselines file to record new ones.
+# Instrumented builds (e.g. sanitizers) aren't comparable to the baselines: set BENCHMARK_BUDGET=0 to skip the gate.
+BENCHMARK_BUDGET="${BENCHMARK_BUDGET:-200}"
+if [ "$BENCHMARK_BUDGET" = "0" ]; then
+    echo "SKIP: benchmark gate (BENCHMARK_BUDGET=0)"
+elif "$BIN" nand="$NAND" sd="$SD" action=benchmark baseline="$FIXTURES/benchmark-baseline.csv" budget="$BENCHMARK_BUDGET" > "$WORK/benchmark.log" 2>&1; then
+    pass "benchmark within the $BENCHMARK_BUDGET% budget"
+else
+    run benchmark-retry 0 action=benchmark baseline="$FIXTURES/benchmark-baseline.csv" budget="$BENCHMARK_BUDGET"
+fi
+
+# Benchmark gate self-tests: the pass baselines can't be exceeded, while the fail ones always are.
+run benchmark-budget-pass 0 action=benchmark baseline="$FIXTURES/benchmark-pass.csv"
+run benchmark-budget-fail fail action=benchmark baseline="$FIXTURES/benchmark-fail.csv"
+grep -q "exceeded the" "$WORK/benchmark-budget-fail.log" && pass "benchmark regressions are reported" || fail "benchmark regressions are reported"
+
+# Custom benchmark profiles replace the built-in ones, and generate the requested archive shape. Invalid profiles are rejected.
+run benchmark-custom 0 action=benchmark u8profile=name=tiny,depth=2,fan-out=3,files=4,titlelist=0 baseline="$WORK/benchmark-custom.csv"
+grep -q "U8 benchmark (1 profile)" "$WORK/benchmark-custom.log" && grep -q "Profile \"tiny\": 65 nodes (52 files)" "$WORK/benchmark-custom.log" && pass "custom benchmark profile" || fail "custom benchmark profile"
+run benchmark-custom-invalid fail action=benchmark u8profile=depth=x
+
+# Recorded traces can be replayed and fitted. Fitting is deterministic.
+run replay 0 replay="$FIXTURES/iotrace.csv"
+run fit 0 fit="$FIXTURES/iotrace.csv"
+grep "^model=" "$WORK/fit.log" > "$WORK/fit.txt"
+compare "fitted models" "$WORK/fit.txt" fit.txt
+
+if [ $FAILED -ne 0 ]; then
+    echo "$FAILED check(s) failed."
+    exit 1
+fi
+
+echo "All checks passed."
+exit 0
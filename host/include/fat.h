@@ -0,0 +1,37 @@
+/*
+ * fat.h
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifndef __HOST_FAT_H__
+#define __HOST_FAT_H__
+
+#include <stdbool.h>
+
+/* The "sd" device maps to a local directory (see hostio.h). Mounting only succeeds if that directory has been set. */
+
+typedef struct {
+    bool (*shutdown)(void);
+} DISC_INTERFACE;
+
+bool fatMountSimple(const char *name, const DISC_INTERFACE *interface);
+void fatUnmount(const char *name);
+
+#endif /* __HOST_FAT_H__ */
@@ -0,0 +1,231 @@
+/*
+ * gccore.h
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifndef __HOST_GCCORE_H__
+#define __HOST_GCCORE_H__
+
+/* Host replacement for the libogc headers used by the application. Only the declarations needed by the sources are provided. */
+/* ES, ISFS and SD card calls are emulated over local directories (see hostio.h). Video, input and system calls are no-ops. */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef unsigned long long u64;
+
+typedef int8_t s8;
+typedef int16_t s16;
+typedef int32_t s32;
+typedef long long s64;
+
+typedef volatile u32 vu32;
+
+#define ATTRIBUTE_ALIGN(v)          __attribute__((aligned(v)))
+#define ATTRIBUTE_PACKED            __attribute__((packed))
+
+/* ES. TMDs returned by the emulated ES calls are converted to the host byte order. */
+
+typedef u32 signed_blob;
+typedef u8 sha1[20];
+
+#define ES_SIG_RSA4096              0x10000
+#define ES_SIG_RSA2048              0x10001
+#define ES_SIG_ECDSA                0x10002
+
+#define SIGNATURE_SIZE(x)           ((*(x)) == ES_SIG_RSA2048 ? 0x140 : ((*(x)) == ES_SIG_RSA4096 ? 0x240 : ((*(x)) == ES_SIG_ECDSA ? 0x80 : 0)))
+#define IS_VALID_SIGNATURE(x)       (SIGNATURE_SIZE(x) != 0)
+
+typedef struct _tmd_content {
+    u32 cid;
+    u16 index;
+    u16 type;
+    u64 size;
+    sha1 hash;
+} ATTRIBUTE_PACKED tmd_content;
+
+typedef struct _tmd {
+    char issuer[0x40];
+    u8 version;
+    u8 ca_crl_version;
+    u8 signer_crl_version;
+    u8 vwii_title;
+    u64 sys_version;
+    u64 title_id;
+    u32 title_type;
+    u16 group_id;
+    u16 zero;
+    u16 region;
+    u8 ratings[16];
+    u8 reserved[12];
+    u8 ipc_mask[12];
+    u8 reserved2[18];
+    u32 access_rights;
+    u16 title_version;
+    u16 num_contents;
+    u16 boot_index;
+    u16 fill3;
+    tmd_content contents[];
+} ATTRIBUTE_PACKED tmd;
+
+s32 ES_GetTitleContentsCount(u64 titleID, u32 *num);
+s32 ES_GetStoredTMDSize(u64 titleID, u32 *size);
+s32 ES_GetStoredTMD(u64 titleID, signed_blob *stmd, u32 size);
+s32 ES_GetDeviceID(u32 *device_id);
+
+/* ISFS. */
+
+#define ISFS_MAXPATH                64
+
+#define ISFS_OPEN_READ              1
+#define ISFS_OPEN_WRITE             2
+#define ISFS_OPEN_RW                (ISFS_OPEN_READ | ISFS_OPEN_WRITE)
+
+#define ISFS_OK                     0
+#define ISFS_ENOMEM                 -22
+#define ISFS_EINVAL                 -101
+
+#define IPC_OK                      0
+
+typedef struct _fstats {
+    u32 file_length;
+    u32 file_pos;
+} fstats;
+
+typedef s32 (*isfscallback)(s32 result, void *usrdata);
+
+s32 ISFS_Initialize(void);
+s32 ISFS_Deinitialize(void);
+s32 ISFS_Open(const char *filepath, u8 mode);
+s32 ISFS_Close(s32 fd);
+s32 ISFS_Read(s32 fd, void *buffer, u32 length);
+s32 ISFS_ReadAsync(s32 fd, void *buffer, u32 length, isfscallback cb, void *usrdata);
+s32 ISFS_Write(s32 fd, const void *buffer, u32 length);
+s32 ISFS_Seek(s32 fd, s32 where, s32 whence);
+s32 ISFS_GetFileStats(s32 fd, fstats *status);
+s32 ISFS_CreateFile(const char *filepath, u8 attributes, u8 owner_perm, u8 group_perm, u8 other_perm);
+s32 ISFS_Delete(const char *filepath);
+s32 ISFS_GetAttr(const char *filepath, u32 *ownerID, u16 *groupID, u8 *attributes, u8 *ownerperm, u8 *groupperm, u8 *otherperm);
+s32 ISFS_SetAttr(const char *filepath, u32 ownerID, u16 groupID, u8 attributes, u8 ownerperm, u8 groupperm, u8 otherperm);
+
+/* IOS. */
+
+s32 IOS_GetVersion(void);
+s32 IOS_GetRevision(void);
+
+/* Threads. Handles point to host objects, and are allocated on creation. */
+
+typedef struct _host_thread *lwp_t;
+typedef pthread_mutex_t *mutex_t;
+typedef pthread_cond_t *cond_t;
+typedef pthread_cond_t *lwpq_t;
+
+#define LWP_THREAD_NULL             ((lwp_t)NULL)
+#define LWP_MUTEX_NULL              ((mutex_t)NULL)
+#define LWP_PRIO_IDLE               0
+#define LWP_PRIO_HIGHEST            127
+
+s32 LWP_CreateThread(lwp_t *thethread, void *(*entry)(void *), void *arg, void *stackbase, u32 stack_size, u8 prio);
+s32 LWP_JoinThread(lwp_t thethread, void **value_ptr);
+
+s32 LWP_MutexInit(mutex_t *mutex, bool use_recursive);
+s32 LWP_MutexDestroy(mutex_t mutex);
+s32 LWP_MutexLock(mutex_t mutex);
+s32 LWP_MutexUnlock(mutex_t mutex);
+
+s32 LWP_CondInit(cond_t *cond);
+s32 LWP_CondWait(cond_t cond, mutex_t mutex);
+s32 LWP_CondSignal(cond_t cond);
+s32 LWP_CondBroadcast(cond_t cond);
+s32 LWP_CondDestroy(cond_t cond);
+
+/// Thread queues must be used while interrupts are disabled through IRQ_Disable(), just like on the console.
+s32 LWP_InitQueue(lwpq_t *thequeue);
+void LWP_CloseQueue(lwpq_t thequeue);
+s32 LWP_ThreadSleep(lwpq_t thequeue);
+void LWP_ThreadSignal(lwpq_t thequeue);
+void LWP_ThreadBroadcast(lwpq_t thequeue);
+
+/// There are no interrupts to disable on the host. A global recursive lock is held instead, which serializes every interrupt-disabled section.
+u32 IRQ_Disable(void);
+void IRQ_Restore(u32 level);
+
+/* Video, console and system. */
+
+typedef struct _gx_rmode {
+    u32 viTVMode;
+    u16 fbWidth;
+    u16 efbHeight;
+    u16 xfbHeight;
+    u16 viXOrigin;
+    u16 viYOrigin;
+    u16 viWidth;
+    u16 viHeight;
+} GXRModeObj;
+
+extern GXRModeObj TVPal576IntDfScale, TVPal576ProgScale;
+
+#define VI_MAX_WIDTH_PAL            720
+#define VI_MAX_HEIGHT_PAL           574
+#define VI_MAX_WIDTH_NTSC           720
+#define VI_MAX_HEIGHT_NTSC          480
+
+#define COLOR_BLACK                 0x00800080
+
+#define MEM_K0_TO_K1(x)             (x)
+
+void VIDEO_Init(void);
+GXRModeObj *VIDEO_GetPreferredMode(GXRModeObj *mode);
+void VIDEO_SetBlack(bool black);
+void VIDEO_Configure(GXRModeObj *rmode);
+void VIDEO_Flush(void);
+void VIDEO_WaitVSync(void);
+u32 VIDEO_GetFrameBufferSize(GXRModeObj *rmode);
+void VIDEO_ClearFrameBuffer(GXRModeObj *rmode, void *fb, u32 color);
+void VIDEO_SetNextFramebuffer(void *fb);
+
+void *SYS_AllocateFramebuffer(GXRModeObj *rmode);
+void DCInvalidateRange(void *startaddress, u32 len);
+
+void CON_InitEx(GXRModeObj *rmode, s32 conXOrigin, s32 conYOrigin, s32 conWidth, s32 conHeight);
+void CON_GetMetrics(s32 *cols, s32 *rows);
+
+#define CONF_ASPECT_16_9            1
+s32 CONF_GetAspectRatio(void);
+
+#define SYS_RETURNTOMENU            3
+void SYS_ResetSystem(s32 reset, u32 reset_code, s32 force_menu);
+
+/// Arena free space is reported as zero, since there are no arenas on the host.
+u32 SYS_GetArena1Size(void);
+u32 SYS_GetArena2Size(void);
+
+#define AHBPROT_DISABLED            1
+
+#include <ogc/lwp_watchdog.h>
+
+#endif /* __HOST_GCCORE_H__ */
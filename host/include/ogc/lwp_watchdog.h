@@ -0,0 +1,40 @@
+/*
+ * lwp_watchdog.h
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifndef __HOST_LWP_WATCHDOG_H__
+#define __HOST_LWP_WATCHDOG_H__
+
+/* Time base ticks are emulated using the host monotonic clock, at the same rate used by Broadway (see gettime()). */
+
+#define TB_TIMER_CLOCK              60750
+
+#define ticks_to_millisecs(ticks)   (((u64)(ticks) / (u64)(TB_TIMER_CLOCK)))
+#define ticks_to_microsecs(ticks)   ((((u64)(ticks) * 8) / (u64)(TB_TIMER_CLOCK / 125)))
+#define ticks_to_nanosecs(ticks)    ((((u64)(ticks) * 8000) / (u64)(TB_TIMER_CLOCK / 125)))
+
+#define diff_ticks(tick0, tick1)    (((u64)(tick1) < (u64)(tick0)) ? ((u64)-1 - (u64)(tick0) + (u64)(tick1)) : ((u64)(tick1) - (u64)(tick0)))
+#define diff_msec(tick0, tick1)     (ticks_to_millisecs(diff_ticks(tick0, tick1)))
+#define diff_usec(tick0, tick1)     (ticks_to_microsecs(diff_ticks(tick0, tick1)))
+
+u64 gettime(void);
+
+#endif /* __HOST_LWP_WATCHDOG_H__ */
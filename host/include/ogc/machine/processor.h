@@ -0,0 +1,34 @@
+/*
+ * processor.h
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifndef __HOST_PROCESSOR_H__
+#define __HOST_PROCESSOR_H__
+
+/* Interrupt-disabled sections are serialized through the same global lock used by IRQ_Disable(). */
+#define _CPU_ISR_Disable(_isr_cookie)   do { (_isr_cookie) = IRQ_Disable(); } while(0)
+#define _CPU_ISR_Restore(_isr_cookie)   do { IRQ_Restore(_isr_cookie); } while(0)
+
+/* Hardware registers don't exist on the host. Writes are ignored. */
+void write32(u32 addr, u32 value);
+void mask32(u32 addr, u32 clear, u32 set);
+
+#endif /* __HOST_PROCESSOR_H__ */
@@ -0,0 +1,42 @@
+/*
+ * sha.h
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifndef __HOST_SHA_H__
+#define __HOST_SHA_H__
+
+#include <gccore.h>
+
+/* SHA engine replacement. It has its own software implementation, so results can still be checked against the one from sha1.c. */
+
+typedef struct {
+    u32 states[5];
+    u32 upper_length;
+    u32 lower_length;
+} sha_context;
+
+s32 SHA_Init(void);
+s32 SHA_Close(void);
+s32 SHA_InitializeContext(const sha_context *context);
+s32 SHA_Input(const sha_context *context, const void *data, const u32 data_size);
+s32 SHA_Calculate(const sha_context *context, const void *data, const u32 data_size, void *message_digest);
+
+#endif /* __HOST_SHA_H__ */
@@ -0,0 +1,31 @@
+/*
+ * runtimeiospatch.h
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifndef __HOST_RUNTIMEIOSPATCH_H__
+#define __HOST_RUNTIMEIOSPATCH_H__
+
+#include <gccore.h>
+
+/* Nothing to patch on the host. Always reports a single applied patch. */
+s32 IosPatch_RUNTIME(bool wii, bool sciifii, bool vwii, bool verbose);
+
+#endif /* __HOST_RUNTIMEIOSPATCH_H__ */
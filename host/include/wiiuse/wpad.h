@@ -0,0 +1,69 @@
+/*
+ * wpad.h
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifndef __HOST_WPAD_H__
+#define __HOST_WPAD_H__
+
+/* No controllers are available on the host. WPAD_ScanPads() always fails. */
+
+#define WPAD_CHAN_ALL                   -1
+#define WPAD_CHAN_0                     0
+#define WPAD_CHAN_3                     3
+
+#define WPAD_FMT_BTNS_ACC_IR            2
+#define WPAD_ERR_NONE                   0
+
+#define WPAD_BUTTON_2                   0x0001
+#define WPAD_BUTTON_1                   0x0002
+#define WPAD_BUTTON_B                   0x0004
+#define WPAD_BUTTON_A                   0x0008
+#define WPAD_BUTTON_MINUS               0x0010
+#define WPAD_BUTTON_HOME                0x0080
+#define WPAD_BUTTON_LEFT                0x0100
+#define WPAD_BUTTON_RIGHT               0x0200
+#define WPAD_BUTTON_DOWN                0x0400
+#define WPAD_BUTTON_UP                  0x0800
+#define WPAD_BUTTON_PLUS                0x1000
+
+#define WPAD_CLASSIC_BUTTON_UP          (0x0001 << 16)
+#define WPAD_CLASSIC_BUTTON_LEFT        (0x0002 << 16)
+#define WPAD_CLASSIC_BUTTON_ZR          (0x0004 << 16)
+#define WPAD_CLASSIC_BUTTON_X           (0x0008 << 16)
+#define WPAD_CLASSIC_BUTTON_A           (0x0010 << 16)
+#define WPAD_CLASSIC_BUTTON_Y           (0x0020 << 16)
+#define WPAD_CLASSIC_BUTTON_B           (0x0040 << 16)
+#define WPAD_CLASSIC_BUTTON_ZL          (0x0080 << 16)
+#define WPAD_CLASSIC_BUTTON_FULL_R      (0x0200 << 16)
+#define WPAD_CLASSIC_BUTTON_PLUS        (0x0400 << 16)
+#define WPAD_CLASSIC_BUTTON_HOME        (0x0800 << 16)
+#define WPAD_CLASSIC_BUTTON_MINUS       (0x1000 << 16)
+#define WPAD_CLASSIC_BUTTON_FULL_L      (0x2000 << 16)
+#define WPAD_CLASSIC_BUTTON_DOWN        (0x4000 << 16)
+#define WPAD_CLASSIC_BUTTON_RIGHT       (0x8000u << 16)
+
+s32 WPAD_Init(void);
+s32 WPAD_SetDataFormat(s32 chan, s32 fmt);
+s32 WPAD_ScanPads(void);
+u32 WPAD_ButtonsDown(int chan);
+u32 WPAD_ButtonsHeld(int chan);
+
+#endif /* __HOST_WPAD_H__ */
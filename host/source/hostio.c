@@ -0,0 +1,1271 @@
+/*
+ * hostio.c
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fcntl.h>
+#include <stdarg.h>
+#include <fat.h>
+#include <sdcard/wiisd_io.h>
+
+#include "utils.h"
+#include "iotrace.h"
+#include "hostio.h"
+
+#define HOST_IO_MAX_ISFS_FDS        16      /* IOS doesn't allow many more open files either. */
+#define HOST_IO_MAX_SD_FDS          0x1000  /* Highest host file descriptor that can be tracked as an SD card file. */
+
+#define HOST_IO_SD_PREFIX           "sd:/"
+
+#define HOST_IO_TITLE_TMD_FORMAT    "/title/%08x/%08x/content/title.tmd"
+
+#define HOST_IO_TRACE_MAX_LINE      0x200
+#define HOST_IO_FIT_MIN_EVENTS      2
+
+typedef struct {
+    bool used;
+    int fd;
+    u8 mode;
+    char path[ISFS_MAXPATH];
+} HostIoIsfsFile;
+
+typedef struct {
+    s32 fd;
+    void *buf;
+    u32 length;
+    isfscallback cb;
+    void *usrdata;
+} HostIoAsyncRead;
+
+typedef struct {
+    u32 start_usec;
+    u32 elapsed_usec;
+    u8 op;
+    char path[HOST_IO_MAX_PATH];
+    u32 offset;
+    u32 size;
+    s32 result;
+} HostIoTraceEvent;
+
+/// Running sums for a least squares fit of elapsed time over transfer size.
+typedef struct {
+    u32 count;
+    double sum_x, sum_y, sum_xx, sum_xy;
+} HostIoFitSums;
+
+/* Global variables. */
+
+static char g_hostIoNandRoot[HOST_IO_MAX_PATH] = {0};
+static __thread const char *g_hostIoThreadNandRoot = NULL;
+static char g_hostIoSdRoot[HOST_IO_MAX_PATH] = {0};
+
+static pthread_mutex_t g_hostIoMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static HostIoModel g_hostIoModels[HostIoDevice_Count] = {0};
+static HostIoStats g_hostIoStats[HostIoDevice_Count] = {0};
+static u32 g_hostIoFaultSeeds[HostIoDevice_Count] = {0};
+static u32 g_hostIoFaultCallCounts[HostIoDevice_Count] = {0};
+
+static HostIoIsfsFile g_hostIoIsfsFiles[HOST_IO_MAX_ISFS_FDS] = {0};
+static bool g_hostIoSdFds[HOST_IO_MAX_SD_FDS] = {0};
+
+static const char *g_hostIoDeviceNames[HostIoDevice_Count] = {
+    [HostIoDevice_Es]   = "es",
+    [HostIoDevice_Nand] = "nand",
+    [HostIoDevice_Sd]   = "sd"
+};
+
+static const char *g_hostIoTraceOpNames[IoTraceOp_Count] = {
+    [IoTraceOp_EsGetTmdSize] = "es_get_tmd_size",
+    [IoTraceOp_EsGetTmd]     = "es_get_tmd",
+    [IoTraceOp_IsfsOpen]     = "isfs_open",
+    [IoTraceOp_IsfsRead]     = "isfs_read",
+    [IoTraceOp_IsfsWrite]    = "isfs_write",
+    [IoTraceOp_IsfsSeek]     = "isfs_seek",
+    [IoTraceOp_SdOpen]       = "sd_open",
+    [IoTraceOp_SdRead]       = "sd_read",
+    [IoTraceOp_SdWrite]      = "sd_write",
+    [IoTraceOp_SdClose]      = "sd_close"
+};
+
+static const u8 g_hostIoTraceOpDevices[IoTraceOp_Count] = {
+    [IoTraceOp_EsGetTmdSize] = HostIoDevice_Es,
+    [IoTraceOp_EsGetTmd]     = HostIoDevice_Es,
+    [IoTraceOp_IsfsOpen]     = HostIoDevice_Nand,
+    [IoTraceOp_IsfsRead]     = HostIoDevice_Nand,
+    [IoTraceOp_IsfsWrite]    = HostIoDevice_Nand,
+    [IoTraceOp_IsfsSeek]     = HostIoDevice_Nand,
+    [IoTraceOp_SdOpen]       = HostIoDevice_Sd,
+    [IoTraceOp_SdRead]       = HostIoDevice_Sd,
+    [IoTraceOp_SdWrite]      = HostIoDevice_Sd,
+    [IoTraceOp_SdClose]      = HostIoDevice_Sd
+};
+
+/* Real libc functions. SD card paths are mapped through linker wrappers (see the host Makefile). */
+
+int __real_open(const char *path, int flags, ...);
+ssize_t __real_read(int fd, void *buf, size_t count);
+ssize_t __real_write(int fd, const void *buf, size_t count);
+int __real_close(int fd);
+FILE *__real_fopen(const char *path, const char *mode);
+int __real_stat(const char *path, struct stat *st);
+int __real_mkdir(const char *path, mode_t mode);
+int __real_rename(const char *old_path, const char *new_path);
+int __real_remove(const char *path);
+DIR *__real_opendir(const char *path);
+int __real_statvfs(const char *path, struct statvfs *buf);
+
+/* Function prototypes. */
+
+static void *hostIoAsyncReadThreadFunc(void *arg);
+
+static bool hostIoModelCall(u8 device, u32 size, bool write, bool transfer);
+static void hostIoCorruptBuffer(void *buf, u32 size, u32 seed);
+
+static s32 hostIoGetIsfsFd(HostIoIsfsFile **out_file, s32 fd);
+static bool hostIoSdMapPath(const char *path, char *out, size_t out_size);
+
+static void hostIoConvertTmd(u8 *stmd, u32 size);
+
+static bool hostIoParseTraceLine(char *line, HostIoTraceEvent *out);
+static bool hostIoReplayEvent(const HostIoTraceEvent *event, u8 *buf, u32 buf_size);
+
+static void hostIoSleep(u64 usec);
+
+void hostIoSetNandRoot(const char *path)
+{
+    snprintf(g_hostIoNandRoot, sizeof(g_hostIoNandRoot), "%s", (path ? path : ""));
+}
+
+void hostIoSetThreadNandRoot(const char *path)
+{
+    g_hostIoThreadNandRoot = path;
+}
+
+void hostIoSetSdRoot(const char *path)
+{
+    snprintf(g_hostIoSdRoot, sizeof(g_hostIoSdRoot), "%s", (path ? path : ""));
+}
+
+bool hostIoResolvePath(u8 device, const char *path, char *out, size_t out_size)
+{
+    if (!path || !out || !out_size) return false;
+
+    const char *root = NULL;
+    int len = 0;
+
+    switch(device)
+    {
+        case HostIoDevice_Es:
+        case HostIoDevice_Nand:
+            root = (g_hostIoThreadNandRoot ? g_hostIoThreadNandRoot : g_hostIoNandRoot);
+            if (!*root || *path != '/') return false;
+            len = snprintf(out, out_size, "%s%s", root, path);
+            break;
+        case HostIoDevice_Sd:
+            if (strncmp(path, HOST_IO_SD_PREFIX, strlen(HOST_IO_SD_PREFIX)) != 0)
+            {
+                len = snprintf(out, out_size, "%s", path);
+                break;
+            }
+
+            if (!*g_hostIoSdRoot) return false;
+            len = snprintf(out, out_size, "%s/%s", g_hostIoSdRoot, path + strlen(HOST_IO_SD_PREFIX));
+            break;
+        default:
+            return false;
+    }
+
+    return (len > 0 && (size_t)len < out_size);
+}
+
+bool hostIoParseModel(const char *str, HostIoModel *out)
+{
+    if (!str || !out) return false;
+
+    char buf[0x100] = {0}, *token = NULL, *saveptr = NULL;
+    HostIoModel model = {0};
+
+    if (snprintf(buf, sizeof(buf), "%s", str) >= (int)sizeof(buf)) return false;
+
+    for(token = strtok_r(buf, ",", &saveptr); token; token = strtok_r(NULL, ",", &saveptr))
+    {
+        char *value = strchr(token, '='), *end = NULL;
+        unsigned long num = 0;
+
+        if (!value) return false;
+        *value++ = '\0';
+
+        if (!strcmp(token, "fault"))
+        {
+            if (!strcmp(value, "error"))
+            {
+                model.fault_type = HostIoFaultType_Error;
+            } else
+            if (!strcmp(value, "corrupt"))
+            {
+                model.fault_type = HostIoFaultType_Corrupt;
+            } else {
+                return false;
+            }
+
+            continue;
+        }
+
+        if (!strcmp(token, "fault-op"))
+        {
+            if (!strcmp(value, "any"))
+            {
+                model.fault_op = HostIoFaultOp_Any;
+            } else
+            if (!strcmp(value, "read"))
+            {
+                model.fault_op = HostIoFaultOp_Read;
+            } else
+            if (!strcmp(value, "write"))
+            {
+                model.fault_op = HostIoFaultOp_Write;
+            } else {
+                return false;
+            }
+
+            continue;
+        }
+
+        num = strtoul(value, &end, 0);
+        if (!*value || *end || num > 0xFFFFFFFFUL) return false;
+
+        if (!strcmp(token, "latency"))
+        {
+            model.latency_usec = (u32)num;
+        } else
+        if (!strcmp(token, "bandwidth"))
+        {
+            model.bandwidth_kib = (u32)num;
+        } else
+        if (!strcmp(token, "write-bandwidth"))
+        {
+            model.write_bandwidth_kib = (u32)num;
+        } else
+        if (!strcmp(token, "page"))
+        {
+            model.page_size = (u32)num;
+        } else
+        if (!strcmp(token, "fault-nth"))
+        {
+            model.fault_nth = (u32)num;
+        } else
+        if (!strcmp(token, "fault-every"))
+        {
+            model.fault_every = (u32)num;
+        } else
+        if (!strcmp(token, "fault-rate") && num <= 100)
+        {
+            model.fault_percent = (u32)num;
+        } else {
+            return false;
+        }
+    }
+
+    memcpy(out, &model, sizeof(HostIoModel));
+
+    return true;
+}
+
+const char *hostIoGetDeviceName(u8 device)
+{
+    return (device < HostIoDevice_Count ? g_hostIoDeviceNames[device] : NULL);
+}
+
+u8 hostIoGetDeviceByName(const char *name, size_t name_len)
+{
+    for(u8 i = 0; i < HostIoDevice_Count; i++)
+    {
+        if (strlen(g_hostIoDeviceNames[i]) == name_len && !strncmp(g_hostIoDeviceNames[i], name, name_len)) return i;
+    }
+
+    return HostIoDevice_Count;
+}
+
+void hostIoSetModel(u8 device, const HostIoModel *model)
+{
+    if (device >= HostIoDevice_Count || !model) return;
+
+    pthread_mutex_lock(&g_hostIoMutex);
+    memcpy(&(g_hostIoModels[device]), model, sizeof(HostIoModel));
+    pthread_mutex_unlock(&g_hostIoMutex);
+}
+
+void hostIoGetModel(u8 device, HostIoModel *out)
+{
+    if (device >= HostIoDevice_Count || !out) return;
+
+    pthread_mutex_lock(&g_hostIoMutex);
+    memcpy(out, &(g_hostIoModels[device]), sizeof(HostIoModel));
+    pthread_mutex_unlock(&g_hostIoMutex);
+}
+
+void hostIoFormatModel(const HostIoModel *model, char *out, size_t out_size)
+{
+    if (!model || !out || !out_size) return;
+
+    snprintf(out, out_size, "latency=%u,bandwidth=%u,write-bandwidth=%u,page=%u,fault-nth=%u,fault-every=%u,fault-rate=%u,fault=%s,fault-op=%s", model->latency_usec, \
+             model->bandwidth_kib, model->write_bandwidth_kib, model->page_size, model->fault_nth, model->fault_every, model->fault_percent, \
+             (model->fault_type == HostIoFaultType_Corrupt ? "corrupt" : "error"), \
+             (model->fault_op == HostIoFaultOp_Read ? "read" : (model->fault_op == HostIoFaultOp_Write ? "write" : "any")));
+}
+
+void hostIoGetStats(u8 device, HostIoStats *out)
+{
+    if (device >= HostIoDevice_Count || !out) return;
+
+    pthread_mutex_lock(&g_hostIoMutex);
+    memcpy(out, &(g_hostIoStats[device]), sizeof(HostIoStats));
+    pthread_mutex_unlock(&g_hostIoMutex);
+}
+
+void hostIoResetStats(void)
+{
+    pthread_mutex_lock(&g_hostIoMutex);
+    memset(g_hostIoStats, 0, sizeof(g_hostIoStats));
+    memset(g_hostIoFaultSeeds, 0, sizeof(g_hostIoFaultSeeds));
+    memset(g_hostIoFaultCallCounts, 0, sizeof(g_hostIoFaultCallCounts));
+    pthread_mutex_unlock(&g_hostIoMutex);
+}
+
+void hostIoPrintStats(void)
+{
+    bool header_printed = false;
+
+    for(u8 i = 0; i < HostIoDevice_Count; i++)
+    {
+        HostIoStats stats = {0};
+
+        hostIoGetStats(i, &stats);
+        if (!stats.call_count) continue;
+
+        if (!header_printed)
+        {
+            printf("%-6s | %8s | %9s | %6s | %12s | %12s\n", "Device", "Calls", "Transfers", "Faults", "Bytes", "Modeled (ms)");
+            printf("-------+----------+-----------+--------+--------------+-------------\n");
+            header_printed = true;
+        }
+
+        printf("%-6s | %8u | %9u | %6u | %12llu | %12llu\n", g_hostIoDeviceNames[i], stats.call_count, stats.transfer_count, stats.fault_count, stats.byte_count, \
+               stats.modeled_usec / 1000);
+    }
+
+    if (header_printed) printf("\n");
+}
+
+bool hostIoReplayTrace(const char *path)
+{
+    if (!path || !*path) return false;
+
+    FILE *fp = NULL;
+    char line[HOST_IO_TRACE_MAX_LINE] = {0};
+    HostIoTraceEvent event = {0};
+    u8 *buf = NULL;
+    u32 buf_size = UTILS_MAX_IO_CHUNK_SIZE, line_num = 0, event_count = 0;
+    u32 op_counts[IoTraceOp_Count] = {0};
+    u64 recorded_usec[IoTraceOp_Count] = {0}, replayed_usec[IoTraceOp_Count] = {0};
+    bool success = false;
+
+    if (!(fp = fopen(path, "r")))
+    {
+        ERROR_MSG("Failed to open \"%s\"! (%d).", path, errno);
+        return false;
+    }
+
+    if (!(buf = (u8*)utilsAllocateMemory(buf_size)))
+    {
+        ERROR_MSG("Failed to allocate memory for replay buffer!");
+        goto out;
+    }
+
+    while(fgets(line, sizeof(line), fp))
+    {
+        u64 start_time = 0;
+
+        line_num++;
+
+        /* Skip the header and empty lines. */
+        if (line_num == 1 || !*utilsTrimString(line)) continue;
+
+        if (!hostIoParseTraceLine(line, &event))
+        {
+            ERROR_MSG("Invalid trace event at line %u!", line_num);
+            goto out;
+        }
+
+        start_time = gettime();
+        if (!hostIoReplayEvent(&event, buf, buf_size)) goto out;
+
+        op_counts[event.op]++;
+        recorded_usec[event.op] += event.elapsed_usec;
+        replayed_usec[event.op] += diff_usec(start_time, gettime());
+        event_count++;
+    }
+
+    printf("Replayed %u %s from \"%s\".\n\n", event_count, (event_count == 1 ? "event" : "events"), path);
+
+    printf("%-15s | %6s | %13s | %13s | %7s\n", "Operation", "Count", "Recorded (ms)", "Replayed (ms)", "Ratio");
+    printf("----------------+--------+---------------+---------------+--------\n");
+
+    for(u8 i = 0; i < IoTraceOp_Count; i++)
+    {
+        if (!op_counts[i]) continue;
+
+        printf("%-15s | %6u | %13llu | %13llu | %3llu.%02llu\n", g_hostIoTraceOpNames[i], op_counts[i], recorded_usec[i] / 1000, replayed_usec[i] / 1000, \
+               (recorded_usec[i] ? (replayed_usec[i] / recorded_usec[i]) : 0), (recorded_usec[i] ? (((replayed_usec[i] * 100) / recorded_usec[i]) % 100) : 0));
+    }
+
+    printf("\n");
+
+    success = true;
+
+out:
+    if (buf) utilsFreeMemory(buf);
+
+    fclose(fp);
+
+    return success;
+}
+
+bool hostIoFitTrace(const char *path)
+{
+    if (!path || !*path) return false;
+
+    FILE *fp = NULL;
+    char line[HOST_IO_TRACE_MAX_LINE] = {0}, model_str[0x100] = {0};
+    HostIoTraceEvent event = {0};
+    HostIoFitSums sums[HostIoDevice_Count][2] = {0};
+    u32 line_num = 0;
+    bool fitted = false;
+
+    if (!(fp = fopen(path, "r")))
+    {
+        ERROR_MSG("Failed to open \"%s\"! (%d).", path, errno);
+        return false;
+    }
+
+    /* Only successful data transfers are used. TMD requests count as reads. */
+    while(fgets(line, sizeof(line), fp))
+    {
+        HostIoFitSums *sum = NULL;
+        bool write = false;
+
+        line_num++;
+        if (line_num == 1 || !*utilsTrimString(line)) continue;
+
+        if (!hostIoParseTraceLine(line, &event))
+        {
+            ERROR_MSG("Invalid trace event at line %u!", line_num);
+            fclose(fp);
+            return false;
+        }
+
+        if (event.result < 0 || !event.size) continue;
+
+        switch(event.op)
+        {
+            case IoTraceOp_IsfsWrite:
+            case IoTraceOp_SdWrite:
+                write = true;
+                break;
+            case IoTraceOp_EsGetTmd:
+            case IoTraceOp_IsfsRead:
+            case IoTraceOp_SdRead:
+                break;
+            default:
+                continue;
+        }
+
+        sum = &(sums[g_hostIoTraceOpDevices[event.op]][write ? 1 : 0]);
+        sum->count++;
+        sum->sum_x += (double)event.size;
+        sum->sum_y += (double)event.elapsed_usec;
+        sum->sum_xx += ((double)event.size * (double)event.size);
+        sum->sum_xy += ((double)event.size * (double)event.elapsed_usec);
+    }
+
+    fclose(fp);
+
+    for(u8 i = 0; i < HostIoDevice_Count; i++)
+    {
+        HostIoModel model = {0};
+        double latency = 0.0;
+        u32 bandwidth[2] = {0};
+        bool device_fitted = false;
+
+        hostIoGetModel(i, &model);
+
+        for(u8 j = 0; j < 2; j++)
+        {
+            HostIoFitSums *sum = &(sums[i][j]);
+            double denom = ((sum->count * sum->sum_xx) - (sum->sum_x * sum->sum_x)), slope = 0.0, intercept = 0.0;
+
+            /* Transfers with a single size can't tell latency and bandwidth apart. */
+            if (sum->count < HOST_IO_FIT_MIN_EVENTS || denom <= 0.0) continue;
+
+            slope = (((sum->count * sum->sum_xy) - (sum->sum_x * sum->sum_y)) / denom);
+            intercept = ((sum->sum_y - (slope * sum->sum_x)) / sum->count);
+
+            /* slope is in usec per byte. */
+            if (slope > 0.0) bandwidth[j] = (u32)(1000000.0 / (slope * 1024.0));
+
+            /* Reads set the latency, unless there are only writes. */
+            if (!j || !device_fitted) latency = (intercept > 0.0 ? intercept : 0.0);
+
+            device_fitted = true;
+        }
+
+        if (!device_fitted) continue;
+
+        model.latency_usec = (u32)latency;
+        model.bandwidth_kib = bandwidth[0];
+        model.write_bandwidth_kib = bandwidth[1];
+        hostIoSetModel(i, &model);
+
+        hostIoFormatModel(&model, model_str, sizeof(model_str));
+        printf("model=%s:%s\n", g_hostIoDeviceNames[i], model_str);
+
+        fitted = true;
+    }
+
+    if (!fitted) ERROR_MSG("Not enough data transfers in \"%s\" to fit any model!", path);
+
+    printf("\n");
+
+    return fitted;
+}
+
+/* ES. */
+
+s32 ES_GetTitleContentsCount(u64 titleID, u32 *num)
+{
+    u32 size = 0;
+    u8 *stmd = NULL;
+    s32 ret = 0;
+
+    if (!num) return HOST_IO_FS_EINVAL;
+
+    if ((ret = ES_GetStoredTMDSize(titleID, &size)) < 0) return ret;
+
+    if (!(stmd = (u8*)malloc(size))) return ISFS_ENOMEM;
+
+    if ((ret = ES_GetStoredTMD(titleID, (signed_blob*)stmd, size)) >= 0) *num = utilsGetTMDFromSignedBlob((signed_blob*)stmd)->num_contents;
+
+    free(stmd);
+
+    return ret;
+}
+
+s32 ES_GetStoredTMDSize(u64 titleID, u32 *size)
+{
+    char tmd_path[ISFS_MAXPATH] = {0}, path[HOST_IO_MAX_PATH] = {0};
+    struct stat st = {0};
+
+    if (!size) return HOST_IO_FS_EINVAL;
+
+    hostIoModelCall(HostIoDevice_Es, 0, false, false);
+
+    snprintf(tmd_path, sizeof(tmd_path), HOST_IO_TITLE_TMD_FORMAT, TITLE_UPPER(titleID), TITLE_LOWER(titleID));
+    if (!hostIoResolvePath(HostIoDevice_Es, tmd_path, path, sizeof(path)) || __real_stat(path, &st) != 0) return HOST_IO_FS_ENOENT;
+
+    *size = (u32)st.st_size;
+
+    return IPC_OK;
+}
+
+s32 ES_GetStoredTMD(u64 titleID, signed_blob *stmd, u32 size)
+{
+    char tmd_path[ISFS_MAXPATH] = {0}, path[HOST_IO_MAX_PATH] = {0};
+    int fd = -1;
+    s32 ret = IPC_OK;
+
+    if (!stmd || !size) return HOST_IO_FS_EINVAL;
+
+    snprintf(tmd_path, sizeof(tmd_path), HOST_IO_TITLE_TMD_FORMAT, TITLE_UPPER(titleID), TITLE_LOWER(titleID));
+    if (!hostIoResolvePath(HostIoDevice_Es, tmd_path, path, sizeof(path)) || (fd = __real_open(path, O_RDONLY)) < 0) return HOST_IO_FS_ENOENT;
+
+    if (__real_read(fd, stmd, size) != (ssize_t)size)
+    {
+        ret = HOST_IO_FS_EINVAL;
+        goto out;
+    }
+
+    if (!hostIoModelCall(HostIoDevice_Es, size, false, true))
+    {
+        ret = HOST_IO_FS_ECORRUPT;
+        goto out;
+    }
+
+    /* ES hands out big-endian TMDs. Convert it, so that its fields can be accessed directly. */
+    hostIoConvertTmd((u8*)stmd, size);
+
+out:
+    __real_close(fd);
+
+    return ret;
+}
+
+s32 ES_GetDeviceID(u32 *device_id)
+{
+    if (!device_id) return HOST_IO_FS_EINVAL;
+    *device_id = HOST_IO_DEVICE_ID;
+    return IPC_OK;
+}
+
+/* ISFS. */
+
+s32 ISFS_Initialize(void)
+{
+    return IPC_OK;
+}
+
+s32 ISFS_Deinitialize(void)
+{
+    for(u32 i = 0; i < HOST_IO_MAX_ISFS_FDS; i++)
+    {
+        if (g_hostIoIsfsFiles[i].used) ISFS_Close((s32)i);
+    }
+
+    return IPC_OK;
+}
+
+s32 ISFS_Open(const char *filepath, u8 mode)
+{
+    char path[HOST_IO_MAX_PATH] = {0};
+    int flags = 0, fd = -1;
+    s32 ret = HOST_IO_FS_EMAXFD;
+
+    if (!filepath || !mode || mode > ISFS_OPEN_RW || strlen(filepath) >= ISFS_MAXPATH) return HOST_IO_FS_EINVAL;
+
+    hostIoModelCall(HostIoDevice_Nand, 0, false, false);
+
+    if (!hostIoResolvePath(HostIoDevice_Nand, filepath, path, sizeof(path))) return HOST_IO_FS_ENOENT;
+
+    flags = (mode == ISFS_OPEN_RW ? O_RDWR : (mode == ISFS_OPEN_WRITE ? O_WRONLY : O_RDONLY));
+    if ((fd = __real_open(path, flags)) < 0) return (errno == ENOENT ? HOST_IO_FS_ENOENT : HOST_IO_FS_EINVAL);
+
+    pthread_mutex_lock(&g_hostIoMutex);
+
+    for(u32 i = 0; i < HOST_IO_MAX_ISFS_FDS; i++)
+    {
+        HostIoIsfsFile *file = &(g_hostIoIsfsFiles[i]);
+        if (file->used) continue;
+
+        file->used = true;
+        file->fd = fd;
+        file->mode = mode;
+        snprintf(file->path, sizeof(file->path), "%s", filepath);
+
+        ret = (s32)i;
+        break;
+    }
+
+    pthread_mutex_unlock(&g_hostIoMutex);
+
+    if (ret < 0) __real_close(fd);
+
+    return ret;
+}
+
+s32 ISFS_Close(s32 fd)
+{
+    HostIoIsfsFile *file = NULL;
+    s32 ret = hostIoGetIsfsFd(&file, fd);
+    if (ret < 0) return ret;
+
+    __real_close(file->fd);
+
+    pthread_mutex_lock(&g_hostIoMutex);
+    memset(file, 0, sizeof(HostIoIsfsFile));
+    pthread_mutex_unlock(&g_hostIoMutex);
+
+    return IPC_OK;
+}
+
+s32 ISFS_Read(s32 fd, void *buffer, u32 length)
+{
+    HostIoIsfsFile *file = NULL;
+    ssize_t read_size = 0;
+    s32 ret = hostIoGetIsfsFd(&file, fd);
+
+    if (ret < 0) return ret;
+    if (!buffer || !(file->mode & ISFS_OPEN_READ)) return HOST_IO_FS_EINVAL;
+
+    if ((read_size = __real_read(file->fd, buffer, length)) < 0) return HOST_IO_FS_ECORRUPT;
+
+    if (!hostIoModelCall(HostIoDevice_Nand, (u32)read_size, false, true))
+    {
+        if (g_hostIoModels[HostIoDevice_Nand].fault_type != HostIoFaultType_Corrupt) return HOST_IO_FS_ECORRUPT;
+        hostIoCorruptBuffer(buffer, (u32)read_size, g_hostIoStats[HostIoDevice_Nand].fault_count);
+    }
+
+    return (s32)read_size;
+}
+
+s32 ISFS_ReadAsync(s32 fd, void *buffer, u32 length, isfscallback cb, void *usrdata)
+{
+    HostIoIsfsFile *file = NULL;
+    HostIoAsyncRead *req = NULL;
+    pthread_t thread;
+    s32 ret = hostIoGetIsfsFd(&file, fd);
+
+    if (ret < 0) return ret;
+    if (!buffer || !cb) return HOST_IO_FS_EINVAL;
+
+    if (!(req = (HostIoAsyncRead*)malloc(sizeof(HostIoAsyncRead)))) return ISFS_ENOMEM;
+
+    req->fd = fd;
+    req->buf = buffer;
+    req->length = length;
+    req->cb = cb;
+    req->usrdata = usrdata;
+
+    /* The read runs on its own thread, which lets it overlap with whatever the caller does next, just like an IOS request. */
+    if (pthread_create(&thread, NULL, hostIoAsyncReadThreadFunc, req) != 0)
+    {
+        free(req);
+        return ISFS_ENOMEM;
+    }
+
+    pthread_detach(thread);
+
+    return IPC_OK;
+}
+
+s32 ISFS_Write(s32 fd, const void *buffer, u32 length)
+{
+    HostIoIsfsFile *file = NULL;
+    ssize_t write_size = 0;
+    u8 *corrupted = NULL;
+    s32 ret = hostIoGetIsfsFd(&file, fd);
+
+    if (ret < 0) return ret;
+    if (!buffer || !(file->mode & ISFS_OPEN_WRITE)) return HOST_IO_FS_EINVAL;
+
+    if (!hostIoModelCall(HostIoDevice_Nand, length, true, true))
+    {
+        if (g_hostIoModels[HostIoDevice_Nand].fault_type != HostIoFaultType_Corrupt) return HOST_IO_FS_ECORRUPT;
+
+        /* Silently store a corrupted copy. Only a read-back check can catch this. */
+        if (length && (corrupted = (u8*)malloc(length)))
+        {
+            memcpy(corrupted, buffer, length);
+            hostIoCorruptBuffer(corrupted, length, g_hostIoStats[HostIoDevice_Nand].fault_count);
+            buffer = corrupted;
+        }
+    }
+
+    write_size = __real_write(file->fd, buffer, length);
+
+    if (corrupted) free(corrupted);
+
+    return (write_size < 0 ? HOST_IO_FS_ECORRUPT : (s32)write_size);
+}
+
+s32 ISFS_Seek(s32 fd, s32 where, s32 whence)
+{
+    HostIoIsfsFile *file = NULL;
+    off_t pos = 0;
+    s32 ret = hostIoGetIsfsFd(&file, fd);
+
+    if (ret < 0) return ret;
+
+    hostIoModelCall(HostIoDevice_Nand, 0, false, false);
+
+    if ((pos = lseek(file->fd, (off_t)where, whence)) < 0) return HOST_IO_FS_EINVAL;
+
+    return (s32)pos;
+}
+
+s32 ISFS_GetFileStats(s32 fd, fstats *status)
+{
+    HostIoIsfsFile *file = NULL;
+    struct stat st = {0};
+    s32 ret = hostIoGetIsfsFd(&file, fd);
+
+    if (ret < 0) return ret;
+    if (!status || fstat(file->fd, &st) != 0) return HOST_IO_FS_EINVAL;
+
+    status->file_length = (u32)st.st_size;
+    status->file_pos = (u32)lseek(file->fd, 0, SEEK_CUR);
+
+    return IPC_OK;
+}
+
+s32 ISFS_CreateFile(const char *filepath, u8 attributes, u8 owner_perm, u8 group_perm, u8 other_perm)
+{
+    char path[HOST_IO_MAX_PATH] = {0};
+    int fd = -1;
+
+    (void)attributes;
+    (void)owner_perm;
+    (void)group_perm;
+    (void)other_perm;
+
+    if (!filepath || strlen(filepath) >= ISFS_MAXPATH || !hostIoResolvePath(HostIoDevice_Nand, filepath, path, sizeof(path))) return HOST_IO_FS_EINVAL;
+
+    hostIoModelCall(HostIoDevice_Nand, 0, false, false);
+
+    if ((fd = __real_open(path, O_WRONLY | O_CREAT | O_EXCL, 0644)) < 0) return (errno == EEXIST ? HOST_IO_FS_EEXIST : HOST_IO_FS_ENOENT);
+
+    __real_close(fd);
+
+    return IPC_OK;
+}
+
+s32 ISFS_Delete(const char *filepath)
+{
+    char path[HOST_IO_MAX_PATH] = {0};
+
+    if (!filepath || !hostIoResolvePath(HostIoDevice_Nand, filepath, path, sizeof(path))) return HOST_IO_FS_EINVAL;
+
+    hostIoModelCall(HostIoDevice_Nand, 0, false, false);
+
+    return (__real_remove(path) == 0 ? IPC_OK : HOST_IO_FS_ENOENT);
+}
+
+s32 ISFS_GetAttr(const char *filepath, u32 *ownerID, u16 *groupID, u8 *attributes, u8 *ownerperm, u8 *groupperm, u8 *otherperm)
+{
+    char path[HOST_IO_MAX_PATH] = {0};
+    struct stat st = {0};
+
+    if (!filepath || !ownerID || !groupID || !attributes || !ownerperm || !groupperm || !otherperm || \
+        !hostIoResolvePath(HostIoDevice_Nand, filepath, path, sizeof(path))) return HOST_IO_FS_EINVAL;
+
+    if (__real_stat(path, &st) != 0) return HOST_IO_FS_ENOENT;
+
+    /* Local files don't have NAND attributes. Report the ones used by title contents. */
+    *ownerID = 0;
+    *groupID = 0;
+    *attributes = 0;
+    *ownerperm = 3;
+    *groupperm = 3;
+    *otherperm = 1;
+
+    return IPC_OK;
+}
+
+s32 ISFS_SetAttr(const char *filepath, u32 ownerID, u16 groupID, u8 attributes, u8 ownerperm, u8 groupperm, u8 otherperm)
+{
+    char path[HOST_IO_MAX_PATH] = {0};
+    struct stat st = {0};
+
+    (void)ownerID;
+    (void)groupID;
+    (void)attributes;
+    (void)ownerperm;
+    (void)groupperm;
+    (void)otherperm;
+
+    if (!filepath || !hostIoResolvePath(HostIoDevice_Nand, filepath, path, sizeof(path))) return HOST_IO_FS_EINVAL;
+
+    return (__real_stat(path, &st) == 0 ? IPC_OK : HOST_IO_FS_ENOENT);
+}
+
+/* SD card. libfat is replaced by path mapping, while transfers go through the SD card model. */
+
+static bool hostIoSdShutdown(void)
+{
+    return true;
+}
+
+const DISC_INTERFACE __io_wiisd = { hostIoSdShutdown };
+
+bool fatMountSimple(const char *name, const DISC_INTERFACE *interface)
+{
+    struct stat st = {0};
+    (void)interface;
+    return (name && !strcmp(name, "sd") && *g_hostIoSdRoot && __real_stat(g_hostIoSdRoot, &st) == 0 && S_ISDIR(st.st_mode));
+}
+
+void fatUnmount(const char *name)
+{
+    (void)name;
+}
+
+int __wrap_open(const char *path, int flags, ...)
+{
+    char mapped[HOST_IO_MAX_PATH] = {0};
+    mode_t mode = 0;
+    int fd = -1;
+    bool sd = (path && !strncmp(path, HOST_IO_SD_PREFIX, strlen(HOST_IO_SD_PREFIX)));
+
+    if (flags & O_CREAT)
+    {
+        va_list args;
+        va_start(args, flags);
+        mode = (mode_t)va_arg(args, int);
+        va_end(args);
+    }
+
+    if (!hostIoSdMapPath(path, mapped, sizeof(mapped))) return -1;
+
+    if (sd) hostIoModelCall(HostIoDevice_Sd, 0, false, false);
+
+    fd = __real_open(mapped, flags, mode);
+
+    if (sd && fd >= 0 && fd < HOST_IO_MAX_SD_FDS) g_hostIoSdFds[fd] = true;
+
+    return fd;
+}
+
+ssize_t __wrap_read(int fd, void *buf, size_t count)
+{
+    ssize_t ret = __real_read(fd, buf, count);
+
+    if (fd < 0 || fd >= HOST_IO_MAX_SD_FDS || !g_hostIoSdFds[fd] || ret < 0) return ret;
+
+    if (!hostIoModelCall(HostIoDevice_Sd, (u32)ret, false, true))
+    {
+        if (g_hostIoModels[HostIoDevice_Sd].fault_type != HostIoFaultType_Corrupt)
+        {
+            errno = EIO;
+            return -1;
+        }
+
+        hostIoCorruptBuffer(buf, (u32)ret, g_hostIoStats[HostIoDevice_Sd].fault_count);
+    }
+
+    return ret;
+}
+
+ssize_t __wrap_write(int fd, const void *buf, size_t count)
+{
+    u8 *corrupted = NULL;
+    ssize_t ret = 0;
+
+    if (fd < 0 || fd >= HOST_IO_MAX_SD_FDS || !g_hostIoSdFds[fd]) return __real_write(fd, buf, count);
+
+    if (!hostIoModelCall(HostIoDevice_Sd, (u32)count, true, true))
+    {
+        if (g_hostIoModels[HostIoDevice_Sd].fault_type != HostIoFaultType_Corrupt)
+        {
+            errno = EIO;
+            return -1;
+        }
+
+        if (count && (corrupted = (u8*)malloc(count)))
+        {
+            memcpy(corrupted, buf, count);
+            hostIoCorruptBuffer(corrupted, (u32)count, g_hostIoStats[HostIoDevice_Sd].fault_count);
+            buf = corrupted;
+        }
+    }
+
+    ret = __real_write(fd, buf, count);
+
+    if (corrupted) free(corrupted);
+
+    return ret;
+}
+
+int __wrap_close(int fd)
+{
+    if (fd >= 0 && fd < HOST_IO_MAX_SD_FDS && g_hostIoSdFds[fd])
+    {
+        g_hostIoSdFds[fd] = false;
+        hostIoModelCall(HostIoDevice_Sd, 0, false, false);
+    }
+
+    return __real_close(fd);
+}
+
+FILE *__wrap_fopen(const char *path, const char *mode)
+{
+    char mapped[HOST_IO_MAX_PATH] = {0};
+    return (hostIoSdMapPath(path, mapped, sizeof(mapped)) ? __real_fopen(mapped, mode) : NULL);
+}
+
+int __wrap_stat(const char *path, struct stat *st)
+{
+    char mapped[HOST_IO_MAX_PATH] = {0};
+    return (hostIoSdMapPath(path, mapped, sizeof(mapped)) ? __real_stat(mapped, st) : -1);
+}
+
+int __wrap_mkdir(const char *path, mode_t mode)
+{
+    char mapped[HOST_IO_MAX_PATH] = {0};
+    return (hostIoSdMapPath(path, mapped, sizeof(mapped)) ? __real_mkdir(mapped, mode) : -1);
+}
+
+int __wrap_rename(const char *old_path, const char *new_path)
+{
+    char old_mapped[HOST_IO_MAX_PATH] = {0}, new_mapped[HOST_IO_MAX_PATH] = {0};
+    return ((hostIoSdMapPath(old_path, old_mapped, sizeof(old_mapped)) && hostIoSdMapPath(new_path, new_mapped, sizeof(new_mapped))) ? \
+            __real_rename(old_mapped, new_mapped) : -1);
+}
+
+int __wrap_remove(const char *path)
+{
+    char mapped[HOST_IO_MAX_PATH] = {0};
+    return (hostIoSdMapPath(path, mapped, sizeof(mapped)) ? __real_remove(mapped) : -1);
+}
+
+DIR *__wrap_opendir(const char *path)
+{
+    char mapped[HOST_IO_MAX_PATH] = {0};
+    return (hostIoSdMapPath(path, mapped, sizeof(mapped)) ? __real_opendir(mapped) : NULL);
+}
+
+int __wrap_statvfs(const char *path, struct statvfs *buf)
+{
+    char mapped[HOST_IO_MAX_PATH] = {0};
+    return (hostIoSdMapPath(path, mapped, sizeof(mapped)) ? __real_statvfs(mapped, buf) : -1);
+}
+
+static void *hostIoAsyncReadThreadFunc(void *arg)
+{
+    HostIoAsyncRead *req = (HostIoAsyncRead*)arg;
+    s32 ret = ISFS_Read(req->fd, req->buf, req->length);
+    u32 level = 0;
+
+    /* IOS callbacks run from the IPC interrupt handler. */
+    level = IRQ_Disable();
+    req->cb(ret, req->usrdata);
+    IRQ_Restore(level);
+
+    free(req);
+
+    return NULL;
+}
+
+static bool hostIoModelCall(u8 device, u32 size, bool write, bool transfer)
+{
+    HostIoModel *model = &(g_hostIoModels[device]);
+    HostIoStats *stats = &(g_hostIoStats[device]);
+    u64 cost_usec = 0;
+    u32 bandwidth = 0;
+    bool fault = false;
+
+    pthread_mutex_lock(&g_hostIoMutex);
+
+    stats->call_count++;
+    cost_usec = model->latency_usec;
+
+    if (transfer)
+    {
+        u64 rounded_size = size;
+
+        stats->transfer_count++;
+
+        stats->byte_count += size;
+
+        if (model->page_size > 1) rounded_size = (((u64)size + model->page_size - 1) / model->page_size) * model->page_size;
+
+        bandwidth = ((write && model->write_bandwidth_kib) ? model->write_bandwidth_kib : model->bandwidth_kib);
+        if (bandwidth) cost_usec += ((rounded_size * 1000000) / ((u64)bandwidth * 1024));
+
+        /* Only calls matching the fault operation type are counted. */
+        if (model->fault_op == HostIoFaultOp_Any || model->fault_op == (write ? HostIoFaultOp_Write : HostIoFaultOp_Read))
+        {
+            u32 call_idx = ++(g_hostIoFaultCallCounts[device]);
+
+            if (model->fault_nth && call_idx == model->fault_nth) fault = true;
+            if (model->fault_every && (call_idx % model->fault_every) == 0) fault = true;
+
+            if (model->fault_percent)
+            {
+                /* Fixed seed LCG, so that faults are reproducible. */
+                u32 *seed = &(g_hostIoFaultSeeds[device]);
+                *seed = ((*seed * 1103515245) + 12345 + device);
+                if (((*seed >> 16) % 100) < model->fault_percent) fault = true;
+            }
+        }
+
+        if (fault) stats->fault_count++;
+    }
+
+    stats->modeled_usec += cost_usec;
+
+    pthread_mutex_unlock(&g_hostIoMutex);
+
+    hostIoSleep(cost_usec);
+
+    return !fault;
+}
+
+static void hostIoCorruptBuffer(void *buf, u32 size, u32 seed)
+{
+    if (!buf || !size) return;
+    ((u8*)buf)[(seed * 2654435761U) % size] ^= (u8)(1 << (seed & 7));
+}
+
+static s32 hostIoGetIsfsFd(HostIoIsfsFile **out_file, s32 fd)
+{
+    if (fd < 0 || fd >= HOST_IO_MAX_ISFS_FDS || !g_hostIoIsfsFiles[fd].used) return HOST_IO_FS_EINVAL;
+    *out_file = &(g_hostIoIsfsFiles[fd]);
+    return IPC_OK;
+}
+
+static bool hostIoSdMapPath(const char *path, char *out, size_t out_size)
+{
+    if (!path)
+    {
+        errno = EFAULT;
+        return false;
+    }
+
+    if (!hostIoResolvePath(HostIoDevice_Sd, path, out, out_size))
+    {
+        /* No SD card. */
+        errno = ENODEV;
+        return false;
+    }
+
+    return true;
+}
+
+static void hostIoConvertTmd(u8 *stmd, u32 size)
+{
+    u32 sig_type = 0, sig_size = 0;
+    tmd *t = NULL;
+
+    if (size < sizeof(u32)) return;
+
+    memcpy(&sig_type, stmd, sizeof(u32));
+    sig_type = BE32(sig_type);
+    memcpy(stmd, &sig_type, sizeof(u32));
+
+    sig_size = SIGNATURE_SIZE((signed_blob*)stmd);
+    if (!sig_size || size < (sig_size + sizeof(tmd))) return;
+
+    t = (tmd*)(stmd + sig_size);
+
+    t->sys_version = BE64(t->sys_version);
+    t->title_id = BE64(t->title_id);
+    t->title_type = BE32(t->title_type);
+    t->group_id = BE16(t->group_id);
+    t->region = BE16(t->region);
+    t->access_rights = BE32(t->access_rights);
+    t->title_version = BE16(t->title_version);
+    t->num_contents = BE16(t->num_contents);
+    t->boot_index = BE16(t->boot_index);
+
+    /* Leave truncated content records alone. Callers will bail out on their own. */
+    for(u32 i = 0; i < t->num_contents && (sig_size + sizeof(tmd) + ((i + 1) * sizeof(tmd_content))) <= size; i++)
+    {
+        tmd_content *content = &(t->contents[i]);
+        content->cid = BE32(content->cid);
+        content->index = BE16(content->index);
+        content->type = BE16(content->type);
+        content->size = BE64(content->size);
+    }
+}
+
+static bool hostIoParseTraceLine(char *line, HostIoTraceEvent *out)
+{
+    char *fields[7] = {0}, *ptr = line;
+    unsigned long values[2] = {0};
+    u32 field_count = 0;
+
+    memset(out, 0, sizeof(HostIoTraceEvent));
+
+    /* Split fields. Paths are quoted, and may hold commas. */
+    while(field_count < MAX_ELEMENTS(fields))
+    {
+        if (*ptr == '"')
+        {
+            fields[field_count++] = ++ptr;
+            if (!(ptr = strchr(ptr, '"'))) return false;
+            *ptr++ = '\0';
+        } else {
+            fields[field_count++] = ptr;
+            ptr += strcspn(ptr, ",");
+        }
+
+        if (*ptr != ',') break;
+        *ptr++ = '\0';
+    }
+
+    if (field_count != MAX_ELEMENTS(fields) || *ptr) return false;
+
+    values[0] = strtoul(fields[0], NULL, 10);
+    values[1] = strtoul(fields[1], NULL, 10);
+    out->start_usec = (u32)values[0];
+    out->elapsed_usec = (u32)values[1];
+
+    for(out->op = 0; out->op < IoTraceOp_Count; out->op++)
+    {
+        if (!strcmp(fields[2], g_hostIoTraceOpNames[out->op])) break;
+    }
+
+    if (out->op >= IoTraceOp_Count) return false;
+
+    snprintf(out->path, sizeof(out->path), "%s", fields[3]);
+    out->offset = (u32)strtoul(fields[4], NULL, 10);
+    out->size = (u32)strtoul(fields[5], NULL, 10);
+    out->result = (s32)strtol(fields[6], NULL, 10);
+
+    return true;
+}
+
+static bool hostIoReplayEvent(const HostIoTraceEvent *event, u8 *buf, u32 buf_size)
+{
+    char path[HOST_IO_MAX_PATH] = {0};
+    u8 device = g_hostIoTraceOpDevices[event->op];
+    bool transfer = false, write = false;
+    int fd = -1;
+
+    switch(event->op)
+    {
+        case IoTraceOp_EsGetTmd:
+            transfer = true;
+            break;
+        case IoTraceOp_IsfsWrite:
+        case IoTraceOp_SdWrite:
+            transfer = write = true;
+            break;
+        case IoTraceOp_IsfsRead:
+        case IoTraceOp_SdRead:
+            /* Read the recorded block from the backing file, if it exists. */
+            transfer = true;
+
+            if (event->size > buf_size)
+            {
+                ERROR_MSG("Trace read exceeds replay buffer size! (0x%X).", event->size);
+                return false;
+            }
+
+            if (*event->path && hostIoResolvePath(device, event->path, path, sizeof(path)) && (fd = __real_open(path, O_RDONLY)) >= 0)
+            {
+                if (pread(fd, buf, event->size, (off_t)event->offset) < 0) ERROR_MSG("Failed to read \"%s\"! (%d).", path, errno);
+                __real_close(fd);
+            }
+
+            break;
+        default:
+            break;
+    }
+
+    /* Faults aren't relevant here: the recorded result is kept. */
+    hostIoModelCall(device, (transfer ? event->size : 0), write, transfer);
+
+    return true;
+}
+
+static void hostIoSleep(u64 usec)
+{
+    struct timespec ts = { (time_t)(usec / 1000000), (long)((usec % 1000000) * 1000) };
+    if (!usec) return;
+    while(nanosleep(&ts, &ts) != 0 && errno == EINTR);
+}
@@ -0,0 +1,125 @@
+/*
+ * hostio.h
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifndef __HOSTIO_H__
+#define __HOSTIO_H__
+
+#define HOST_IO_DEVICE_ID           (u32)0x0403AC68 /* Reported by ES_GetDeviceID(). */
+#define HOST_IO_MAX_PATH            0x1000
+
+/* Emulated IOS error codes. */
+#define HOST_IO_FS_EINVAL           -101
+#define HOST_IO_FS_ECORRUPT         -103
+#define HOST_IO_FS_EEXIST           -105
+#define HOST_IO_FS_ENOENT           -106
+#define HOST_IO_FS_EMAXFD           -109
+
+/// Emulated devices. Each one has its own I/O model.
+typedef enum {
+    HostIoDevice_Es    = 0, ///< ES TMD requests.
+    HostIoDevice_Nand  = 1, ///< ISFS calls.
+    HostIoDevice_Sd    = 2, ///< SD card calls (any path starting with "sd:/").
+    HostIoDevice_Count = 3
+} HostIoDevice;
+
+typedef enum {
+    HostIoFaultType_Error   = 0,    ///< Faulty calls fail with an I/O error.
+    HostIoFaultType_Corrupt = 1     ///< Faulty calls succeed, but a single bit from the transferred data is flipped. Written data is corrupted on the backing file.
+} HostIoFaultType;
+
+typedef enum {
+    HostIoFaultOp_Any   = 0,    ///< Both reads and writes are faulted.
+    HostIoFaultOp_Read  = 1,    ///< Only reads (and TMD requests) are faulted.
+    HostIoFaultOp_Write = 2     ///< Only writes are faulted. Useful to check that written data is read back and verified.
+} HostIoFaultOp;
+
+/// Cost and fault model for an emulated device. The cost of each call is latency_usec, plus the time needed to transfer its data at bandwidth_kib.
+/// Transfer sizes are rounded up to page_size first, which models partial page reads and writes. Only data transfer calls (reads, writes and TMD requests) matching fault_op are faulted,
+/// and fault_nth / fault_every only count matching calls.
+/// Calls sleep for their modeled cost, so emulated runs take roughly as long as they would on the modeled hardware.
+typedef struct {
+    u32 latency_usec;   ///< Fixed cost of every call, in microseconds.
+    u32 bandwidth_kib;  ///< Transfer rate, in KiB/s. Zero means no transfer cost.
+    u32 write_bandwidth_kib;    ///< Transfer rate for writes, in KiB/s. Zero means bandwidth_kib is used for writes as well.
+    u32 page_size;      ///< Transfer granularity, in bytes. Zero or one disable rounding.
+    u32 fault_nth;      ///< Fault the Nth data transfer call (1-based). Zero disables it.
+    u32 fault_every;    ///< Fault every Nth data transfer call. Zero disables it.
+    u32 fault_percent;  ///< Probability of faulting each data transfer call, as a percentage. Uses a fixed seed, so runs are reproducible.
+    u8 fault_type;      ///< HostIoFaultType.
+    u8 fault_op;        ///< HostIoFaultOp.
+} HostIoModel;
+
+/// Cumulative counters for an emulated device.
+typedef struct {
+    u32 call_count;     ///< Number of calls.
+    u32 transfer_count; ///< Number of data transfer calls.
+    u32 fault_count;    ///< Number of faulted calls.
+    u64 byte_count;     ///< Transferred bytes, before page rounding.
+    u64 modeled_usec;   ///< Modeled cost of all calls, in microseconds.
+} HostIoStats;
+
+/// Sets the local directory holding the emulated NAND filesystem (e.g. a NAND dump). ISFS paths are resolved relative to it.
+/// TMDs are read from "<nand_root>/title/<tid_high>/<tid_low>/content/title.tmd", just like ES does.
+void hostIoSetNandRoot(const char *path);
+
+/// Overrides the NAND root for the calling thread only. Lets worker threads process different NAND dumps at the same time. NULL restores the global root.
+void hostIoSetThreadNandRoot(const char *path);
+
+/// Sets the local directory mapped to "sd:/". Mounting the SD card fails until it's set.
+void hostIoSetSdRoot(const char *path);
+
+/// Resolves an emulated path ("/..." for ISFS paths, "sd:/..." for SD card paths) to a local path. Any other path is copied as-is.
+bool hostIoResolvePath(u8 device, const char *path, char *out, size_t out_size);
+
+/// Parses a model from a comma-separated list of key=value pairs:
+/// "latency=<usec>", "bandwidth=<KiB/s>", "write-bandwidth=<KiB/s>", "page=<bytes>", "fault-nth=<n>", "fault-every=<n>", "fault-rate=<percent>", "fault=error|corrupt" and "fault-op=any|read|write".
+bool hostIoParseModel(const char *str, HostIoModel *out);
+
+/// Retrieves a device name ("es", "nand" or "sd"). Returns NULL for invalid devices.
+const char *hostIoGetDeviceName(u8 device);
+
+/// Looks up a device by its name. Returns HostIoDevice_Count if it's invalid.
+u8 hostIoGetDeviceByName(const char *name, size_t name_len);
+
+void hostIoSetModel(u8 device, const HostIoModel *model);
+void hostIoGetModel(u8 device, HostIoModel *out);
+
+/// Formats a model as a string accepted by hostIoParseModel().
+void hostIoFormatModel(const HostIoModel *model, char *out, size_t out_size);
+
+void hostIoGetStats(u8 device, HostIoStats *out);
+
+/// Resets the stats for all devices, as well as the fault counters.
+void hostIoResetStats(void);
+
+/// Prints the stats for all devices that have been used.
+void hostIoPrintStats(void);
+
+/// Replays an I/O trace saved by ioTraceSaveToMountedDevice() against the emulated devices, and prints the recorded and emulated time for each operation type.
+/// Reads are issued against the backing files whenever they exist. Writes and TMD requests only incur their modeled cost, since the trace doesn't hold any data.
+bool hostIoReplayTrace(const char *path);
+
+/// Fits a latency, read bandwidth and write bandwidth model for each device to the data transfer calls from an I/O trace, using a least squares fit over (size, elapsed time) pairs.
+/// Devices without enough data transfer calls are left untouched. Fitted models are applied right away, and printed as "model=" arguments for the host build.
+bool hostIoFitTrace(const char *path);
+
+#endif /* __HOSTIO_H__ */
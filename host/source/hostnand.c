@@ -0,0 +1,326 @@
+/*
+ * hostnand.c
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils.h"
+#include "ardb.h"
+#include "u8.h"
+#include "sha1.h"
+#include "titlemeta.h"
+#include "hostio.h"
+#include "hostnand.h"
+
+#define HOST_NAND_SIGNATURE_TYPE        ES_SIG_RSA2048
+#define HOST_NAND_SIGNATURE_SIZE        0x140
+
+#define HOST_NAND_CONTENT_COUNT         3
+#define HOST_NAND_BLOB_SIZE             0x60000
+#define HOST_NAND_SMALL_SIZE            0x1200
+#define HOST_NAND_LAYOUT_SIZE           0x42345 /* Spans several NAND clusters, so restoring a backup only rewrites the modified ones. */
+
+#define HOST_NAND_U8_NODE_COUNT         7
+#define HOST_NAND_U8_ROOT_NODE_OFFSET   0x20    /* The U8 header is followed by 0x10 reserved bytes. */
+#define HOST_NAND_U8_DATA_ALIGNMENT     0x20
+
+typedef struct {
+    u32 cid;
+    u8 *data;
+    u32 size;
+} HostNandContent;
+
+typedef struct {
+    const char *name;
+    u32 first_code;
+    u32 code_count;
+    bool wc24;
+} HostNandDatabase;
+
+/* Global variables. */
+
+static const HostNandDatabase g_hostNandDatabases[AspectRatioDatabaseType_Count] = {
+    [AspectRatioDatabaseType_Disc]           = { "discdb.bin", 0x524100, 0x40, false },    /* "RA?". */
+    [AspectRatioDatabaseType_VirtualConsole] = { "vcadb.bin",  0x464100, 0x20, false },    /* "FA?". */
+    [AspectRatioDatabaseType_WiiWare]        = { "wwdb.bin",   0x574100, 0x30, true  }     /* "WA?". */
+};
+
+/* Function prototypes. */
+
+static void hostNandFillData(u8 *buf, u32 size, u32 seed);
+
+static u8 *hostNandBuildArchive(u32 *out_size);
+static u32 hostNandBuildDatabase(u8 *buf, const HostNandDatabase *db);
+
+static u8 *hostNandBuildSignedTmd(const HostNandContent *contents, u32 content_count, u32 *out_size);
+
+static bool hostNandWriteFile(const char *path, const void *buf, u32 size);
+static bool hostNandCreateDirectories(const char *path);
+
+bool hostNandCreate(const char *root)
+{
+    if (!root || !*root) return false;
+
+    HostNandContent contents[HOST_NAND_CONTENT_COUNT] = {
+        { 0x00000010, NULL, HOST_NAND_BLOB_SIZE  },
+        { 0x00000011, NULL, 0                    },
+        { 0x00000012, NULL, HOST_NAND_SMALL_SIZE }
+    };
+
+    char dir[HOST_IO_MAX_PATH] = {0}, path[HOST_IO_MAX_PATH] = {0};
+    u8 *stmd = NULL;
+    u32 stmd_size = 0;
+    bool success = false;
+
+    /* Scratch directory used by IOS and by I/O calibration. */
+    snprintf(dir, sizeof(dir), "%s/tmp", root);
+    if (!hostNandCreateDirectories(dir)) goto out;
+
+    snprintf(dir, sizeof(dir), "%s/title/%08x/%08x/content", root, TITLE_UPPER(SYSTEM_MENU_TID), TITLE_LOWER(SYSTEM_MENU_TID));
+    if (!hostNandCreateDirectories(dir)) goto out;
+
+    /* Generate contents. */
+    if (!(contents[0].data = (u8*)utilsAllocateMemory(contents[0].size)) || !(contents[1].data = hostNandBuildArchive(&(contents[1].size))) || \
+        !(contents[2].data = (u8*)utilsAllocateMemory(contents[2].size)))
+    {
+        ERROR_MSG("Failed to generate contents!");
+        goto out;
+    }
+
+    hostNandFillData(contents[0].data, contents[0].size, contents[0].cid);
+    hostNandFillData(contents[2].data, contents[2].size, contents[2].cid);
+
+    for(u32 i = 0; i < HOST_NAND_CONTENT_COUNT; i++)
+    {
+        snprintf(path, sizeof(path), "%s/%08x.app", dir, contents[i].cid);
+        if (!hostNandWriteFile(path, contents[i].data, contents[i].size)) goto out;
+    }
+
+    /* Generate signed TMD. */
+    if (!(stmd = hostNandBuildSignedTmd(contents, HOST_NAND_CONTENT_COUNT, &stmd_size))) goto out;
+
+    snprintf(path, sizeof(path), "%s/title.tmd", dir);
+    if (!hostNandWriteFile(path, stmd, stmd_size)) goto out;
+
+    success = true;
+
+out:
+    if (stmd) utilsFreeMemory(stmd);
+
+    for(u32 i = 0; i < HOST_NAND_CONTENT_COUNT; i++)
+    {
+        if (contents[i].data) utilsFreeMemory(contents[i].data);
+    }
+
+    return success;
+}
+
+static void hostNandFillData(u8 *buf, u32 size, u32 seed)
+{
+    u32 state = (seed * 2654435761U) + 1;
+
+    for(u32 i = 0; i < size; i++)
+    {
+        state = ((state * 1103515245) + 12345);
+        buf[i] = (u8)(state >> 16);
+    }
+}
+
+static u8 *hostNandBuildArchive(u32 *out_size)
+{
+    /* Node layout: root, "titlelist" (with all three databases), "layout" (with a single file). */
+    const char *names[HOST_NAND_U8_NODE_COUNT] = { "", TITLE_META_ARCHIVE_DIR_NAME, NULL, NULL, NULL, "layout", "common.bin" };
+
+    U8Header header = {0};
+    U8Node nodes[HOST_NAND_U8_NODE_COUNT] = {0};
+    char strtab[0x100] = {0};
+    u32 strtab_size = 0, file_sizes[HOST_NAND_U8_NODE_COUNT] = {0}, data_size = 0, archive_size = 0, offset = 0;
+    u8 *archive = NULL;
+
+    names[2] = g_hostNandDatabases[AspectRatioDatabaseType_Disc].name;
+    names[3] = g_hostNandDatabases[AspectRatioDatabaseType_VirtualConsole].name;
+    names[4] = g_hostNandDatabases[AspectRatioDatabaseType_WiiWare].name;
+
+    for(u32 i = 0; i < HOST_NAND_U8_NODE_COUNT; i++)
+    {
+        nodes[i].name_offset = strtab_size;
+        strcpy(strtab + strtab_size, names[i]);
+        strtab_size += (u32)(strlen(names[i]) + 1);
+    }
+
+    for(u32 i = 0; i < AspectRatioDatabaseType_Count; i++) file_sizes[2 + i] = (sizeof(AspectRatioDatabase) + ((g_hostNandDatabases[i].code_count + 2) * sizeof(u32)));
+    file_sizes[6] = HOST_NAND_LAYOUT_SIZE;
+
+    header.magic = U8_MAGIC;
+    header.root_node_offset = HOST_NAND_U8_ROOT_NODE_OFFSET;
+    header.node_info_block_size = ((HOST_NAND_U8_NODE_COUNT * sizeof(U8Node)) + strtab_size);
+    header.data_offset = ALIGN_UP(header.root_node_offset + header.node_info_block_size, 0x40);
+
+    for(u32 i = 0; i < HOST_NAND_U8_NODE_COUNT; i++) data_size += ALIGN_UP(file_sizes[i], HOST_NAND_U8_DATA_ALIGNMENT);
+    archive_size = (header.data_offset + data_size);
+
+    if (!(archive = (u8*)utilsAllocateMemory(archive_size))) return NULL;
+    memset(archive, 0, archive_size);
+
+    /* Directories. */
+    nodes[0].type = nodes[1].type = nodes[5].type = U8NodeType_Directory;
+    nodes[0].size = HOST_NAND_U8_NODE_COUNT;
+    nodes[1].size = 5;
+    nodes[5].size = HOST_NAND_U8_NODE_COUNT;
+
+    /* Files. */
+    offset = header.data_offset;
+
+    for(u32 i = 0; i < HOST_NAND_U8_NODE_COUNT; i++)
+    {
+        if (nodes[i].type != U8NodeType_File) continue;
+
+        nodes[i].data_offset = offset;
+        nodes[i].size = file_sizes[i];
+
+        if (i >= 2 && i <= 4)
+        {
+            hostNandBuildDatabase(archive + offset, &(g_hostNandDatabases[i - 2]));
+        } else {
+            hostNandFillData(archive + offset, file_sizes[i], i);
+        }
+
+        offset += ALIGN_UP(file_sizes[i], HOST_NAND_U8_DATA_ALIGNMENT);
+    }
+
+    /* Store everything in big-endian byte order. */
+    utilsSwapBigEndianWords(&header, sizeof(U8Header) / sizeof(u32));
+    utilsSwapBigEndianWords(nodes, (HOST_NAND_U8_NODE_COUNT * sizeof(U8Node)) / sizeof(u32));
+
+    memcpy(archive, &header, sizeof(U8Header));
+    memcpy(archive + HOST_NAND_U8_ROOT_NODE_OFFSET, nodes, sizeof(nodes));
+    memcpy(archive + HOST_NAND_U8_ROOT_NODE_OFFSET + sizeof(nodes), strtab, strtab_size);
+
+    *out_size = archive_size;
+
+    return archive;
+}
+
+static u32 hostNandBuildDatabase(u8 *buf, const HostNandDatabase *db)
+{
+    AspectRatioDatabase *ardb = (AspectRatioDatabase*)buf;
+    u32 entry_count = 0;
+
+    /* WC24 channel codes are lower than any generated code, so entries stay sorted. */
+    if (db->wc24)
+    {
+        ardb->entries[entry_count++] = BE32(ARDB_WC24_EVC_ENTRY << 8);
+        ardb->entries[entry_count++] = BE32(ARDB_WC24_CMOC_ENTRY << 8);
+    }
+
+    for(u32 i = 0; i < db->code_count; i++) ardb->entries[entry_count++] = BE32((db->first_code + (i * 3)) << 8);
+
+    ardb->magic = BE32(ARDB_MAGIC);
+    ardb->version = BE32(1);
+    ardb->entry_count = BE32(entry_count);
+    ardb->reserved = 0;
+
+    return entry_count;
+}
+
+static u8 *hostNandBuildSignedTmd(const HostNandContent *contents, u32 content_count, u32 *out_size)
+{
+    u32 stmd_size = (HOST_NAND_SIGNATURE_SIZE + sizeof(tmd) + (content_count * sizeof(tmd_content)));
+    u8 *stmd = NULL;
+    u32 sig_type = BE32(HOST_NAND_SIGNATURE_TYPE);
+    tmd *t = NULL;
+
+    if (!(stmd = (u8*)utilsAllocateMemory(stmd_size))) return NULL;
+    memset(stmd, 0, stmd_size);
+
+    memcpy(stmd, &sig_type, sizeof(u32));
+
+    t = (tmd*)(stmd + HOST_NAND_SIGNATURE_SIZE);
+    snprintf(t->issuer, sizeof(t->issuer), "Root-CA00000001-CP00000004");
+    t->sys_version = BE64(TITLE_ID(1, 80));
+    t->title_id = BE64(SYSTEM_MENU_TID);
+    t->title_type = BE32(1);
+    t->title_version = BE16(HOST_NAND_SYSTEM_MENU_VERSION);
+    t->num_contents = BE16(content_count);
+    t->boot_index = BE16(2);
+
+    for(u32 i = 0; i < content_count; i++)
+    {
+        tmd_content *content = &(t->contents[i]);
+
+        content->cid = BE32(contents[i].cid);
+        content->index = BE16(i);
+        content->type = BE16(1);
+        content->size = BE64(contents[i].size);
+
+        if (!sha1CalculateHash(contents[i].data, contents[i].size, content->hash))
+        {
+            utilsFreeMemory(stmd);
+            return NULL;
+        }
+    }
+
+    *out_size = stmd_size;
+
+    return stmd;
+}
+
+static bool hostNandWriteFile(const char *path, const void *buf, u32 size)
+{
+    FILE *fp = fopen(path, "wb");
+    bool success = false;
+
+    if (!fp)
+    {
+        ERROR_MSG("Failed to create \"%s\"! (%d).", path, errno);
+        return false;
+    }
+
+    success = (fwrite(buf, 1, size, fp) == size);
+    if (!success) ERROR_MSG("Failed to write 0x%X bytes to \"%s\"!", size, path);
+
+    fclose(fp);
+
+    return success;
+}
+
+static bool hostNandCreateDirectories(const char *path)
+{
+    char tmp[HOST_IO_MAX_PATH] = {0};
+    struct stat st = {0};
+
+    snprintf(tmp, sizeof(tmp), "%s", path);
+
+    for(char *ptr = tmp + 1; *ptr; ptr++)
+    {
+        if (*ptr != '/') continue;
+
+        *ptr = '\0';
+        mkdir(tmp, 0777);
+        *ptr = '/';
+    }
+
+    mkdir(tmp, 0777);
+
+    if (stat(tmp, &st) != 0 || !S_ISDIR(st.st_mode))
+    {
+        ERROR_MSG("Failed to create \"%s\"! (%d).", tmp, errno);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,36 @@
+/*
+ * hostnand.h
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifndef __HOSTNAND_H__
+#define __HOSTNAND_H__
+
+#define HOST_NAND_SYSTEM_MENU_VERSION   (u16)0x1F2     /* v498. */
+
+/// Populates a local directory with a synthetic System Menu title that can be used as the emulated NAND filesystem root (see hostIoSetNandRoot()).
+/// Its contents are deterministic: the same files are generated on every run, and on every host. It holds a signed TMD and three contents:
+///     - A large content without any U8 archive, which is the largest content on purpose. Archive content probing has to skip it.
+///     - A U8 archive with a "/titlelist" directory holding all three aspect ratio databases. The WiiWare database includes the WC24 channel entries.
+///     - A small content without any U8 archive.
+/// Content hashes within the TMD match the generated data. An empty "/tmp" directory is created as well. Any existing files are replaced.
+bool hostNandCreate(const char *root);
+
+#endif /* __HOSTNAND_H__ */
@@ -0,0 +1,521 @@
+/*
+ * hostogc.c
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Needed for PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP. */
+#define _GNU_SOURCE
+
+#include "utils.h"
+
+#include <ogc/sha.h>
+#include <runtimeiospatch.h>
+
+#define HOST_OGC_NSEC_PER_SEC       1000000000ULL
+
+#define HOST_OGC_CONSOLE_COLS       80
+#define HOST_OGC_CONSOLE_ROWS       25
+
+#define HOST_OGC_IOS_VERSION        58
+#define HOST_OGC_IOS_REVISION       6176
+
+#define HOST_OGC_SHA1_BLOCK_SIZE    0x40
+
+struct _host_thread {
+    pthread_t thread;
+};
+
+/* Global variables. */
+
+static pthread_mutex_t g_hostOgcIrqMutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+static const u32 g_hostOgcSha1InitialState[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+GXRModeObj TVPal576IntDfScale = { 0, 640, 528, 574, 40, 0, 640, 574 };
+GXRModeObj TVPal576ProgScale = { 0, 640, 528, 574, 40, 0, 640, 574 };
+
+/* Function prototypes. */
+
+static void hostOgcSha1ProcessBlock(u32 *states, const u8 *block);
+static void hostOgcSha1AddLength(sha_context *ctx, u32 size);
+
+/* Time base. */
+
+u64 gettime(void)
+{
+    struct timespec ts = {0};
+    u64 nsec = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    nsec = (((u64)ts.tv_sec * HOST_OGC_NSEC_PER_SEC) + (u64)ts.tv_nsec);
+
+    /* Broadway's time base runs at (TB_TIMER_CLOCK * 1000) Hz, which is 243 ticks every 4000 ns. */
+    return ((nsec / 4000) * 243) + (((nsec % 4000) * 243) / 4000);
+}
+
+/* Interrupts. */
+
+u32 IRQ_Disable(void)
+{
+    pthread_mutex_lock(&g_hostOgcIrqMutex);
+    return 1;
+}
+
+void IRQ_Restore(u32 level)
+{
+    (void)level;
+    pthread_mutex_unlock(&g_hostOgcIrqMutex);
+}
+
+/* Threads. */
+
+s32 LWP_CreateThread(lwp_t *thethread, void *(*entry)(void *), void *arg, void *stackbase, u32 stack_size, u8 prio)
+{
+    lwp_t thread = NULL;
+
+    (void)stackbase;
+    (void)stack_size;
+    (void)prio;
+
+    if (!thethread || !entry || !(thread = (lwp_t)malloc(sizeof(struct _host_thread)))) return -1;
+
+    if (pthread_create(&(thread->thread), NULL, entry, arg) != 0)
+    {
+        free(thread);
+        return -1;
+    }
+
+    *thethread = thread;
+
+    return 0;
+}
+
+s32 LWP_JoinThread(lwp_t thethread, void **value_ptr)
+{
+    s32 ret = 0;
+
+    if (!thethread) return -1;
+
+    ret = (pthread_join(thethread->thread, value_ptr) == 0 ? 0 : -1);
+    free(thethread);
+
+    return ret;
+}
+
+s32 LWP_MutexInit(mutex_t *mutex, bool use_recursive)
+{
+    pthread_mutexattr_t attr;
+    mutex_t new_mutex = NULL;
+    s32 ret = -1;
+
+    if (!mutex || !(new_mutex = (mutex_t)malloc(sizeof(pthread_mutex_t)))) return -1;
+
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, use_recursive ? PTHREAD_MUTEX_RECURSIVE : PTHREAD_MUTEX_NORMAL);
+
+    if (pthread_mutex_init(new_mutex, &attr) == 0)
+    {
+        *mutex = new_mutex;
+        ret = 0;
+    } else {
+        free(new_mutex);
+    }
+
+    pthread_mutexattr_destroy(&attr);
+
+    return ret;
+}
+
+s32 LWP_MutexDestroy(mutex_t mutex)
+{
+    if (!mutex) return -1;
+    pthread_mutex_destroy(mutex);
+    free(mutex);
+    return 0;
+}
+
+s32 LWP_MutexLock(mutex_t mutex)
+{
+    return ((mutex && pthread_mutex_lock(mutex) == 0) ? 0 : -1);
+}
+
+s32 LWP_MutexUnlock(mutex_t mutex)
+{
+    return ((mutex && pthread_mutex_unlock(mutex) == 0) ? 0 : -1);
+}
+
+s32 LWP_CondInit(cond_t *cond)
+{
+    cond_t new_cond = NULL;
+
+    if (!cond || !(new_cond = (cond_t)malloc(sizeof(pthread_cond_t)))) return -1;
+
+    if (pthread_cond_init(new_cond, NULL) != 0)
+    {
+        free(new_cond);
+        return -1;
+    }
+
+    *cond = new_cond;
+
+    return 0;
+}
+
+s32 LWP_CondWait(cond_t cond, mutex_t mutex)
+{
+    return ((cond && mutex && pthread_cond_wait(cond, mutex) == 0) ? 0 : -1);
+}
+
+s32 LWP_CondSignal(cond_t cond)
+{
+    return ((cond && pthread_cond_signal(cond) == 0) ? 0 : -1);
+}
+
+s32 LWP_CondBroadcast(cond_t cond)
+{
+    return ((cond && pthread_cond_broadcast(cond) == 0) ? 0 : -1);
+}
+
+s32 LWP_CondDestroy(cond_t cond)
+{
+    if (!cond) return -1;
+    pthread_cond_destroy(cond);
+    free(cond);
+    return 0;
+}
+
+s32 LWP_InitQueue(lwpq_t *thequeue)
+{
+    return LWP_CondInit(thequeue);
+}
+
+void LWP_CloseQueue(lwpq_t thequeue)
+{
+    LWP_CondDestroy(thequeue);
+}
+
+s32 LWP_ThreadSleep(lwpq_t thequeue)
+{
+    /* Sleeping releases the interrupt lock, just like a thread switch re-enables interrupts on the console. */
+    return ((thequeue && pthread_cond_wait(thequeue, &g_hostOgcIrqMutex) == 0) ? 0 : -1);
+}
+
+void LWP_ThreadSignal(lwpq_t thequeue)
+{
+    if (thequeue) pthread_cond_signal(thequeue);
+}
+
+void LWP_ThreadBroadcast(lwpq_t thequeue)
+{
+    if (thequeue) pthread_cond_broadcast(thequeue);
+}
+
+/* SHA engine. */
+
+s32 SHA_Init(void)
+{
+    return 0;
+}
+
+s32 SHA_Close(void)
+{
+    return 0;
+}
+
+s32 SHA_InitializeContext(const sha_context *context)
+{
+    sha_context *ctx = (sha_context*)context;
+
+    if (!ctx) return -1;
+
+    memcpy(ctx->states, g_hostOgcSha1InitialState, sizeof(g_hostOgcSha1InitialState));
+    ctx->upper_length = ctx->lower_length = 0;
+
+    return 0;
+}
+
+s32 SHA_Input(const sha_context *context, const void *data, const u32 data_size)
+{
+    sha_context *ctx = (sha_context*)context;
+    const u8 *data_u8 = (const u8*)data;
+
+    /* Just like the real engine, only whole blocks can be fed. */
+    if (!ctx || (data_size && !data) || !IS_ALIGNED(data_size, HOST_OGC_SHA1_BLOCK_SIZE)) return -1;
+
+    for(u32 offset = 0; offset < data_size; offset += HOST_OGC_SHA1_BLOCK_SIZE) hostOgcSha1ProcessBlock(ctx->states, data_u8 + offset);
+
+    hostOgcSha1AddLength(ctx, data_size);
+
+    return 0;
+}
+
+s32 SHA_Calculate(const sha_context *context, const void *data, const u32 data_size, void *message_digest)
+{
+    sha_context *ctx = (sha_context*)context;
+    const u8 *data_u8 = (const u8*)data;
+    u32 block_size = ALIGN_DOWN(data_size, HOST_OGC_SHA1_BLOCK_SIZE), remainder = (data_size - block_size), padding_size = 0;
+    u64 bit_length = 0;
+    u8 padding[HOST_OGC_SHA1_BLOCK_SIZE * 2] = {0}, *digest = (u8*)message_digest;
+
+    if (!ctx || (data_size && !data) || !digest || SHA_Input(context, data, block_size) < 0) return -1;
+
+    hostOgcSha1AddLength(ctx, remainder);
+    bit_length = ((((u64)ctx->upper_length << 32) | ctx->lower_length) << 3);
+
+    padding_size = (remainder < (HOST_OGC_SHA1_BLOCK_SIZE - 8) ? HOST_OGC_SHA1_BLOCK_SIZE : (HOST_OGC_SHA1_BLOCK_SIZE * 2));
+
+    if (remainder) memcpy(padding, data_u8 + block_size, remainder);
+    padding[remainder] = 0x80;
+
+    for(u32 i = 0; i < 8; i++) padding[padding_size - 1 - i] = (u8)(bit_length >> (i * 8));
+
+    for(u32 offset = 0; offset < padding_size; offset += HOST_OGC_SHA1_BLOCK_SIZE) hostOgcSha1ProcessBlock(ctx->states, padding + offset);
+
+    for(u32 i = 0; i < 5; i++)
+    {
+        u32 state = BE32(ctx->states[i]);
+        memcpy(digest + (i * sizeof(u32)), &state, sizeof(u32));
+    }
+
+    return 0;
+}
+
+/* IOS. */
+
+s32 IOS_GetVersion(void)
+{
+    return HOST_OGC_IOS_VERSION;
+}
+
+s32 IOS_GetRevision(void)
+{
+    return HOST_OGC_IOS_REVISION;
+}
+
+s32 IosPatch_RUNTIME(bool wii, bool sciifii, bool vwii, bool verbose)
+{
+    (void)wii;
+    (void)sciifii;
+    (void)vwii;
+    (void)verbose;
+    return 1;
+}
+
+/* Hardware registers. */
+
+void write32(u32 addr, u32 value)
+{
+    (void)addr;
+    (void)value;
+}
+
+void mask32(u32 addr, u32 clear, u32 set)
+{
+    (void)addr;
+    (void)clear;
+    (void)set;
+}
+
+/* Video, console and system. */
+
+void VIDEO_Init(void)
+{
+}
+
+GXRModeObj *VIDEO_GetPreferredMode(GXRModeObj *mode)
+{
+    return (mode ? mode : &TVPal576IntDfScale);
+}
+
+void VIDEO_SetBlack(bool black)
+{
+    (void)black;
+}
+
+void VIDEO_Configure(GXRModeObj *rmode)
+{
+    (void)rmode;
+}
+
+void VIDEO_Flush(void)
+{
+}
+
+void VIDEO_WaitVSync(void)
+{
+}
+
+u32 VIDEO_GetFrameBufferSize(GXRModeObj *rmode)
+{
+    (void)rmode;
+    return 0;
+}
+
+void VIDEO_ClearFrameBuffer(GXRModeObj *rmode, void *fb, u32 color)
+{
+    (void)rmode;
+    (void)fb;
+    (void)color;
+}
+
+void VIDEO_SetNextFramebuffer(void *fb)
+{
+    (void)fb;
+}
+
+void *SYS_AllocateFramebuffer(GXRModeObj *rmode)
+{
+    (void)rmode;
+    return NULL;
+}
+
+void DCInvalidateRange(void *startaddress, u32 len)
+{
+    (void)startaddress;
+    (void)len;
+}
+
+void CON_InitEx(GXRModeObj *rmode, s32 conXOrigin, s32 conYOrigin, s32 conWidth, s32 conHeight)
+{
+    (void)rmode;
+    (void)conXOrigin;
+    (void)conYOrigin;
+    (void)conWidth;
+    (void)conHeight;
+}
+
+void CON_GetMetrics(s32 *cols, s32 *rows)
+{
+    if (cols) *cols = HOST_OGC_CONSOLE_COLS;
+    if (rows) *rows = HOST_OGC_CONSOLE_ROWS;
+}
+
+s32 CONF_GetAspectRatio(void)
+{
+    return 0;
+}
+
+void SYS_ResetSystem(s32 reset, u32 reset_code, s32 force_menu)
+{
+    (void)reset;
+    (void)reset_code;
+    (void)force_menu;
+    exit(0);
+}
+
+u32 SYS_GetArena1Size(void)
+{
+    return 0;
+}
+
+u32 SYS_GetArena2Size(void)
+{
+    return 0;
+}
+
+/* Input. */
+
+s32 WPAD_Init(void)
+{
+    return WPAD_ERR_NONE;
+}
+
+s32 WPAD_SetDataFormat(s32 chan, s32 fmt)
+{
+    (void)chan;
+    (void)fmt;
+    return WPAD_ERR_NONE;
+}
+
+s32 WPAD_ScanPads(void)
+{
+    return -1;
+}
+
+u32 WPAD_ButtonsDown(int pad)
+{
+    (void)pad;
+    return 0;
+}
+
+u32 WPAD_ButtonsHeld(int pad)
+{
+    (void)pad;
+    return 0;
+}
+
+static void hostOgcSha1ProcessBlock(u32 *states, const u8 *block)
+{
+    u32 w[80] = {0}, a = states[0], b = states[1], c = states[2], d = states[3], e = states[4];
+
+    for(u32 i = 0; i < 16; i++)
+    {
+        memcpy(&(w[i]), block + (i * sizeof(u32)), sizeof(u32));
+        w[i] = BE32(w[i]);
+    }
+
+    for(u32 i = 16; i < 80; i++)
+    {
+        u32 val = (w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16]);
+        w[i] = ((val << 1) | (val >> 31));
+    }
+
+    for(u32 i = 0; i < 80; i++)
+    {
+        u32 f = 0, k = 0, tmp = 0;
+
+        if (i < 20)
+        {
+            f = ((b & c) | (~b & d));
+            k = 0x5A827999;
+        } else
+        if (i < 40)
+        {
+            f = (b ^ c ^ d);
+            k = 0x6ED9EBA1;
+        } else
+        if (i < 60)
+        {
+            f = ((b & c) | (b & d) | (c & d));
+            k = 0x8F1BBCDC;
+        } else {
+            f = (b ^ c ^ d);
+            k = 0xCA62C1D6;
+        }
+
+        tmp = (((a << 5) | (a >> 27)) + f + e + k + w[i]);
+        e = d;
+        d = c;
+        c = ((b << 30) | (b >> 2));
+        b = a;
+        a = tmp;
+    }
+
+    states[0] += a;
+    states[1] += b;
+    states[2] += c;
+    states[3] += d;
+    states[4] += e;
+}
+
+static void hostOgcSha1AddLength(sha_context *ctx, u32 size)
+{
+    u32 lower_length = (ctx->lower_length + size);
+    if (lower_length < ctx->lower_length) ctx->upper_length++;
+    ctx->lower_length = lower_length;
+}
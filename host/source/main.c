@@ -0,0 +1,439 @@
+/*
+ * main.c
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils.h"
+#include "ardb.h"
+#include "rules.h"
+#include "u8.h"
+#include "patch.h"
+#include "inventory.h"
+#include "iocal.h"
+#include "iotrace.h"
+#include "titlemeta.h"
+#include "profiler.h"
+#include "benchmark.h"
+#include "options.h"
+#include "actions.h"
+#include "taskpool.h"
+#include "hostio.h"
+#include "hostnand.h"
+
+/* Host entry point. ES, ISFS and SD card calls are emulated over local directories (see hostio.h), so every action can run off-console. */
+/* Arguments use the same "key=value" pairs as the console build (see options.h), plus the host-only keys listed in printUsage(). */
+
+#define HOST_MAX_ARGS   0x40
+#define HOST_MAX_DUMPS  0x400
+
+/// Verification state for a single NAND dump (see verifyNandDumps()).
+typedef struct {
+    char root[HOST_IO_MAX_PATH];
+    u16 title_version;
+    bool tmd_loaded;
+    ArdbVerifyResult result;
+} HostDumpVerification;
+
+static Options g_options = {0};
+
+static const char *g_mknandPath = NULL, *g_replayPath = NULL, *g_fitPath = NULL, *g_dumpsPath = NULL;
+static const char *g_profilePath = NULL, *g_memProfilePath = NULL;
+
+static void printUsage(const char *program);
+
+static bool parseHostArgument(const char *arg, bool *out_consumed);
+static bool parseModelArgument(const char *value);
+
+static bool verifyNandDumps(const char *path);
+static bool verifyNandDumpTask(void *arg, u32 idx);
+static int compareDumpVerifications(const void *a, const void *b);
+
+int main(int argc, char **argv)
+{
+    int ret = 0, option_argc = 1;
+    char *option_argv[HOST_MAX_ARGS] = { argv[0] };
+    struct stat st = {0};
+
+    if (argc < 2 || argc > HOST_MAX_ARGS)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    /* Host-only arguments are handled here. Everything else goes through the regular options parser. */
+    for(int i = 1; i < argc; i++)
+    {
+        bool consumed = false;
+
+        if (!parseHostArgument(argv[i], &consumed))
+        {
+            ERROR_MSG("Invalid argument \"%s\"!", argv[i]);
+            return 1;
+        }
+
+        if (!consumed) option_argv[option_argc++] = argv[i];
+    }
+
+    optionsInit(&g_options);
+
+    /* Load the config file from the emulated SD card, if available. Command line arguments take precedence over it. */
+    if (utilsMountSdCard() && stat(OPTIONS_FILE_PATH, &st) == 0)
+    {
+        printf("Loading options from \"" OPTIONS_FILE_PATH "\"...\n\n");
+        if (!optionsLoadFromFile(&g_options, OPTIONS_FILE_PATH))
+        {
+            printf("Invalid config file!\n");
+            return 1;
+        }
+    }
+
+    if (!optionsParseArguments(&g_options, option_argc, option_argv))
+    {
+        printf("Invalid command line arguments!\n");
+        return 1;
+    }
+
+    if (!optionsIsUnattended(&g_options) && !g_mknandPath && !g_replayPath && !g_fitPath)
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    /* Generate the synthetic NAND first, so that it can be used right away. */
+    if (g_mknandPath)
+    {
+        if (!hostNandCreate(g_mknandPath))
+        {
+            printf("Failed to create synthetic NAND at \"%s\"!\n", g_mknandPath);
+            return 1;
+        }
+
+        printf("Created synthetic NAND at \"%s\".\n\n", g_mknandPath);
+    }
+
+    if (ISFS_Initialize() < 0)
+    {
+        printf("Failed to initialize NAND FS driver!\n");
+        return 1;
+    }
+
+    if (utilsMountSdCard() && ioCalLoad()) printf("Loaded calibrated I/O chunk sizes from \"" IO_CAL_PATH "\".\n\n");
+
+    /* Fitted models are applied right away, so they're used by everything that runs afterwards. */
+    if (g_fitPath && !hostIoFitTrace(g_fitPath))
+    {
+        ret = 1;
+        goto out;
+    }
+
+    if (g_replayPath)
+    {
+        if (!hostIoReplayTrace(g_replayPath))
+        {
+            ret = 1;
+            goto out;
+        }
+
+        hostIoPrintStats();
+        hostIoResetStats();
+    }
+
+    if (!optionsIsUnattended(&g_options)) goto out;
+
+    /* NAND dump verification is host-only. Every other action runs the same code as the console build. */
+    if (g_options.action == OptionsAction_Verify && g_dumpsPath)
+    {
+        printf("Verifying System Menu contents from NAND dumps at \"%s\"...\n\n", g_dumpsPath);
+        if (!verifyNandDumps(g_dumpsPath)) ret = -9;
+    } else {
+        ret = actionsRun(&g_options, g_options.action);
+    }
+
+    if (ret != 0)
+    {
+        printf("\n\nProcess cannot continue.\n");
+        ret = 1;
+        goto out;
+    }
+
+#ifdef PROFILE_PHASES
+    profilerPrintSummary();
+
+    /* Spans are timed through the gettime() shim, which uses clock_gettime(). CSV files are written with plain stdio calls, so any local path works. */
+    if (g_profilePath && profilerSaveToMountedDevice(g_profilePath)) printf("Saved timing data to \"%s\".\n\n", g_profilePath);
+    if (g_memProfilePath && profilerSaveMemoryToMountedDevice(g_memProfilePath)) printf("Saved memory usage data to \"%s\".\n\n", g_memProfilePath);
+#endif  /* PROFILE_PHASES */
+
+    hostIoPrintStats();
+
+#ifdef RECORD_IO_TRACE
+    if (utilsMountSdCard())
+    {
+        u32 dropped_count = 0, event_count = ioTraceGetEventCount(&dropped_count);
+
+        mkdir("sd:/" APP_TITLE, 0777);
+        if (ioTraceSaveToMountedDevice(IO_TRACE_CSV_PATH)) printf("Saved %u I/O trace events (%u dropped) to \"" IO_TRACE_CSV_PATH "\".\n\n", event_count, dropped_count);
+    }
+#endif  /* RECORD_IO_TRACE */
+
+    printf("Process completed.\n");
+
+out:
+    actionsFree();
+    patchClearEntries();
+    titleMetaFree();
+    utilsUnmountSdCard();
+    ISFS_Deinitialize();
+
+    return ret;
+}
+
+static void printUsage(const char *program)
+{
+    printf("Usage: %s [key=value ...]\n\n", program);
+    printf("Host-only keys:\n");
+    printf("    nand=<dir>              Local directory used as the NAND filesystem root (e.g. a NAND dump).\n");
+    printf("    sd=<dir>                Local directory mapped to \"sd:/\". The SD card isn't available if not set.\n");
+    printf("    model=<dev>:<spec>      I/O model for a device (\"es\", \"nand\" or \"sd\"). <spec> is a comma-separated list of\n");
+    printf("                            latency=<usec>, bandwidth=<KiB/s>, write-bandwidth=<KiB/s>, page=<bytes>,\n");
+    printf("                            fault-nth=<n>, fault-every=<n>, fault-rate=<percent>, fault=error|corrupt and\n");
+    printf("                            fault-op=any|read|write.\n");
+    printf("    mknand=<dir>            Populates a local directory with a synthetic System Menu title (see hostnand.h).\n");
+    printf("    baseline=<csv>          U8 benchmark baselines file. Defaults to \"" BENCHMARK_BASELINE_PATH "\" if the SD card is available.\n");
+    printf("    profile=<csv>           Appends the phase timings to a local CSV file, just like SAVE_PROFILE_CSV does on the console.\n");
+    printf("    memprofile=<csv>        Appends the phase memory usage to a local CSV file.\n");
+    printf("    u8profile=<spec>        Benchmarks a single custom synthetic U8 archive shape instead of the built-in ones:\n");
+    printf("                            \"name=<label>\", \"depth=<n>\", \"fan-out=<n>\", \"files=<n>\", \"name-length=<n>\",\n");
+    printf("                            \"file-size=<bytes>\", \"max-nodes=<n>\" and \"titlelist=0|1\", separated by commas.\n");
+    printf("    replay=<csv>            Replays an I/O trace saved by the console build against the emulated devices.\n");
+    printf("    fit=<csv>               Fits I/O models to an I/O trace, and applies them.\n");
+    printf("    jobs=<n>                Worker threads used for U8 extraction, inventory dump loading and NAND dump\n");
+    printf("                            verification (1-%u, 1 by default).\n", TASK_POOL_MAX_WORKERS);
+    printf("    dumps=<dir>             With \"action=verify\", verifies the System Menu contents from every NAND dump stored in a\n");
+    printf("                            subdirectory of <dir>, instead of the one set through \"nand=<dir>\".\n\n");
+    printf("Any other key is handled just like on the console (e.g. \"action=verify\", \"db=wwdb\", \"budget=10\").\n");
+}
+
+static bool parseHostArgument(const char *arg, bool *out_consumed)
+{
+    const char *value = strchr(arg, '=');
+    size_t key_len = (value ? (size_t)(value - arg) : 0);
+
+    *out_consumed = false;
+    if (!value++) return true;
+
+#define HOST_KEY_MATCHES(key)   (key_len == strlen(key) && !strncmp(arg, key, key_len))
+
+    if (HOST_KEY_MATCHES("nand"))
+    {
+        hostIoSetNandRoot(value);
+    } else
+    if (HOST_KEY_MATCHES("sd"))
+    {
+        hostIoSetSdRoot(value);
+    } else
+    if (HOST_KEY_MATCHES("model"))
+    {
+        if (!parseModelArgument(value)) return false;
+    } else
+    if (HOST_KEY_MATCHES("mknand"))
+    {
+        g_mknandPath = value;
+    } else
+    if (HOST_KEY_MATCHES("baseline"))
+    {
+        actionsSetBenchmarkBaselinePath(value);
+    } else
+    if (HOST_KEY_MATCHES("profile"))
+    {
+        g_profilePath = value;
+    } else
+    if (HOST_KEY_MATCHES("memprofile"))
+    {
+        g_memProfilePath = value;
+    } else
+    if (HOST_KEY_MATCHES("u8profile"))
+    {
+        if (!benchmarkSetU8Profile(value)) return false;
+    } else
+    if (HOST_KEY_MATCHES("replay"))
+    {
+        g_replayPath = value;
+    } else
+    if (HOST_KEY_MATCHES("fit"))
+    {
+        g_fitPath = value;
+    } else
+    if (HOST_KEY_MATCHES("dumps"))
+    {
+        g_dumpsPath = value;
+    } else
+    if (HOST_KEY_MATCHES("jobs"))
+    {
+        char *end = NULL;
+        unsigned long jobs = strtoul(value, &end, 10);
+        if (!*value || *end || !jobs || jobs > TASK_POOL_MAX_WORKERS) return false;
+        taskPoolSetWorkerCount((u32)jobs);
+    } else {
+        return true;
+    }
+
+#undef HOST_KEY_MATCHES
+
+    *out_consumed = true;
+
+    return (*value != '\0');
+}
+
+static bool parseModelArgument(const char *value)
+{
+    const char *spec = strchr(value, ':');
+    HostIoModel model = {0};
+    u8 device = HostIoDevice_Count;
+
+    if (!spec || (device = hostIoGetDeviceByName(value, (size_t)(spec - value))) >= HostIoDevice_Count || !hostIoParseModel(spec + 1, &model)) return false;
+
+    hostIoSetModel(device, &model);
+
+    return true;
+}
+
+static bool verifyNandDumps(const char *path)
+{
+    DIR *dir = NULL;
+    struct dirent *entry = NULL;
+    struct stat st = {0};
+    char tmd_path[HOST_IO_MAX_PATH] = {0};
+    HostDumpVerification *dumps = NULL;
+    u32 dump_count = 0, fail_count = 0;
+    u64 byte_count = 0, start_time = 0, elapsed_usec = 0, mb_per_sec_x100 = 0;
+    bool success = false;
+
+    if (!(dir = opendir(path)))
+    {
+        ERROR_MSG("opendir(\"%s\") failed! (%d).", path, errno);
+        return false;
+    }
+
+    if (!(dumps = (HostDumpVerification*)utilsAllocateMemory(HOST_MAX_DUMPS * sizeof(HostDumpVerification))))
+    {
+        ERROR_MSG("Failed to allocate memory for NAND dumps!");
+        goto out;
+    }
+
+    /* Only subdirectories holding a System Menu TMD are considered NAND dumps. */
+    while((entry = readdir(dir)))
+    {
+        HostDumpVerification *dump = &(dumps[dump_count]);
+
+        if (*(entry->d_name) == '.') continue;
+
+        if (dump_count >= HOST_MAX_DUMPS)
+        {
+            ERROR_MSG("Too many NAND dumps! Only the first %u will be verified.", HOST_MAX_DUMPS);
+            break;
+        }
+
+        if (snprintf(dump->root, sizeof(dump->root), "%s/%s", path, entry->d_name) >= (int)sizeof(dump->root) || \
+            snprintf(tmd_path, sizeof(tmd_path), "%s/title/%08x/%08x/content/title.tmd", dump->root, TITLE_UPPER(SYSTEM_MENU_TID), TITLE_LOWER(SYSTEM_MENU_TID)) >= (int)sizeof(tmd_path) || \
+            stat(tmd_path, &st) != 0) continue;
+
+        dump_count++;
+    }
+
+    if (!dump_count)
+    {
+        ERROR_MSG("No NAND dumps available at \"%s\"!", path);
+        goto out;
+    }
+
+    /* Results are displayed in a stable order, regardless of the directory order and the order tasks complete in. */
+    qsort(dumps, dump_count, sizeof(HostDumpVerification), compareDumpVerifications);
+
+    printf("Verifying %u NAND %s using %u %s...\n\n", dump_count, (dump_count == 1 ? "dump" : "dumps"), taskPoolGetWorkerCount(), \
+           (taskPoolGetWorkerCount() == 1 ? "worker" : "workers"));
+    fflush(stdout);
+
+    start_time = gettime();
+
+    /* Failed verifications don't stop the remaining tasks, since every dump must be reported. */
+    taskPoolRun(dump_count, verifyNandDumpTask, dumps);
+
+    elapsed_usec = diff_usec(start_time, gettime());
+    if (!elapsed_usec) elapsed_usec = 1;
+
+    for(u32 i = 0; i < dump_count; i++)
+    {
+        HostDumpVerification *dump = &(dumps[i]);
+        bool ok = (dump->tmd_loaded && !dump->result.fail_count);
+
+        if (dump->tmd_loaded)
+        {
+            printf("%s: v%u, %u passed, %u failed, %u skipped (0x%llX bytes) - %s.\n", dump->root, dump->title_version, dump->result.pass_count, dump->result.fail_count, \
+                   dump->result.skip_count, dump->result.byte_count, (ok ? "OK" : "FAILED"));
+        } else {
+            printf("%s: FAILED (TMD unavailable).\n", dump->root);
+        }
+
+        if (!ok) fail_count++;
+        byte_count += dump->result.byte_count;
+    }
+
+    /* Bytes per microsecond equals megabytes per second. */
+    mb_per_sec_x100 = ((byte_count * 100) / elapsed_usec);
+    printf("\n%u passed, %u failed. Hashed 0x%llX bytes in %llu ms (%llu.%02llu MB/s).\n\n", dump_count - fail_count, fail_count, byte_count, elapsed_usec / 1000, \
+           mb_per_sec_x100 / 100, mb_per_sec_x100 % 100);
+
+    success = (fail_count == 0);
+
+out:
+    if (dumps) utilsFreeMemory(dumps);
+
+    closedir(dir);
+
+    return success;
+}
+
+static bool verifyNandDumpTask(void *arg, u32 idx)
+{
+    HostDumpVerification *dump = &(((HostDumpVerification*)arg)[idx]);
+    signed_blob *stmd = NULL;
+    tmd *title_tmd = NULL;
+    u32 stmd_size = 0;
+
+    /* ES and ISFS calls made by this thread are resolved against the dump. */
+    hostIoSetThreadNandRoot(dump->root);
+
+    if ((stmd = utilsGetSignedTMDFromTitle(SYSTEM_MENU_TID, &stmd_size)) && (title_tmd = utilsGetTMDFromSignedBlob(stmd)))
+    {
+        dump->tmd_loaded = true;
+        dump->title_version = title_tmd->title_version;
+        ardbVerifyTitleContents(SYSTEM_MENU_TID, title_tmd, false, &(dump->result));
+    }
+
+    hostIoSetThreadNandRoot(NULL);
+
+    if (stmd) utilsFreeMemory(stmd);
+
+    return true;
+}
+
+static int compareDumpVerifications(const void *a, const void *b)
+{
+    return strcmp(((const HostDumpVerification*)a)->root, ((const HostDumpVerification*)b)->root);
+}
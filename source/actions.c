@@ -0,0 +1,172 @@
+/*
+ * actions.c
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils.h"
+#include "ardb.h"
+#include "rules.h"
+#include "inventory.h"
+#include "iocal.h"
+#include "titlemeta.h"
+#include "benchmark.h"
+#include "options.h"
+#include "actions.h"
+
+/* Global variables. */
+
+static const u32 g_ardbWc24Entries[] = {
+    ARDB_WC24_EVC_ENTRY,
+    ARDB_WC24_CMOC_ENTRY
+};
+
+static const u32 g_ardbWc24EntriesCount = MAX_ELEMENTS(g_ardbWc24Entries);
+
+static AspectRatioDatabaseRules g_ardbRules[AspectRatioDatabaseType_Count] = {0};
+
+#ifdef BENCHMARK_U8
+static const char *g_actionsBenchmarkBaselinePath = NULL;
+#endif  /* BENCHMARK_U8 */
+
+/* Function prototypes. */
+
+static bool actionsLoadPatchRules(const Options *opts);
+
+int actionsRun(const Options *opts, u8 action)
+{
+    AspectRatioDatabaseRules selected_rules[AspectRatioDatabaseType_Count] = {0};
+    bool dry_run = (action == OptionsAction_DryRun);
+
+#ifdef BENCHMARK_U8
+    const char *baseline_path = g_actionsBenchmarkBaselinePath;
+#endif  /* BENCHMARK_U8 */
+
+#ifdef BACKUP_U8_ARCHIVE
+    const TitleMetadata *sysmenu_meta = NULL;
+
+    /* Retry mounting the SD card for actions that need it, in case it was inserted after startup. */
+    if (action != OptionsAction_Verify && action != OptionsAction_Benchmark && !utilsMountSdCard())
+    {
+        printf("Failed to mount SD card!");
+        return -5;
+    }
+#endif  /* BACKUP_U8_ARCHIVE */
+
+    switch(action)
+    {
+        case OptionsAction_Patch:
+        case OptionsAction_DryRun:
+            /* Patch aspect ratio databases. */
+            printf("Patching 43DB entries%s...\n\n", (dry_run ? " (dry run)" : ""));
+
+            if (!actionsLoadPatchRules(opts)) return -6;
+
+            /* Rules for databases that weren't selected are left out. The copies don't own any memory. */
+            for(u8 type = 0; type < AspectRatioDatabaseType_Count; type++)
+            {
+                if (optionsIsDatabaseSelected(opts, type)) memcpy(&(selected_rules[type]), &(g_ardbRules[type]), sizeof(AspectRatioDatabaseRules));
+            }
+
+            if (!ardbPatchSystemMenuArchive(selected_rules, dry_run)) return -6;
+
+            break;
+#ifdef BACKUP_U8_ARCHIVE
+        case OptionsAction_Restore:
+            /* Restore System Menu U8 archive backup. */
+            printf("Restoring System Menu U8 archive...\n\n");
+            if (!ardbRestoreSystemMenuArchive()) return -7;
+            break;
+        case OptionsAction_Extract:
+            /* Extract System Menu U8 archive. */
+            printf("Extracting System Menu U8 archive...\n\n");
+            if (!ardbExtractSystemMenuArchive()) return -8;
+            break;
+        case OptionsAction_Inventory:
+            /* Export aspect ratio database inventory. */
+            printf("Exporting 43DB inventory...\n\n");
+            if (!inventoryExportToMountedDevice(INVENTORY_DUMP_PATH, INVENTORY_CSV_PATH)) return -11;
+            break;
+        case OptionsAction_Calibrate:
+            /* Calibrate I/O chunk sizes. NAND reads are measured using the System Menu U8 archive content. */
+            printf("Calibrating I/O chunk sizes...\n\n");
+            if (!(sysmenu_meta = titleMetaGet(SYSTEM_MENU_TID)) || !ioCalRun(sysmenu_meta->archive_content_path)) return -13;
+            break;
+#endif  /* BACKUP_U8_ARCHIVE */
+        case OptionsAction_Verify:
+            /* Verify System Menu contents. */
+            printf("Verifying System Menu contents...\n\n");
+            if (!ardbVerifySystemMenuContents()) return -9;
+            break;
+#ifdef BENCHMARK_U8
+        case OptionsAction_Benchmark:
+            /* Run U8 benchmark. Results are compared against baselines stored in the SD card, if available. */
+#ifdef BACKUP_U8_ARCHIVE
+            if (!baseline_path && utilsMountSdCard()) baseline_path = BENCHMARK_BASELINE_PATH;
+#endif  /* BACKUP_U8_ARCHIVE */
+            if (!benchmarkRunU8(baseline_path, opts->benchmark_budget)) return -12;
+            break;
+#endif  /* BENCHMARK_U8 */
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+#ifdef BENCHMARK_U8
+void actionsSetBenchmarkBaselinePath(const char *path)
+{
+    g_actionsBenchmarkBaselinePath = path;
+}
+#endif  /* BENCHMARK_U8 */
+
+void actionsFree(void)
+{
+    rulesFree(g_ardbRules);
+}
+
+static bool actionsLoadPatchRules(const Options *opts)
+{
+#ifdef BACKUP_U8_ARCHIVE
+    struct stat st = {0};
+
+    /* Use a custom rules file, if requested. */
+    if (*(opts->rules_path))
+    {
+        printf("Loading rules from \"%s\"...\n\n", opts->rules_path);
+        return rulesLoadFromFile(g_ardbRules, opts->rules_path);
+    }
+
+    /* Use the rules file from the SD card, if available. */
+    if (!opts->default_rules && utilsMountSdCard() && stat(RULES_FILE_PATH, &st) == 0)
+    {
+        printf("Loading rules from \"" RULES_FILE_PATH "\"...\n\n");
+        return rulesLoadFromFile(g_ardbRules, RULES_FILE_PATH);
+    }
+#else
+    (void)opts;
+#endif  /* BACKUP_U8_ARCHIVE */
+
+    /* Fall back to the WC24 channel entries from the WW 43DB. */
+    for(u32 i = 0; i < g_ardbWc24EntriesCount; i++)
+    {
+        if (!rulesAddRemovalCode(&(g_ardbRules[AspectRatioDatabaseType_WiiWare]), g_ardbWc24Entries[i])) return false;
+    }
+
+    return true;
+}
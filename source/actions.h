@@ -0,0 +1,40 @@
+/*
+ * actions.h
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifndef __ACTIONS_H__
+#define __ACTIONS_H__
+
+/// Runs the provided action (see OptionsAction), using the database selection, rules path and benchmark budget from opts.
+/// Actions that need the SD card retry mounting it first, in case it was inserted after startup.
+/// Shared by the console and host entry points. Returns 0 on success, or a negative error code.
+int actionsRun(const Options *opts, u8 action);
+
+#ifdef BENCHMARK_U8
+/// Makes actionsRun() compare U8 benchmark results against the baselines stored in path.
+/// By default, BENCHMARK_BASELINE_PATH is used if the SD card is available. NULL restores the default.
+void actionsSetBenchmarkBaselinePath(const char *path);
+#endif  /* BENCHMARK_U8 */
+
+/// Frees the patch rules loaded by actionsRun().
+void actionsFree(void);
+
+#endif /* __ACTIONS_H__ */
@@ -22,6 +22,12 @@
 #include "ardb.h"
 #include "u8.h"
 #include "sha1.h"
+#include "rules.h"
+#include "hashcache.h"
+#include "titlemeta.h"
+#include "profiler.h"
+#include "pipeline.h"
+#include "patch.h"
 
 static const char *g_ardbArchivePaths[AspectRatioDatabaseType_Count] = {
     "/titlelist/discdb.bin",
@@ -29,223 +35,390 @@ static const char *g_ardbArchivePaths[AspectRatioDatabaseType_Count] = {
     "/titlelist/wwdb.bin"
 };
 
-bool ardbPatchDatabaseFromSystemMenuArchive(u8 type, const u32 *entries, const u32 entry_count)
+static bool ardbCheckSystemMenuArchive(const char *content_path, const AspectRatioDatabaseRules *rules, bool *out_patch_needed);
+
+static bool ardbPatchDatabase(U8Context *u8_ctx, u8 type, const AspectRatioDatabaseRules *rules, bool *out_modified);
+
+static bool ardbIsPatchNeeded(const AspectRatioDatabase *ardb, const AspectRatioDatabaseRules *rules);
+
+static char *ardbCodeToString(u32 code, char *out);
+
+static int ardbEntrySortFunction(const void *a, const void *b);
+
+#ifdef BACKUP_U8_ARCHIVE
+static bool ardbIsBackupHashCached(const char *backup_path, const tmd_content *content);
+#endif  /* BACKUP_U8_ARCHIVE */
+
+const char *ardbGetArchivePath(u8 type)
+{
+    return (type < AspectRatioDatabaseType_Count ? g_ardbArchivePaths[type] : NULL);
+}
+
+bool ardbValidateDatabase(const u8 *ardb_data, u32 ardb_data_size, const char *ardb_path)
 {
-    if (type >= AspectRatioDatabaseType_Count)
+    const AspectRatioDatabase *ardb = (const AspectRatioDatabase*)ardb_data;
+
+    if (!ardb_data || ardb_data_size < sizeof(AspectRatioDatabase))
     {
-        ERROR_MSG("Invalid aspect ratio database type value!");
+        ERROR_MSG("Invalid ARDB size for \"%s\"!", ardb_path);
         return false;
     }
 
-    if (!entries || !entry_count)
+    u32 entry_count = BE32(ardb->entry_count);
+
+    if (BE32(ardb->magic) != ARDB_MAGIC)
     {
-        ERROR_MSG("Invalid patch entries array / count!");
+        ERROR_MSG("Invalid ARDB magic word for \"%s\": 0x%08X.", ardb_path, BE32(ardb->magic));
         return false;
     }
 
-    signed_blob *sysmenu_stmd = NULL;
-    u32 sysmenu_stmd_size = 0;
+    if (!entry_count || ardb_data_size < (sizeof(AspectRatioDatabase) + (sizeof(u32) * entry_count)))
+    {
+        ERROR_MSG("Invalid ARDB entry count for \"%s\": %u", ardb_path, entry_count);
+        return false;
+    }
 
-    tmd *sysmenu_tmd = NULL;
-    tmd_content *sysmenu_archive_content = NULL;
+    return true;
+}
 
-    char content_path[ISFS_MAXPATH] = {0};
-    u8 *sysmenu_archive_content_data = NULL;
-    u32 sysmenu_archive_content_size = 0;
+bool ardbIsSorted(const AspectRatioDatabase *ardb)
+{
+    if (!ardb) return false;
 
-    U8Context u8_ctx = {0};
-    u32 u8_node_idx = 0;
+    for(u32 i = 1, entry_count = BE32(ardb->entry_count); i < entry_count; i++)
+    {
+        if (BE32(ardb->entries[i - 1]) > BE32(ardb->entries[i])) return false;
+    }
 
-    u8 *ardb_data = NULL;
-    u32 ardb_data_size = 0, ardb_orig_entry_count = 0;
-    AspectRatioDatabase *ardb = NULL;
+    return true;
+}
 
-    bool success = false;
+void ardbSort(AspectRatioDatabase *ardb)
+{
+    if (!ardb || ardbIsSorted(ardb)) return;
+    qsort(ardb->entries, BE32(ardb->entry_count), sizeof(u32), ardbEntrySortFunction);
+}
 
-#ifdef BACKUP_U8_ARCHIVE
-    char backup_path[ISFS_MAXPATH] = {0};
-    sha1 sysmenu_archive_content_hash = {0};
-    bool hash_match = false, backup_created = false;
-#endif  /* BACKUP_U8_ARCHIVE */
+bool ardbContainsCode(const AspectRatioDatabase *ardb, u32 code)
+{
+    if (!ardb) return false;
 
-    /* Get System Menu TMD. */
-    sysmenu_stmd = utilsGetSignedTMDFromTitle(SYSTEM_MENU_TID, &sysmenu_stmd_size);
-    if (!sysmenu_stmd)
+    u32 low = 0, high = BE32(ardb->entry_count);
+
+    /* Entries are sorted by their full value, which means they're sorted by title code as well. */
+    while(low < high)
     {
-        ERROR_MSG("Error retrieving System Menu TMD!");
-        goto out;
+        u32 mid = (low + ((high - low) / 2)), val = (BE32(ardb->entries[mid]) >> 8);
+
+        if (val == code) return true;
+
+        if (val < code)
+        {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
     }
 
-    sysmenu_tmd = utilsGetTMDFromSignedBlob(sysmenu_stmd);
+    return false;
+}
 
-    /* Look for the biggest content record (U8 archive with resources). */
-    sysmenu_archive_content = &(sysmenu_tmd->contents[0]);
-    for(u16 i = 0; i < sysmenu_tmd->num_contents; i++)
+bool ardbMergeCodes(AspectRatioDatabase *ardb, u32 max_entry_count, const u32 *codes, u32 code_count, u32 *out_added_count)
+{
+    if (!ardb || BE32(ardb->entry_count) > max_entry_count || (code_count && !codes) || !out_added_count)
     {
-        if (sysmenu_tmd->contents[i].size > sysmenu_archive_content->size) sysmenu_archive_content = &(sysmenu_tmd->contents[i]);
+        ERROR_MSG("Invalid parameters!");
+        return false;
     }
 
-    /* Generate U8 archive content path and read the whole content file. */
-    sprintf(content_path, "/title/%08x/%08x/content/%08x.app", TITLE_UPPER(SYSTEM_MENU_TID), TITLE_LOWER(SYSTEM_MENU_TID), sysmenu_archive_content->cid);
-    sysmenu_archive_content_data = (u8*)utilsReadFileFromIsfs(content_path, &sysmenu_archive_content_size);
-    if (!sysmenu_archive_content_data)
+    u32 entry_count = BE32(ardb->entry_count), added_count = 0;
+    s32 i = 0, j = 0, k = 0;
+
+    /* Count missing codes. Both arrays are sorted, so a single pass is enough. */
+    for(u32 x = 0, y = 0; y < code_count;)
     {
-        ERROR_MSG("Failed to read System Menu U8 archive content data!");
-        goto out;
+        u32 val = (x < entry_count ? (BE32(ardb->entries[x]) >> 8) : 0xFFFFFFFF);
+
+        if (val < codes[y])
+        {
+            x++;
+        } else {
+            if (val != codes[y]) added_count++;
+            y++;
+        }
     }
 
-#ifdef BACKUP_U8_ARCHIVE
-    /* Calculate U8 archive content hash. */
-    sha1CalculateHash(sysmenu_archive_content_data, sysmenu_archive_content_size, sysmenu_archive_content_hash);
+    if (!added_count)
+    {
+        *out_added_count = 0;
+        return true;
+    }
 
-    /* Compare hashes. */
-    hash_match = (memcmp(sysmenu_archive_content->hash, sysmenu_archive_content_hash, SHA1_HASH_SIZE) == 0);
-    if (hash_match)
+    if ((max_entry_count - entry_count) < added_count)
     {
-        /* Create output directory. */
-        sprintf(backup_path, "sd:/" APP_TITLE "_bkp");
-        mkdir(backup_path, 0777);
+        ERROR_MSG("Not enough room for 0x%X additional entries!", added_count);
+        return false;
+    }
 
-        /* Generate backup content path. */
-        strcat(backup_path, strrchr(content_path, '/'));
+    /* Merge both arrays starting from the end, so that no entries are overwritten before being moved. */
+    i = (s32)entry_count - 1;
+    j = (s32)code_count - 1;
+    k = (s32)(entry_count + added_count) - 1;
+
+    while(j >= 0)
+    {
+        u32 val = (i >= 0 ? (BE32(ardb->entries[i]) >> 8) : 0);
 
-        /* Write backup content file. */
-        backup_created = utilsWriteFileToMountedDevice(backup_path, sysmenu_archive_content_data, sysmenu_archive_content_size);
-        if (!backup_created)
+        if (i >= 0 && val > codes[j])
         {
-            ERROR_MSG("Failed to write U8 archive backup!");
-            goto out;
+            ardb->entries[k--] = ardb->entries[i--];
+        } else
+        if (i >= 0 && val == codes[j])
+        {
+            /* Already present. */
+            j--;
+        } else {
+            ardb->entries[k--] = BE32(codes[j--] << 8);
         }
+    }
 
-        printf("Saved System Menu U8 archive backup to \"%s\".\nPlease copy it to a safe location.\n\n", backup_path);
-    } else {
-        printf("U8 archive content hash mismatch! Skipping backup generation.\n\n");
+    ardb->entry_count = BE32(entry_count + added_count);
+    *out_added_count = added_count;
+
+    return true;
+}
+
+bool ardbPatchSystemMenuArchive(const AspectRatioDatabaseRules *rules, bool dry_run)
+{
+    if (!rules)
+    {
+        ERROR_MSG("Invalid rules array!");
+        return false;
     }
+
+    const TitleMetadata *sysmenu_meta = NULL;
+
+    const char *content_path = NULL;
+    u8 *sysmenu_archive_content_data = NULL;
+    u32 sysmenu_archive_content_size = 0;
+
+    U8Context u8_ctx = {0};
+
+    sha1 patched_content_hash = {0};
+    bool patch_needed = true, modified = false, success = false;
+
+#ifdef BACKUP_U8_ARCHIVE
+    tmd_content *sysmenu_archive_content = NULL;
+    char backup_path[ISFS_MAXPATH] = {0}, backup_tmp_path[ISFS_MAXPATH + 4] = {0};
+    sha1 sysmenu_archive_content_hash = {0};
+    Sha1Checkpoints sysmenu_archive_content_checkpoints = {0};
+    bool hash_match = false, backup_valid = false, backup_created = false;
 #endif  /* BACKUP_U8_ARCHIVE */
 
-    /* Initialize U8 context. */
-    if (!u8ContextInit(sysmenu_archive_content_data, sysmenu_archive_content_size, &u8_ctx))
+    /* Get System Menu metadata. This also locates the content record holding the U8 archive with resources. */
+    profilerSetMemoryPhase(ProfilerPhase_TmdFetch);
+    sysmenu_meta = titleMetaGet(SYSTEM_MENU_TID);
+    if (!sysmenu_meta)
     {
-        ERROR_MSG("Failed to initialize System Menu U8 archive context!");
+        ERROR_MSG("Error retrieving System Menu TMD!");
         goto out;
     }
 
-    /* Get U8 node for the aspect ratio database path. */
-    if (!u8GetFileNodeByPath(&u8_ctx, g_ardbArchivePaths[type], &u8_node_idx))
+#ifdef BACKUP_U8_ARCHIVE
+    sysmenu_archive_content = sysmenu_meta->archive_content;
+#endif  /* BACKUP_U8_ARCHIVE */
+    content_path = sysmenu_meta->archive_content_path;
+
+    /* Check if any changes are needed before reading the whole content file. */
+    /* If this check fails, just carry on with the full process. Any actual errors will be reported later. */
+    profilerSetMemoryPhase(ProfilerPhase_IsfsRead);
+#ifdef BACKUP_U8_ARCHIVE
+    /* U8 archive patches can only be checked after loading the whole content file, so skip this step if there are any. */
+    if (!patchGetEntryCount() && ardbCheckSystemMenuArchive(content_path, rules, &patch_needed) && !patch_needed)
+#else
+    if (ardbCheckSystemMenuArchive(content_path, rules, &patch_needed) && !patch_needed)
+#endif  /* BACKUP_U8_ARCHIVE */
     {
-        ERROR_MSG("Failed to retrieve U8 node for \"%s\"!", g_ardbArchivePaths[type]);
+        printf("The System Menu U8 archive is already patched. No changes are needed.\n\n");
+        success = true;
         goto out;
     }
 
-    /* Read aspect ratio database data. */
-    if (!(ardb_data = u8LoadFileData(&u8_ctx, u8_node_idx, &ardb_data_size)) || ardb_data_size < sizeof(AspectRatioDatabase))
+#ifdef BACKUP_U8_ARCHIVE
+    /* Dry runs don't need a backup, since nothing is written. */
+    if (!dry_run)
     {
-        ERROR_MSG("Failed to read \"%s\" contents from U8 archive!", g_ardbArchivePaths[type]);
-        goto out;
+        /* Create output directory. */
+        sprintf(backup_path, "sd:/" APP_TITLE "_bkp");
+        mkdir(backup_path, 0777);
+
+        /* Generate backup content paths. */
+        /* The backup is streamed to a temporary file, which only replaces any existing backup if the content hash matches. */
+        strcat(backup_path, strrchr(content_path, '/'));
+        sprintf(backup_tmp_path, "%s.tmp", backup_path);
+
+        /* Don't write the backup again if the existing one is known to match the TMD hash. */
+        /* This is a read-only shortcut: restoring a backup always hashes its data again before writing anything to the NAND. */
+        backup_valid = ardbIsBackupHashCached(backup_path, sysmenu_archive_content);
     }
 
-    /* Parse aspect ratio database. */
-    ardb = (AspectRatioDatabase*)ardb_data;
+    /* Read the whole content file. Its hash is calculated and the backup is written at the same time. */
+    /* The hash is also needed by dry runs, since it's used as the U8 index key. SHA-1 midstates are kept to speed up the post-patch hash calculation. */
+    profilerSetMemoryPhase(ProfilerPhase_IsfsRead);
+    sysmenu_archive_content_data = (u8*)pipelineReadIsfsFile(content_path, &sysmenu_archive_content_size, sysmenu_archive_content_hash, \
+                                                             &sysmenu_archive_content_checkpoints, ((dry_run || backup_valid) ? NULL : backup_tmp_path));
+#else
+    /* Read the whole content file. */
+    profilerSetMemoryPhase(ProfilerPhase_IsfsRead);
+    sysmenu_archive_content_data = (u8*)pipelineReadIsfsFile(content_path, &sysmenu_archive_content_size, NULL, NULL, NULL);
+#endif  /* BACKUP_U8_ARCHIVE */
 
-    if (ardb->magic != ARDB_MAGIC)
+    if (!sysmenu_archive_content_data)
     {
-        ERROR_MSG("Invalid ARDB magic word for \"%s\": 0x%08X.", g_ardbArchivePaths[type], ardb->magic);
+        ERROR_MSG("Failed to read System Menu U8 archive content data!");
         goto out;
     }
 
-    if (!ardb->entry_count || ardb_data_size < (sizeof(AspectRatioDatabase) + (sizeof(u32) * ardb->entry_count)))
+#ifdef BACKUP_U8_ARCHIVE
+    if (!dry_run)
     {
-        ERROR_MSG("Invalid ARDB entry count for \"%s\": %u", g_ardbArchivePaths[type], ardb->entry_count);
-        goto out;
+        /* Compare hashes. */
+        hash_match = (memcmp(sysmenu_archive_content->hash, sysmenu_archive_content_hash, SHA1_HASH_SIZE) == 0);
+        if (hash_match && backup_valid)
+        {
+            printf("Found a valid System Menu U8 archive backup at \"%s\". Skipping backup generation.\n\n", backup_path);
+        } else
+        if (hash_match)
+        {
+            /* Replace any previous backup. */
+            remove(backup_path);
+
+            backup_created = (rename(backup_tmp_path, backup_path) == 0);
+            if (!backup_created)
+            {
+                ERROR_MSG("Failed to write U8 archive backup!");
+                goto out;
+            }
+
+            /* The backup hash is already known, so cache it right away. */
+            HashCacheKey backup_key = {0};
+            if (hashCacheGetKeyFromMountedDevice(backup_path, &backup_key)) hashCacheStore(&backup_key, sysmenu_archive_content_hash);
+
+            printf("Saved System Menu U8 archive backup to \"%s\".\nPlease copy it to a safe location.\n\n", backup_path);
+        } else {
+            remove(backup_tmp_path);
+            printf("U8 archive content hash mismatch! Skipping backup generation.\n\n");
+        }
     }
+#endif  /* BACKUP_U8_ARCHIVE */
 
-    ardb_orig_entry_count = ardb->entry_count;
-
-    printf("Loaded \"%s\" (v%u, holding %u %s)", g_ardbArchivePaths[type], ardb->version, ardb->entry_count, (ardb->entry_count == 1 ? "entry" : "entries"));
+    /* Initialize U8 context. */
+    profilerSetMemoryPhase(ProfilerPhase_U8Parse);
+#ifdef BACKUP_U8_ARCHIVE
+    /* Reuse a previously generated U8 index, if available. */
+    if (!u8ContextInitWithIndex(sysmenu_archive_content_data, sysmenu_archive_content_size, sysmenu_archive_content_hash, U8_INDEX_PATH, &u8_ctx))
+#else
+    if (!u8ContextInit(sysmenu_archive_content_data, sysmenu_archive_content_size, &u8_ctx))
+#endif  /* BACKUP_U8_ARCHIVE */
+    {
+        ERROR_MSG("Failed to initialize System Menu U8 archive context!");
+        goto out;
+    }
 
-#ifdef DISPLAY_ARDB_ENTRIES
-    if (ardb->entry_count)
+    /* Patch aspect ratio databases. */
+    profilerSetMemoryPhase(ProfilerPhase_ArdbEdit);
+    for(u8 type = 0; type < AspectRatioDatabaseType_Count; type++)
     {
-        printf(":\n");
+        bool db_modified = false;
 
-        for(u32 i = 0; i < ardb->entry_count; i++)
-        {
-            printf("%.*s", 3, (char*)&(ardb->entries[i]));
-            if (i < (ardb->entry_count - 1)) printf(", ");
-        }
+        if (!rulesHasEdits(&(rules[type]))) continue;
 
-        printf("\n\n");
-    } else {
-        printf(".\n\n");
-    }
-#else   /* DISPLAY_ARDB_ENTRIES */
-    printf(".\n\n");
-#endif  /* DISPLAY_ARDB_ENTRIES */
+        if (!ardbPatchDatabase(&u8_ctx, type, &(rules[type]), &db_modified)) goto out;
 
-    fflush(stdout);
+        modified |= db_modified;
+    }
 
-    /* Patch aspect ratio database. */
-    for(u32 i = 0, j = 0; i < ardb->entry_count; i++, j++)
+#ifdef BACKUP_U8_ARCHIVE
+    /* Apply U8 archive patches. These are committed alongside the ARDB changes. */
+    if (patchGetEntryCount() > 0)
     {
-        for(u32 k = 0; k < entry_count; k++)
-        {
-            u32 val = (ardb->entries[i] >> 8);
-            if (val != entries[k]) continue;
+        bool patched = false;
 
-            /* Jackpot. */
-            printf("Removing 43DB entry #%u: %.*s. (0x%X).\n", j, 3, (char*)&val, val);
-            fflush(stdout);
+        if (!patchApplyToU8Archive(&u8_ctx, &patched)) goto out;
 
-            if ((i + 1) < ardb->entry_count) memmove(&(ardb->entries[i]), &(ardb->entries[i + 1]), sizeof(u32) * (ardb->entry_count - i - 1));
-            memset(&(ardb->entries[ardb->entry_count - 1]), 0, sizeof(u32));
+        modified |= patched;
 
-            ardb->entry_count--;
-            i--;
-
-            break;
+        if (!modified)
+        {
+            printf("The System Menu U8 archive is already patched. No changes are needed.\n\n");
+            success = true;
+            goto out;
         }
     }
+#endif  /* BACKUP_U8_ARCHIVE */
 
-    if (ardb->entry_count == ardb_orig_entry_count)
+    if (!modified)
     {
-        ERROR_MSG("Unable to locate desired TIDs within \"%s\". No changes have been made.", g_ardbArchivePaths[type]);
+        ERROR_MSG("Unable to locate desired TIDs within the System Menu U8 archive. No changes have been made.");
         goto out;
     }
 
-    printf("\n");
-    fflush(stdout);
-
-    /* Save modified aspect ratio database data to U8 archive buffer. */
-    ardb_data_size = (sizeof(AspectRatioDatabase) + (sizeof(u32) * ardb->entry_count));
+    if (dry_run)
+    {
+        printf("Dry run: no changes have been written to the NAND storage.\n\n");
+        success = true;
+        goto out;
+    }
 
-    if (!u8SaveFileData(&u8_ctx, u8_node_idx, ardb_data, ardb_data_size))
+    /* Calculate the expected hash for the modified U8 archive before writing it, so it can be verified afterwards. */
+    profilerSetMemoryPhase(ProfilerPhase_Sha1);
+#ifdef BACKUP_U8_ARCHIVE
+    /* Only the data located after the last checkpoint before the first modified byte needs to be hashed. */
+    if (!sha1ResumeHash(&sysmenu_archive_content_checkpoints, sysmenu_archive_content_data, sysmenu_archive_content_size, u8_ctx.dirty_offset, patched_content_hash))
+#else
+    if (!sha1CalculateHash(sysmenu_archive_content_data, sysmenu_archive_content_size, patched_content_hash))
+#endif  /* BACKUP_U8_ARCHIVE */
     {
-        ERROR_MSG("Failed to save modified aspect ratio database data into U8 archive!");
+        ERROR_MSG("Failed to calculate modified U8 archive hash!");
         goto out;
     }
 
     /* Write modified U8 archive buffer to the NAND storage. */
+    profilerSetMemoryPhase(ProfilerPhase_IsfsWrite);
     if (!utilsWriteFileToIsfs(content_path, sysmenu_archive_content_data, sysmenu_archive_content_size))
     {
         ERROR_MSG("Failed to write modified U8 archive to \"%s\"!", content_path);
         goto out;
     }
 
+    /* Read the written data back and make sure it matches. */
+    profilerSetMemoryPhase(ProfilerPhase_IsfsRead);
+    if (!utilsVerifyIsfsFileHash(content_path, patched_content_hash, sysmenu_archive_content_size))
+    {
+#ifdef BACKUP_U8_ARCHIVE
+        ERROR_MSG("Modified U8 archive verification failed! Please restore the System Menu U8 archive backup.");
+#else
+        ERROR_MSG("Modified U8 archive verification failed!");
+#endif  /* BACKUP_U8_ARCHIVE */
+        goto out;
+    }
+
+    printf("Modified U8 archive successfully verified.\n\n");
+
     /* Update output flag. */
     success = true;
 
 out:
-    if (ardb_data) free(ardb_data);
-
     u8ContextFree(&u8_ctx);
 
-    if (sysmenu_archive_content_data) free(sysmenu_archive_content_data);
-
-    if (sysmenu_stmd) free(sysmenu_stmd);
+    if (sysmenu_archive_content_data) utilsFreeMemory(sysmenu_archive_content_data);
 
 #ifdef BACKUP_U8_ARCHIVE
-    if (hash_match && !backup_created)
+    sha1CheckpointsFree(&sysmenu_archive_content_checkpoints);
+
+    if (hash_match && !backup_valid && !backup_created)
     {
+        remove(backup_tmp_path);
         sprintf(backup_path, "sd:/" APP_TITLE "_bkp");
         remove(backup_path);
     }
@@ -254,49 +427,139 @@ out:
     return success;
 }
 
-#ifdef BACKUP_U8_ARCHIVE
-bool ardbRestoreSystemMenuArchive(void)
+bool ardbVerifyTitleContents(u64 title_id, const tmd *title_tmd, bool verbose, ArdbVerifyResult *out_result)
 {
-    signed_blob *sysmenu_stmd = NULL;
-    u32 sysmenu_stmd_size = 0;
+    if (!title_tmd || !out_result)
+    {
+        ERROR_MSG("Invalid parameters!");
+        return false;
+    }
+
+    char content_path[ISFS_MAXPATH] = {0};
+    u64 start_time = gettime();
+
+    memset(out_result, 0, sizeof(ArdbVerifyResult));
+
+    for(u16 i = 0; i < title_tmd->num_contents; i++)
+    {
+        const tmd_content *content = &(title_tmd->contents[i]);
+        sha1 hash = {0};
+        u32 size = 0;
+        u64 content_start_time = 0, content_elapsed_usec = 0;
+        bool hash_calculated = false, match = false;
+
+        if (verbose) printf("Content #%u (%08x): ", content->index, content->cid);
+
+        /* Shared contents aren't stored in the title directory. */
+        if (!titleMetaGetContentPath(title_id, content, content_path))
+        {
+            if (verbose) printf("shared content, skipped.\n");
+            out_result->skip_count++;
+            continue;
+        }
+
+        if (verbose) fflush(stdout);
+
+        content_start_time = gettime();
+        hash_calculated = utilsCalculateIsfsFileHash(content_path, hash, &size);
+        content_elapsed_usec = diff_usec(content_start_time, gettime());
+        if (!content_elapsed_usec) content_elapsed_usec = 1;
+
+        match = (hash_calculated && (u64)size == content->size && memcmp(hash, content->hash, SHA1_HASH_SIZE) == 0);
+        if (match)
+        {
+            out_result->pass_count++;
+        } else {
+            out_result->fail_count++;
+        }
+
+        if (hash_calculated) out_result->byte_count += size;
 
+        if (!verbose) continue;
+
+        if (hash_calculated)
+        {
+            printf("%s (0x%X bytes, %llu KiB/s).\n", (match ? "OK" : ((u64)size != content->size ? "FAILED (size mismatch)" : "FAILED (hash mismatch)")), size, \
+                   (((u64)size * 1000000) / content_elapsed_usec) / 1024);
+        } else {
+            printf("FAILED (read error).\n");
+        }
+    }
+
+    out_result->elapsed_usec = diff_usec(start_time, gettime());
+    if (!out_result->elapsed_usec) out_result->elapsed_usec = 1;
+
+    return (out_result->fail_count == 0);
+}
+
+bool ardbVerifySystemMenuContents(void)
+{
+    const TitleMetadata *sysmenu_meta = NULL;
     tmd *sysmenu_tmd = NULL;
+    ArdbVerifyResult result = {0};
+    bool success = false;
+
+    /* Get System Menu metadata. */
+    profilerSetMemoryPhase(ProfilerPhase_TmdFetch);
+    sysmenu_meta = titleMetaGet(SYSTEM_MENU_TID);
+    if (!sysmenu_meta)
+    {
+        ERROR_MSG("Error retrieving System Menu TMD!");
+        return false;
+    }
+
+    sysmenu_tmd = sysmenu_meta->tmd;
+
+    printf("Verifying %u System Menu %s (v%u)...\n\n", sysmenu_tmd->num_contents, (sysmenu_tmd->num_contents == 1 ? "content" : "contents"), sysmenu_tmd->title_version);
+    fflush(stdout);
+
+    success = ardbVerifyTitleContents(SYSTEM_MENU_TID, sysmenu_tmd, true, &result);
+
+    printf("\n%u passed, %u failed, %u skipped. Hashed 0x%llX bytes in %llu ms (%llu KiB/s).\n", result.pass_count, result.fail_count, result.skip_count, result.byte_count, \
+           result.elapsed_usec / 1000, ((result.byte_count * 1000000) / result.elapsed_usec) / 1024);
+
+    if (result.fail_count) printf("Keep in mind the U8 archive content won't match its TMD hash once it has been patched.\n");
+
+    printf("\n");
+
+    return success;
+}
+
+#ifdef BACKUP_U8_ARCHIVE
+bool ardbRestoreSystemMenuArchive(void)
+{
+    const TitleMetadata *sysmenu_meta = NULL;
     tmd_content *sysmenu_archive_content = NULL;
 
-    char content_path[ISFS_MAXPATH] = {0};
+    const char *content_path = NULL;
 
     char backup_path[ISFS_MAXPATH] = {0};
     u8 *backup_content_data = NULL;
     u32 backup_content_size = 0;
     sha1 backup_content_hash = {0};
 
+    u32 written_size = 0;
+
     bool success = false;
 
-    /* Get System Menu TMD. */
-    sysmenu_stmd = utilsGetSignedTMDFromTitle(SYSTEM_MENU_TID, &sysmenu_stmd_size);
-    if (!sysmenu_stmd)
+    /* Get System Menu metadata. This also locates the content record holding the U8 archive with resources. */
+    profilerSetMemoryPhase(ProfilerPhase_TmdFetch);
+    sysmenu_meta = titleMetaGet(SYSTEM_MENU_TID);
+    if (!sysmenu_meta)
     {
         ERROR_MSG("Error retrieving System Menu TMD!");
         goto out;
     }
 
-    sysmenu_tmd = utilsGetTMDFromSignedBlob(sysmenu_stmd);
-
-    /* Look for the biggest content record (U8 archive with resources). */
-    sysmenu_archive_content = &(sysmenu_tmd->contents[0]);
-    for(u16 i = 0; i < sysmenu_tmd->num_contents; i++)
-    {
-        if (sysmenu_tmd->contents[i].size > sysmenu_archive_content->size) sysmenu_archive_content = &(sysmenu_tmd->contents[i]);
-    }
-
-    /* Generate U8 archive content path. */
-    sprintf(content_path, "/title/%08x/%08x/content/%08x.app", TITLE_UPPER(SYSTEM_MENU_TID), TITLE_LOWER(SYSTEM_MENU_TID), sysmenu_archive_content->cid);
+    sysmenu_archive_content = sysmenu_meta->archive_content;
+    content_path = sysmenu_meta->archive_content_path;
 
     /* Generate backup content path. */
     sprintf(backup_path, "sd:/" APP_TITLE "_bkp");
     strcat(backup_path, strrchr(content_path, '/'));
 
     /* Read whole backup content file. */
+    profilerSetMemoryPhase(ProfilerPhase_SdRead);
     backup_content_data = (u8*)utilsReadFileFromMountedDevice(backup_path, &backup_content_size);
     if (!backup_content_data)
     {
@@ -304,8 +567,13 @@ bool ardbRestoreSystemMenuArchive(void)
         goto out;
     }
 
-    /* Calculate U8 archive content hash. */
-    sha1CalculateHash(backup_content_data, backup_content_size, backup_content_hash);
+    /* Calculate U8 archive content hash. The hash cache isn't used here, since the backup data is about to be written to the NAND. */
+    profilerSetMemoryPhase(ProfilerPhase_Sha1);
+    if (!sha1CalculateHash(backup_content_data, backup_content_size, backup_content_hash))
+    {
+        ERROR_MSG("Failed to calculate U8 archive backup hash!");
+        goto out;
+    }
 
     /* Compare hashes. */
     if (memcmp(sysmenu_archive_content->hash, backup_content_hash, SHA1_HASH_SIZE) != 0)
@@ -314,21 +582,413 @@ bool ardbRestoreSystemMenuArchive(void)
         goto out;
     }
 
-    /* Write U8 archive buffer to the NAND storage. */
-    if (!utilsWriteFileToIsfs(content_path, backup_content_data, backup_content_size))
+    /* Refresh the cached backup hash, so that the next patch run doesn't write the backup again. */
+    HashCacheKey backup_key = {0};
+    if (hashCacheGetKeyFromMountedDevice(backup_path, &backup_key)) hashCacheStore(&backup_key, backup_content_hash);
+
+    /* Only write the NAND clusters that differ from the backup. */
+    profilerSetMemoryPhase(ProfilerPhase_IsfsWrite);
+    if (!utilsWriteFileDifferencesToIsfs(content_path, backup_content_data, backup_content_size, &written_size))
     {
         ERROR_MSG("Failed to write U8 archive backup to \"%s\"!", content_path);
         goto out;
     }
 
+    if (!written_size)
+    {
+        printf("The System Menu U8 archive already matches its backup. No changes are needed.\n\n");
+        success = true;
+        goto out;
+    }
+
+    printf("Rewrote 0x%X out of 0x%X bytes from the System Menu U8 archive.\n\n", written_size, backup_content_size);
+
+    /* Verify the restored content against the TMD. */
+    profilerSetMemoryPhase(ProfilerPhase_IsfsRead);
+    if (!utilsVerifyIsfsFileHash(content_path, sysmenu_archive_content->hash, backup_content_size))
+    {
+        ERROR_MSG("Restored U8 archive content hash mismatch!");
+        goto out;
+    }
+
     /* Update output flag. */
     success = true;
 
 out:
-    if (backup_content_data) free(backup_content_data);
+    if (backup_content_data) utilsFreeMemory(backup_content_data);
+
+    return success;
+}
+
+bool ardbExtractSystemMenuArchive(void)
+{
+    const TitleMetadata *sysmenu_meta = NULL;
+    tmd_content *sysmenu_archive_content = NULL;
+
+    const char *content_path = NULL;
+    u8 *sysmenu_archive_content_data = NULL;
+    u32 sysmenu_archive_content_size = 0;
+
+    U8Context u8_ctx = {0};
+
+    char extract_path[ISFS_MAXPATH] = {0};
+    u32 file_count = 0;
+    u64 data_size = 0, start_time = 0, elapsed_usec = 0, mb_per_sec_x100 = 0;
+
+    bool success = false;
+
+    /* Get System Menu metadata. This also locates the content record holding the U8 archive with resources. */
+    profilerSetMemoryPhase(ProfilerPhase_TmdFetch);
+    sysmenu_meta = titleMetaGet(SYSTEM_MENU_TID);
+    if (!sysmenu_meta)
+    {
+        ERROR_MSG("Error retrieving System Menu TMD!");
+        goto out;
+    }
+
+    sysmenu_archive_content = sysmenu_meta->archive_content;
+    content_path = sysmenu_meta->archive_content_path;
+
+    /* Read the whole content file. */
+    profilerSetMemoryPhase(ProfilerPhase_IsfsRead);
+    sysmenu_archive_content_data = (u8*)utilsReadFileFromIsfs(content_path, &sysmenu_archive_content_size);
+    if (!sysmenu_archive_content_data)
+    {
+        ERROR_MSG("Failed to read System Menu U8 archive content data!");
+        goto out;
+    }
 
-    if (sysmenu_stmd) free(sysmenu_stmd);
+    /* Initialize U8 context. */
+    profilerSetMemoryPhase(ProfilerPhase_U8Parse);
+    if (!u8ContextInit(sysmenu_archive_content_data, sysmenu_archive_content_size, &u8_ctx))
+    {
+        ERROR_MSG("Failed to initialize System Menu U8 archive context!");
+        goto out;
+    }
+
+    /* Create parent output directory. */
+    sprintf(extract_path, "sd:/" APP_TITLE "_ext");
+    mkdir(extract_path, 0777);
+
+    /* Generate extraction path. */
+    sprintf(extract_path + strlen(extract_path), "/%08x", sysmenu_archive_content->cid);
+
+    printf("Extracting System Menu U8 archive to \"%s\"...\n", extract_path);
+    fflush(stdout);
+
+    /* Extract U8 archive. */
+    profilerSetMemoryPhase(ProfilerPhase_SdWrite);
+    start_time = gettime();
+
+    if (!u8ExtractArchiveToMountedDevice(&u8_ctx, extract_path, &file_count, &data_size))
+    {
+        ERROR_MSG("Failed to extract System Menu U8 archive!");
+        goto out;
+    }
+
+    elapsed_usec = diff_usec(start_time, gettime());
+    if (!elapsed_usec) elapsed_usec = 1;
+
+    printf("Extracted %u %s (0x%llX bytes) in %llu ms.\n", file_count, (file_count == 1 ? "file" : "files"), data_size, elapsed_usec / 1000);
+    /* Bytes per microsecond equals megabytes per second. */
+    mb_per_sec_x100 = ((data_size * 100) / elapsed_usec);
+    printf("Throughput: %llu files/s, %llu.%02llu MB/s.\n\n", ((u64)file_count * 1000000) / elapsed_usec, mb_per_sec_x100 / 100, mb_per_sec_x100 % 100);
+
+    /* Update output flag. */
+    success = true;
+
+out:
+    u8ContextFree(&u8_ctx);
+
+    if (sysmenu_archive_content_data) utilsFreeMemory(sysmenu_archive_content_data);
 
     return success;
 }
 #endif  /* BACKUP_U8_ARCHIVE */
+
+static bool ardbPatchDatabase(U8Context *u8_ctx, u8 type, const AspectRatioDatabaseRules *rules, bool *out_modified)
+{
+    const char *ardb_path = g_ardbArchivePaths[type];
+    u32 u8_node_idx = 0;
+
+    u8 *ardb_data = NULL, *ardb_buf = NULL;
+    u32 ardb_data_size = 0, ardb_capacity = 0, ardb_orig_entry_count = 0, entry_count = 0;
+    AspectRatioDatabase *ardb = NULL;
+
+    char code_str[4] = {0};
+    u64 start_time = profilerSpanBegin();
+    bool modified = false, success = false;
+
+    /* Get U8 node for the aspect ratio database path. */
+    if (!u8GetFileNodeByPath(u8_ctx, ardb_path, &u8_node_idx))
+    {
+        ERROR_MSG("Failed to retrieve U8 node for \"%s\"!", ardb_path);
+        goto out;
+    }
+
+    /* Read aspect ratio database data. */
+    if (!(ardb_data = u8LoadFileData(u8_ctx, u8_node_idx, &ardb_data_size)))
+    {
+        ERROR_MSG("Failed to read \"%s\" contents from U8 archive!", ardb_path);
+        goto out;
+    }
+
+    /* Parse aspect ratio database. */
+    if (!ardbValidateDatabase(ardb_data, ardb_data_size, ardb_path)) goto out;
+
+    ardb = (AspectRatioDatabase*)ardb_data;
+
+    /* Allocate a working buffer big enough to hold all additions. */
+    ardb_orig_entry_count = BE32(ardb->entry_count);
+
+    ardb_buf = (u8*)utilsAllocateMemory(sizeof(AspectRatioDatabase) + (sizeof(u32) * (ardb_orig_entry_count + rules->add_code_count)));
+    if (!ardb_buf)
+    {
+        ERROR_MSG("Failed to allocate memory for \"%s\" working buffer!", ardb_path);
+        goto out;
+    }
+
+    memcpy(ardb_buf, ardb_data, sizeof(AspectRatioDatabase) + (sizeof(u32) * ardb_orig_entry_count));
+    ardb = (AspectRatioDatabase*)ardb_buf;
+
+    printf("Loaded \"%s\" (v%u, holding %u %s)", ardb_path, BE32(ardb->version), ardb_orig_entry_count, (ardb_orig_entry_count == 1 ? "entry" : "entries"));
+
+#ifdef DISPLAY_ARDB_ENTRIES
+    if (ardb_orig_entry_count)
+    {
+        printf(":\n");
+
+        for(u32 i = 0; i < ardb_orig_entry_count; i++)
+        {
+            printf("%.*s", 3, (char*)&(ardb->entries[i]));
+            if (i < (ardb_orig_entry_count - 1)) printf(", ");
+        }
+
+        printf("\n\n");
+    } else {
+        printf(".\n\n");
+    }
+#else   /* DISPLAY_ARDB_ENTRIES */
+    printf(".\n\n");
+#endif  /* DISPLAY_ARDB_ENTRIES */
+
+    fflush(stdout);
+
+    /* Remove entries. These are matched in blocks, and kept entries are compacted in a single pass. */
+    for(u32 i = 0; i < ardb_orig_entry_count; i += RULES_MATCH_BLOCK_SIZE)
+    {
+        u32 block_count = ((ardb_orig_entry_count - i) < RULES_MATCH_BLOCK_SIZE ? (ardb_orig_entry_count - i) : RULES_MATCH_BLOCK_SIZE);
+        u32 mask = rulesMatchEntryBlock(rules, &(ardb->entries[i]), block_count);
+
+        /* Fast path: keep the whole block. */
+        if (!mask)
+        {
+            if (entry_count != i) memmove(&(ardb->entries[entry_count]), &(ardb->entries[i]), sizeof(u32) * block_count);
+            entry_count += block_count;
+            continue;
+        }
+
+        for(u32 j = 0; j < block_count; j++)
+        {
+            if (mask & (1U << j))
+            {
+                /* Jackpot. */
+                u32 val = (BE32(ardb->entries[i + j]) >> 8);
+                printf("Removing 43DB entry #%u: %s. (0x%X).\n", i + j, ardbCodeToString(val, code_str), val);
+                modified = true;
+                continue;
+            }
+
+            ardb->entries[entry_count++] = ardb->entries[i + j];
+        }
+    }
+
+    ardb->entry_count = BE32(entry_count);
+
+    /* Add entries. */
+    if (rules->add_code_count)
+    {
+        u32 added_count = 0;
+
+        /* Additions are merged, which requires a sorted database. */
+        if (!ardbIsSorted(ardb))
+        {
+            printf("\"%s\" isn't sorted. Sorting it before adding new entries.\n", ardb_path);
+            ardbSort(ardb);
+            modified = true;
+        }
+
+        for(u32 i = 0; i < rules->add_code_count; i++)
+        {
+            u32 val = rules->add_codes[i];
+            if (!ardbContainsCode(ardb, val)) printf("Adding 43DB entry: %s. (0x%X).\n", ardbCodeToString(val, code_str), val);
+        }
+
+        if (!ardbMergeCodes(ardb, ardb_orig_entry_count + rules->add_code_count, rules->add_codes, rules->add_code_count, &added_count))
+        {
+            ERROR_MSG("Failed to merge new entries into \"%s\"!", ardb_path);
+            goto out;
+        }
+
+        if (added_count) modified = true;
+    }
+
+    fflush(stdout);
+
+    /* ardbValidateDatabase() rejects empty databases, so an empty one would make every following run fail until the backup is restored. Bail out before anything gets written. */
+    if (!ardb->entry_count)
+    {
+        ERROR_MSG("Removal rules match every entry from \"%s\"! Empty databases aren't supported.", ardb_path);
+        goto out;
+    }
+
+    if (!modified)
+    {
+        printf("No changes needed for \"%s\".\n\n", ardb_path);
+        success = true;
+        goto out;
+    }
+
+    printf("\n");
+    fflush(stdout);
+
+    /* Make sure the modified aspect ratio database fits in the U8 archive. */
+    ardb_data_size = (sizeof(AspectRatioDatabase) + (sizeof(u32) * BE32(ardb->entry_count)));
+    ardb_capacity = u8GetFileDataCapacity(u8_ctx, u8_node_idx);
+
+    if (ardb_data_size > ardb_capacity)
+    {
+        ERROR_MSG("Modified \"%s\" needs 0x%X bytes, but only 0x%X bytes are available in the U8 archive!", ardb_path, ardb_data_size, ardb_capacity);
+        goto out;
+    }
+
+    /* Save modified aspect ratio database data to U8 archive buffer. */
+    if (!u8SaveFileData(u8_ctx, u8_node_idx, ardb_buf, ardb_data_size))
+    {
+        ERROR_MSG("Failed to save modified aspect ratio database data into U8 archive!");
+        goto out;
+    }
+
+    /* Update output flag. */
+    *out_modified = true;
+    success = true;
+
+out:
+    if (success) profilerSpanEnd(ProfilerPhase_ArdbEdit, start_time, ardb_data_size);
+
+    if (ardb_buf) utilsFreeMemory(ardb_buf);
+
+    if (ardb_data) utilsFreeMemory(ardb_data);
+
+    return success;
+}
+
+static bool ardbCheckSystemMenuArchive(const char *content_path, const AspectRatioDatabaseRules *rules, bool *out_patch_needed)
+{
+    u8 *u8_data = NULL, *ardb_data = NULL;
+    u32 u8_archive_size = 0;
+
+    U8Header u8_header = {0};
+    U8Context u8_ctx = {0};
+
+    bool patch_needed = false, success = false;
+
+    /* Read U8 header. */
+    if (!(u8_data = (u8*)utilsReadFileRangeFromIsfs(content_path, 0, sizeof(U8Header), &u8_archive_size))) goto out;
+
+    memcpy(&u8_header, u8_data, sizeof(U8Header));
+    utilsSwapBigEndianWords(&u8_header, sizeof(U8Header) / sizeof(u32));
+    utilsFreeMemory(u8_data);
+    u8_data = NULL;
+
+    if (u8_header.magic != U8_MAGIC || u8_header.data_offset <= sizeof(U8Header) || u8_header.data_offset >= u8_archive_size) goto out;
+
+    /* Read everything up to the file data block: U8 header, node table and string table. */
+    if (!(u8_data = (u8*)utilsReadFileRangeFromIsfs(content_path, 0, u8_header.data_offset, NULL)) || \
+        !u8ContextInitPartial(u8_data, u8_header.data_offset, u8_archive_size, &u8_ctx)) goto out;
+
+    /* Only read the target aspect ratio databases. */
+    for(u8 type = 0; type < AspectRatioDatabaseType_Count && !patch_needed; type++)
+    {
+        const char *ardb_path = g_ardbArchivePaths[type];
+        U8Node *ardb_node = NULL;
+        u32 u8_node_idx = 0;
+
+        if (!rulesHasEdits(&(rules[type]))) continue;
+
+        if (!(ardb_node = u8GetFileNodeByPath(&u8_ctx, ardb_path, &u8_node_idx)) || \
+            !(ardb_data = (u8*)utilsReadFileRangeFromIsfs(content_path, ardb_node->data_offset, ardb_node->size, NULL))) goto out;
+
+        if (!ardbValidateDatabase(ardb_data, ardb_node->size, ardb_path)) goto out;
+
+        patch_needed = ardbIsPatchNeeded((AspectRatioDatabase*)ardb_data, &(rules[type]));
+
+        utilsFreeMemory(ardb_data);
+        ardb_data = NULL;
+    }
+
+    *out_patch_needed = patch_needed;
+    success = true;
+
+out:
+    if (ardb_data) utilsFreeMemory(ardb_data);
+
+    u8ContextFree(&u8_ctx);
+
+    if (u8_data) utilsFreeMemory(u8_data);
+
+    return success;
+}
+
+static bool ardbIsPatchNeeded(const AspectRatioDatabase *ardb, const AspectRatioDatabaseRules *rules)
+{
+    /* Check if any entries must be removed. */
+    u32 entry_count = BE32(ardb->entry_count);
+
+    for(u32 i = 0; i < entry_count; i += RULES_MATCH_BLOCK_SIZE)
+    {
+        u32 block_count = ((entry_count - i) < RULES_MATCH_BLOCK_SIZE ? (entry_count - i) : RULES_MATCH_BLOCK_SIZE);
+        if (rulesMatchEntryBlock(rules, &(ardb->entries[i]), block_count)) return true;
+    }
+
+    /* Check if any entries must be added. */
+    /* Unsorted databases need to be sorted before adding new entries, so they always need to be patched. */
+    if (!rules->add_code_count) return false;
+
+    if (!ardbIsSorted(ardb)) return true;
+
+    for(u32 i = 0; i < rules->add_code_count; i++)
+    {
+        if (!ardbContainsCode(ardb, rules->add_codes[i])) return true;
+    }
+
+    return false;
+}
+
+static char *ardbCodeToString(u32 code, char *out)
+{
+    out[0] = (char)(code >> 16);
+    out[1] = (char)(code >> 8);
+    out[2] = (char)code;
+    out[3] = '\0';
+    return out;
+}
+
+static int ardbEntrySortFunction(const void *a, const void *b)
+{
+    u32 val_a = BE32(*((const u32*)a)), val_b = BE32(*((const u32*)b));
+    return (val_a < val_b ? -1 : (val_a > val_b ? 1 : 0));
+}
+
+#ifdef BACKUP_U8_ARCHIVE
+static bool ardbIsBackupHashCached(const char *backup_path, const tmd_content *content)
+{
+    HashCacheKey key = {0};
+    sha1 hash = {0};
+
+    /* Only trust cached checksums if the file size and timestamp are unchanged. */
+    if (!hashCacheGetKeyFromMountedDevice(backup_path, &key) || key.size != content->size || !hashCacheLookup(&key, hash)) return false;
+
+    return (memcmp(hash, content->hash, SHA1_HASH_SIZE) == 0);
+}
+#endif  /* BACKUP_U8_ARCHIVE */
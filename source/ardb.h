@@ -28,6 +28,7 @@
 #define ARDB_WC24_EVC_ENTRY     0x48414A        /* "HAJ" - Everybody Votes Channel. */
 #define ARDB_WC24_CMOC_ENTRY    0x484150        /* "HAP" - Check Mii Out Channel. */
 
+/// All fields are stored in big-endian byte order, and aspect ratio databases are always handled in that form. Use BE32() to access them.
 typedef struct {
     u32 magic;          ///< ARDB_MAGIC.
     u32 version;        ///< Database version number.
@@ -38,6 +39,9 @@ typedef struct {
 
 SIZE_ASSERT(AspectRatioDatabase, 0x10);
 
+#define ARDB_CODE_BITMAP_SIZE   (u32)0x200000   /* One bit per 24-bit title code. */
+#define ARDB_MAX_REMOVE_CODES   8               /* Exact title code removal rules kept alongside the bitmap, for vectorized matching. */
+
 typedef enum {
     AspectRatioDatabaseType_Disc            = 0,
     AspectRatioDatabaseType_VirtualConsole  = 1,
@@ -45,13 +49,65 @@ typedef enum {
     AspectRatioDatabaseType_Count           = 3
 } AspectRatioDatabaseType;
 
-/// Patches an aspect ratio database stored inside the System Menu's U8 archive by removing the desired title IDs from its records.
-/// The entries from the provided u32 array must use a 3-byte representation of the desired title IDs, ignoring the last byte value.
-bool ardbPatchDatabaseFromSystemMenuArchive(u8 type, const u32 *entries, const u32 entry_count);
+/// Compiled set of edits for a single aspect ratio database. Title codes use a 3-byte representation of the desired title IDs, ignoring the last byte value.
+typedef struct {
+    u8 *remove_bitmap;      ///< Bitmap with ARDB_CODE_BITMAP_SIZE bytes. Each set bit represents a title code that must be removed. NULL if there are no removal rules.
+    u32 remove_rule_count;  ///< Number of removal rules compiled into the bitmap.
+    u32 remove_codes[ARDB_MAX_REMOVE_CODES];    ///< Title codes from exact removal rules. Only used if remove_code_count matches remove_rule_count, i.e. without patterns and up to ARDB_MAX_REMOVE_CODES rules.
+    u32 remove_code_count;  ///< Number of title codes in remove_codes.
+    u32 *add_codes;         ///< Title codes that must be added. Sorted in ascending order, without duplicates.
+    u32 add_code_count;     ///< Number of title codes that must be added.
+} AspectRatioDatabaseRules;
+
+/// Returns the path to the provided aspect ratio database type within the System Menu's U8 archive, or NULL if the type is invalid.
+const char *ardbGetArchivePath(u8 type);
+
+/// Validates the header and size of an aspect ratio database. ardb_path is only used in error messages.
+bool ardbValidateDatabase(const u8 *ardb_data, u32 ardb_data_size, const char *ardb_path);
+
+/// Checks if the entries from the provided aspect ratio database are sorted in ascending order.
+bool ardbIsSorted(const AspectRatioDatabase *ardb);
+
+/// Sorts the entries from the provided aspect ratio database in ascending order. Does nothing if they're already sorted.
+void ardbSort(AspectRatioDatabase *ardb);
+
+/// Checks if the provided title code is present in a sorted aspect ratio database using a binary search.
+bool ardbContainsCode(const AspectRatioDatabase *ardb, u32 code);
+
+/// Merges a sorted title code array without duplicates into a sorted aspect ratio database, skipping codes that are already present.
+/// The database must be able to hold up to max_entry_count entries. The merge is performed in place, in linear time.
+/// The number of added entries is saved to out_added_count.
+bool ardbMergeCodes(AspectRatioDatabase *ardb, u32 max_entry_count, const u32 *codes, u32 code_count, u32 *out_added_count);
+
+/// Patches the aspect ratio databases stored inside the System Menu's U8 archive using the provided rules array, which must hold AspectRatioDatabaseType_Count elements.
+/// All databases are patched using a single U8 archive load and a single NAND write. Any available U8 archive patch entries (see patch.h) are applied as well.
+/// If dry_run is true, all changes are displayed, but neither the backup nor the modified U8 archive are written.
+bool ardbPatchSystemMenuArchive(const AspectRatioDatabaseRules *rules, bool dry_run);
+
+/// Content verification results for a single title.
+typedef struct {
+    u32 pass_count;
+    u32 fail_count;
+    u32 skip_count;     ///< Shared contents, which aren't stored in the title directory.
+    u64 byte_count;     ///< Hashed bytes.
+    u64 elapsed_usec;
+} ArdbVerifyResult;
+
+/// Verifies every content listed in the provided TMD against its size and SHA-1 checksum, streaming it from the title directory within the ISFS. Results are saved to out_result.
+/// Per-content results and throughput are printed if verbose is true. Only local state is used, so several titles can be verified at once from different threads.
+/// Returns false if any content fails verification.
+bool ardbVerifyTitleContents(u64 title_id, const tmd *title_tmd, bool verbose, ArdbVerifyResult *out_result);
+
+/// Verifies the integrity of every System Menu content listed in its TMD, printing per-content results and throughput.
+/// Returns false if any content fails verification.
+bool ardbVerifySystemMenuContents(void);
 
 #ifdef BACKUP_U8_ARCHIVE
 /// Restores a previously created System Menu U8 archive from the inserted SD card.
 bool ardbRestoreSystemMenuArchive(void);
+
+/// Extracts the full contents of the System Menu U8 archive to the inserted SD card.
+bool ardbExtractSystemMenuArchive(void);
 #endif  /* BACKUP_U8_ARCHIVE */
 
 #endif /* __ARDB_H__ */
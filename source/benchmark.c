@@ -0,0 +1,863 @@
+/*
+ * benchmark.c
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils.h"
+#include "ardb.h"
+#include "rules.h"
+#include "u8.h"
+#include "sha1.h"
+#include "benchmark.h"
+
+#ifdef BENCHMARK_U8
+
+#define BENCHMARK_U8_ROOT_NODE_OFFSET       0x20
+#define BENCHMARK_U8_MAX_NAME_LENGTH        0x40
+#define BENCHMARK_U8_MAX_PATH               0x200
+
+#define BENCHMARK_U8_INIT_ITERATIONS        100
+#define BENCHMARK_U8_OP_ITERATIONS          2000
+#define BENCHMARK_U8_EDIT_ITERATIONS        200
+#define BENCHMARK_U8_HASH_ITERATIONS        20
+
+#define BENCHMARK_ARDB_ENTRY_COUNT          1024
+#define BENCHMARK_ARDB_REMOVE_INTERVAL      256     /* Every Nth entry is removed by the edit and match benchmarks. Keeps the removal set small enough for vectorized matching. */
+#define BENCHMARK_ARDB_ADD_COUNT            16
+#define BENCHMARK_ARDB_MIN_FILE_SIZE        (sizeof(AspectRatioDatabase) + (sizeof(u32) * (BENCHMARK_ARDB_ENTRY_COUNT + BENCHMARK_ARDB_ADD_COUNT)))
+
+#define BENCHMARK_SHA1_CHECKPOINT_INTERVAL  0x1000
+
+#define BENCHMARK_MAX_RESULTS               64
+#define BENCHMARK_NAME_LENGTH               0x20
+
+/// Holds a synthetic U8 archive along with the path and node index of each file within it.
+typedef struct {
+    const BenchmarkU8Profile *profile;
+    U8Node *nodes;
+    u32 node_count;
+    char *str_table;
+    u32 str_table_size;
+    char *file_paths;           ///< BENCHMARK_U8_MAX_PATH bytes per entry.
+    u32 *file_node_indexes;
+    u32 file_count;
+    u32 name_counter;
+    u8 *archive;
+    u32 archive_size;
+} BenchmarkU8Archive;
+
+/// Holds the average time per operation for a single profile and operation. Used for both results and baselines.
+typedef struct {
+    char profile[BENCHMARK_NAME_LENGTH];
+    char op[BENCHMARK_NAME_LENGTH];
+    u64 ns_per_op;
+} BenchmarkResult;
+
+/* Global variables. */
+
+static const BenchmarkU8Profile g_benchmarkU8Profiles[] = {
+    /* Name,         depth, fan-out, files/dir, name length, file size, max nodes, titlelist. */
+    { "flat",            0,       0,       512,          12,     0x200,      1024, false },
+    { "deep",           16,       1,         2,          12,     0x200,      1024, false },
+    { "wide tree",       3,       8,         4,          12,     0x200,      4096, false },
+    { "long names",      2,       4,         8,          48,     0x200,      1024, false },
+    { "system menu",     3,       5,         6,          16,    0x2000,      2048, true  }
+};
+
+static const u32 g_benchmarkU8ProfileCount = MAX_ELEMENTS(g_benchmarkU8Profiles);
+
+static char g_benchmarkU8CustomProfileName[BENCHMARK_NAME_LENGTH] = {0};
+static BenchmarkU8Profile g_benchmarkU8CustomProfile = {0};
+static bool g_benchmarkU8CustomProfileSet = false;
+
+static const char *g_benchmarkU8TitleListFiles[] = { "discdb.bin", "vcadb.bin", "wwdb.bin" };
+
+static BenchmarkResult g_benchmarkResults[BENCHMARK_MAX_RESULTS] = {0};
+static u32 g_benchmarkResultCount = 0;
+
+static BenchmarkResult g_benchmarkBaselines[BENCHMARK_MAX_RESULTS] = {0};
+static u32 g_benchmarkBaselineCount = 0;
+
+static u32 g_benchmarkBudget = 0, g_benchmarkRegressionCount = 0;
+
+/* Function prototypes. */
+
+static bool benchmarkRunU8Profile(const BenchmarkU8Profile *profile);
+
+static bool benchmarkBuildU8Archive(const BenchmarkU8Profile *profile, BenchmarkU8Archive *out);
+static void benchmarkFreeU8Archive(BenchmarkU8Archive *archive);
+
+static bool benchmarkAddU8Directory(BenchmarkU8Archive *archive, u32 parent_idx, const char *name, char *path, u32 level);
+static bool benchmarkAddU8File(BenchmarkU8Archive *archive, const char *name, char *path);
+static bool benchmarkAddU8Node(BenchmarkU8Archive *archive, u8 type, const char *name, u32 data_offset, u32 size);
+static void benchmarkGenerateU8NodeName(BenchmarkU8Archive *archive, char prefix, char *out);
+
+static void benchmarkFillArdb(u8 *buf);
+static bool benchmarkEditArdb(U8Context *u8_ctx, u32 node_idx, const AspectRatioDatabaseRules *rules, u32 *out_entry_count);
+static bool benchmarkMatchArdb(const BenchmarkU8Profile *profile, const char *op, const AspectRatioDatabase *ardb, const AspectRatioDatabaseRules *rules, u32 expected_match_count);
+static bool benchmarkMatchArdbReference(const BenchmarkU8Profile *profile, const AspectRatioDatabase *ardb, const AspectRatioDatabaseRules *rules, u32 expected_match_count);
+
+static void benchmarkRecordResult(const BenchmarkU8Profile *profile, const char *op, u32 iterations, u64 start_time, u32 start_alloc_count);
+
+static void benchmarkLoadBaselines(const char *path);
+static bool benchmarkSaveBaselines(const char *path);
+
+ALWAYS_INLINE u32 benchmarkGetArdbCode(u32 idx)
+{
+    /* Codes are spaced out, so that additions can be placed between them. */
+    return (0x414141 + (idx * 3));
+}
+
+bool benchmarkRunU8(const char *baseline_path, u32 budget_pct)
+{
+    const BenchmarkU8Profile *profiles = (g_benchmarkU8CustomProfileSet ? &g_benchmarkU8CustomProfile : g_benchmarkU8Profiles);
+    u32 profile_count = (g_benchmarkU8CustomProfileSet ? 1 : g_benchmarkU8ProfileCount), fail_count = 0;
+
+    g_benchmarkResultCount = g_benchmarkBaselineCount = g_benchmarkRegressionCount = 0;
+    g_benchmarkBudget = budget_pct;
+
+    if (baseline_path) benchmarkLoadBaselines(baseline_path);
+
+    printf("U8 benchmark (%u %s", profile_count, (profile_count == 1 ? "profile" : "profiles"));
+    if (g_benchmarkBaselineCount) printf(", %u baselines, %u%% budget", g_benchmarkBaselineCount, g_benchmarkBudget);
+    printf(").\n\n");
+
+    for(u32 i = 0; i < profile_count; i++)
+    {
+        if (!benchmarkRunU8Profile(&(profiles[i]))) fail_count++;
+    }
+
+    if (fail_count) printf("%u %s failed correctness checks.\n", fail_count, (fail_count == 1 ? "profile" : "profiles"));
+    if (g_benchmarkRegressionCount) printf("%u %s exceeded the %u%% budget.\n", g_benchmarkRegressionCount, (g_benchmarkRegressionCount == 1 ? "result" : "results"), g_benchmarkBudget);
+
+    /* Only clean runs become baselines. Existing baselines are never overwritten: delete the file to generate new ones. */
+    if (!fail_count && baseline_path && !g_benchmarkBaselineCount && benchmarkSaveBaselines(baseline_path))
+    {
+        printf("Saved %u baselines to \"%s\".\n", g_benchmarkResultCount, baseline_path);
+    }
+
+    printf("\n");
+
+    return (!fail_count && !g_benchmarkRegressionCount);
+}
+
+bool benchmarkSetU8Profile(const char *spec)
+{
+    char buf[0x100] = {0}, *token = NULL, *saveptr = NULL;
+    BenchmarkU8Profile profile = {0};
+    const char *name = "custom";
+
+    if (!spec)
+    {
+        g_benchmarkU8CustomProfileSet = false;
+        return true;
+    }
+
+    /* Start from the "system menu" profile. */
+    for(u32 i = 0; i < g_benchmarkU8ProfileCount; i++)
+    {
+        if (!g_benchmarkU8Profiles[i].titlelist) continue;
+        profile = g_benchmarkU8Profiles[i];
+        break;
+    }
+
+    if (snprintf(buf, sizeof(buf), "%s", spec) >= (int)sizeof(buf)) return false;
+
+    for(token = strtok_r(buf, ",", &saveptr); token; token = strtok_r(NULL, ",", &saveptr))
+    {
+        char *value = strchr(token, '='), *end = NULL;
+        unsigned long num = 0;
+
+        if (!value) return false;
+        *value++ = '\0';
+
+        if (!strcmp(token, "name"))
+        {
+            if (!*value || strlen(value) >= BENCHMARK_NAME_LENGTH || strchr(value, ',')) return false;
+            name = value;
+            continue;
+        }
+
+        num = strtoul(value, &end, 0);
+        if (!*value || *end || num > 0xFFFFFFFFUL) return false;
+
+        if (!strcmp(token, "depth"))
+        {
+            profile.depth = (u32)num;
+        } else
+        if (!strcmp(token, "fan-out"))
+        {
+            profile.fan_out = (u32)num;
+        } else
+        if (!strcmp(token, "files"))
+        {
+            profile.files_per_dir = (u32)num;
+        } else
+        if (!strcmp(token, "name-length"))
+        {
+            profile.name_length = (u32)num;
+        } else
+        if (!strcmp(token, "file-size"))
+        {
+            profile.file_size = (u32)num;
+        } else
+        if (!strcmp(token, "max-nodes"))
+        {
+            profile.max_node_count = (u32)num;
+        } else
+        if (!strcmp(token, "titlelist") && num <= 1)
+        {
+            profile.titlelist = (num == 1);
+        } else {
+            return false;
+        }
+    }
+
+    snprintf(g_benchmarkU8CustomProfileName, sizeof(g_benchmarkU8CustomProfileName), "%s", name);
+    profile.name = g_benchmarkU8CustomProfileName;
+
+    g_benchmarkU8CustomProfile = profile;
+    g_benchmarkU8CustomProfileSet = true;
+
+    return true;
+}
+
+static bool benchmarkRunU8Profile(const BenchmarkU8Profile *profile)
+{
+    BenchmarkU8Archive archive = {0};
+    U8Context u8_ctx = {0};
+    u8 *file_data = NULL, *check_data = NULL, *ardb_data = NULL;
+    u32 node_idx = 0, file_size = 0, check_size = 0, alloc_count = 0, entry_count = 0;
+    u64 start_time = 0;
+
+    AspectRatioDatabaseRules rules[AspectRatioDatabaseType_Count] = {0};
+    AspectRatioDatabaseRules *wwdb_rules = &(rules[AspectRatioDatabaseType_WiiWare]), bitmap_rules = {0};
+    u32 expected_entry_count = 0;
+
+    Sha1Checkpoints checkpoints = {0};
+    u8 hash[SHA1_HASH_SIZE] = {0}, sw_hash[SHA1_HASH_SIZE] = {0}, resumed_hash[SHA1_HASH_SIZE] = {0};
+
+    bool success = false;
+
+    if (!benchmarkBuildU8Archive(profile, &archive))
+    {
+        ERROR_MSG("Failed to build synthetic U8 archive for profile \"%s\"!", profile->name);
+        goto out;
+    }
+
+    printf("Profile \"%s\": %u nodes (%u files), 0x%X bytes.\n", profile->name, archive.node_count, archive.file_count, archive.archive_size);
+    printf("%-10s | %6s | %10s | %10s | %10s | %s\n", "Operation", "Iters", "ns/op", "allocs/op", "base ns/op", "Status");
+    printf("-----------+--------+------------+------------+------------+-------\n");
+    fflush(stdout);
+
+    /* u8ContextInit(). */
+    alloc_count = utilsGetAllocationCount();
+    start_time = gettime();
+
+    for(u32 i = 0; i < BENCHMARK_U8_INIT_ITERATIONS; i++)
+    {
+        if (!u8ContextInit(archive.archive, archive.archive_size, &u8_ctx)) goto out;
+        u8ContextFree(&u8_ctx);
+    }
+
+    benchmarkRecordResult(profile, "init", BENCHMARK_U8_INIT_ITERATIONS, start_time, alloc_count);
+
+    /* Keep a context around for the rest of the operations. */
+    if (!u8ContextInit(archive.archive, archive.archive_size, &u8_ctx)) goto out;
+
+    /* u8GetFileNodeByPath(). Files are looked up in round-robin order. */
+    alloc_count = utilsGetAllocationCount();
+    start_time = gettime();
+
+    for(u32 i = 0; i < BENCHMARK_U8_OP_ITERATIONS; i++)
+    {
+        u32 file_idx = (i % archive.file_count);
+
+        if (!u8GetFileNodeByPath(&u8_ctx, archive.file_paths + (file_idx * BENCHMARK_U8_MAX_PATH), &node_idx) || node_idx != archive.file_node_indexes[file_idx])
+        {
+            ERROR_MSG("Lookup mismatch for \"%s\"!", archive.file_paths + (file_idx * BENCHMARK_U8_MAX_PATH));
+            goto out;
+        }
+    }
+
+    benchmarkRecordResult(profile, "lookup", BENCHMARK_U8_OP_ITERATIONS, start_time, alloc_count);
+
+    /* u8LoadFileData(). */
+    alloc_count = utilsGetAllocationCount();
+    start_time = gettime();
+
+    for(u32 i = 0; i < BENCHMARK_U8_OP_ITERATIONS; i++)
+    {
+        u32 file_node_idx = archive.file_node_indexes[i % archive.file_count];
+
+        file_data = u8LoadFileData(&u8_ctx, file_node_idx, &file_size);
+        if (!file_data) goto out;
+
+        /* Check every file once. */
+        if (i < archive.file_count && (file_size != u8_ctx.nodes[file_node_idx].size || memcmp(file_data, archive.archive + u8_ctx.nodes[file_node_idx].data_offset, file_size) != 0))
+        {
+            ERROR_MSG("Loaded data mismatch for U8 node #%u!", file_node_idx);
+            goto out;
+        }
+
+        utilsFreeMemory(file_data);
+        file_data = NULL;
+    }
+
+    benchmarkRecordResult(profile, "load", BENCHMARK_U8_OP_ITERATIONS, start_time, alloc_count);
+
+    /* u8SaveFileData(). The original file data is written back, so the archive is left untouched. */
+    file_data = u8LoadFileData(&u8_ctx, archive.file_node_indexes[0], &file_size);
+    if (!file_data) goto out;
+
+    alloc_count = utilsGetAllocationCount();
+    start_time = gettime();
+
+    for(u32 i = 0; i < BENCHMARK_U8_OP_ITERATIONS; i++)
+    {
+        if (!u8SaveFileData(&u8_ctx, archive.file_node_indexes[0], file_data, file_size)) goto out;
+    }
+
+    benchmarkRecordResult(profile, "save", BENCHMARK_U8_OP_ITERATIONS, start_time, alloc_count);
+
+    if (!(check_data = u8LoadFileData(&u8_ctx, archive.file_node_indexes[0], &check_size)) || check_size != file_size || memcmp(check_data, file_data, file_size) != 0)
+    {
+        ERROR_MSG("Saved data mismatch for U8 node #%u!", archive.file_node_indexes[0]);
+        goto out;
+    }
+
+    /* Aspect ratio database edits: removals through the rules bitmap, followed by a merge. The U8 archive is left untouched. */
+    if (profile->titlelist)
+    {
+        if (!u8GetFileNodeByPath(&u8_ctx, ardbGetArchivePath(AspectRatioDatabaseType_WiiWare), &node_idx)) goto out;
+
+        for(u32 i = 0; i < BENCHMARK_ARDB_ENTRY_COUNT; i += BENCHMARK_ARDB_REMOVE_INTERVAL)
+        {
+            if (!rulesAddRemovalCode(wwdb_rules, benchmarkGetArdbCode(i))) goto out;
+            expected_entry_count++;
+        }
+
+        for(u32 i = 0; i < BENCHMARK_ARDB_ADD_COUNT; i++)
+        {
+            if (!rulesAddAdditionCode(wwdb_rules, benchmarkGetArdbCode(i * 2) + 1)) goto out;
+        }
+
+        expected_entry_count = (BENCHMARK_ARDB_ENTRY_COUNT - expected_entry_count + BENCHMARK_ARDB_ADD_COUNT);
+
+        alloc_count = utilsGetAllocationCount();
+        start_time = gettime();
+
+        for(u32 i = 0; i < BENCHMARK_U8_EDIT_ITERATIONS; i++)
+        {
+            if (!benchmarkEditArdb(&u8_ctx, node_idx, wwdb_rules, &entry_count)) goto out;
+
+            if (entry_count != expected_entry_count)
+            {
+                ERROR_MSG("Edited ARDB entry count mismatch! (got %u, expected %u).", entry_count, expected_entry_count);
+                goto out;
+            }
+        }
+
+        benchmarkRecordResult(profile, "edit", BENCHMARK_U8_EDIT_ITERATIONS, start_time, alloc_count);
+
+        /* rulesMatchEntryBlock() on its own, using exact title codes (vectorized on host builds) and the removal bitmap, along with a plain per-code compare loop as a reference. */
+        /* The bitmap copy shares the removal bitmap, and must not be freed. Clearing remove_code_count forces bitmap lookups. */
+        bitmap_rules = *wwdb_rules;
+        bitmap_rules.remove_code_count = 0;
+
+        if (!(ardb_data = u8LoadFileData(&u8_ctx, node_idx, &file_size)) || \
+            !benchmarkMatchArdb(profile, "match", (const AspectRatioDatabase*)ardb_data, wwdb_rules, BENCHMARK_ARDB_ENTRY_COUNT / BENCHMARK_ARDB_REMOVE_INTERVAL) || \
+            !benchmarkMatchArdb(profile, "match-bmp", (const AspectRatioDatabase*)ardb_data, &bitmap_rules, BENCHMARK_ARDB_ENTRY_COUNT / BENCHMARK_ARDB_REMOVE_INTERVAL) || \
+            !benchmarkMatchArdbReference(profile, (const AspectRatioDatabase*)ardb_data, wwdb_rules, BENCHMARK_ARDB_ENTRY_COUNT / BENCHMARK_ARDB_REMOVE_INTERVAL)) goto out;
+    }
+
+    /* sha1CalculateHash(). The SHA engine is checked against the software backend, as well as against a calculation resumed from a midstate. */
+    if (!sha1CalculateHashWithCheckpoints(archive.archive, archive.archive_size, Sha1Backend_Software, BENCHMARK_SHA1_CHECKPOINT_INTERVAL, &checkpoints, sw_hash) || \
+        !sha1ResumeHash(&checkpoints, archive.archive, archive.archive_size, archive.archive_size / 2, resumed_hash) || memcmp(sw_hash, resumed_hash, SHA1_HASH_SIZE) != 0)
+    {
+        ERROR_MSG("Software SHA-1 checksum mismatch!");
+        goto out;
+    }
+
+    alloc_count = utilsGetAllocationCount();
+    start_time = gettime();
+
+    for(u32 i = 0; i < BENCHMARK_U8_HASH_ITERATIONS; i++)
+    {
+        if (!sha1CalculateHash(archive.archive, archive.archive_size, hash)) goto out;
+    }
+
+    benchmarkRecordResult(profile, "hash", BENCHMARK_U8_HASH_ITERATIONS, start_time, alloc_count);
+
+    if (memcmp(hash, sw_hash, SHA1_HASH_SIZE) != 0)
+    {
+        ERROR_MSG("SHA engine checksum mismatch!");
+        goto out;
+    }
+
+    success = true;
+
+out:
+    printf("\n");
+    fflush(stdout);
+
+    sha1CheckpointsFree(&checkpoints);
+
+    rulesFree(rules);
+
+    if (ardb_data) utilsFreeMemory(ardb_data);
+
+    if (check_data) utilsFreeMemory(check_data);
+
+    if (file_data) utilsFreeMemory(file_data);
+
+    u8ContextFree(&u8_ctx);
+
+    benchmarkFreeU8Archive(&archive);
+
+    return success;
+}
+
+static bool benchmarkBuildU8Archive(const BenchmarkU8Profile *profile, BenchmarkU8Archive *out)
+{
+    if (!profile->file_size || !profile->max_node_count || !profile->name_length || profile->name_length >= BENCHMARK_U8_MAX_NAME_LENGTH || \
+        (profile->titlelist && profile->file_size < BENCHMARK_ARDB_MIN_FILE_SIZE))
+    {
+        ERROR_MSG("Invalid profile parameters!");
+        return false;
+    }
+
+    char path[BENCHMARK_U8_MAX_PATH] = {0};
+    U8Header *header = NULL;
+    u32 node_info_block_size = 0, data_offset = 0, cur_offset = 0;
+    bool success = false;
+
+    memset(out, 0, sizeof(BenchmarkU8Archive));
+    out->profile = profile;
+
+    /* Allocate worst-case buffers. The node count limit bounds everything else. */
+    out->nodes = (U8Node*)utilsAllocateMemory(profile->max_node_count * sizeof(U8Node));
+    out->str_table = (char*)utilsAllocateMemory(profile->max_node_count * BENCHMARK_U8_MAX_NAME_LENGTH);
+    out->file_paths = (char*)utilsAllocateMemory(profile->max_node_count * BENCHMARK_U8_MAX_PATH);
+    out->file_node_indexes = (u32*)utilsAllocateMemory(profile->max_node_count * sizeof(u32));
+    if (!out->nodes || !out->str_table || !out->file_paths || !out->file_node_indexes)
+    {
+        ERROR_MSG("Failed to allocate memory for synthetic U8 archive tables!");
+        goto out;
+    }
+
+    /* Generate the node tree, starting from the root directory (empty name, parent index 0). */
+    if (!benchmarkAddU8Directory(out, 0, "", path, 0) || !out->file_count) goto out;
+
+    /* Calculate the archive layout. */
+    node_info_block_size = ((out->node_count * sizeof(U8Node)) + out->str_table_size);
+    data_offset = ALIGN_UP(BENCHMARK_U8_ROOT_NODE_OFFSET + node_info_block_size, 0x40);
+    cur_offset = data_offset;
+
+    for(u32 i = 0; i < out->node_count; i++)
+    {
+        U8Node *node = &(out->nodes[i]);
+        if (node->type != U8NodeType_File) continue;
+
+        node->data_offset = cur_offset;
+        cur_offset += ALIGN_UP(node->size, 0x20);
+    }
+
+    out->archive_size = cur_offset;
+
+    /* Assemble the archive. */
+    out->archive = (u8*)utilsAllocateMemory(out->archive_size);
+    if (!out->archive)
+    {
+        ERROR_MSG("Failed to allocate memory for synthetic U8 archive! (0x%X).", out->archive_size);
+        goto out;
+    }
+
+    header = (U8Header*)out->archive;
+    header->magic = U8_MAGIC;
+    header->root_node_offset = BENCHMARK_U8_ROOT_NODE_OFFSET;
+    header->node_info_block_size = node_info_block_size;
+    header->data_offset = data_offset;
+    utilsSwapBigEndianWords(header, sizeof(U8Header) / sizeof(u32));
+
+    memcpy(out->archive + BENCHMARK_U8_ROOT_NODE_OFFSET, out->nodes, out->node_count * sizeof(U8Node));
+    utilsSwapBigEndianWords(out->archive + BENCHMARK_U8_ROOT_NODE_OFFSET, (out->node_count * sizeof(U8Node)) / sizeof(u32));
+    memcpy(out->archive + BENCHMARK_U8_ROOT_NODE_OFFSET + (out->node_count * sizeof(U8Node)), out->str_table, out->str_table_size);
+
+    /* Fill file data with a simple pattern. */
+    for(u32 i = data_offset; i < out->archive_size; i++) out->archive[i] = (u8)i;
+
+    /* Aspect ratio databases are always the first files, since the titlelist directory is added right after the root directory. */
+    if (profile->titlelist)
+    {
+        for(u32 i = 0; i < MAX_ELEMENTS(g_benchmarkU8TitleListFiles); i++) benchmarkFillArdb(out->archive + out->nodes[out->file_node_indexes[i]].data_offset);
+    }
+
+    success = true;
+
+out:
+    if (!success) benchmarkFreeU8Archive(out);
+
+    return success;
+}
+
+static void benchmarkFreeU8Archive(BenchmarkU8Archive *archive)
+{
+    if (archive->nodes) utilsFreeMemory(archive->nodes);
+    if (archive->str_table) utilsFreeMemory(archive->str_table);
+    if (archive->file_paths) utilsFreeMemory(archive->file_paths);
+    if (archive->file_node_indexes) utilsFreeMemory(archive->file_node_indexes);
+    if (archive->archive) utilsFreeMemory(archive->archive);
+    memset(archive, 0, sizeof(BenchmarkU8Archive));
+}
+
+static bool benchmarkAddU8Directory(BenchmarkU8Archive *archive, u32 parent_idx, const char *name, char *path, u32 level)
+{
+    const BenchmarkU8Profile *profile = archive->profile;
+    u32 dir_idx = archive->node_count, path_len = strlen(path);
+    char child_name[BENCHMARK_U8_MAX_NAME_LENGTH] = {0};
+    bool success = false;
+
+    /* Nodes are stored depth-first, so a directory's children always follow it. */
+    if (!benchmarkAddU8Node(archive, U8NodeType_Directory, name, parent_idx, 0)) return false;
+
+    if (dir_idx)
+    {
+        if ((path_len + 1 + strlen(name)) >= BENCHMARK_U8_MAX_PATH)
+        {
+            ERROR_MSG("Synthetic U8 path too long!");
+            return false;
+        }
+
+        sprintf(path + path_len, "/%s", name);
+    }
+
+    /* Mimic the System Menu U8 archive layout, if needed. */
+    if (!dir_idx && profile->titlelist)
+    {
+        u32 titlelist_idx = archive->node_count;
+
+        if (!benchmarkAddU8Node(archive, U8NodeType_Directory, "titlelist", dir_idx, 0)) goto out;
+
+        strcat(path, "/titlelist");
+
+        for(u32 i = 0; i < MAX_ELEMENTS(g_benchmarkU8TitleListFiles); i++)
+        {
+            if (!benchmarkAddU8File(archive, g_benchmarkU8TitleListFiles[i], path)) goto out;
+        }
+
+        archive->nodes[titlelist_idx].size = archive->node_count;
+        path[path_len] = '\0';
+    }
+
+    for(u32 i = 0; i < profile->files_per_dir && archive->node_count < profile->max_node_count; i++)
+    {
+        benchmarkGenerateU8NodeName(archive, 'f', child_name);
+        if (!benchmarkAddU8File(archive, child_name, path)) goto out;
+    }
+
+    if (level < profile->depth)
+    {
+        for(u32 i = 0; i < profile->fan_out && archive->node_count < profile->max_node_count; i++)
+        {
+            benchmarkGenerateU8NodeName(archive, 'd', child_name);
+            if (!benchmarkAddU8Directory(archive, dir_idx, child_name, path, level + 1)) goto out;
+        }
+    }
+
+    /* Directory size: node number from the last node within this directory. */
+    archive->nodes[dir_idx].size = archive->node_count;
+
+    success = true;
+
+out:
+    path[path_len] = '\0';
+
+    return success;
+}
+
+static bool benchmarkAddU8File(BenchmarkU8Archive *archive, const char *name, char *path)
+{
+    char *file_path = (archive->file_paths + (archive->file_count * BENCHMARK_U8_MAX_PATH));
+
+    if ((strlen(path) + 1 + strlen(name)) >= BENCHMARK_U8_MAX_PATH)
+    {
+        ERROR_MSG("Synthetic U8 path too long!");
+        return false;
+    }
+
+    /* The data offset is set once the whole node table is available. */
+    archive->file_node_indexes[archive->file_count] = archive->node_count;
+    if (!benchmarkAddU8Node(archive, U8NodeType_File, name, 0, archive->profile->file_size)) return false;
+
+    sprintf(file_path, "%s/%s", path, name);
+    archive->file_count++;
+
+    return true;
+}
+
+static bool benchmarkAddU8Node(BenchmarkU8Archive *archive, u8 type, const char *name, u32 data_offset, u32 size)
+{
+    U8Node *node = NULL;
+    u32 name_len = strlen(name);
+
+    if (archive->node_count >= archive->profile->max_node_count || name_len >= BENCHMARK_U8_MAX_NAME_LENGTH)
+    {
+        ERROR_MSG("Synthetic U8 node limit reached!");
+        return false;
+    }
+
+    node = &(archive->nodes[archive->node_count++]);
+    node->type = type;
+    node->name_offset = archive->str_table_size;
+    node->data_offset = data_offset;
+    node->size = size;
+
+    memcpy(archive->str_table + archive->str_table_size, name, name_len + 1);
+    archive->str_table_size += (name_len + 1);
+
+    return true;
+}
+
+static void benchmarkGenerateU8NodeName(BenchmarkU8Archive *archive, char prefix, char *out)
+{
+    u32 name_length = archive->profile->name_length;
+
+    /* Unique names padded to the requested length, e.g. "f0000000012". */
+    snprintf(out, BENCHMARK_U8_MAX_NAME_LENGTH, "%c%0*u", prefix, (int)(name_length > 1 ? (name_length - 1) : 1), archive->name_counter++);
+}
+
+static void benchmarkFillArdb(u8 *buf)
+{
+    AspectRatioDatabase *ardb = (AspectRatioDatabase*)buf;
+
+    ardb->magic = BE32(ARDB_MAGIC);
+    ardb->version = BE32(1);
+    ardb->entry_count = BE32(BENCHMARK_ARDB_ENTRY_COUNT);
+    ardb->reserved = 0;
+
+    for(u32 i = 0; i < BENCHMARK_ARDB_ENTRY_COUNT; i++) ardb->entries[i] = BE32(benchmarkGetArdbCode(i) << 8);
+}
+
+static bool benchmarkEditArdb(U8Context *u8_ctx, u32 node_idx, const AspectRatioDatabaseRules *rules, u32 *out_entry_count)
+{
+    u8 *ardb_data = NULL, *ardb_buf = NULL;
+    u32 ardb_data_size = 0, orig_entry_count = 0, entry_count = 0, added_count = 0;
+    AspectRatioDatabase *ardb = NULL;
+    bool success = false;
+
+    if (!(ardb_data = u8LoadFileData(u8_ctx, node_idx, &ardb_data_size)) || !ardbValidateDatabase(ardb_data, ardb_data_size, "benchmark")) goto out;
+
+    orig_entry_count = BE32(((AspectRatioDatabase*)ardb_data)->entry_count);
+
+    ardb_buf = (u8*)utilsAllocateMemory(sizeof(AspectRatioDatabase) + (sizeof(u32) * (orig_entry_count + rules->add_code_count)));
+    if (!ardb_buf) goto out;
+
+    memcpy(ardb_buf, ardb_data, sizeof(AspectRatioDatabase) + (sizeof(u32) * orig_entry_count));
+    ardb = (AspectRatioDatabase*)ardb_buf;
+
+    /* Same removal loop used by ardbPatchDatabase(), minus the output. */
+    for(u32 i = 0; i < orig_entry_count; i += RULES_MATCH_BLOCK_SIZE)
+    {
+        u32 block_count = ((orig_entry_count - i) < RULES_MATCH_BLOCK_SIZE ? (orig_entry_count - i) : RULES_MATCH_BLOCK_SIZE);
+        u32 mask = rulesMatchEntryBlock(rules, &(ardb->entries[i]), block_count);
+
+        for(u32 j = 0; j < block_count; j++)
+        {
+            if (!(mask & (1U << j))) ardb->entries[entry_count++] = ardb->entries[i + j];
+        }
+    }
+
+    ardb->entry_count = BE32(entry_count);
+
+    if (!ardbMergeCodes(ardb, orig_entry_count + rules->add_code_count, rules->add_codes, rules->add_code_count, &added_count) || !ardbIsSorted(ardb)) goto out;
+
+    *out_entry_count = BE32(ardb->entry_count);
+    success = true;
+
+out:
+    if (ardb_buf) utilsFreeMemory(ardb_buf);
+
+    if (ardb_data) utilsFreeMemory(ardb_data);
+
+    return success;
+}
+
+static bool benchmarkMatchArdb(const BenchmarkU8Profile *profile, const char *op, const AspectRatioDatabase *ardb, const AspectRatioDatabaseRules *rules, u32 expected_match_count)
+{
+    u32 entry_count = BE32(ardb->entry_count), alloc_count = utilsGetAllocationCount(), match_count = 0;
+    u64 start_time = gettime();
+
+    /* Every iteration scans the whole database. */
+    for(u32 i = 0; i < BENCHMARK_U8_OP_ITERATIONS; i++)
+    {
+        match_count = 0;
+
+        for(u32 j = 0; j < entry_count; j += RULES_MATCH_BLOCK_SIZE)
+        {
+            u32 block_count = ((entry_count - j) < RULES_MATCH_BLOCK_SIZE ? (entry_count - j) : RULES_MATCH_BLOCK_SIZE);
+            match_count += (u32)__builtin_popcount(rulesMatchEntryBlock(rules, &(ardb->entries[j]), block_count));
+        }
+
+        if (match_count != expected_match_count)
+        {
+            ERROR_MSG("ARDB match count mismatch for \"%s\"! (got %u, expected %u).", op, match_count, expected_match_count);
+            return false;
+        }
+    }
+
+    benchmarkRecordResult(profile, op, BENCHMARK_U8_OP_ITERATIONS, start_time, alloc_count);
+
+    return true;
+}
+
+static bool benchmarkMatchArdbReference(const BenchmarkU8Profile *profile, const AspectRatioDatabase *ardb, const AspectRatioDatabaseRules *rules, u32 expected_match_count)
+{
+    u32 entry_count = BE32(ardb->entry_count), alloc_count = utilsGetAllocationCount(), match_count = 0;
+    u64 start_time = gettime();
+
+    /* Scalar baseline for the "match" operation: each entry is shifted down to its title code and compared against every exact removal code in turn. */
+    for(u32 i = 0; i < BENCHMARK_U8_OP_ITERATIONS; i++)
+    {
+        match_count = 0;
+
+        for(u32 j = 0; j < entry_count; j++)
+        {
+            u32 code = (BE32(ardb->entries[j]) >> 8);
+
+            for(u32 k = 0; k < rules->remove_code_count; k++)
+            {
+                if (code != rules->remove_codes[k]) continue;
+                match_count++;
+                break;
+            }
+        }
+
+        if (match_count != expected_match_count)
+        {
+            ERROR_MSG("ARDB match count mismatch for \"match-ref\"! (got %u, expected %u).", match_count, expected_match_count);
+            return false;
+        }
+    }
+
+    benchmarkRecordResult(profile, "match-ref", BENCHMARK_U8_OP_ITERATIONS, start_time, alloc_count);
+
+    return true;
+}
+
+static void benchmarkRecordResult(const BenchmarkU8Profile *profile, const char *op, u32 iterations, u64 start_time, u32 start_alloc_count)
+{
+    u64 elapsed_ns = ticks_to_nanosecs(diff_ticks(start_time, gettime()));
+    u64 ns_per_op = (elapsed_ns / iterations);
+    u32 alloc_count = (utilsGetAllocationCount() - start_alloc_count);
+    const BenchmarkResult *baseline = NULL;
+
+    /* Allocations per operation are printed with two decimal places. */
+    u32 allocs_per_op_x100 = (u32)(((u64)alloc_count * 100) / iterations);
+
+    for(u32 i = 0; i < g_benchmarkBaselineCount; i++)
+    {
+        if (strcmp(g_benchmarkBaselines[i].profile, profile->name) != 0 || strcmp(g_benchmarkBaselines[i].op, op) != 0) continue;
+        baseline = &(g_benchmarkBaselines[i]);
+        break;
+    }
+
+    printf("%-10s | %6u | %10llu | %7u.%02u | ", op, iterations, ns_per_op, allocs_per_op_x100 / 100, allocs_per_op_x100 % 100);
+
+    if (baseline)
+    {
+        bool regression = ((ns_per_op * 100) > (baseline->ns_per_op * (100 + g_benchmarkBudget)));
+        if (regression) g_benchmarkRegressionCount++;
+        printf("%10llu | %s\n", baseline->ns_per_op, (regression ? "SLOW" : "ok"));
+    } else {
+        printf("%10s | %s\n", "-", "-");
+    }
+
+    fflush(stdout);
+
+    if (g_benchmarkResultCount < BENCHMARK_MAX_RESULTS)
+    {
+        BenchmarkResult *result = &(g_benchmarkResults[g_benchmarkResultCount++]);
+        snprintf(result->profile, sizeof(result->profile), "%s", profile->name);
+        snprintf(result->op, sizeof(result->op), "%s", op);
+        result->ns_per_op = ns_per_op;
+    }
+}
+
+/* Baselines only use stdio, so they work with any path: a mounted device, or a local file on the host build. */
+static void benchmarkLoadBaselines(const char *path)
+{
+    FILE *fp = NULL;
+    char line[0x100] = {0};
+
+    /* Missing baselines aren't an error. */
+    if (!(fp = fopen(path, "r"))) return;
+
+    while(fgets(line, sizeof(line), fp) && g_benchmarkBaselineCount < BENCHMARK_MAX_RESULTS)
+    {
+        BenchmarkResult *baseline = &(g_benchmarkBaselines[g_benchmarkBaselineCount]);
+        unsigned long long ns_per_op = 0;
+
+        /* The header row doesn't hold a number in its last column, so it's skipped as well. */
+        if (sscanf(line, "%31[^,],%31[^,],%llu", baseline->profile, baseline->op, &ns_per_op) != 3 || !ns_per_op) continue;
+
+        baseline->ns_per_op = (u64)ns_per_op;
+        g_benchmarkBaselineCount++;
+    }
+
+    fclose(fp);
+}
+
+static bool benchmarkSaveBaselines(const char *path)
+{
+    FILE *fp = NULL;
+    char dir[BENCHMARK_U8_MAX_PATH] = {0}, *sep = NULL;
+
+    /* Create the parent directory, if needed. */
+    snprintf(dir, sizeof(dir), "%s", path);
+    if ((sep = strrchr(dir, '/')) && sep > dir && *(sep - 1) != ':')
+    {
+        *sep = '\0';
+        mkdir(dir, 0777);
+    }
+
+    fp = fopen(path, "w");
+    if (!fp)
+    {
+        ERROR_MSG("Failed to open \"%s\" for writing! (%d).", path, errno);
+        return false;
+    }
+
+    fprintf(fp, "profile,operation,ns_per_op\n");
+
+    for(u32 i = 0; i < g_benchmarkResultCount; i++)
+    {
+        BenchmarkResult *result = &(g_benchmarkResults[i]);
+        fprintf(fp, "%s,%s,%llu\n", result->profile, result->op, result->ns_per_op);
+    }
+
+    if (fclose(fp) != 0)
+    {
+        ERROR_MSG("Failed to write \"%s\"! (%d).", path, errno);
+        return false;
+    }
+
+    return true;
+}
+
+#endif  /* BENCHMARK_U8 */
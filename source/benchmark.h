@@ -0,0 +1,59 @@
+/*
+ * benchmark.h
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifndef __BENCHMARK_H__
+#define __BENCHMARK_H__
+
+#ifdef BENCHMARK_U8
+
+#define BENCHMARK_BASELINE_PATH     "sd:/" APP_TITLE "/benchmark.csv"
+
+/// Describes the shape of a synthetic U8 archive.
+typedef struct {
+    const char *name;           ///< Profile name.
+    u32 depth;                  ///< Directory nesting levels below the root directory.
+    u32 fan_out;                ///< Subdirectories per directory.
+    u32 files_per_dir;          ///< Files per directory.
+    u32 name_length;            ///< Node name length.
+    u32 file_size;              ///< File data size. Must not be zero.
+    u32 max_node_count;         ///< Node count limit, including the root node.
+    bool titlelist;             ///< Adds a "/titlelist" directory with all three aspect ratio databases, like the System Menu U8 archive.
+} BenchmarkU8Profile;
+
+/// Builds synthetic U8 archives for a set of built-in profiles and measures the performance of the U8 parser on each one of them.
+/// The "system menu" profile also holds valid aspect ratio databases, which are used to benchmark database edits.
+/// Every operation is checked for correctness. Results are printed as a table with the average time and allocation count per operation.
+/// If baseline_path is provided, results are compared against the baselines stored in it, and any result exceeding its baseline by more than
+/// budget_pct percent is flagged as a regression. If no baselines are available, the current results are saved as the new baselines.
+/// Baselines are read and written using plain stdio calls, so baseline_path may point to any accessible file (e.g. a local file on the host build).
+/// Returns false if any correctness check fails or any result exceeds its budget.
+bool benchmarkRunU8(const char *baseline_path, u32 budget_pct);
+
+/// Makes benchmarkRunU8() use a single custom profile instead of the built-in ones. The profile is parsed from a comma-separated list of key=value pairs:
+/// "name=<label>", "depth=<n>", "fan-out=<n>", "files=<n>", "name-length=<n>", "file-size=<bytes>", "max-nodes=<n>" and "titlelist=0|1".
+/// Missing keys keep their values from the built-in "system menu" profile, and the name defaults to "custom". Baselines are matched by name, so give
+/// different shapes different names. NULL restores the built-in profiles. Returns false if spec is invalid.
+bool benchmarkSetU8Profile(const char *spec);
+
+#endif  /* BENCHMARK_U8 */
+
+#endif /* __BENCHMARK_H__ */
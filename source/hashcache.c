@@ -0,0 +1,128 @@
+/*
+ * hashcache.c
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils.h"
+#include "sha1.h"
+#include "hashcache.h"
+
+#ifdef BACKUP_U8_ARCHIVE
+
+/* The hash cache is a sidecar file (see UtilsSidecarHeader). */
+typedef struct {
+    HashCacheKey key;
+    u8 hash[SHA1_HASH_SIZE];
+    u32 reserved;
+} HashCacheEntry;
+
+SIZE_ASSERT(HashCacheEntry, 0x68);
+
+/* Global variables. */
+
+static bool g_hashCacheLoaded = false;
+static HashCacheEntry g_hashCacheEntries[HASH_CACHE_MAX_ENTRIES] = {0};
+static u32 g_hashCacheEntryCount = 0;
+
+/* Function prototypes. */
+
+static void hashCacheLoad(void);
+
+static s32 hashCacheGetEntryIndex(const char *path);
+
+bool hashCacheGetKeyFromMountedDevice(const char *path, HashCacheKey *out_key)
+{
+    struct stat st = {0};
+
+    if (!path || !*path || strlen(path) >= MEMBER_SIZE(HashCacheKey, path) || !out_key || stat(path, &st) != 0) return false;
+
+    memset(out_key, 0, sizeof(HashCacheKey));
+    snprintf(out_key->path, sizeof(out_key->path), "%s", path);
+    out_key->size = (u64)st.st_size;
+    out_key->timestamp = (u64)st.st_mtime;
+
+    return true;
+}
+
+bool hashCacheLookup(const HashCacheKey *key, void *out_hash)
+{
+    s32 idx = -1;
+
+    if (!key || !out_hash) return false;
+
+    hashCacheLoad();
+
+    /* Any mismatch means the file may have changed since its checksum was cached. */
+    if ((idx = hashCacheGetEntryIndex(key->path)) < 0 || memcmp(&(g_hashCacheEntries[idx].key), key, sizeof(HashCacheKey)) != 0) return false;
+
+    memcpy(out_hash, g_hashCacheEntries[idx].hash, SHA1_HASH_SIZE);
+
+    return true;
+}
+
+bool hashCacheStore(const HashCacheKey *key, const void *hash)
+{
+    HashCacheEntry entry = {0};
+    s32 idx = -1;
+
+    if (!key || !*(key->path) || !hash) return false;
+
+    hashCacheLoad();
+
+    memcpy(&(entry.key), key, sizeof(HashCacheKey));
+    memcpy(entry.hash, hash, SHA1_HASH_SIZE);
+
+    if ((idx = hashCacheGetEntryIndex(key->path)) >= 0)
+    {
+        memcpy(&(g_hashCacheEntries[idx]), &entry, sizeof(HashCacheEntry));
+    } else {
+        g_hashCacheEntryCount = utilsAppendSidecarEntry(g_hashCacheEntries, g_hashCacheEntryCount, HASH_CACHE_MAX_ENTRIES, sizeof(HashCacheEntry), &entry);
+    }
+
+    if (!utilsSaveSidecarFile(HASH_CACHE_PATH, HASH_CACHE_MAGIC, HASH_CACHE_VERSION, g_hashCacheEntries, sizeof(HashCacheEntry), g_hashCacheEntryCount))
+    {
+        ERROR_MSG("Failed to write hash cache!");
+        return false;
+    }
+
+    return true;
+}
+
+static void hashCacheLoad(void)
+{
+    bool invalid = false;
+
+    if (g_hashCacheLoaded) return;
+
+    g_hashCacheLoaded = true;
+    g_hashCacheEntryCount = utilsLoadSidecarFile(HASH_CACHE_PATH, HASH_CACHE_MAGIC, HASH_CACHE_VERSION, g_hashCacheEntries, sizeof(HashCacheEntry), HASH_CACHE_MAX_ENTRIES, &invalid);
+
+    if (invalid) printf("Discarding invalid hash cache.\n");
+}
+
+static s32 hashCacheGetEntryIndex(const char *path)
+{
+    for(u32 i = 0; i < g_hashCacheEntryCount; i++)
+    {
+        if (!strncmp(g_hashCacheEntries[i].key.path, path, MEMBER_SIZE(HashCacheKey, path))) return (s32)i;
+    }
+
+    return -1;
+}
+
+#endif  /* BACKUP_U8_ARCHIVE */
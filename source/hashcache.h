@@ -0,0 +1,54 @@
+/*
+ * hashcache.h
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifndef __HASHCACHE_H__
+#define __HASHCACHE_H__
+
+#ifdef BACKUP_U8_ARCHIVE
+
+#define HASH_CACHE_PATH         "sd:/" APP_TITLE "/hashcache.bin"
+
+#define HASH_CACHE_MAGIC        (u32)0x48434845 /* "HCHE". */
+#define HASH_CACHE_VERSION      2
+#define HASH_CACHE_MAX_ENTRIES  32
+
+/// Identifies a file stored in a mounted device whose SHA-1 checksum is cached. A cached checksum is only trusted if every field matches.
+typedef struct {
+    char path[0x40];    ///< Full file path.
+    u64 size;           ///< File size.
+    u64 timestamp;      ///< Modification timestamp.
+} HashCacheKey;
+
+SIZE_ASSERT(HashCacheKey, 0x50);
+
+/// Fills a hash cache key using the stats from a file stored in a mounted device.
+bool hashCacheGetKeyFromMountedDevice(const char *path, HashCacheKey *out_key);
+
+/// Looks up a cached SHA-1 checksum. Returns false if there's no cached checksum, or if it's stale.
+bool hashCacheLookup(const HashCacheKey *key, void *out_hash);
+
+/// Saves a SHA-1 checksum to the hash cache, replacing any previous entry for the same path.
+bool hashCacheStore(const HashCacheKey *key, const void *hash);
+
+#endif  /* BACKUP_U8_ARCHIVE */
+
+#endif /* __HASHCACHE_H__ */
@@ -0,0 +1,427 @@
+/*
+ * inventory.c
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils.h"
+#include "ardb.h"
+#include "rules.h"
+#include "u8.h"
+#include "titlemeta.h"
+#include "taskpool.h"
+#include "inventory.h"
+
+#ifdef BACKUP_U8_ARCHIVE
+
+#define INVENTORY_LABEL_LENGTH  0x40
+#define INVENTORY_MAX_ROW_SIZE  (0x20 + (INVENTORY_MAX_SOURCES * 2))
+
+/// Holds the title codes from all aspect ratio databases within a single U8 archive.
+typedef struct {
+    char label[INVENTORY_LABEL_LENGTH];         ///< Column label.
+    u32 versions[AspectRatioDatabaseType_Count];        ///< Aspect ratio database versions.
+    u32 *codes[AspectRatioDatabaseType_Count];          ///< Title codes, sorted in ascending order and without duplicates.
+    u32 code_counts[AspectRatioDatabaseType_Count];     ///< Title code counts.
+    u64 byte_count;                             ///< Bytes read from the U8 archive.
+    bool loaded;                                ///< Set once all databases have been loaded.
+} InventorySource;
+
+/// Shared state for dump loading tasks.
+typedef struct {
+    const char *dump_path;
+    InventorySource *sources;   ///< Dump sources. Labels hold the dump filenames.
+} InventoryLoadContext;
+
+/* Function prototypes. */
+
+static bool inventoryLoadSource(InventorySource *source, const char *path, UtilsReadRangeFunction read_range);
+static bool inventoryLoadDumpTask(void *arg, u32 idx);
+static void inventoryFreeSource(InventorySource *source);
+
+static bool inventoryWriteCsv(const InventorySource *sources, u32 source_count, const char *out_path);
+static void inventoryFormatCode(u32 code, char *out);
+
+static int inventoryCodeSortFunction(const void *a, const void *b);
+static int inventorySourceSortFunction(const void *a, const void *b);
+
+bool inventoryExportToMountedDevice(const char *dump_path, const char *out_path)
+{
+    if (!dump_path || !*dump_path || !out_path || !*out_path)
+    {
+        ERROR_MSG("Invalid parameters!");
+        return false;
+    }
+
+    const TitleMetadata *sysmenu_meta = NULL;
+    InventorySource *sources = NULL;
+    u32 source_count = 0, dump_count = 0;
+
+    DIR *dir = NULL;
+    struct dirent *entry = NULL;
+    InventoryLoadContext load_ctx = {0};
+
+    u64 byte_count = 0, start_time = gettime(), elapsed_usec = 0;
+    bool success = false;
+
+    sources = (InventorySource*)utilsAllocateMemory(sizeof(InventorySource) * INVENTORY_MAX_SOURCES);
+    if (!sources)
+    {
+        ERROR_MSG("Failed to allocate memory for inventory sources!");
+        return false;
+    }
+
+    memset(sources, 0, sizeof(InventorySource) * INVENTORY_MAX_SOURCES);
+
+    /* Get System Menu metadata. This also locates the content record holding the U8 archive with resources. */
+    sysmenu_meta = titleMetaGet(SYSTEM_MENU_TID);
+    if (!sysmenu_meta)
+    {
+        ERROR_MSG("Error retrieving System Menu TMD!");
+        goto out;
+    }
+
+    /* The U8 archive stored in the NAND always comes first. */
+    snprintf(sources[0].label, sizeof(sources[0].label), "nand-v%u", sysmenu_meta->tmd->title_version);
+    if (!inventoryLoadSource(&(sources[0]), sysmenu_meta->archive_content_path, utilsReadFileRangeFromIsfs))
+    {
+        ERROR_MSG("Failed to load System Menu U8 archive databases!");
+        goto out;
+    }
+
+    /* List all available dumps. */
+    dir = opendir(dump_path);
+    if (dir)
+    {
+        while((entry = readdir(dir)))
+        {
+            u32 name_len = strlen(entry->d_name);
+
+            if (name_len <= 4 || name_len >= INVENTORY_LABEL_LENGTH || strcasecmp(entry->d_name + name_len - 4, ".app") != 0) continue;
+
+            if ((dump_count + 1) >= INVENTORY_MAX_SOURCES)
+            {
+                printf("Inventory source limit reached (%u). Skipping remaining dumps.\n\n", INVENTORY_MAX_SOURCES);
+                break;
+            }
+
+            snprintf(sources[++dump_count].label, sizeof(sources[0].label), "%s", entry->d_name);
+        }
+
+        closedir(dir);
+    } else {
+        printf("No dumps available at \"%s\". Only the NAND U8 archive will be processed.\n\n", dump_path);
+    }
+
+    /* Directory listings aren't sorted, so sort dumps by label to get a stable column order. */
+    if (dump_count > 1) qsort(&(sources[1]), dump_count, sizeof(InventorySource), inventorySourceSortFunction);
+
+    /* Load dumps. Each task only touches its own source, so they can be loaded in any order. */
+    if (dump_count)
+    {
+        printf("Loading %u U8 archive %s using %u %s...\n\n", dump_count, (dump_count == 1 ? "dump" : "dumps"), taskPoolGetWorkerCount(), \
+               (taskPoolGetWorkerCount() == 1 ? "worker" : "workers"));
+
+        load_ctx.dump_path = dump_path;
+        load_ctx.sources = &(sources[1]);
+
+        if (!taskPoolRun(dump_count, inventoryLoadDumpTask, &load_ctx))
+        {
+            ERROR_MSG("Failed to load U8 archive dumps!");
+            goto out;
+        }
+    }
+
+    /* Drop invalid dumps, keeping the sort order. */
+    for(u32 i = 0; i <= dump_count; i++)
+    {
+        if (!sources[i].loaded) continue;
+
+        byte_count += sources[i].byte_count;
+
+        if (i != source_count)
+        {
+            sources[source_count] = sources[i];
+            memset(&(sources[i]), 0, sizeof(InventorySource));
+        }
+
+        source_count++;
+    }
+
+    for(u32 i = 0; i < source_count; i++)
+    {
+        InventorySource *source = &(sources[i]);
+
+        printf("%s:", source->label);
+
+        for(u8 type = 0; type < AspectRatioDatabaseType_Count; type++)
+        {
+            printf(" %s v%u (%u)%s", rulesGetDatabaseName(type), source->versions[type], source->code_counts[type], (type < (AspectRatioDatabaseType_Count - 1) ? "," : ".\n"));
+        }
+    }
+
+    printf("\n");
+
+    if (!inventoryWriteCsv(sources, source_count, out_path)) goto out;
+
+    elapsed_usec = diff_usec(start_time, gettime());
+
+    printf("Processed %u U8 %s (%llu KiB) in %llu ms", source_count, (source_count == 1 ? "archive" : "archives"), byte_count / 1024, elapsed_usec / 1000);
+    if (elapsed_usec) printf(" (%llu archives/s)", ((u64)source_count * 1000000) / elapsed_usec);
+    printf(".\n\nSaved inventory to \"%s\".\n\n", out_path);
+
+    success = true;
+
+out:
+    for(u32 i = 0; i <= dump_count; i++) inventoryFreeSource(&(sources[i]));
+
+    utilsFreeMemory(sources);
+
+    return success;
+}
+
+static bool inventoryLoadSource(InventorySource *source, const char *path, UtilsReadRangeFunction read_range)
+{
+    u8 *u8_data = NULL, *ardb_data = NULL;
+    u32 u8_archive_size = 0;
+    u64 byte_count = 0;
+
+    U8Header u8_header = {0};
+    U8Context u8_ctx = {0};
+
+    bool success = false;
+
+    /* Read U8 header. */
+    if (!(u8_data = (u8*)read_range(path, 0, sizeof(U8Header), &u8_archive_size))) goto out;
+
+    memcpy(&u8_header, u8_data, sizeof(U8Header));
+    utilsSwapBigEndianWords(&u8_header, sizeof(U8Header) / sizeof(u32));
+    utilsFreeMemory(u8_data);
+    u8_data = NULL;
+
+    if (u8_header.magic != U8_MAGIC || u8_header.data_offset <= sizeof(U8Header) || u8_header.data_offset >= u8_archive_size)
+    {
+        ERROR_MSG("\"%s\" isn't a valid U8 archive!", path);
+        goto out;
+    }
+
+    /* Read everything up to the file data block: U8 header, node table and string table. */
+    if (!(u8_data = (u8*)read_range(path, 0, u8_header.data_offset, NULL)) || \
+        !u8ContextInitPartial(u8_data, u8_header.data_offset, u8_archive_size, &u8_ctx)) goto out;
+
+    byte_count += u8_header.data_offset;
+
+    /* Only read the aspect ratio databases. */
+    for(u8 type = 0; type < AspectRatioDatabaseType_Count; type++)
+    {
+        const char *ardb_path = ardbGetArchivePath(type);
+        const AspectRatioDatabase *ardb = NULL;
+        U8Node *ardb_node = NULL;
+        u32 u8_node_idx = 0, *codes = NULL, code_count = 0, entry_count = 0;
+        bool sorted = true;
+
+        if (!(ardb_node = u8GetFileNodeByPath(&u8_ctx, ardb_path, &u8_node_idx)) || \
+            !(ardb_data = (u8*)read_range(path, ardb_node->data_offset, ardb_node->size, NULL))) goto out;
+
+        if (!ardbValidateDatabase(ardb_data, ardb_node->size, ardb_path)) goto out;
+
+        byte_count += ardb_node->size;
+        ardb = (const AspectRatioDatabase*)ardb_data;
+
+        /* ardbValidateDatabase() already rejects empty databases. */
+        entry_count = BE32(ardb->entry_count);
+        codes = (u32*)utilsAllocateMemory(entry_count * sizeof(u32));
+        if (!codes)
+        {
+            ERROR_MSG("Failed to allocate memory for \"%s\" title codes!", ardb_path);
+            goto out;
+        }
+
+        /* Decode title codes. The last byte from each entry is ignored. */
+        for(u32 i = 0; i < entry_count; i++)
+        {
+            codes[i] = (BE32(ardb->entries[i]) >> 8);
+            if (i && codes[i - 1] > codes[i]) sorted = false;
+        }
+
+        if (!sorted) qsort(codes, entry_count, sizeof(u32), inventoryCodeSortFunction);
+
+        /* Remove duplicates, which are adjacent now. */
+        for(u32 i = 0; i < entry_count; i++)
+        {
+            if (!code_count || codes[code_count - 1] != codes[i]) codes[code_count++] = codes[i];
+        }
+
+        source->versions[type] = BE32(ardb->version);
+        source->codes[type] = codes;
+        source->code_counts[type] = code_count;
+
+        utilsFreeMemory(ardb_data);
+        ardb_data = NULL;
+    }
+
+    source->byte_count = byte_count;
+    source->loaded = success = true;
+
+out:
+    if (ardb_data) utilsFreeMemory(ardb_data);
+
+    u8ContextFree(&u8_ctx);
+
+    if (u8_data) utilsFreeMemory(u8_data);
+
+    return success;
+}
+
+static bool inventoryLoadDumpTask(void *arg, u32 idx)
+{
+    InventoryLoadContext *load_ctx = (InventoryLoadContext*)arg;
+    InventorySource *source = &(load_ctx->sources[idx]);
+    char path[0x200] = {0};
+
+    snprintf(path, sizeof(path), "%s/%s", load_ctx->dump_path, source->label);
+
+    /* Invalid dumps are skipped, so this never fails. Otherwise, no more dumps would get loaded. */
+    if (!inventoryLoadSource(source, path, utilsReadFileRangeFromMountedDevice))
+    {
+        printf("Skipping \"%s\".\n\n", path);
+        inventoryFreeSource(source);
+    }
+
+    return true;
+}
+
+static void inventoryFreeSource(InventorySource *source)
+{
+    for(u8 type = 0; type < AspectRatioDatabaseType_Count; type++)
+    {
+        if (source->codes[type]) utilsFreeMemory(source->codes[type]);
+        source->codes[type] = NULL;
+        source->code_counts[type] = 0;
+    }
+}
+
+static bool inventoryWriteCsv(const InventorySource *sources, u32 source_count, const char *out_path)
+{
+    FILE *fp = NULL;
+    char row[INVENTORY_MAX_ROW_SIZE] = {0};
+    u32 cursors[INVENTORY_MAX_SOURCES] = {0};
+
+    fp = fopen(out_path, "w");
+    if (!fp)
+    {
+        ERROR_MSG("Failed to open \"%s\" for writing! (%d).", out_path, errno);
+        return false;
+    }
+
+    fprintf(fp, "database,code");
+    for(u32 i = 0; i < source_count; i++) fprintf(fp, ",%s", sources[i].label);
+    fprintf(fp, "\n");
+
+    for(u8 type = 0; type < AspectRatioDatabaseType_Count; type++)
+    {
+        const char *db_name = rulesGetDatabaseName(type);
+        u32 row_count = 0, partial_count = 0;
+
+        memset(cursors, 0, sizeof(cursors));
+
+        /* Every source is already sorted and deduplicated, so a k-way merge yields all title codes in order, along with the sources that hold them. */
+        while(true)
+        {
+            u32 min_code = 0xFFFFFFFF, row_len = 0, present_count = 0;
+
+            for(u32 i = 0; i < source_count; i++)
+            {
+                if (cursors[i] < sources[i].code_counts[type] && sources[i].codes[type][cursors[i]] < min_code) min_code = sources[i].codes[type][cursors[i]];
+            }
+
+            /* Title codes only take 24 bits, so this can only happen once all sources have been exhausted. */
+            if (min_code == 0xFFFFFFFF) break;
+
+            row_len = (u32)snprintf(row, sizeof(row), "%s,", db_name);
+            inventoryFormatCode(min_code, row + row_len);
+            row_len += strlen(row + row_len);
+
+            for(u32 i = 0; i < source_count; i++)
+            {
+                bool present = (cursors[i] < sources[i].code_counts[type] && sources[i].codes[type][cursors[i]] == min_code);
+
+                if (present)
+                {
+                    present_count++;
+                    cursors[i]++;
+                }
+
+                row[row_len++] = ',';
+                row[row_len++] = (present ? '1' : '0');
+            }
+
+            row[row_len++] = '\n';
+            row[row_len] = '\0';
+            fputs(row, fp);
+
+            row_count++;
+            if (present_count != source_count) partial_count++;
+        }
+
+        printf("%s: %u unique title %s, %u of them not present in every archive.\n", db_name, row_count, (row_count == 1 ? "code" : "codes"), partial_count);
+    }
+
+    printf("\n");
+
+    if (fclose(fp) != 0)
+    {
+        ERROR_MSG("Failed to write \"%s\"! (%d).", out_path, errno);
+        return false;
+    }
+
+    return true;
+}
+
+static void inventoryFormatCode(u32 code, char *out)
+{
+    char chars[3] = { (char)(code >> 16), (char)(code >> 8), (char)code };
+    bool printable = true;
+
+    /* Fall back to hex for anything that could break the CSV layout. */
+    for(u32 i = 0; i < 3; i++)
+    {
+        if (chars[i] > 0x20 && chars[i] < 0x7F && chars[i] != ',' && chars[i] != '"') continue;
+        printable = false;
+        break;
+    }
+
+    if (printable)
+    {
+        sprintf(out, "%.3s", chars);
+    } else {
+        sprintf(out, "0x%06X", code);
+    }
+}
+
+static int inventoryCodeSortFunction(const void *a, const void *b)
+{
+    u32 val_a = *((const u32*)a), val_b = *((const u32*)b);
+    return (val_a < val_b ? -1 : (val_a > val_b ? 1 : 0));
+}
+
+static int inventorySourceSortFunction(const void *a, const void *b)
+{
+    return strcmp(((const InventorySource*)a)->label, ((const InventorySource*)b)->label);
+}
+
+#endif  /* BACKUP_U8_ARCHIVE */
@@ -0,0 +1,41 @@
+/*
+ * inventory.h
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifndef __INVENTORY_H__
+#define __INVENTORY_H__
+
+#ifdef BACKUP_U8_ARCHIVE
+
+#define INVENTORY_DUMP_PATH     "sd:/" APP_TITLE "/dumps"
+#define INVENTORY_CSV_PATH      "sd:/" APP_TITLE "/inventory.csv"
+
+#define INVENTORY_MAX_SOURCES   512 /* Including the NAND U8 archive. */
+
+/// Builds an inventory of the title codes held by the aspect ratio databases from the System Menu U8 archive stored in the NAND, as well as from every
+/// System Menu U8 archive content dump ("*.app") available at dump_path. Only the U8 node table and the databases are read from each archive.
+/// Dumps are loaded through the task pool, using as many worker threads as set through taskPoolSetWorkerCount(). Invalid dumps are skipped.
+/// The inventory is saved to out_path as a CSV file with one row per database and title code, and one column per archive, sorted by title code.
+bool inventoryExportToMountedDevice(const char *dump_path, const char *out_path);
+
+#endif  /* BACKUP_U8_ARCHIVE */
+
+#endif /* __INVENTORY_H__ */
@@ -0,0 +1,415 @@
+/*
+ * iocal.c
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <fcntl.h>
+
+#include "utils.h"
+#include "iocal.h"
+
+#ifdef BACKUP_U8_ARCHIVE
+
+#define IO_CAL_SAMPLE_SIZE          0x100000    /* Bytes transferred by each measurement. */
+#define IO_CAL_TOLERANCE            5           /* Smaller chunk sizes within this percentage of the best throughput are preferred, since they need less memory. */
+
+#define IO_CAL_ISFS_TMP_PATH        "/tmp/iocal.tmp"
+#define IO_CAL_SD_TMP_PATH          "sd:/" APP_TITLE "/iocal.tmp"
+
+#define IO_CAL_CHUNK_SIZE_COUNT     7
+#define IO_CAL_ALIGNMENT_COUNT      3
+
+typedef enum {
+    IoCalTransfer_IsfsRead  = 0,
+    IoCalTransfer_IsfsWrite = 1,
+    IoCalTransfer_SdWrite   = 2,    ///< Comes before IoCalTransfer_SdRead, since it creates the file used to measure reads.
+    IoCalTransfer_SdRead    = 3,
+    IoCalTransfer_Count     = 4     ///< Total values supported by this enum.
+} IoCalTransfer;
+
+/* Calibration data is stored in a sidecar file (see UtilsSidecarHeader). */
+typedef struct {
+    u32 device_id;                  ///< Console device ID.
+    u32 reserved[3];                ///< Reserved.
+    UtilsIoChunkSizes chunk_sizes;  ///< Calibrated chunk sizes.
+} IoCalEntry;
+
+SIZE_ASSERT(IoCalEntry, 0x20);
+
+/* Global variables. */
+
+static const u32 g_ioCalChunkSizes[IO_CAL_CHUNK_SIZE_COUNT] = { 0x4000, 0x8000, 0x10000, 0x20000, 0x40000, 0x80000, 0x100000 };
+
+/* Buffer alignments, in bytes. Buffers returned by utilsAllocateMemory() are 64-byte aligned, so that's the one used to pick chunk sizes. */
+static const u32 g_ioCalAlignments[IO_CAL_ALIGNMENT_COUNT] = { 64, 32, 4 };
+
+static const char *g_ioCalTransferNames[IoCalTransfer_Count] = {
+    [IoCalTransfer_IsfsRead]  = "ISFS read",
+    [IoCalTransfer_IsfsWrite] = "ISFS write",
+    [IoCalTransfer_SdWrite]   = "SD card write",
+    [IoCalTransfer_SdRead]    = "SD card read"
+};
+
+/* Function prototypes. */
+
+static u32 ioCalMeasureIsfs(const char *path, bool write_mode, u8 *buf, u32 chunk_size);
+static u32 ioCalMeasureMountedDevice(const char *path, bool write_mode, u8 *buf, u32 chunk_size);
+static u32 ioCalGetThroughput(u32 size, u64 start_time);
+
+static u32 ioCalSelectChunkSize(const u32 *results);
+static void ioCalPrintCurve(u8 transfer, const u32 (*results)[IO_CAL_ALIGNMENT_COUNT], u32 selected_chunk_size);
+
+static u32 ioCalLoadEntries(IoCalEntry *out_entries);
+static bool ioCalSaveEntry(u32 device_id, const UtilsIoChunkSizes *chunk_sizes);
+
+bool ioCalLoad(void)
+{
+    IoCalEntry entries[IO_CAL_MAX_ENTRIES] = {0};
+    u32 device_id = 0, entry_count = 0;
+
+    if (ES_GetDeviceID(&device_id) < 0 || !(entry_count = ioCalLoadEntries(entries))) return false;
+
+    for(u32 i = 0; i < entry_count; i++)
+    {
+        if (entries[i].device_id != device_id) continue;
+
+        utilsSetIoChunkSizes(&(entries[i].chunk_sizes));
+        return true;
+    }
+
+    return false;
+}
+
+bool ioCalRun(const char *nand_path)
+{
+    if (!nand_path || !*nand_path)
+    {
+        ERROR_MSG("Invalid parameters!");
+        return false;
+    }
+
+    u8 *buf = NULL;
+    u32 results[IoCalTransfer_Count][IO_CAL_CHUNK_SIZE_COUNT][IO_CAL_ALIGNMENT_COUNT] = {0};
+    u32 selected[IoCalTransfer_Count] = {0}, device_id = 0;
+    u64 free_space = 0;
+    UtilsIoChunkSizes chunk_sizes = {0};
+    s32 ret = 0;
+    bool success = false;
+
+    if ((ret = ES_GetDeviceID(&device_id)) < 0)
+    {
+        ERROR_MSG("ES_GetDeviceID failed! (%d).", ret);
+        return false;
+    }
+
+    if (!utilsGetFileSystemStatsByPath(IO_CAL_SD_TMP_PATH, NULL, &free_space) || free_space < IO_CAL_SAMPLE_SIZE)
+    {
+        ERROR_MSG("Not enough free space available in the SD card!");
+        return false;
+    }
+
+    /* Leave room to offset the buffer by any of the tested alignments. */
+    buf = (u8*)utilsAllocateMemory(IO_CAL_SAMPLE_SIZE + 64);
+    if (!buf)
+    {
+        ERROR_MSG("Failed to allocate memory for calibration buffer!");
+        return false;
+    }
+
+    for(u32 i = 0; i < (IO_CAL_SAMPLE_SIZE + 64); i++) buf[i] = (u8)i;
+
+    /* Create output directory. */
+    mkdir("sd:/" APP_TITLE, 0777);
+
+    for(u8 transfer = 0; transfer < IoCalTransfer_Count; transfer++)
+    {
+        bool isfs = (transfer == IoCalTransfer_IsfsRead || transfer == IoCalTransfer_IsfsWrite);
+        bool write_mode = (transfer == IoCalTransfer_IsfsWrite || transfer == IoCalTransfer_SdWrite);
+
+        printf("Measuring %s throughput... ", g_ioCalTransferNames[transfer]);
+        fflush(stdout);
+
+        for(u32 i = 0; i < IO_CAL_CHUNK_SIZE_COUNT; i++)
+        {
+            for(u32 j = 0; j < IO_CAL_ALIGNMENT_COUNT; j++)
+            {
+                /* ISFS transfers need 32-byte aligned buffers. */
+                if (isfs && g_ioCalAlignments[j] < 32) continue;
+
+                u8 *cur_buf = (buf + (g_ioCalAlignments[j] & 63));
+
+                results[transfer][i][j] = (isfs ? ioCalMeasureIsfs((write_mode ? IO_CAL_ISFS_TMP_PATH : nand_path), write_mode, cur_buf, g_ioCalChunkSizes[i]) : \
+                                                  ioCalMeasureMountedDevice(IO_CAL_SD_TMP_PATH, write_mode, cur_buf, g_ioCalChunkSizes[i]));
+                if (!results[transfer][i][j])
+                {
+                    printf("FAILED!\n\n");
+                    goto out;
+                }
+            }
+        }
+
+        printf("OK!\n");
+    }
+
+    printf("\n");
+
+    for(u8 transfer = 0; transfer < IoCalTransfer_Count; transfer++)
+    {
+        u32 curve[IO_CAL_CHUNK_SIZE_COUNT] = {0};
+
+        for(u32 i = 0; i < IO_CAL_CHUNK_SIZE_COUNT; i++) curve[i] = results[transfer][i][0];
+
+        selected[transfer] = ioCalSelectChunkSize(curve);
+        ioCalPrintCurve(transfer, results[transfer], selected[transfer]);
+    }
+
+    chunk_sizes.isfs_read = selected[IoCalTransfer_IsfsRead];
+    chunk_sizes.isfs_write = selected[IoCalTransfer_IsfsWrite];
+    chunk_sizes.sd_read = selected[IoCalTransfer_SdRead];
+    chunk_sizes.sd_write = selected[IoCalTransfer_SdWrite];
+
+    utilsSetIoChunkSizes(&chunk_sizes);
+
+    success = ioCalSaveEntry(device_id, &chunk_sizes);
+    if (success) printf("Saved calibrated chunk sizes for console %08X to \"" IO_CAL_PATH "\".\n\n", device_id);
+
+out:
+    ISFS_Delete(IO_CAL_ISFS_TMP_PATH);
+    remove(IO_CAL_SD_TMP_PATH);
+
+    utilsFreeMemory(buf);
+
+    return success;
+}
+
+static u32 ioCalMeasureIsfs(const char *path, bool write_mode, u8 *buf, u32 chunk_size)
+{
+    s32 fd = -1, ret = 0;
+    fstats *stats = NULL;
+    u32 size = IO_CAL_SAMPLE_SIZE, offset = 0, throughput = 0;
+    u64 start_time = 0;
+
+    if (write_mode)
+    {
+        /* Start from an empty file, so every measurement allocates the same NAND clusters. */
+        ISFS_Delete(path);
+
+        if ((ret = ISFS_CreateFile(path, 0, ISFS_OPEN_RW, ISFS_OPEN_RW, 0)) < 0)
+        {
+            ERROR_MSG("ISFS_CreateFile(\"%s\") failed! (%d).", path, ret);
+            return 0;
+        }
+    }
+
+    fd = ISFS_Open(path, (write_mode ? ISFS_OPEN_WRITE : ISFS_OPEN_READ));
+    if (fd < 0)
+    {
+        ERROR_MSG("ISFS_Open(\"%s\") failed! (%d).", path, fd);
+        return 0;
+    }
+
+    if (!write_mode)
+    {
+        /* ISFS_GetFileStats() needs a 32-byte aligned buffer. */
+        if (!(stats = (fstats*)utilsAllocateMemory(sizeof(fstats))) || (ret = ISFS_GetFileStats(fd, stats)) < 0 || !stats->file_length)
+        {
+            ERROR_MSG("ISFS_GetFileStats(\"%s\") failed! (%d).", path, ret);
+            goto out;
+        }
+
+        if (stats->file_length < size) size = ALIGN_DOWN(stats->file_length, 0x20);
+    }
+
+    start_time = gettime();
+
+    while(offset < size)
+    {
+        u32 cur_size = ((size - offset) < chunk_size ? (size - offset) : chunk_size);
+
+        ret = (write_mode ? ISFS_Write(fd, buf + offset, cur_size) : ISFS_Read(fd, buf + offset, cur_size));
+        if (ret != (s32)cur_size)
+        {
+            ERROR_MSG("ISFS_%s(\"%s\", 0x%X, 0x%X) failed! (%d).", (write_mode ? "Write" : "Read"), path, offset, cur_size, ret);
+            goto out;
+        }
+
+        offset += cur_size;
+    }
+
+    /* Written data is only committed to the NAND once the file is closed. */
+    ISFS_Close(fd);
+    fd = -1;
+
+    throughput = ioCalGetThroughput(size, start_time);
+
+out:
+    if (fd >= 0) ISFS_Close(fd);
+
+    if (stats) utilsFreeMemory(stats);
+
+    return throughput;
+}
+
+static u32 ioCalMeasureMountedDevice(const char *path, bool write_mode, u8 *buf, u32 chunk_size)
+{
+    int fd = -1;
+    u32 offset = 0, throughput = 0;
+    u64 start_time = 0;
+
+    fd = (write_mode ? open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666) : open(path, O_RDONLY));
+    if (fd < 0)
+    {
+        ERROR_MSG("open(\"%s\") failed! (%d).", path, errno);
+        return 0;
+    }
+
+    start_time = gettime();
+
+    /* Chunks are passed straight to the device driver, so misaligned buffers are bounced by it. */
+    while(offset < IO_CAL_SAMPLE_SIZE)
+    {
+        u32 cur_size = ((IO_CAL_SAMPLE_SIZE - offset) < chunk_size ? (IO_CAL_SAMPLE_SIZE - offset) : chunk_size);
+        ssize_t res = (write_mode ? write(fd, buf + offset, cur_size) : read(fd, buf + offset, cur_size));
+
+        if (res != (ssize_t)cur_size)
+        {
+            ERROR_MSG("%s(\"%s\", 0x%X, 0x%X) failed! (%d).", (write_mode ? "write" : "read"), path, offset, cur_size, errno);
+            goto out;
+        }
+
+        offset += cur_size;
+    }
+
+    /* libfat flushes its cache on close(), so it must be accounted for. */
+    if (close(fd) != 0)
+    {
+        fd = -1;
+        ERROR_MSG("close(\"%s\") failed! (%d).", path, errno);
+        goto out;
+    }
+
+    fd = -1;
+
+    throughput = ioCalGetThroughput(IO_CAL_SAMPLE_SIZE, start_time);
+
+out:
+    if (fd >= 0) close(fd);
+
+    return throughput;
+}
+
+static u32 ioCalGetThroughput(u32 size, u64 start_time)
+{
+    u64 elapsed_usec = diff_usec(start_time, gettime());
+
+    /* Report at least 1 KiB/s, since zero means failure. */
+    if (!elapsed_usec) elapsed_usec = 1;
+
+    u64 throughput = (((u64)size * 1000000) / (elapsed_usec * 1024));
+
+    return (throughput ? (u32)throughput : 1);
+}
+
+static u32 ioCalSelectChunkSize(const u32 *results)
+{
+    u32 best = 0;
+
+    for(u32 i = 0; i < IO_CAL_CHUNK_SIZE_COUNT; i++)
+    {
+        if (results[i] > best) best = results[i];
+    }
+
+    /* Pick the smallest chunk size that's close enough to the best throughput. Chunk sizes are sorted in ascending order. */
+    for(u32 i = 0; i < IO_CAL_CHUNK_SIZE_COUNT; i++)
+    {
+        if (((u64)results[i] * 100) >= ((u64)best * (100 - IO_CAL_TOLERANCE))) return g_ioCalChunkSizes[i];
+    }
+
+    return UTILS_DEFAULT_IO_CHUNK_SIZE;
+}
+
+static void ioCalPrintCurve(u8 transfer, const u32 (*results)[IO_CAL_ALIGNMENT_COUNT], u32 selected_chunk_size)
+{
+    printf("%s throughput (KiB/s):\n", g_ioCalTransferNames[transfer]);
+
+    printf("%9s", "Chunk");
+    for(u32 j = 0; j < IO_CAL_ALIGNMENT_COUNT; j++) printf(" | %4u-byte", g_ioCalAlignments[j]);
+    printf("\n");
+
+    for(u32 i = 0; i < IO_CAL_CHUNK_SIZE_COUNT; i++)
+    {
+        printf("%c%4u KiB", (g_ioCalChunkSizes[i] == selected_chunk_size ? '*' : ' '), g_ioCalChunkSizes[i] / 1024);
+
+        for(u32 j = 0; j < IO_CAL_ALIGNMENT_COUNT; j++)
+        {
+            if (results[i][j])
+            {
+                printf(" | %10u", results[i][j]);
+            } else {
+                printf(" | %10s", "-");
+            }
+        }
+
+        printf("\n");
+    }
+
+    printf("\n");
+    fflush(stdout);
+}
+
+static u32 ioCalLoadEntries(IoCalEntry *out_entries)
+{
+    bool invalid = false;
+    u32 entry_count = utilsLoadSidecarFile(IO_CAL_PATH, IO_CAL_MAGIC, IO_CAL_VERSION, out_entries, sizeof(IoCalEntry), IO_CAL_MAX_ENTRIES, &invalid);
+
+    /* A missing calibration file isn't an error, but an invalid one is reported. */
+    if (invalid) printf("Discarding invalid I/O calibration data.\n");
+
+    return entry_count;
+}
+
+static bool ioCalSaveEntry(u32 device_id, const UtilsIoChunkSizes *chunk_sizes)
+{
+    IoCalEntry entries[IO_CAL_MAX_ENTRIES] = {0}, entry = {0};
+    u32 entry_count = ioCalLoadEntries(entries);
+
+    /* Replace any previous calibration for this console. */
+    for(u32 i = 0; i < entry_count; i++)
+    {
+        if (entries[i].device_id != device_id) continue;
+
+        if ((i + 1) < entry_count) memmove(&(entries[i]), &(entries[i + 1]), sizeof(IoCalEntry) * (entry_count - i - 1));
+        entry_count--;
+        break;
+    }
+
+    entry.device_id = device_id;
+    memcpy(&(entry.chunk_sizes), chunk_sizes, sizeof(UtilsIoChunkSizes));
+
+    entry_count = utilsAppendSidecarEntry(entries, entry_count, IO_CAL_MAX_ENTRIES, sizeof(IoCalEntry), &entry);
+
+    if (!utilsSaveSidecarFile(IO_CAL_PATH, IO_CAL_MAGIC, IO_CAL_VERSION, entries, sizeof(IoCalEntry), entry_count))
+    {
+        ERROR_MSG("Failed to write I/O calibration data!");
+        return false;
+    }
+
+    return true;
+}
+
+#endif  /* BACKUP_U8_ARCHIVE */
@@ -0,0 +1,45 @@
+/*
+ * iocal.h
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifndef __IOCAL_H__
+#define __IOCAL_H__
+
+#ifdef BACKUP_U8_ARCHIVE
+
+#define IO_CAL_PATH                 "sd:/" APP_TITLE "/iocal.bin"
+
+#define IO_CAL_MAGIC                (u32)0x494F434C /* "IOCL". */
+#define IO_CAL_VERSION              1
+#define IO_CAL_MAX_ENTRIES          8
+
+/// Loads the chunk sizes calibrated for the running console from IO_CAL_PATH, and applies them through utilsSetIoChunkSizes().
+/// Returns false if no calibration is available for this console, in which case the default chunk sizes are kept.
+bool ioCalLoad(void);
+
+/// Measures ISFS and SD card throughput using several chunk sizes and buffer alignments, and prints the measured curves.
+/// ISFS reads use nand_path (e.g. the System Menu U8 archive content), while ISFS writes and SD card transfers use temporary files, which are deleted afterwards.
+/// The best chunk size for each transfer type is applied and saved to IO_CAL_PATH, keyed by the console device ID. Calibrations for other consoles are kept.
+bool ioCalRun(const char *nand_path);
+
+#endif  /* BACKUP_U8_ARCHIVE */
+
+#endif /* __IOCAL_H__ */
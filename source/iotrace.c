@@ -0,0 +1,172 @@
+/*
+ * iotrace.c
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils.h"
+#include "iotrace.h"
+
+#ifdef RECORD_IO_TRACE
+
+#define IO_TRACE_NO_PATH    0xFF
+
+typedef struct {
+    u32 start_usec;     ///< Start time, relative to the first event.
+    u32 elapsed_usec;   ///< Elapsed time.
+    u32 offset;         ///< Block offset.
+    u32 size;           ///< Block size.
+    s32 result;         ///< Call return value.
+    u8 op;              ///< IoTraceOp.
+    u8 path_idx;        ///< Index into the path table. IO_TRACE_NO_PATH if not available.
+    u16 reserved;
+} IoTraceEvent;
+
+SIZE_ASSERT(IoTraceEvent, 0x18);
+
+/* Global variables. */
+
+static IoTraceEvent g_ioTraceEvents[IO_TRACE_MAX_EVENTS] = {0};
+static u32 g_ioTraceEventCount = 0, g_ioTraceDroppedCount = 0;
+
+static char g_ioTracePaths[IO_TRACE_MAX_PATHS][ISFS_MAXPATH + 0x20] = {0};
+static u32 g_ioTracePathCount = 0;
+
+static u64 g_ioTraceEpoch = 0;
+
+#ifdef BACKUP_U8_ARCHIVE
+/* Only needed to save traces. */
+static const char *g_ioTraceOpNames[IoTraceOp_Count] = {
+    [IoTraceOp_EsGetTmdSize] = "es_get_tmd_size",
+    [IoTraceOp_EsGetTmd]     = "es_get_tmd",
+    [IoTraceOp_IsfsOpen]     = "isfs_open",
+    [IoTraceOp_IsfsRead]     = "isfs_read",
+    [IoTraceOp_IsfsWrite]    = "isfs_write",
+    [IoTraceOp_IsfsSeek]     = "isfs_seek",
+    [IoTraceOp_SdOpen]       = "sd_open",
+    [IoTraceOp_SdRead]       = "sd_read",
+    [IoTraceOp_SdWrite]      = "sd_write",
+    [IoTraceOp_SdClose]      = "sd_close"
+};
+#endif  /* BACKUP_U8_ARCHIVE */
+
+/* Function prototypes. */
+
+static u8 ioTraceGetPathIndex(const char *path);
+
+void ioTraceRecord(u8 op, const char *path, u32 offset, u32 size, s32 result, u64 start_time)
+{
+    u64 end_time = gettime();
+    IoTraceEvent *event = NULL;
+    u32 level = 0;
+
+    if (op >= IoTraceOp_Count) return;
+
+    /* Calls may complete on the pipeline threads, so the event table is only updated with interrupts disabled. This also keeps thread switches out. */
+    _CPU_ISR_Disable(level);
+
+    if (g_ioTraceEventCount >= IO_TRACE_MAX_EVENTS)
+    {
+        g_ioTraceDroppedCount++;
+        goto out;
+    }
+
+    if (!g_ioTraceEventCount) g_ioTraceEpoch = start_time;
+
+    event = &(g_ioTraceEvents[g_ioTraceEventCount++]);
+
+    /* Async calls may have been issued before the first recorded event. */
+    event->start_usec = (start_time > g_ioTraceEpoch ? (u32)diff_usec(g_ioTraceEpoch, start_time) : 0);
+    event->elapsed_usec = (u32)diff_usec(start_time, end_time);
+    event->offset = offset;
+    event->size = size;
+    event->result = result;
+    event->op = op;
+    event->path_idx = ioTraceGetPathIndex(path);
+
+out:
+    _CPU_ISR_Restore(level);
+}
+
+u32 ioTraceGetEventCount(u32 *out_dropped)
+{
+    if (out_dropped) *out_dropped = g_ioTraceDroppedCount;
+    return g_ioTraceEventCount;
+}
+
+void ioTraceReset(void)
+{
+    u32 level = 0;
+
+    _CPU_ISR_Disable(level);
+
+    g_ioTraceEventCount = g_ioTraceDroppedCount = g_ioTracePathCount = 0;
+    g_ioTraceEpoch = 0;
+
+    _CPU_ISR_Restore(level);
+}
+
+#ifdef BACKUP_U8_ARCHIVE
+bool ioTraceSaveToMountedDevice(const char *path)
+{
+    if (!path || !*path) return false;
+
+    FILE *fp = fopen(path, "w");
+    if (!fp)
+    {
+        ERROR_MSG("Failed to open \"%s\" for writing! (%d).", path, errno);
+        return false;
+    }
+
+    /* Paths are quoted, since SD card paths may hold commas. */
+    fprintf(fp, "start_usec,elapsed_usec,op,path,offset,size,result\n");
+
+    for(u32 i = 0; i < g_ioTraceEventCount; i++)
+    {
+        IoTraceEvent *event = &(g_ioTraceEvents[i]);
+        fprintf(fp, "%u,%u,%s,\"%s\",%u,%u,%d\n", event->start_usec, event->elapsed_usec, g_ioTraceOpNames[event->op], \
+                (event->path_idx != IO_TRACE_NO_PATH ? g_ioTracePaths[event->path_idx] : ""), event->offset, event->size, event->result);
+    }
+
+    if (fclose(fp) != 0)
+    {
+        ERROR_MSG("Failed to write \"%s\"! (%d).", path, errno);
+        return false;
+    }
+
+    return true;
+}
+#endif  /* BACKUP_U8_ARCHIVE */
+
+static u8 ioTraceGetPathIndex(const char *path)
+{
+    if (!path || !*path) return IO_TRACE_NO_PATH;
+
+    /* Traces only touch a handful of files, so a linear search is good enough. */
+    for(u32 i = 0; i < g_ioTracePathCount; i++)
+    {
+        if (!strncmp(g_ioTracePaths[i], path, sizeof(g_ioTracePaths[i]))) return (u8)i;
+    }
+
+    if (g_ioTracePathCount >= IO_TRACE_MAX_PATHS) return IO_TRACE_NO_PATH;
+
+    snprintf(g_ioTracePaths[g_ioTracePathCount], sizeof(g_ioTracePaths[g_ioTracePathCount]), "%s", path);
+
+    return (u8)g_ioTracePathCount++;
+}
+
+#endif  /* RECORD_IO_TRACE */
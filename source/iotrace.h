@@ -0,0 +1,91 @@
+/*
+ * iotrace.h
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifndef __IOTRACE_H__
+#define __IOTRACE_H__
+
+#define IO_TRACE_CSV_PATH       "sd:/" APP_TITLE "/iotrace.csv"
+
+#define IO_TRACE_MAX_EVENTS     4096
+#define IO_TRACE_MAX_PATHS      64
+
+typedef enum {
+    IoTraceOp_EsGetTmdSize = 0,
+    IoTraceOp_EsGetTmd     = 1,
+    IoTraceOp_IsfsOpen     = 2,
+    IoTraceOp_IsfsRead     = 3,
+    IoTraceOp_IsfsWrite    = 4,
+    IoTraceOp_IsfsSeek     = 5,
+    IoTraceOp_SdOpen       = 6,
+    IoTraceOp_SdRead       = 7,
+    IoTraceOp_SdWrite      = 8,
+    IoTraceOp_SdClose      = 9,    ///< libfat flushes its cache on close(), so this can take a while after writes.
+    IoTraceOp_Count        = 10    ///< Total values supported by this enum.
+} IoTraceOp;
+
+#ifdef RECORD_IO_TRACE
+
+/// Returns a timestamp that must be passed to ioTraceRecord() once the traced call completes.
+ALWAYS_INLINE u64 ioTraceBegin(void)
+{
+    return gettime();
+}
+
+/// Records a completed ES, ISFS or SD card call. path may be NULL for calls that aren't tied to a file (e.g. ES calls).
+/// offset and size describe the transferred block, and result holds the call return value. Safe to call from any thread.
+/// Events are dropped once IO_TRACE_MAX_EVENTS is reached.
+void ioTraceRecord(u8 op, const char *path, u32 offset, u32 size, s32 result, u64 start_time);
+
+/// Returns the number of recorded events, as well as the number of dropped events through out_dropped (if provided).
+u32 ioTraceGetEventCount(u32 *out_dropped);
+
+/// Clears all recorded events.
+void ioTraceReset(void);
+
+#ifdef BACKUP_U8_ARCHIVE
+/// Saves all recorded events to a CSV file stored in a mounted device, replacing any previous trace.
+/// Each row holds the start time relative to the first event, the elapsed time (both in microseconds), the operation, the file path, the offset, the size and the result.
+bool ioTraceSaveToMountedDevice(const char *path);
+#endif  /* BACKUP_U8_ARCHIVE */
+
+#else
+
+/* Tracing compiles down to nothing if it's disabled. */
+
+ALWAYS_INLINE u64 ioTraceBegin(void)
+{
+    return 0;
+}
+
+ALWAYS_INLINE void ioTraceRecord(u8 op, const char *path, u32 offset, u32 size, s32 result, u64 start_time)
+{
+    (void)op;
+    (void)path;
+    (void)offset;
+    (void)size;
+    (void)result;
+    (void)start_time;
+}
+
+#endif  /* RECORD_IO_TRACE */
+
+#endif /* __IOTRACE_H__ */
@@ -20,36 +20,61 @@
 
 #include "utils.h"
 #include "ardb.h"
+#include "rules.h"
+#include "u8.h"
+#include "patch.h"
+#include "inventory.h"
+#include "iocal.h"
+#include "iotrace.h"
+#include "titlemeta.h"
+#include "profiler.h"
+#include "benchmark.h"
+#include "options.h"
+#include "actions.h"
 
 #include <runtimeiospatch.h>
 
-static const u32 g_ardbWc24Entries[] = {
-    ARDB_WC24_EVC_ENTRY,
-    ARDB_WC24_CMOC_ENTRY
-};
+static Options g_options = {0};
 
-static const u32 g_ardbWc24EntriesCount = MAX_ELEMENTS(g_ardbWc24Entries);
+#ifdef BACKUP_U8_ARCHIVE
+static bool g_optionsFileLoaded = false;
+#endif  /* BACKUP_U8_ARCHIVE */
 
 extern void __exception_setreload(int t);
 
+static u8 waitForAction(void);
+
+#ifdef BACKUP_U8_ARCHIVE
+static bool loadOptionsFile(int argc, char **argv);
+#endif  /* BACKUP_U8_ARCHIVE */
+
 int main(int argc, char **argv)
 {
-    (void)argc;
-    (void)argv;
-
     int ret = 0;
-    bool vwii = utilsIsWiiU(), bail = false;
+    bool vwii = utilsIsWiiU(), bail = false, args_parsed = false;
+    u8 action = OptionsAction_None;
+    u64 start_time = gettime();
 
     /* Set reload time to 10 seconds in case an exception is triggered. */
     __exception_setreload(10);
 
-    /* Initialize video output and controllers. */
+    /* Initialize video output. */
     utilsInitConsole(vwii);
-    utilsInitPads();
 
     /* Print headline. */
     utilsPrintHeadline();
 
+    /* Parse command line arguments. */
+    optionsInit(&g_options);
+    args_parsed = optionsParseArguments(&g_options, argc, argv);
+
+    if (!args_parsed)
+    {
+        printf("Invalid command line arguments!");
+        ret = -10;
+        goto out;
+    }
+
     /* Check if we're running under vWii (Wii U). */
     if (!vwii)
     {
@@ -86,6 +111,12 @@ int main(int argc, char **argv)
 
     printf("OK!\n");
 
+#ifdef BACKUP_U8_ARCHIVE
+    /* Mount the SD card in the background, now that the IOS patches are in place. */
+    /* It only needs to be ready once we actually use it: every step that does waits for it through utilsMountSdCard(). */
+    utilsMountSdCardAsync();
+#endif  /* BACKUP_U8_ARCHIVE */
+
     /* Initialize NAND filesystem driver. */
     printf("Initializing NAND FS driver... ");
 
@@ -97,28 +128,132 @@ int main(int argc, char **argv)
         goto out;
     }
 
-    printf("OK!\n");
+    printf("OK!\n\n");
 
 #ifdef BACKUP_U8_ARCHIVE
-    /* Mount SD card. */
-    printf("Mounting SD card... ");
+    /* The config file may select an action, so it must be loaded before showing the menu. */
+    /* If the command line arguments already select an action, it's only loaded right before running it, which gives the SD card more time to get mounted. */
+    if (!optionsIsUnattended(&g_options) && !loadOptionsFile(argc, argv))
+    {
+        printf("Invalid config file!");
+        ret = -10;
+        goto out;
+    }
+#endif  /* BACKUP_U8_ARCHIVE */
 
-    if (!utilsMountSdCard())
+    printf("Ready in %llu ms.\n\n", diff_usec(start_time, gettime()) / 1000);
+
+    if (optionsIsUnattended(&g_options))
     {
-        printf("FAILED!");
-        ret = -5;
+        action = g_options.action;
+    } else {
+        /* Controllers are initialized on first use, so unattended runs never wait for them. */
+        utilsInitPads();
+
+        action = waitForAction();
+        if (action == OptionsAction_None)
+        {
+            /* Exit. */
+            bail = true;
+            goto out;
+        }
+    }
+
+#ifdef BACKUP_U8_ARCHIVE
+    if (!loadOptionsFile(argc, argv))
+    {
+        printf("Invalid config file!");
+        ret = -10;
         goto out;
     }
+#endif  /* BACKUP_U8_ARCHIVE */
 
-    printf("OK!\n\n");
-#else
-    printf("\n");
+    utilsPrintHeadline();
+
+    ret = actionsRun(&g_options, action);
+    if (ret != 0) goto out;
+
+#ifdef PROFILE_PHASES
+    profilerPrintSummary();
+
+#if defined(SAVE_PROFILE_CSV) && defined(BACKUP_U8_ARCHIVE)
+    if (utilsMountSdCard())
+    {
+        mkdir("sd:/" APP_TITLE, 0777);
+        if (profilerSaveToMountedDevice(PROFILER_CSV_PATH)) printf("Saved timing data to \"" PROFILER_CSV_PATH "\".\n\n");
+        if (profilerSaveMemoryToMountedDevice(PROFILER_MEMORY_CSV_PATH)) printf("Saved memory usage data to \"" PROFILER_MEMORY_CSV_PATH "\".\n\n");
+    }
+#endif  /* SAVE_PROFILE_CSV && BACKUP_U8_ARCHIVE */
+#endif  /* PROFILE_PHASES */
+
+#if defined(RECORD_IO_TRACE) && defined(BACKUP_U8_ARCHIVE)
+    if (utilsMountSdCard())
+    {
+        u32 dropped_count = 0, event_count = ioTraceGetEventCount(&dropped_count);
+
+        mkdir("sd:/" APP_TITLE, 0777);
+        if (ioTraceSaveToMountedDevice(IO_TRACE_CSV_PATH)) printf("Saved %u I/O trace events (%u dropped) to \"" IO_TRACE_CSV_PATH "\".\n\n", event_count, dropped_count);
+    }
+#endif  /* RECORD_IO_TRACE && BACKUP_U8_ARCHIVE */
+
+    printf("Process completed.");
+
+out:
+    actionsFree();
+
+#ifdef BACKUP_U8_ARCHIVE
+    patchClearEntries();
+#endif  /* BACKUP_U8_ARCHIVE */
+
+    titleMetaFree();
+
+#ifdef BACKUP_U8_ARCHIVE
+    utilsUnmountSdCard();
 #endif  /* BACKUP_U8_ARCHIVE */
 
-    printf("Press 1/X  to patch WC24 channel entries within the WW 43DB.\n\n");
+    ISFS_Deinitialize();
+
+    if (ret != 0) printf("\n\nProcess cannot continue.");
+
+    if (!bail)
+    {
+        if (optionsIsUnattended(&g_options))
+        {
+            /* Give whoever is watching the screen a chance to read the results. */
+            printf(" Returning to the loader in %u %s...", g_options.return_delay, (g_options.return_delay == 1 ? "second" : "seconds"));
+            fflush(stdout);
+            sleep(g_options.return_delay);
+        } else {
+            printf(" Press any button to exit.");
+            fflush(stdout);
+            utilsInitPads();
+            utilsWaitForButtonPress();
+        }
+    }
+
+    utilsReboot();
+
+    return ret;
+}
+
+static u8 waitForAction(void)
+{
+    printf("Press 1/X  to patch WC24 channel entries within the WW 43DB.\n");
+#ifdef BACKUP_U8_ARCHIVE
+    printf("           Rules from \"" RULES_FILE_PATH "\" are used instead, if available.\n");
+#endif  /* BACKUP_U8_ARCHIVE */
+    printf("\n");
 #ifdef BACKUP_U8_ARCHIVE
     printf("Press  -   to restore a backup of the System Menu U8 archive.\n\n");
+    printf("Press 2/Y  to extract the System Menu U8 archive to the SD card.\n\n");
+    printf("Press  B   to export a 43DB inventory to the SD card.\n");
+    printf("           Dumps from \"" INVENTORY_DUMP_PATH "\" are included.\n\n");
+    printf("Press  Up  to calibrate NAND and SD card transfer chunk sizes.\n\n");
 #endif  /* BACKUP_U8_ARCHIVE */
+    printf("Press  +   to verify the integrity of all System Menu contents.\n\n");
+#ifdef BENCHMARK_U8
+    printf("Press  A   to benchmark the U8 parser using synthetic archives.\n\n");
+#endif  /* BENCHMARK_U8 */
     printf("Press HOME to exit.\n\n");
 
     fflush(stdout);
@@ -127,58 +262,44 @@ int main(int argc, char **argv)
     {
         u32 pressed = utilsGetInput(UtilsInputType_Down);
 
-        if (pressed == WPAD_BUTTON_1)
-        {
-            /* Patch WiiWare aspect ratio database. */
-            utilsPrintHeadline();
-            printf("Patching WC24 entries within WW 43DB...\n\n");
-
-            if (!ardbPatchDatabaseFromSystemMenuArchive(AspectRatioDatabaseType_WiiWare, g_ardbWc24Entries, g_ardbWc24EntriesCount))
-            {
-                ret = -6;
-                goto out;
-            }
-
-            break;
-        } else
+        if (pressed == WPAD_BUTTON_1) return OptionsAction_Patch;
 #ifdef BACKUP_U8_ARCHIVE
-        if (pressed == WPAD_BUTTON_MINUS)
-        {
-            /* Restore System Menu U8 archive backup. */
-            utilsPrintHeadline();
-            printf("Restoring System Menu U8 archive...\n\n");
-
-            if (!ardbRestoreSystemMenuArchive())
-            {
-                ret = -7;
-                goto out;
-            }
-
-            break;
-        } else
+        if (pressed == WPAD_BUTTON_MINUS) return OptionsAction_Restore;
+        if (pressed == WPAD_BUTTON_2) return OptionsAction_Extract;
+        if (pressed == WPAD_BUTTON_B) return OptionsAction_Inventory;
+        if (pressed == WPAD_BUTTON_UP) return OptionsAction_Calibrate;
 #endif  /* BACKUP_U8_ARCHIVE */
-        if (pressed == WPAD_BUTTON_HOME)
-        {
-            /* Exit. */
-            bail = true;
-            break;
-        }
+        if (pressed == WPAD_BUTTON_PLUS) return OptionsAction_Verify;
+#ifdef BENCHMARK_U8
+        if (pressed == WPAD_BUTTON_A) return OptionsAction_Benchmark;
+#endif  /* BENCHMARK_U8 */
+        if (pressed == WPAD_BUTTON_HOME) return OptionsAction_None;
     }
+}
 
-    if (!bail) printf("Process completed. Press any button to exit.");
-
-out:
 #ifdef BACKUP_U8_ARCHIVE
-    utilsUnmountSdCard();
-#endif  /* BACKUP_U8_ARCHIVE */
+static bool loadOptionsFile(int argc, char **argv)
+{
+    struct stat st = {0};
 
-    ISFS_Deinitialize();
+    if (g_optionsFileLoaded) return true;
+    g_optionsFileLoaded = true;
 
-    if (ret != 0) printf("\n\nProcess cannot continue. Press any button to exit.");
+    /* Wait for the background SD card mount. A missing SD card isn't an error. */
+    if (!utilsMountSdCard()) return true;
 
-    if (!bail) utilsWaitForButtonPress();
+    /* Load the config file, if available. Command line arguments take precedence over it. */
+    if (stat(OPTIONS_FILE_PATH, &st) == 0)
+    {
+        printf("Loading options from \"" OPTIONS_FILE_PATH "\"...\n\n");
 
-    utilsReboot();
+        optionsInit(&g_options);
+        if (!optionsLoadFromFile(&g_options, OPTIONS_FILE_PATH) || !optionsParseArguments(&g_options, argc, argv)) return false;
+    }
 
-    return ret;
+    /* Apply the transfer chunk sizes calibrated for this console, if available. */
+    if (ioCalLoad()) printf("Loaded calibrated I/O chunk sizes from \"" IO_CAL_PATH "\".\n\n");
+
+    return true;
 }
+#endif  /* BACKUP_U8_ARCHIVE */
@@ -0,0 +1,241 @@
+/*
+ * options.c
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils.h"
+#include "ardb.h"
+#include "rules.h"
+#include "options.h"
+
+/* Global variables. */
+
+static const char *g_optionsActionNames[OptionsAction_Count] = {
+    [OptionsAction_None]      = "none",
+    [OptionsAction_Patch]     = "patch",
+    [OptionsAction_DryRun]    = "dryrun",
+    [OptionsAction_Restore]   = "restore",
+    [OptionsAction_Extract]   = "extract",
+    [OptionsAction_Verify]    = "verify",
+    [OptionsAction_Benchmark] = "benchmark",
+    [OptionsAction_Inventory] = "inventory",
+    [OptionsAction_Calibrate] = "calibrate"
+};
+
+/* Function prototypes. */
+
+static bool optionsParsePair(Options *opts, char *pair);
+
+static bool optionsParseAction(Options *opts, const char *value);
+static bool optionsParseDatabaseList(Options *opts, char *value);
+
+void optionsInit(Options *opts)
+{
+    if (!opts) return;
+
+    memset(opts, 0, sizeof(Options));
+    opts->return_delay = OPTIONS_DEFAULT_RETURN_DELAY;
+    opts->benchmark_budget = OPTIONS_DEFAULT_BENCHMARK_BUDGET;
+}
+
+bool optionsParseArguments(Options *opts, int argc, char **argv)
+{
+    if (!opts || argc < 0 || (argc > 0 && !argv))
+    {
+        ERROR_MSG("Invalid parameters!");
+        return false;
+    }
+
+    for(int i = 1; i < argc; i++)
+    {
+        char pair[0x200] = {0};
+
+        if (!argv[i] || !*argv[i]) continue;
+
+        /* Work on a copy, since the pair is split in place. */
+        if (strlen(argv[i]) >= sizeof(pair))
+        {
+            ERROR_MSG("Argument #%d is too long!", i);
+            return false;
+        }
+
+        strcpy(pair, argv[i]);
+
+        if (!optionsParsePair(opts, pair))
+        {
+            ERROR_MSG("Invalid argument \"%s\"!", argv[i]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+#ifdef BACKUP_U8_ARCHIVE
+bool optionsLoadFromFile(Options *opts, const char *path)
+{
+    if (!opts || !path || !*path)
+    {
+        ERROR_MSG("Invalid parameters!");
+        return false;
+    }
+
+    char *text = NULL, *line = NULL, *next_line = NULL;
+    u32 line_number = 0;
+    bool success = false;
+
+    /* Read whole config file. */
+    text = utilsReadTextFileFromMountedDevice(path);
+    if (!text)
+    {
+        ERROR_MSG("Failed to read config file!");
+        return false;
+    }
+
+    for(line = text; line; line = next_line)
+    {
+        char *comment = NULL;
+
+        line_number++;
+
+        /* Split lines. */
+        if ((next_line = strchr(line, '\n'))) *next_line++ = '\0';
+
+        /* Strip comments and whitespace. */
+        if ((comment = strchr(line, '#'))) *comment = '\0';
+        line = utilsTrimString(line);
+        if (!*line) continue;
+
+        if (!optionsParsePair(opts, line))
+        {
+            ERROR_MSG("Invalid option at line #%u!", line_number);
+            goto out;
+        }
+    }
+
+    success = true;
+
+out:
+    utilsFreeMemory(text);
+
+    return success;
+}
+#endif  /* BACKUP_U8_ARCHIVE */
+
+static bool optionsParsePair(Options *opts, char *pair)
+{
+    char *key = pair, *value = NULL, *end = NULL;
+    unsigned long delay = 0, budget = 0;
+
+    /* Split key and value. */
+    if (!(value = strchr(pair, '='))) return false;
+    *value++ = '\0';
+
+    key = utilsTrimString(key);
+    value = utilsTrimString(value);
+    if (!*key || !*value) return false;
+
+    if (!strcmp(key, "action")) return optionsParseAction(opts, value);
+
+    if (!strcmp(key, "db")) return optionsParseDatabaseList(opts, value);
+
+    if (!strcmp(key, "rules"))
+    {
+        if (!strcmp(value, "default"))
+        {
+            opts->default_rules = true;
+            *(opts->rules_path) = '\0';
+            return true;
+        }
+
+#ifdef BACKUP_U8_ARCHIVE
+        if (strlen(value) >= sizeof(opts->rules_path)) return false;
+
+        opts->default_rules = false;
+        strcpy(opts->rules_path, value);
+
+        return true;
+#else
+        return false;
+#endif  /* BACKUP_U8_ARCHIVE */
+    }
+
+    if (!strcmp(key, "delay"))
+    {
+        delay = strtoul(value, &end, 10);
+        if (*end || delay > 60) return false;
+
+        opts->return_delay = (u32)delay;
+
+        return true;
+    }
+
+    if (!strcmp(key, "budget"))
+    {
+        budget = strtoul(value, &end, 10);
+        if (*end || !budget || budget > 1000) return false;
+
+        opts->benchmark_budget = (u32)budget;
+
+        return true;
+    }
+
+    return false;
+}
+
+static bool optionsParseAction(Options *opts, const char *value)
+{
+    for(u8 i = (OptionsAction_None + 1); i < OptionsAction_Count; i++)
+    {
+        if (strcmp(value, g_optionsActionNames[i]) != 0) continue;
+
+        /* Reject actions that aren't available in this build. */
+#ifndef BACKUP_U8_ARCHIVE
+        if (i == OptionsAction_Restore || i == OptionsAction_Extract || i == OptionsAction_Inventory || i == OptionsAction_Calibrate) return false;
+#endif  /* BACKUP_U8_ARCHIVE */
+
+#ifndef BENCHMARK_U8
+        if (i == OptionsAction_Benchmark) return false;
+#endif  /* BENCHMARK_U8 */
+
+        opts->action = i;
+
+        return true;
+    }
+
+    return false;
+}
+
+static bool optionsParseDatabaseList(Options *opts, char *value)
+{
+    u8 mask = 0;
+
+    for(char *name = strtok(value, ","); name; name = strtok(NULL, ","))
+    {
+        s32 type = rulesGetDatabaseTypeByName(utilsTrimString(name));
+        if (type < 0) return false;
+
+        mask |= (u8)(1 << type);
+    }
+
+    if (!mask) return false;
+
+    opts->database_mask = mask;
+
+    return true;
+}
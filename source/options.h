@@ -0,0 +1,84 @@
+/*
+ * options.h
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifndef __OPTIONS_H__
+#define __OPTIONS_H__
+
+#define OPTIONS_FILE_PATH                   "sd:/" APP_TITLE "/config.txt"
+
+#define OPTIONS_DEFAULT_RETURN_DELAY        5   /* Seconds. */
+#define OPTIONS_DEFAULT_BENCHMARK_BUDGET    25  /* Percentage. */
+
+typedef enum {
+    OptionsAction_None      = 0,    ///< Interactive mode.
+    OptionsAction_Patch     = 1,
+    OptionsAction_DryRun    = 2,    ///< Same as OptionsAction_Patch, but nothing is written.
+    OptionsAction_Restore   = 3,
+    OptionsAction_Extract   = 4,
+    OptionsAction_Verify    = 5,
+    OptionsAction_Benchmark = 6,
+    OptionsAction_Inventory = 7,
+    OptionsAction_Calibrate = 8,
+    OptionsAction_Count     = 9     ///< Total values supported by this enum.
+} OptionsAction;
+
+/// Options can be provided as command line arguments (e.g. through the <arguments> element from meta.xml) or through a config file.
+/// Both use "key=value" pairs. The config file holds one pair per line, and everything after a '#' character is ignored.
+/// Supported keys:
+///     "action": "patch", "dryrun", "restore", "extract", "verify", "benchmark", "inventory" or "calibrate". Selecting an action enables unattended mode.
+///     "db": comma-separated list of databases to patch ("discdb", "vcadb", "wwdb"). All of them are patched by default.
+///     "rules": "default" to ignore the rules file from the SD card, or a path to a custom rules file.
+///     "delay": seconds to wait before returning to the loader in unattended mode.
+///     "budget": percentage by which a U8 benchmark result may exceed its stored baseline before it's considered a regression.
+typedef struct {
+    u8 action;                  ///< OptionsAction.
+    u8 database_mask;           ///< Bitmask of AspectRatioDatabaseType values to patch. Zero means all databases.
+    bool default_rules;         ///< Use the built-in WC24 channel rules, even if a rules file is available.
+    char rules_path[0x100];     ///< Custom rules file path. Empty if not set.
+    u32 return_delay;           ///< Seconds to wait before returning to the loader in unattended mode.
+    u32 benchmark_budget;       ///< Allowed U8 benchmark slowdown over the stored baselines, as a percentage.
+} Options;
+
+/// Sets default values for all options.
+void optionsInit(Options *opts);
+
+/// Parses command line arguments into the provided options. argv[0] is skipped, since it holds the executable path.
+bool optionsParseArguments(Options *opts, int argc, char **argv);
+
+#ifdef BACKUP_U8_ARCHIVE
+/// Parses a config file stored in a mounted device into the provided options.
+bool optionsLoadFromFile(Options *opts, const char *path);
+#endif  /* BACKUP_U8_ARCHIVE */
+
+/// Checks if the provided options select an action, which means no user input is required.
+ALWAYS_INLINE bool optionsIsUnattended(const Options *opts)
+{
+    return (opts->action != OptionsAction_None);
+}
+
+/// Checks if the provided aspect ratio database type must be patched.
+ALWAYS_INLINE bool optionsIsDatabaseSelected(const Options *opts, u8 type)
+{
+    return (!opts->database_mask || (opts->database_mask & (1 << type)));
+}
+
+#endif /* __OPTIONS_H__ */
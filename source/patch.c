@@ -0,0 +1,634 @@
+/*
+ * patch.c
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils.h"
+#include "u8.h"
+#include "sha1.h"
+#include "patch.h"
+
+#ifdef BACKUP_U8_ARCHIVE
+
+#define PATCH_PATH_LENGTH       0x100
+#define PATCH_RULE_MAX_TOKENS   4
+
+#define PATCH_IPS_MAGIC         "PATCH"
+#define PATCH_IPS_MAGIC_SIZE    5
+#define PATCH_IPS_EOF           0x454F46    /* "EOF". */
+
+#define PATCH_BPS_MAGIC         "BPS1"
+#define PATCH_BPS_MAGIC_SIZE    4
+#define PATCH_BPS_FOOTER_SIZE   12          /* Source, target and patch CRC32 checksums. */
+
+typedef enum {
+    PatchBpsAction_SourceRead = 0,
+    PatchBpsAction_TargetRead = 1,
+    PatchBpsAction_SourceCopy = 2,
+    PatchBpsAction_TargetCopy = 3
+} PatchBpsAction;
+
+typedef struct {
+    char member_path[PATCH_PATH_LENGTH];    ///< U8 file node path.
+    char patch_path[PATCH_PATH_LENGTH];     ///< Patch file path within a mounted device.
+    bool check_source;                      ///< Set to true if source_hash must be verified.
+    u8 source_hash[SHA1_HASH_SIZE];         ///< Expected SHA-1 checksum for the unpatched U8 file node data.
+    bool check_target;                      ///< Set to true if target_hash must be verified.
+    u8 target_hash[SHA1_HASH_SIZE];         ///< Expected SHA-1 checksum for the patched U8 file node data.
+} PatchEntry;
+
+/* Global variables. */
+
+static PatchEntry g_patchEntries[PATCH_MAX_ENTRIES] = {0};
+static u32 g_patchEntryCount = 0;
+
+static u32 g_patchCrc32Table[0x100] = {0};
+static bool g_patchCrc32TableGenerated = false;
+
+/* Function prototypes. */
+
+static bool patchParseHash(const char *str, u8 *out_hash);
+
+static bool patchApplyEntry(U8Context *ctx, const PatchEntry *entry, bool *out_modified);
+static bool patchApplyIps(U8Context *ctx, u32 file_node_idx, const u8 *patch, u32 patch_size);
+static bool patchApplyBps(U8Context *ctx, u32 file_node_idx, const u8 *patch, u32 patch_size, bool *out_applied);
+
+static bool patchReadBpsNumber(const u8 *patch, u32 patch_end, u32 *offset, u32 *out_value);
+static u32 patchCalculateCrc32(const u8 *data, u32 size);
+
+ALWAYS_INLINE u32 patchReadBigEndian(const u8 *data, u32 size)
+{
+    u32 value = 0;
+    for(u32 i = 0; i < size; i++) value = ((value << 8) | data[i]);
+    return value;
+}
+
+ALWAYS_INLINE u32 patchReadLittleEndian32(const u8 *data)
+{
+    return ((u32)data[0] | ((u32)data[1] << 8) | ((u32)data[2] << 16) | ((u32)data[3] << 24));
+}
+
+bool patchAddEntryFromRule(char *rule)
+{
+    char *tokens[PATCH_RULE_MAX_TOKENS] = {0}, *token = NULL, *saveptr = NULL;
+    u32 token_count = 0;
+    PatchEntry *entry = NULL;
+
+    if (!rule || !*rule)
+    {
+        ERROR_MSG("Invalid parameters!");
+        return false;
+    }
+
+    if (g_patchEntryCount >= PATCH_MAX_ENTRIES)
+    {
+        ERROR_MSG("Patch entry limit reached! (%u).", PATCH_MAX_ENTRIES);
+        return false;
+    }
+
+    /* Split rule into whitespace-separated tokens. */
+    for(token = strtok_r(rule, " \t", &saveptr); token; token = strtok_r(NULL, " \t", &saveptr))
+    {
+        if (token_count >= PATCH_RULE_MAX_TOKENS)
+        {
+            ERROR_MSG("Too many fields in patch rule!");
+            return false;
+        }
+
+        tokens[token_count++] = token;
+    }
+
+    if (token_count < 2 || *(tokens[0]) != '/' || strlen(tokens[0]) >= PATCH_PATH_LENGTH || strlen(tokens[1]) >= PATCH_PATH_LENGTH)
+    {
+        ERROR_MSG("Invalid patch rule!");
+        return false;
+    }
+
+    entry = &(g_patchEntries[g_patchEntryCount]);
+    memset(entry, 0, sizeof(PatchEntry));
+
+    snprintf(entry->member_path, sizeof(entry->member_path), "%s", tokens[0]);
+    snprintf(entry->patch_path, sizeof(entry->patch_path), "%s", tokens[1]);
+
+    /* Parse optional checksums. A dash skips the source checksum. */
+    if (token_count > 2 && strcmp(tokens[2], "-") != 0)
+    {
+        if (!patchParseHash(tokens[2], entry->source_hash))
+        {
+            ERROR_MSG("Invalid source SHA-1 checksum \"%s\"!", tokens[2]);
+            return false;
+        }
+
+        entry->check_source = true;
+    }
+
+    if (token_count > 3)
+    {
+        if (!patchParseHash(tokens[3], entry->target_hash))
+        {
+            ERROR_MSG("Invalid target SHA-1 checksum \"%s\"!", tokens[3]);
+            return false;
+        }
+
+        entry->check_target = true;
+    }
+
+    g_patchEntryCount++;
+
+    return true;
+}
+
+u32 patchGetEntryCount(void)
+{
+    return g_patchEntryCount;
+}
+
+bool patchApplyToU8Archive(U8Context *ctx, bool *out_modified)
+{
+    if (!ctx || !ctx->u8_buf || !ctx->nodes || !out_modified)
+    {
+        ERROR_MSG("Invalid parameters!");
+        return false;
+    }
+
+    *out_modified = false;
+
+    for(u32 i = 0; i < g_patchEntryCount; i++)
+    {
+        bool modified = false;
+
+        if (!patchApplyEntry(ctx, &(g_patchEntries[i]), &modified)) return false;
+
+        *out_modified |= modified;
+    }
+
+    return true;
+}
+
+void patchClearEntries(void)
+{
+    memset(g_patchEntries, 0, sizeof(g_patchEntries));
+    g_patchEntryCount = 0;
+}
+
+static bool patchParseHash(const char *str, u8 *out_hash)
+{
+    if (strlen(str) != (SHA1_HASH_SIZE * 2)) return false;
+
+    for(u32 i = 0; i < (SHA1_HASH_SIZE * 2); i++)
+    {
+        char c = str[i];
+        u8 val = 0;
+
+        if (c >= '0' && c <= '9')
+        {
+            val = (u8)(c - '0');
+        } else
+        if (c >= 'a' && c <= 'f')
+        {
+            val = (u8)(c - 'a' + 10);
+        } else
+        if (c >= 'A' && c <= 'F')
+        {
+            val = (u8)(c - 'A' + 10);
+        } else {
+            return false;
+        }
+
+        if (!(i & 1))
+        {
+            out_hash[i >> 1] = (u8)(val << 4);
+        } else {
+            out_hash[i >> 1] |= val;
+        }
+    }
+
+    return true;
+}
+
+static bool patchApplyEntry(U8Context *ctx, const PatchEntry *entry, bool *out_modified)
+{
+    U8Node *file_node = NULL;
+    u32 file_node_idx = 0, patch_size = 0;
+    u8 *patch = NULL;
+    u8 hash[SHA1_HASH_SIZE] = {0};
+    const char *format = NULL;
+    bool applied = false, success = false;
+
+    /* Get U8 file node. */
+    file_node = u8GetFileNodeByPath(ctx, entry->member_path, &file_node_idx);
+    if (!file_node || !file_node->size || (file_node->data_offset + file_node->size) > ctx->u8_buf_size)
+    {
+        ERROR_MSG("Failed to retrieve U8 file node for \"%s\"!", entry->member_path);
+        return false;
+    }
+
+    /* Verify the current file data, if needed. Patches whose target checksum already matches are skipped. */
+    if (entry->check_source || entry->check_target)
+    {
+        if (!sha1CalculateHash(ctx->u8_buf + file_node->data_offset, file_node->size, hash))
+        {
+            ERROR_MSG("Failed to calculate SHA-1 checksum for \"%s\"!", entry->member_path);
+            return false;
+        }
+
+        if (entry->check_target && !memcmp(hash, entry->target_hash, SHA1_HASH_SIZE))
+        {
+            printf("\"%s\" is already patched.\n\n", entry->member_path);
+            *out_modified = false;
+            return true;
+        }
+
+        if (entry->check_source && memcmp(hash, entry->source_hash, SHA1_HASH_SIZE) != 0)
+        {
+            ERROR_MSG("Source SHA-1 checksum mismatch for \"%s\"!", entry->member_path);
+            return false;
+        }
+    }
+
+    /* Read whole patch file. */
+    patch = (u8*)utilsReadFileFromMountedDevice(entry->patch_path, &patch_size);
+    if (!patch)
+    {
+        ERROR_MSG("Failed to read patch file \"%s\"!", entry->patch_path);
+        return false;
+    }
+
+    /* Apply patch. */
+    if (patch_size >= PATCH_IPS_MAGIC_SIZE && !memcmp(patch, PATCH_IPS_MAGIC, PATCH_IPS_MAGIC_SIZE))
+    {
+        format = "IPS";
+        applied = patchApplyIps(ctx, file_node_idx, patch, patch_size);
+        if (!applied) goto out;
+    } else
+    if (patch_size >= PATCH_BPS_MAGIC_SIZE && !memcmp(patch, PATCH_BPS_MAGIC, PATCH_BPS_MAGIC_SIZE))
+    {
+        format = "BPS";
+        if (!patchApplyBps(ctx, file_node_idx, patch, patch_size, &applied)) goto out;
+    } else {
+        ERROR_MSG("Unknown patch format for \"%s\"!", entry->patch_path);
+        goto out;
+    }
+
+    if (!applied)
+    {
+        printf("\"%s\" is already patched.\n\n", entry->member_path);
+        *out_modified = false;
+        success = true;
+        goto out;
+    }
+
+    /* Verify the patched file data, if needed. */
+    /* The U8 archive buffer may have already been modified at this point, but it won't be written back if we fail. */
+    if (entry->check_target && (!sha1CalculateHash(ctx->u8_buf + file_node->data_offset, file_node->size, hash) || memcmp(hash, entry->target_hash, SHA1_HASH_SIZE) != 0))
+    {
+        ERROR_MSG("Target SHA-1 checksum mismatch for \"%s\"!", entry->member_path);
+        goto out;
+    }
+
+    printf("Applied %s patch \"%s\" to \"%s\" (0x%X bytes).\n\n", format, entry->patch_path, entry->member_path, file_node->size);
+
+    *out_modified = true;
+    success = true;
+
+out:
+    utilsFreeMemory(patch);
+
+    return success;
+}
+
+static bool patchApplyIps(U8Context *ctx, u32 file_node_idx, const u8 *patch, u32 patch_size)
+{
+    U8Node *file_node = &(ctx->nodes[file_node_idx]);
+    u8 *data = NULL;
+    u32 max_size = u8GetFileDataCapacity(ctx, file_node_idx), work_size = file_node->size, final_size = 0, offset = 0;
+
+    if (max_size < file_node->size) max_size = file_node->size;
+
+    /* IPS records only reference target offsets, so they can be applied in place. */
+    /* The first pass validates all records and calculates the required file size, which leaves the U8 archive untouched if the patch is invalid. */
+    for(u32 pass = 0; pass < 2; pass++)
+    {
+        if (pass == 1)
+        {
+            /* An optional truncation size may follow the EOF marker. */
+            final_size = ((offset + 3) <= patch_size ? patchReadBigEndian(patch + offset, 3) : work_size);
+
+            if (work_size > max_size || !final_size || final_size > max_size)
+            {
+                ERROR_MSG("Patched file size exceeds available U8 file node data capacity! (0x%X, 0x%X).", (work_size > final_size ? work_size : final_size), max_size);
+                return false;
+            }
+
+            if (!u8ResizeFileData(ctx, file_node_idx, work_size)) return false;
+
+            data = (ctx->u8_buf + file_node->data_offset);
+            u8MarkModified(ctx, file_node->data_offset);
+        }
+
+        offset = PATCH_IPS_MAGIC_SIZE;
+
+        while(true)
+        {
+            u32 record_offset = 0, record_size = 0;
+            bool rle = false;
+            u8 rle_value = 0;
+
+            if ((offset + 3) > patch_size)
+            {
+                ERROR_MSG("Truncated IPS patch!");
+                return false;
+            }
+
+            record_offset = patchReadBigEndian(patch + offset, 3);
+            offset += 3;
+
+            if (record_offset == PATCH_IPS_EOF) break;
+
+            if ((offset + 2) > patch_size)
+            {
+                ERROR_MSG("Truncated IPS patch!");
+                return false;
+            }
+
+            record_size = patchReadBigEndian(patch + offset, 2);
+            offset += 2;
+
+            /* A zero-sized record is an RLE record. */
+            if (!record_size)
+            {
+                if ((offset + 3) > patch_size || !(record_size = patchReadBigEndian(patch + offset, 2)))
+                {
+                    ERROR_MSG("Invalid IPS RLE record at patch offset 0x%X!", offset);
+                    return false;
+                }
+
+                rle = true;
+                rle_value = patch[offset + 2];
+                offset += 3;
+            } else
+            if (record_size > (patch_size - offset))
+            {
+                ERROR_MSG("Truncated IPS patch!");
+                return false;
+            }
+
+            if (pass == 0)
+            {
+                if ((record_offset + record_size) > work_size) work_size = (record_offset + record_size);
+            } else
+            if (rle)
+            {
+                memset(data + record_offset, rle_value, record_size);
+            } else {
+                memcpy(data + record_offset, patch + offset, record_size);
+            }
+
+            if (!rle) offset += record_size;
+        }
+    }
+
+    return u8ResizeFileData(ctx, file_node_idx, final_size);
+}
+
+static bool patchApplyBps(U8Context *ctx, u32 file_node_idx, const u8 *patch, u32 patch_size, bool *out_applied)
+{
+    U8Node *file_node = &(ctx->nodes[file_node_idx]);
+    const u8 *source = (ctx->u8_buf + file_node->data_offset);
+    u8 *target = NULL;
+
+    u32 source_size = file_node->size, patch_source_size = 0, target_size = 0, metadata_size = 0, max_size = 0;
+    u32 offset = PATCH_BPS_MAGIC_SIZE, actions_end = 0, output_offset = 0, source_rel_offset = 0, target_rel_offset = 0;
+    u32 source_crc = 0, target_crc = 0, cur_crc = 0;
+    bool success = false;
+
+    if (patch_size < (PATCH_BPS_MAGIC_SIZE + 3 + PATCH_BPS_FOOTER_SIZE))
+    {
+        ERROR_MSG("Truncated BPS patch!");
+        return false;
+    }
+
+    actions_end = (patch_size - PATCH_BPS_FOOTER_SIZE);
+    source_crc = patchReadLittleEndian32(patch + actions_end);
+    target_crc = patchReadLittleEndian32(patch + actions_end + 4);
+
+    /* Verify patch checksum. */
+    if (patchCalculateCrc32(patch, patch_size - 4) != patchReadLittleEndian32(patch + actions_end + 8))
+    {
+        ERROR_MSG("BPS patch CRC32 mismatch!");
+        return false;
+    }
+
+    /* Parse BPS header. Metadata is skipped. */
+    if (!patchReadBpsNumber(patch, actions_end, &offset, &patch_source_size) || !patchReadBpsNumber(patch, actions_end, &offset, &target_size) || \
+        !patchReadBpsNumber(patch, actions_end, &offset, &metadata_size) || metadata_size > (actions_end - offset))
+    {
+        ERROR_MSG("Invalid BPS patch header!");
+        return false;
+    }
+
+    offset += metadata_size;
+
+    /* Verify source data. If the target checksum already matches, this patch has already been applied. */
+    cur_crc = patchCalculateCrc32(source, source_size);
+    if (patch_source_size != source_size || cur_crc != source_crc)
+    {
+        if (source_size == target_size && cur_crc == target_crc)
+        {
+            *out_applied = false;
+            return true;
+        }
+
+        ERROR_MSG("BPS patch source mismatch! (0x%X, 0x%08X).", source_size, cur_crc);
+        return false;
+    }
+
+    max_size = u8GetFileDataCapacity(ctx, file_node_idx);
+    if (max_size < source_size) max_size = source_size;
+
+    if (!target_size || target_size > max_size)
+    {
+        ERROR_MSG("Patched file size exceeds available U8 file node data capacity! (0x%X, 0x%X).", target_size, max_size);
+        return false;
+    }
+
+    /* Source copies may reference any source offset, so the target data can't be built in place. */
+    target = (u8*)utilsAllocateMemory(target_size);
+    if (!target)
+    {
+        ERROR_MSG("Failed to allocate memory for BPS target buffer!");
+        return false;
+    }
+
+    while(offset < actions_end)
+    {
+        u32 data = 0, length = 0, action_offset = offset;
+
+        if (!patchReadBpsNumber(patch, actions_end, &offset, &data) || (length = ((data >> 2) + 1)) > (target_size - output_offset))
+        {
+            ERROR_MSG("Invalid BPS action at patch offset 0x%X!", action_offset);
+            goto out;
+        }
+
+        switch(data & 3)
+        {
+            case PatchBpsAction_SourceRead:
+                if (output_offset > source_size || length > (source_size - output_offset))
+                {
+                    ERROR_MSG("Invalid BPS action at patch offset 0x%X!", action_offset);
+                    goto out;
+                }
+
+                memcpy(target + output_offset, source + output_offset, length);
+
+                break;
+            case PatchBpsAction_TargetRead:
+                if (length > (actions_end - offset))
+                {
+                    ERROR_MSG("Invalid BPS action at patch offset 0x%X!", action_offset);
+                    goto out;
+                }
+
+                memcpy(target + output_offset, patch + offset, length);
+                offset += length;
+
+                break;
+            case PatchBpsAction_SourceCopy:
+            case PatchBpsAction_TargetCopy:
+            {
+                bool source_copy = ((data & 3) == PatchBpsAction_SourceCopy);
+                u32 *rel_offset = (source_copy ? &source_rel_offset : &target_rel_offset);
+                u32 rel_data = 0, delta = 0;
+
+                if (!patchReadBpsNumber(patch, actions_end, &offset, &rel_data))
+                {
+                    ERROR_MSG("Invalid BPS action at patch offset 0x%X!", action_offset);
+                    goto out;
+                }
+
+                /* Relative offsets are stored as a magnitude with a sign bit. */
+                delta = (rel_data >> 1);
+
+                if (rel_data & 1)
+                {
+                    if (delta > *rel_offset)
+                    {
+                        ERROR_MSG("Invalid BPS action at patch offset 0x%X!", action_offset);
+                        goto out;
+                    }
+
+                    *rel_offset -= delta;
+                } else {
+                    *rel_offset += delta;
+                }
+
+                if (source_copy)
+                {
+                    if (*rel_offset > source_size || length > (source_size - *rel_offset))
+                    {
+                        ERROR_MSG("Invalid BPS action at patch offset 0x%X!", action_offset);
+                        goto out;
+                    }
+
+                    memcpy(target + output_offset, source + *rel_offset, length);
+                } else {
+                    if (*rel_offset >= output_offset)
+                    {
+                        ERROR_MSG("Invalid BPS action at patch offset 0x%X!", action_offset);
+                        goto out;
+                    }
+
+                    /* Target copies may overlap with the data being written, so copy one byte at a time. */
+                    for(u32 i = 0; i < length; i++) target[output_offset + i] = target[*rel_offset + i];
+                }
+
+                *rel_offset += length;
+
+                break;
+            }
+            default:
+                break;
+        }
+
+        output_offset += length;
+    }
+
+    if (output_offset != target_size || patchCalculateCrc32(target, target_size) != target_crc)
+    {
+        ERROR_MSG("BPS patch target mismatch!");
+        goto out;
+    }
+
+    if (!u8SaveFileData(ctx, file_node_idx, target, target_size)) goto out;
+
+    *out_applied = true;
+    success = true;
+
+out:
+    utilsFreeMemory(target);
+
+    return success;
+}
+
+static bool patchReadBpsNumber(const u8 *patch, u32 patch_end, u32 *offset, u32 *out_value)
+{
+    u64 value = 0, shift = 1;
+
+    /* BPS numbers use a variable-length encoding. The last byte has its MSB set. */
+    while(*offset < patch_end && shift <= ((u64)1 << 35))
+    {
+        u8 byte = patch[(*offset)++];
+
+        value += ((u64)(byte & 0x7F) * shift);
+        if (byte & 0x80)
+        {
+            if (value > 0xFFFFFFFF) return false;
+            *out_value = (u32)value;
+            return true;
+        }
+
+        shift <<= 7;
+        value += shift;
+    }
+
+    return false;
+}
+
+static u32 patchCalculateCrc32(const u8 *data, u32 size)
+{
+    u32 crc = 0xFFFFFFFF;
+
+    /* Generate CRC32 lookup table, if needed. */
+    if (!g_patchCrc32TableGenerated)
+    {
+        for(u32 i = 0; i < 0x100; i++)
+        {
+            u32 val = i;
+            for(u32 j = 0; j < 8; j++) val = ((val & 1) ? ((val >> 1) ^ 0xEDB88320) : (val >> 1));
+            g_patchCrc32Table[i] = val;
+        }
+
+        g_patchCrc32TableGenerated = true;
+    }
+
+    for(u32 i = 0; i < size; i++) crc = (g_patchCrc32Table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8));
+
+    return ~crc;
+}
+
+#endif  /* BACKUP_U8_ARCHIVE */
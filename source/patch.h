@@ -0,0 +1,50 @@
+/*
+ * patch.h
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifndef __PATCH_H__
+#define __PATCH_H__
+
+#ifdef BACKUP_U8_ARCHIVE
+
+#define PATCH_MAX_ENTRIES   32
+
+/// Patch entries are loaded from the "[patch]" section of a rules file, with one entry per line:
+/// "<U8 member path> <patch file path> [<source SHA-1>|-] [<target SHA-1>]". Paths must not hold whitespace, and SHA-1 checksums are 40-character hex strings.
+/// Both IPS and BPS patches are supported. The format is detected from the patch file header. BPS patches are also verified using their own CRC32 checksums.
+/// Patch entries are applied to a U8 archive loaded into memory, so all of them are committed alongside any ARDB changes using a single NAND write.
+
+/// Parses a patch entry from a rules file line and adds it to the patch entry list. The provided line is modified in the process.
+bool patchAddEntryFromRule(char *rule);
+
+/// Returns the number of available patch entries.
+u32 patchGetEntryCount(void);
+
+/// Applies all patch entries to a U8 archive loaded into memory. Entries whose target checksum already matches are skipped.
+/// IPS patches are applied in place. out_modified is set to true if any U8 file node was modified.
+bool patchApplyToU8Archive(U8Context *ctx, bool *out_modified);
+
+/// Clears the patch entry list.
+void patchClearEntries(void);
+
+#endif  /* BACKUP_U8_ARCHIVE */
+
+#endif /* __PATCH_H__ */
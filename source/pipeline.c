@@ -0,0 +1,390 @@
+/*
+ * pipeline.c
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils.h"
+#include "sha1.h"
+#include "profiler.h"
+#include "iotrace.h"
+#include "pipeline.h"
+
+#include <fcntl.h>
+
+#define PIPELINE_THREAD_STACK_SIZE  0x8000
+#define PIPELINE_THREAD_PRIORITY    64
+
+typedef struct {
+    fstats file_stats ATTRIBUTE_ALIGN(32);  ///< ISFS file stats. Kept here (instead of a global) so concurrent reads don't share the IPC buffer.
+    u8 *buf;                ///< Destination buffer. Each chunk is a slice of it.
+    u32 size;               ///< File size.
+    u32 chunk_size;         ///< Chunk size. Always a multiple of PIPELINE_CHUNK_ALIGNMENT.
+    u32 chunk_count;        ///< Number of chunks.
+
+    mutex_t mutex;          ///< Protects read_count and failed.
+    cond_t cond;            ///< Signaled whenever read_count or failed change.
+    u32 read_count;         ///< Number of chunks available to consumer stages.
+    bool failed;            ///< Set by any stage to stop the others.
+
+    bool hash_enabled;      ///< Hasher stage enabled.
+    bool hash_ok;           ///< Hasher stage result.
+    u8 hash[SHA1_HASH_SIZE];
+    Sha1Checkpoints *checkpoints;   ///< Hasher stage midstates, recorded at the start of each chunk. May be NULL.
+
+    int fd;                 ///< Writer stage file descriptor. Negative if the writer stage is disabled.
+    const char *fd_path;    ///< Writer stage file path.
+    bool write_ok;          ///< Writer stage result.
+} PipelineContext;
+
+/* Function prototypes. */
+
+static void *pipelineHashThreadFunc(void *arg);
+
+#ifdef BACKUP_U8_ARCHIVE
+static void *pipelineWriteThreadFunc(void *arg);
+#endif  /* BACKUP_U8_ARCHIVE */
+
+static bool pipelineWaitForChunk(PipelineContext *ctx, u32 idx);
+static bool pipelineSetChunkReady(PipelineContext *ctx);
+static void pipelineSetFailed(PipelineContext *ctx);
+
+ALWAYS_INLINE u32 pipelineGetChunkSize(PipelineContext *ctx, u32 idx)
+{
+    u32 offset = (idx * ctx->chunk_size);
+    return ((ctx->size - offset) < ctx->chunk_size ? (ctx->size - offset) : ctx->chunk_size);
+}
+
+void *pipelineReadIsfsFile(const char *path, u32 *out_size, void *out_hash, Sha1Checkpoints *out_checkpoints, const char *backup_path)
+{
+    if (!path || !*path || !out_size || (out_checkpoints && !out_hash))
+    {
+        ERROR_MSG("Invalid parameters!");
+        return NULL;
+    }
+
+    PipelineContext ctx ATTRIBUTE_ALIGN(32) = { .fd = -1 };
+    UtilsIoChunkSizes chunk_sizes = {0};
+    char isfs_path[ISFS_MAXPATH] ATTRIBUTE_ALIGN(32) = {0};
+    s32 isfs_fd = -1, ret = 0;
+    u64 trace_time = 0;
+    lwp_t hash_thread = LWP_THREAD_NULL, write_thread = LWP_THREAD_NULL;
+    bool sync_initialized = false, success = false;
+
+#ifdef BACKUP_U8_ARCHIVE
+    u64 free_space = 0;
+#else
+    (void)backup_path;
+#endif  /* BACKUP_U8_ARCHIVE */
+
+    snprintf(isfs_path, ISFS_MAXPATH, "%s", path);
+
+    trace_time = ioTraceBegin();
+    isfs_fd = ISFS_Open(isfs_path, ISFS_OPEN_READ);
+    ioTraceRecord(IoTraceOp_IsfsOpen, isfs_path, 0, 0, isfs_fd, trace_time);
+    if (isfs_fd < 0)
+    {
+        ERROR_MSG("ISFS_Open(\"%s\") failed! (%d).", isfs_path, isfs_fd);
+        return NULL;
+    }
+
+    ret = ISFS_GetFileStats(isfs_fd, &(ctx.file_stats));
+    if (ret < 0)
+    {
+        ERROR_MSG("ISFS_GetFileStats(\"%s\") failed! (%d).", isfs_path, ret);
+        goto out;
+    }
+
+    ctx.size = ctx.file_stats.file_length;
+    if (!ctx.size)
+    {
+        ERROR_MSG("\"%s\" is empty!", isfs_path);
+        goto out;
+    }
+
+    /* Use the ISFS read chunk size calibrated for this console, if available. */
+    utilsGetIoChunkSizes(&chunk_sizes);
+    ctx.chunk_size = ALIGN_UP(chunk_sizes.isfs_read, PIPELINE_CHUNK_ALIGNMENT);
+    ctx.chunk_count = ((ctx.size + ctx.chunk_size - 1) / ctx.chunk_size);
+
+    ctx.buf = (u8*)utilsAllocateMemory(ctx.size);
+    if (!ctx.buf)
+    {
+        ERROR_MSG("Failed to allocate memory for \"%s\"!", isfs_path);
+        goto out;
+    }
+
+#ifdef BACKUP_U8_ARCHIVE
+    /* Open the backup file before any data is read. */
+    if (backup_path)
+    {
+        if (!utilsGetFileSystemStatsByPath(backup_path, NULL, &free_space) || free_space < (u64)ctx.size)
+        {
+            ERROR_MSG("Not enough free space available to write \"%s\"! Required 0x%X, available 0x%llX.", backup_path, ctx.size, free_space);
+            goto out;
+        }
+
+        trace_time = ioTraceBegin();
+        ctx.fd = open(backup_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        ioTraceRecord(IoTraceOp_SdOpen, backup_path, 0, 0, ctx.fd, trace_time);
+        if (ctx.fd < 0)
+        {
+            ERROR_MSG("open(\"%s\") failed! (%d).", backup_path, errno);
+            goto out;
+        }
+
+        ctx.fd_path = backup_path;
+    }
+#endif  /* BACKUP_U8_ARCHIVE */
+
+    ctx.hash_enabled = (out_hash != NULL);
+
+    /* Chunks are hashed in order, so each one starts at a checkpoint. */
+    if (out_checkpoints)
+    {
+        if (!sha1CheckpointsInit(out_checkpoints, Sha1Backend_Hardware, ctx.chunk_size, ctx.size)) goto out;
+        ctx.checkpoints = out_checkpoints;
+    }
+
+    LWP_MutexInit(&(ctx.mutex), false);
+    LWP_CondInit(&(ctx.cond));
+    sync_initialized = true;
+
+    /* Start consumer stages. */
+    if (ctx.hash_enabled)
+    {
+        ret = LWP_CreateThread(&hash_thread, pipelineHashThreadFunc, &ctx, NULL, PIPELINE_THREAD_STACK_SIZE, PIPELINE_THREAD_PRIORITY);
+        if (ret < 0)
+        {
+            ERROR_MSG("LWP_CreateThread failed for hasher stage! (%d).", ret);
+            hash_thread = LWP_THREAD_NULL;
+            goto out;
+        }
+    }
+
+#ifdef BACKUP_U8_ARCHIVE
+    if (ctx.fd >= 0)
+    {
+        ret = LWP_CreateThread(&write_thread, pipelineWriteThreadFunc, &ctx, NULL, PIPELINE_THREAD_STACK_SIZE, PIPELINE_THREAD_PRIORITY);
+        if (ret < 0)
+        {
+            ERROR_MSG("LWP_CreateThread failed for writer stage! (%d).", ret);
+            write_thread = LWP_THREAD_NULL;
+            goto out;
+        }
+    }
+#endif  /* BACKUP_U8_ARCHIVE */
+
+    /* Reader stage. IOS takes care of the NAND I/O while the other stages work on previous chunks. */
+    for(u32 i = 0; i < ctx.chunk_count; i++)
+    {
+        u32 chunk_size = pipelineGetChunkSize(&ctx, i);
+        u64 start_time = profilerSpanBegin();
+
+        trace_time = ioTraceBegin();
+        ret = ISFS_Read(isfs_fd, ctx.buf + (i * ctx.chunk_size), chunk_size);
+        ioTraceRecord(IoTraceOp_IsfsRead, isfs_path, i * ctx.chunk_size, chunk_size, ret, trace_time);
+        if (ret != (s32)chunk_size)
+        {
+            ERROR_MSG("ISFS_Read(\"%s\", 0x%X) failed! (%d).", isfs_path, i * ctx.chunk_size, ret);
+            goto out;
+        }
+
+        profilerSpanEnd(ProfilerPhase_IsfsRead, start_time, chunk_size);
+
+        /* Stop reading if a consumer stage failed. */
+        if (!pipelineSetChunkReady(&ctx)) goto out;
+    }
+
+    success = true;
+
+out:
+    /* Stop consumer stages if the reader stage failed, then wait for them. */
+    if (!success && sync_initialized) pipelineSetFailed(&ctx);
+
+    if (hash_thread != LWP_THREAD_NULL)
+    {
+        LWP_JoinThread(hash_thread, NULL);
+        success = (success && ctx.hash_ok);
+    }
+
+    if (write_thread != LWP_THREAD_NULL)
+    {
+        LWP_JoinThread(write_thread, NULL);
+        success = (success && ctx.write_ok);
+    }
+
+    if (sync_initialized)
+    {
+        LWP_CondDestroy(ctx.cond);
+        LWP_MutexDestroy(ctx.mutex);
+    }
+
+#ifdef BACKUP_U8_ARCHIVE
+    if (ctx.fd >= 0)
+    {
+        /* libfat flushes its cache on close(), so it must be accounted for. */
+        trace_time = ioTraceBegin();
+        ret = close(ctx.fd);
+        ioTraceRecord(IoTraceOp_SdClose, backup_path, 0, ctx.size, ret, trace_time);
+
+        if (ret != 0)
+        {
+            ERROR_MSG("close(\"%s\") failed! (%d).", backup_path, errno);
+            success = false;
+        }
+
+        if (!success) remove(backup_path);
+    }
+#endif  /* BACKUP_U8_ARCHIVE */
+
+    ISFS_Close(isfs_fd);
+
+    if (success)
+    {
+        if (out_hash) memcpy(out_hash, ctx.hash, SHA1_HASH_SIZE);
+        *out_size = ctx.size;
+    } else {
+        if (ctx.buf)
+        {
+            utilsFreeMemory(ctx.buf);
+            ctx.buf = NULL;
+        }
+
+        if (ctx.checkpoints) sha1CheckpointsFree(ctx.checkpoints);
+    }
+
+    return ctx.buf;
+}
+
+static void *pipelineHashThreadFunc(void *arg)
+{
+    PipelineContext *ctx = (PipelineContext*)arg;
+    sha_context sha_ctx ATTRIBUTE_ALIGN(32) = {0};
+    u8 hash[SHA1_HASH_SIZE] ATTRIBUTE_ALIGN(32) = {0};
+    bool success = sha1ContextCreate(&sha_ctx);
+
+    for(u32 i = 0; success && i < ctx->chunk_count; i++)
+    {
+        u8 *chunk = (ctx->buf + (i * ctx->chunk_size));
+        u32 chunk_size = pipelineGetChunkSize(ctx, i);
+
+        if (!pipelineWaitForChunk(ctx, i) || (ctx->checkpoints && !sha1CheckpointsExport(ctx->checkpoints, &sha_ctx, i * ctx->chunk_size)))
+        {
+            success = false;
+            break;
+        }
+
+        if ((i + 1) < ctx->chunk_count)
+        {
+            success = sha1ContextUpdate(&sha_ctx, chunk, chunk_size);
+        } else {
+            success = sha1ContextGetHash(&sha_ctx, chunk, chunk_size, hash);
+        }
+    }
+
+    if (success)
+    {
+        memcpy(ctx->hash, hash, SHA1_HASH_SIZE);
+    } else {
+        pipelineSetFailed(ctx);
+    }
+
+    ctx->hash_ok = success;
+
+    return NULL;
+}
+
+#ifdef BACKUP_U8_ARCHIVE
+static void *pipelineWriteThreadFunc(void *arg)
+{
+    PipelineContext *ctx = (PipelineContext*)arg;
+    bool success = true;
+
+    for(u32 i = 0; i < ctx->chunk_count; i++)
+    {
+        u8 *chunk = (ctx->buf + (i * ctx->chunk_size));
+        u32 chunk_size = pipelineGetChunkSize(ctx, i);
+        u64 start_time = 0, trace_time = 0;
+        ssize_t res = 0;
+
+        if (!pipelineWaitForChunk(ctx, i))
+        {
+            success = false;
+            break;
+        }
+
+        start_time = profilerSpanBegin();
+
+        trace_time = ioTraceBegin();
+        res = write(ctx->fd, chunk, chunk_size);
+        ioTraceRecord(IoTraceOp_SdWrite, ctx->fd_path, i * ctx->chunk_size, chunk_size, (s32)res, trace_time);
+
+        if (res != (ssize_t)chunk_size)
+        {
+            ERROR_MSG("write() failed for chunk #%u! (%d).", i, errno);
+            success = false;
+            break;
+        }
+
+        profilerSpanEnd(ProfilerPhase_SdWrite, start_time, chunk_size);
+    }
+
+    if (!success) pipelineSetFailed(ctx);
+
+    ctx->write_ok = success;
+
+    return NULL;
+}
+#endif  /* BACKUP_U8_ARCHIVE */
+
+static bool pipelineWaitForChunk(PipelineContext *ctx, u32 idx)
+{
+    bool ready = false;
+
+    LWP_MutexLock(ctx->mutex);
+
+    while(ctx->read_count <= idx && !ctx->failed) LWP_CondWait(ctx->cond, ctx->mutex);
+    ready = !ctx->failed;
+
+    LWP_MutexUnlock(ctx->mutex);
+
+    return ready;
+}
+
+static bool pipelineSetChunkReady(PipelineContext *ctx)
+{
+    bool running = false;
+
+    LWP_MutexLock(ctx->mutex);
+
+    ctx->read_count++;
+    running = !ctx->failed;
+    LWP_CondBroadcast(ctx->cond);
+
+    LWP_MutexUnlock(ctx->mutex);
+
+    return running;
+}
+
+static void pipelineSetFailed(PipelineContext *ctx)
+{
+    LWP_MutexLock(ctx->mutex);
+    ctx->failed = true;
+    LWP_CondBroadcast(ctx->cond);
+    LWP_MutexUnlock(ctx->mutex);
+}
@@ -0,0 +1,37 @@
+/*
+ * pipeline.h
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifndef __PIPELINE_H__
+#define __PIPELINE_H__
+
+#define PIPELINE_CHUNK_ALIGNMENT    0x40    /* SHA-1 block size. Chunk boundaries double as SHA-1 checkpoint offsets. */
+
+/// Reads a whole file from the ISFS, optionally calculating its SHA-1 checksum and streaming it to a mounted device at the same time.
+/// The calling thread issues ISFS reads in chunks, while a hasher thread and a writer thread consume each chunk as soon as it's available.
+/// The chunk size is the calibrated ISFS read chunk size (see utilsSetIoChunkSizes()), rounded up to a multiple of PIPELINE_CHUNK_ALIGNMENT.
+/// Chunks are read straight into the returned buffer, so no data is copied between stages. The returned pointer must be freed by the user.
+/// out_hash and backup_path may be NULL to disable their respective stages. backup_path is ignored if BACKUP_U8_ARCHIVE isn't defined.
+/// If out_checkpoints is provided, the hasher stage also records a SHA-1 midstate at the start of each chunk, which can be used with sha1ResumeHash(). Requires out_hash.
+/// If any stage fails, the whole operation fails and any partially written backup is removed.
+void *pipelineReadIsfsFile(const char *path, u32 *out_size, void *out_hash, Sha1Checkpoints *out_checkpoints, const char *backup_path);
+
+#endif /* __PIPELINE_H__ */
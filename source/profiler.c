@@ -0,0 +1,307 @@
+/*
+ * profiler.c
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils.h"
+#include "profiler.h"
+
+#ifdef PROFILE_PHASES
+
+/* Global variables. */
+
+static ProfilerCounter g_profilerCounters[ProfilerPhase_Count] = {0};
+
+static ProfilerMemoryCounter g_profilerMemoryCounters[ProfilerPhase_Count] = {0};
+static u8 g_profilerMemoryPhase = ProfilerPhase_Count;
+
+static const char *g_profilerPhaseNames[ProfilerPhase_Count] = {
+    [ProfilerPhase_TmdFetch]  = "TMD fetch",
+    [ProfilerPhase_IsfsRead]  = "ISFS read",
+    [ProfilerPhase_IsfsWrite] = "ISFS write",
+    [ProfilerPhase_Sha1]      = "SHA-1",
+    [ProfilerPhase_SdRead]    = "SD read",
+    [ProfilerPhase_SdWrite]   = "SD write",
+    [ProfilerPhase_U8Parse]   = "U8 parse",
+    [ProfilerPhase_ArdbEdit]  = "ARDB edit"
+};
+
+/* Function prototypes. */
+
+static u64 profilerGetThroughput(const ProfilerCounter *counter);
+static void profilerSampleArenas(ProfilerMemoryCounter *counter);
+
+#ifdef BACKUP_U8_ARCHIVE
+static void profilerGetMountedDeviceCounters(ProfilerCounter *out_read, ProfilerCounter *out_write);
+#endif  /* BACKUP_U8_ARCHIVE */
+
+void profilerSpanEnd(u8 phase, u64 start_time, u64 size)
+{
+    if (phase >= ProfilerPhase_Count) return;
+
+    ProfilerCounter *counter = &(g_profilerCounters[phase]);
+    u64 elapsed_usec = diff_usec(start_time, gettime());
+    u32 level = 0;
+
+    /* Spans may end on worker threads, so counters are only updated with interrupts disabled. */
+    _CPU_ISR_Disable(level);
+    counter->span_count++;
+    counter->byte_count += size;
+    counter->elapsed_usec += elapsed_usec;
+    _CPU_ISR_Restore(level);
+}
+
+bool profilerGetCounter(u8 phase, ProfilerCounter *out)
+{
+    if (phase >= ProfilerPhase_Count || !out) return false;
+    memcpy(out, &(g_profilerCounters[phase]), sizeof(ProfilerCounter));
+    return true;
+}
+
+void profilerSetMemoryPhase(u8 phase)
+{
+    if (phase >= ProfilerPhase_Count) return;
+
+    ProfilerMemoryCounter *counter = &(g_profilerMemoryCounters[phase]);
+    u32 live_bytes = 0;
+
+    utilsGetMemoryUsage(&live_bytes, NULL);
+
+    if (!counter->active)
+    {
+        counter->mem1_free = counter->mem2_free = 0xFFFFFFFF;
+        counter->active = true;
+    }
+
+    if (live_bytes > counter->peak_bytes) counter->peak_bytes = live_bytes;
+    profilerSampleArenas(counter);
+
+    g_profilerMemoryPhase = phase;
+}
+
+void profilerRecordAllocation(u32 size, u32 live_bytes)
+{
+    if (g_profilerMemoryPhase >= ProfilerPhase_Count) return;
+
+    ProfilerMemoryCounter *counter = &(g_profilerMemoryCounters[g_profilerMemoryPhase]);
+
+    counter->alloc_count++;
+    counter->alloc_bytes += size;
+    if (live_bytes > counter->peak_bytes) counter->peak_bytes = live_bytes;
+
+    /* The heap only grows into the arenas, so allocations are the only events that can lower their free space. */
+    profilerSampleArenas(counter);
+}
+
+bool profilerGetMemoryCounter(u8 phase, ProfilerMemoryCounter *out)
+{
+    if (phase >= ProfilerPhase_Count || !out) return false;
+    memcpy(out, &(g_profilerMemoryCounters[phase]), sizeof(ProfilerMemoryCounter));
+    return true;
+}
+
+void profilerReset(void)
+{
+    memset(g_profilerCounters, 0, sizeof(g_profilerCounters));
+    memset(g_profilerMemoryCounters, 0, sizeof(g_profilerMemoryCounters));
+    g_profilerMemoryPhase = ProfilerPhase_Count;
+}
+
+void profilerPrintSummary(void)
+{
+    bool header_printed = false;
+
+#ifdef BACKUP_U8_ARCHIVE
+    ProfilerCounter file_read = {0}, file_write = {0};
+#endif  /* BACKUP_U8_ARCHIVE */
+
+    for(u8 i = 0; i < ProfilerPhase_Count; i++)
+    {
+        ProfilerCounter *counter = &(g_profilerCounters[i]);
+        if (!counter->span_count) continue;
+
+        if (!header_printed)
+        {
+            printf("%-10s | %6s | %10s | %9s | %8s\n", "Phase", "Spans", "Bytes", "Time (ms)", "KiB/s");
+            printf("-----------+--------+------------+-----------+---------\n");
+            header_printed = true;
+        }
+
+        printf("%-10s | %6u | %10llu | %9llu | %8llu\n", g_profilerPhaseNames[i], counter->span_count, counter->byte_count, counter->elapsed_usec / 1000, \
+               profilerGetThroughput(counter));
+    }
+
+    if (header_printed) printf("\n");
+
+#ifdef BACKUP_U8_ARCHIVE
+    /* Whole-file transfers through the mounted device helpers from utils.c. Unlike the SD read and SD write phases, these leave out chunked backup writes from the NAND read pipeline. */
+    profilerGetMountedDeviceCounters(&file_read, &file_write);
+
+    if (file_read.span_count) printf("SD card file reads: %u (%llu bytes in %llu ms, %llu KiB/s).\n", file_read.span_count, file_read.byte_count, \
+                                     file_read.elapsed_usec / 1000, profilerGetThroughput(&file_read));
+
+    if (file_write.span_count) printf("SD card file writes: %u (%llu bytes in %llu ms, %llu KiB/s).\n", file_write.span_count, file_write.byte_count, \
+                                      file_write.elapsed_usec / 1000, profilerGetThroughput(&file_write));
+
+    if (file_read.span_count || file_write.span_count) printf("\n");
+#endif  /* BACKUP_U8_ARCHIVE */
+
+    header_printed = false;
+
+    for(u8 i = 0; i < ProfilerPhase_Count; i++)
+    {
+        ProfilerMemoryCounter *counter = &(g_profilerMemoryCounters[i]);
+        if (!counter->active) continue;
+
+        if (!header_printed)
+        {
+            printf("%-10s | %6s | %10s | %10s | %9s | %9s\n", "Phase", "Allocs", "Bytes", "Peak", "MEM1 free", "MEM2 free");
+            printf("-----------+--------+------------+------------+-----------+----------\n");
+            header_printed = true;
+        }
+
+        printf("%-10s | %6u | %10llu | %10u | %9u | %9u\n", g_profilerPhaseNames[i], counter->alloc_count, counter->alloc_bytes, counter->peak_bytes, \
+               counter->mem1_free, counter->mem2_free);
+    }
+
+    if (header_printed)
+    {
+        u32 live_bytes = 0, peak_bytes = 0;
+        utilsGetMemoryUsage(&live_bytes, &peak_bytes);
+        printf("\nPeak allocated memory: %u bytes. Still allocated: %u bytes.\n\n", peak_bytes, live_bytes);
+    }
+}
+
+#ifdef BACKUP_U8_ARCHIVE
+bool profilerSaveToMountedDevice(const char *path)
+{
+    if (!path || !*path) return false;
+
+    struct stat st = {0};
+    bool write_header = (stat(path, &st) != 0 || !st.st_size);
+    time_t run_time = time(NULL);
+    FILE *fp = NULL;
+    ProfilerCounter file_counters[2] = {0};
+
+    /* Grab these before opening the CSV file, so that they don't include this write. */
+    profilerGetMountedDeviceCounters(&(file_counters[0]), &(file_counters[1]));
+
+    fp = fopen(path, "a");
+    if (!fp)
+    {
+        ERROR_MSG("Failed to open \"%s\" for writing! (%d).", path, errno);
+        return false;
+    }
+
+    /* Rows from every run share the same file. The timestamp tells runs apart. */
+    if (write_header) fprintf(fp, "timestamp,phase,spans,bytes,usec,kib_per_sec\n");
+
+    for(u8 i = 0; i < ProfilerPhase_Count; i++)
+    {
+        ProfilerCounter *counter = &(g_profilerCounters[i]);
+        fprintf(fp, "%lld,%s,%u,%llu,%llu,%llu\n", (long long)run_time, g_profilerPhaseNames[i], counter->span_count, counter->byte_count, counter->elapsed_usec, \
+                profilerGetThroughput(counter));
+    }
+
+    /* Whole-file mounted device transfers are saved as two extra rows. Their span count is the number of files. */
+    for(u8 i = 0; i < 2; i++)
+    {
+        ProfilerCounter *counter = &(file_counters[i]);
+        fprintf(fp, "%lld,%s,%u,%llu,%llu,%llu\n", (long long)run_time, (i == 0 ? "SD file read" : "SD file write"), counter->span_count, counter->byte_count, \
+                counter->elapsed_usec, profilerGetThroughput(counter));
+    }
+
+    if (fclose(fp) != 0)
+    {
+        ERROR_MSG("Failed to write \"%s\"! (%d).", path, errno);
+        return false;
+    }
+
+    return true;
+}
+
+bool profilerSaveMemoryToMountedDevice(const char *path)
+{
+    if (!path || !*path) return false;
+
+    struct stat st = {0};
+    bool write_header = (stat(path, &st) != 0 || !st.st_size);
+    time_t run_time = time(NULL);
+    FILE *fp = NULL;
+
+    fp = fopen(path, "a");
+    if (!fp)
+    {
+        ERROR_MSG("Failed to open \"%s\" for writing! (%d).", path, errno);
+        return false;
+    }
+
+    if (write_header) fprintf(fp, "timestamp,phase,allocs,bytes,peak_bytes,mem1_free,mem2_free\n");
+
+    /* Phases that were never selected are skipped, since their arena values are meaningless. */
+    for(u8 i = 0; i < ProfilerPhase_Count; i++)
+    {
+        ProfilerMemoryCounter *counter = &(g_profilerMemoryCounters[i]);
+        if (!counter->active) continue;
+
+        fprintf(fp, "%lld,%s,%u,%llu,%u,%u,%u\n", (long long)run_time, g_profilerPhaseNames[i], counter->alloc_count, counter->alloc_bytes, counter->peak_bytes, \
+                counter->mem1_free, counter->mem2_free);
+    }
+
+    if (fclose(fp) != 0)
+    {
+        ERROR_MSG("Failed to write \"%s\"! (%d).", path, errno);
+        return false;
+    }
+
+    return true;
+}
+#endif  /* BACKUP_U8_ARCHIVE */
+
+static u64 profilerGetThroughput(const ProfilerCounter *counter)
+{
+    if (!counter->elapsed_usec) return 0;
+    return (((counter->byte_count * 1000000) / counter->elapsed_usec) / 1024);
+}
+
+static void profilerSampleArenas(ProfilerMemoryCounter *counter)
+{
+    u32 mem1_free = SYS_GetArena1Size(), mem2_free = SYS_GetArena2Size();
+
+    if (mem1_free < counter->mem1_free) counter->mem1_free = mem1_free;
+    if (mem2_free < counter->mem2_free) counter->mem2_free = mem2_free;
+}
+
+#ifdef BACKUP_U8_ARCHIVE
+static void profilerGetMountedDeviceCounters(ProfilerCounter *out_read, ProfilerCounter *out_write)
+{
+    UtilsIoCounters read_counters = {0}, write_counters = {0};
+
+    utilsGetMountedDeviceIoCounters(&read_counters, &write_counters);
+
+    out_read->span_count = read_counters.op_count;
+    out_read->byte_count = read_counters.byte_count;
+    out_read->elapsed_usec = read_counters.elapsed_usec;
+
+    out_write->span_count = write_counters.op_count;
+    out_write->byte_count = write_counters.byte_count;
+    out_write->elapsed_usec = write_counters.elapsed_usec;
+}
+#endif  /* BACKUP_U8_ARCHIVE */
+
+#endif  /* PROFILE_PHASES */
@@ -0,0 +1,124 @@
+/*
+ * profiler.h
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#define PROFILER_CSV_PATH           "sd:/" APP_TITLE "/profile.csv"
+#define PROFILER_MEMORY_CSV_PATH    "sd:/" APP_TITLE "/memprofile.csv"
+
+typedef enum {
+    ProfilerPhase_TmdFetch  = 0,
+    ProfilerPhase_IsfsRead  = 1,
+    ProfilerPhase_IsfsWrite = 2,
+    ProfilerPhase_Sha1      = 3,
+    ProfilerPhase_SdRead    = 4,
+    ProfilerPhase_SdWrite   = 5,
+    ProfilerPhase_U8Parse   = 6,
+    ProfilerPhase_ArdbEdit  = 7,
+    ProfilerPhase_Count     = 8     ///< Total values supported by this enum.
+} ProfilerPhase;
+
+/// Cumulative counters for a single phase.
+typedef struct {
+    u32 span_count;     ///< Number of completed spans.
+    u64 byte_count;     ///< Number of processed bytes.
+    u64 elapsed_usec;   ///< Time spent within spans, in microseconds.
+} ProfilerCounter;
+
+/// Memory counters for a single phase. Allocations made through utilsAllocateMemory() are attributed to the phase set by profilerSetMemoryPhase().
+typedef struct {
+    u32 alloc_count;    ///< Number of allocations.
+    u64 alloc_bytes;    ///< Number of allocated bytes.
+    u32 peak_bytes;     ///< Highest number of live allocated bytes while this phase was active.
+    u32 mem1_free;      ///< Lowest MEM1 arena free space while this phase was active.
+    u32 mem2_free;      ///< Lowest MEM2 arena free space while this phase was active.
+    bool active;        ///< Set once this phase has been selected.
+} ProfilerMemoryCounter;
+
+#ifdef PROFILE_PHASES
+
+/// Starts a span. The returned timestamp must be passed to profilerSpanEnd().
+ALWAYS_INLINE u64 profilerSpanBegin(void)
+{
+    return gettime();
+}
+
+/// Ends a span started by profilerSpanBegin(), adding its elapsed time and processed bytes to the provided phase.
+void profilerSpanEnd(u8 phase, u64 start_time, u64 size);
+
+/// Retrieves the counters for the provided phase.
+bool profilerGetCounter(u8 phase, ProfilerCounter *out);
+
+/// Selects the phase that subsequent allocations are attributed to. Its peak byte count starts off at the current number of live allocated bytes.
+void profilerSetMemoryPhase(u8 phase);
+
+/// Called by utilsAllocateMemory() after each successful allocation.
+void profilerRecordAllocation(u32 size, u32 live_bytes);
+
+/// Retrieves the memory counters for the provided phase.
+bool profilerGetMemoryCounter(u8 phase, ProfilerMemoryCounter *out);
+
+/// Clears all counters.
+void profilerReset(void);
+
+/// Prints summary tables with all phases that have at least one completed span, as well as all phases with memory counters.
+void profilerPrintSummary(void);
+
+#ifdef BACKUP_U8_ARCHIVE
+/// Appends all phase counters to a CSV file stored in a mounted device. A header row is written if the file doesn't exist.
+bool profilerSaveToMountedDevice(const char *path);
+
+/// Appends all memory counters to a CSV file stored in a mounted device. A header row is written if the file doesn't exist.
+bool profilerSaveMemoryToMountedDevice(const char *path);
+#endif  /* BACKUP_U8_ARCHIVE */
+
+#else
+
+/* Instrumentation compiles down to nothing if profiling is disabled. */
+
+ALWAYS_INLINE u64 profilerSpanBegin(void)
+{
+    return 0;
+}
+
+ALWAYS_INLINE void profilerSpanEnd(u8 phase, u64 start_time, u64 size)
+{
+    (void)phase;
+    (void)start_time;
+    (void)size;
+}
+
+ALWAYS_INLINE void profilerSetMemoryPhase(u8 phase)
+{
+    (void)phase;
+}
+
+ALWAYS_INLINE void profilerRecordAllocation(u32 size, u32 live_bytes)
+{
+    (void)size;
+    (void)live_bytes;
+}
+
+#endif  /* PROFILE_PHASES */
+
+#endif /* __PROFILER_H__ */
@@ -0,0 +1,453 @@
+/*
+ * rules.c
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils.h"
+#include "ardb.h"
+#include "rules.h"
+#include "u8.h"
+#include "patch.h"
+
+/* Each exact title code takes one compare per vector. Past these code counts, bitmap lookups are faster. */
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define RULES_VECTOR_MATCH
+#define RULES_VECTOR_MAX_CODES  8
+#elif defined(__SSE2__)
+#include <immintrin.h>
+#define RULES_VECTOR_MATCH
+#define RULES_VECTOR_MAX_CODES  4
+#endif
+
+#define RULES_CODE_LENGTH   3
+#define RULES_WILDCARD      -1
+
+#define RULES_PATCH_SECTION AspectRatioDatabaseType_Count
+
+static const char *g_rulesSectionNames[AspectRatioDatabaseType_Count] = {
+    "discdb",
+    "vcadb",
+    "wwdb"
+};
+
+static bool rulesAllocateRemovalBitmap(AspectRatioDatabaseRules *rules);
+static void rulesSetBitmapBits(u8 *bitmap, const s16 *chars, u32 pos, u32 code);
+
+#ifdef RULES_VECTOR_MATCH
+static u32 rulesMatchExactCodes(const AspectRatioDatabaseRules *rules, const u32 *entries, u32 count, u32 *out_idx);
+#endif
+
+bool rulesAddRemovalPattern(AspectRatioDatabaseRules *rules, const char *pattern)
+{
+    s16 chars[RULES_CODE_LENGTH] = {0};
+    u32 len = 0;
+    bool prefix = false;
+
+    if (!rules || !pattern || !(len = strlen(pattern)))
+    {
+        ERROR_MSG("Invalid parameters!");
+        return false;
+    }
+
+    /* Check for a trailing prefix wildcard. */
+    if (pattern[len - 1] == '*')
+    {
+        prefix = true;
+        len--;
+    }
+
+    if (len > RULES_CODE_LENGTH || (!prefix && len != RULES_CODE_LENGTH))
+    {
+        ERROR_MSG("Invalid removal pattern \"%s\"!", pattern);
+        return false;
+    }
+
+    /* Convert pattern characters. Positions not covered by a prefix pattern are wildcards. */
+    for(u32 i = 0; i < RULES_CODE_LENGTH; i++)
+    {
+        if (i >= len || pattern[i] == '?')
+        {
+            chars[i] = RULES_WILDCARD;
+        } else
+        if (pattern[i] == '*')
+        {
+            ERROR_MSG("Invalid removal pattern \"%s\"!", pattern);
+            return false;
+        } else {
+            chars[i] = (u8)pattern[i];
+        }
+    }
+
+    if (!rulesAllocateRemovalBitmap(rules)) return false;
+
+    rulesSetBitmapBits(rules->remove_bitmap, chars, 0, 0);
+    rules->remove_rule_count++;
+
+    return true;
+}
+
+bool rulesAddRemovalCode(AspectRatioDatabaseRules *rules, u32 code)
+{
+    if (!rules || code > 0xFFFFFF)
+    {
+        ERROR_MSG("Invalid parameters!");
+        return false;
+    }
+
+    if (!rulesAllocateRemovalBitmap(rules)) return false;
+
+    rules->remove_bitmap[code >> 3] |= (u8)(1 << (code & 7));
+
+    /* Keep exact codes around for rulesMatchEntryBlock() while no patterns have been added. */
+    if (rules->remove_code_count == rules->remove_rule_count && rules->remove_code_count < ARDB_MAX_REMOVE_CODES) rules->remove_codes[rules->remove_code_count++] = code;
+
+    rules->remove_rule_count++;
+
+    return true;
+}
+
+bool rulesAddAdditionCode(AspectRatioDatabaseRules *rules, u32 code)
+{
+    if (!rules || code > 0xFFFFFF)
+    {
+        ERROR_MSG("Invalid parameters!");
+        return false;
+    }
+
+    u32 pos = rules->add_code_count, *tmp = NULL;
+
+    /* Keep the array sorted without duplicates. Rules files are usually already sorted, so look for the insertion point using a binary search only if needed. */
+    if (pos && rules->add_codes[pos - 1] >= code)
+    {
+        u32 low = 0, high = pos;
+
+        while(low < high)
+        {
+            u32 mid = (low + ((high - low) / 2));
+            if (rules->add_codes[mid] < code)
+            {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+
+        if (rules->add_codes[low] == code) return true;
+
+        pos = low;
+    }
+
+    tmp = realloc(rules->add_codes, (rules->add_code_count + 1) * sizeof(u32));
+    if (!tmp)
+    {
+        ERROR_MSG("Failed to reallocate title code addition array!");
+        return false;
+    }
+
+    rules->add_codes = tmp;
+
+    if (pos < rules->add_code_count) memmove(&(rules->add_codes[pos + 1]), &(rules->add_codes[pos]), sizeof(u32) * (rules->add_code_count - pos));
+    rules->add_codes[pos] = code;
+    rules->add_code_count++;
+
+    return true;
+}
+
+u32 rulesMatchEntryBlock(const AspectRatioDatabaseRules *rules, const u32 *entries, u32 count)
+{
+    const u8 *bitmap = NULL;
+    u32 mask = 0, i = 0;
+
+    if (!rules || !(bitmap = rules->remove_bitmap) || !entries || !count) return 0;
+
+    if (count > RULES_MATCH_BLOCK_SIZE) count = RULES_MATCH_BLOCK_SIZE;
+
+#ifdef RULES_VECTOR_MATCH
+    /* Exact title codes are matched using vector compares. Any entries left over are looked up in the bitmap below. */
+    if (rules->remove_code_count && rules->remove_code_count <= RULES_VECTOR_MAX_CODES && rules->remove_code_count == rules->remove_rule_count) mask = rulesMatchExactCodes(rules, entries, count, &i);
+#endif
+
+    /* Process four entries per iteration. Broadway has no integer SIMD, so we just issue all bitmap loads before testing any bits to let them overlap. */
+    for(; (i + 4) <= count; i += 4)
+    {
+        u32 c0 = (BE32(entries[i]) >> 8), c1 = (BE32(entries[i + 1]) >> 8), c2 = (BE32(entries[i + 2]) >> 8), c3 = (BE32(entries[i + 3]) >> 8);
+        u32 b0 = bitmap[c0 >> 3], b1 = bitmap[c1 >> 3], b2 = bitmap[c2 >> 3], b3 = bitmap[c3 >> 3];
+
+        mask |= ((((b0 >> (c0 & 7)) & 1) << i) | (((b1 >> (c1 & 7)) & 1) << (i + 1)) | (((b2 >> (c2 & 7)) & 1) << (i + 2)) | (((b3 >> (c3 & 7)) & 1) << (i + 3)));
+    }
+
+    /* Process remaining entries. */
+    for(; i < count; i++)
+    {
+        u32 c = (BE32(entries[i]) >> 8);
+        mask |= (((u32)(bitmap[c >> 3] >> (c & 7)) & 1) << i);
+    }
+
+    return mask;
+}
+
+#ifdef BACKUP_U8_ARCHIVE
+bool rulesLoadFromFile(AspectRatioDatabaseRules *rules, const char *path)
+{
+    if (!rules || !path || !*path)
+    {
+        ERROR_MSG("Invalid parameters!");
+        return false;
+    }
+
+    char *text = NULL, *line = NULL, *next_line = NULL;
+    u32 line_number = 0;
+    s32 cur_type = -1;
+    bool success = false;
+
+    /* Read whole rules file. */
+    text = utilsReadTextFileFromMountedDevice(path);
+    if (!text)
+    {
+        ERROR_MSG("Failed to read rules file!");
+        return false;
+    }
+
+    for(line = text; line; line = next_line)
+    {
+        char *comment = NULL;
+        u32 len = 0;
+
+        line_number++;
+
+        /* Split lines. */
+        if ((next_line = strchr(line, '\n'))) *next_line++ = '\0';
+
+        /* Strip comments and whitespace. */
+        if ((comment = strchr(line, '#'))) *comment = '\0';
+        line = utilsTrimString(line);
+        if (!(len = strlen(line))) continue;
+
+        /* Parse section headers. */
+        if (*line == '[')
+        {
+            if (line[len - 1] != ']')
+            {
+                ERROR_MSG("Invalid section header at line #%u!", line_number);
+                goto out;
+            }
+
+            line[len - 1] = '\0';
+
+            if (!strcmp(line + 1, "patch"))
+            {
+                cur_type = RULES_PATCH_SECTION;
+            } else
+            if ((cur_type = rulesGetDatabaseTypeByName(line + 1)) < 0)
+            {
+                ERROR_MSG("Unknown section \"%s\" at line #%u!", line + 1, line_number);
+                goto out;
+            }
+
+            continue;
+        }
+
+        if (cur_type < 0)
+        {
+            ERROR_MSG("Rule at line #%u doesn't belong to any section!", line_number);
+            goto out;
+        }
+
+        /* Parse patch entries. */
+        if (cur_type == RULES_PATCH_SECTION)
+        {
+            if (!patchAddEntryFromRule(line))
+            {
+                ERROR_MSG("Invalid patch rule at line #%u!", line_number);
+                goto out;
+            }
+
+            continue;
+        }
+
+        /* Parse rules. */
+        if (*line == '-')
+        {
+            if (!rulesAddRemovalPattern(&(rules[cur_type]), line + 1))
+            {
+                ERROR_MSG("Invalid removal rule at line #%u!", line_number);
+                goto out;
+            }
+        } else
+        if (*line == '+')
+        {
+            if (len != (RULES_CODE_LENGTH + 1) || strpbrk(line + 1, "?*"))
+            {
+                ERROR_MSG("Invalid addition rule at line #%u!", line_number);
+                goto out;
+            }
+
+            if (!rulesAddAdditionCode(&(rules[cur_type]), ((u32)(u8)line[1] << 16) | ((u32)(u8)line[2] << 8) | (u32)(u8)line[3])) goto out;
+        } else {
+            ERROR_MSG("Invalid rule at line #%u!", line_number);
+            goto out;
+        }
+    }
+
+    /* Additions matching a removal rule would be removed and added back on every run, so the U8 archive would be rewritten every single time. */
+    for(u8 type = 0; type < AspectRatioDatabaseType_Count; type++)
+    {
+        const AspectRatioDatabaseRules *cur_rules = &(rules[type]);
+
+        if (!cur_rules->remove_bitmap) continue;
+
+        for(u32 i = 0; i < cur_rules->add_code_count; i++)
+        {
+            u32 code = cur_rules->add_codes[i];
+            if (!(cur_rules->remove_bitmap[code >> 3] & (1 << (code & 7)))) continue;
+
+            ERROR_MSG("Addition rule \"+%c%c%c\" matches a removal rule from the [%s] section!", (char)(code >> 16), (char)(code >> 8), (char)code, g_rulesSectionNames[type]);
+            goto out;
+        }
+    }
+
+    success = true;
+
+out:
+    if (!success)
+    {
+        rulesFree(rules);
+        patchClearEntries();
+    }
+
+    utilsFreeMemory(text);
+
+    return success;
+}
+#endif  /* BACKUP_U8_ARCHIVE */
+
+s32 rulesGetDatabaseTypeByName(const char *name)
+{
+    if (!name) return -1;
+
+    for(s32 i = 0; i < AspectRatioDatabaseType_Count; i++)
+    {
+        if (!strcmp(name, g_rulesSectionNames[i])) return i;
+    }
+
+    return -1;
+}
+
+const char *rulesGetDatabaseName(u8 type)
+{
+    return (type < AspectRatioDatabaseType_Count ? g_rulesSectionNames[type] : NULL);
+}
+
+void rulesFree(AspectRatioDatabaseRules *rules)
+{
+    if (!rules) return;
+
+    for(u32 i = 0; i < AspectRatioDatabaseType_Count; i++)
+    {
+        if (rules[i].remove_bitmap) utilsFreeMemory(rules[i].remove_bitmap);
+        if (rules[i].add_codes) free(rules[i].add_codes);
+        memset(&(rules[i]), 0, sizeof(AspectRatioDatabaseRules));
+    }
+}
+
+#ifdef RULES_VECTOR_MATCH
+static u32 rulesMatchExactCodes(const AspectRatioDatabaseRules *rules, const u32 *entries, u32 count, u32 *out_idx)
+{
+    /* Entries are compared straight from memory against each code, masking out the last byte. This works regardless of host endianness. */
+    u32 code_count = rules->remove_code_count, entry_mask = BE32(0xFFFFFF00), mask = 0, i = 0;
+
+#if defined(__AVX2__)
+    __m256i vmask = _mm256_set1_epi32((int)entry_mask), keys[RULES_VECTOR_MAX_CODES];
+
+    for(u32 j = 0; j < code_count; j++) keys[j] = _mm256_set1_epi32((int)BE32(rules->remove_codes[j] << 8));
+
+    for(; (i + 8) <= count; i += 8)
+    {
+        __m256i v = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)&(entries[i])), vmask), hit = _mm256_setzero_si256();
+        for(u32 j = 0; j < code_count; j++) hit = _mm256_or_si256(hit, _mm256_cmpeq_epi32(v, keys[j]));
+        mask |= ((u32)_mm256_movemask_ps(_mm256_castsi256_ps(hit)) << i);
+    }
+#else
+    __m128i vmask = _mm_set1_epi32((int)entry_mask), keys[RULES_VECTOR_MAX_CODES];
+
+    for(u32 j = 0; j < code_count; j++) keys[j] = _mm_set1_epi32((int)BE32(rules->remove_codes[j] << 8));
+
+    for(; (i + 4) <= count; i += 4)
+    {
+        __m128i v = _mm_and_si128(_mm_loadu_si128((const __m128i*)&(entries[i])), vmask), hit = _mm_setzero_si128();
+        for(u32 j = 0; j < code_count; j++) hit = _mm_or_si128(hit, _mm_cmpeq_epi32(v, keys[j]));
+        mask |= ((u32)_mm_movemask_ps(_mm_castsi128_ps(hit)) << i);
+    }
+#endif
+
+    *out_idx = i;
+
+    return mask;
+}
+#endif  /* RULES_VECTOR_MATCH */
+
+static bool rulesAllocateRemovalBitmap(AspectRatioDatabaseRules *rules)
+{
+    if (rules->remove_bitmap) return true;
+
+    rules->remove_bitmap = (u8*)utilsAllocateMemory(ARDB_CODE_BITMAP_SIZE);
+    if (!rules->remove_bitmap)
+    {
+        ERROR_MSG("Failed to allocate memory for removal bitmap!");
+        return false;
+    }
+
+    return true;
+}
+
+static void rulesSetBitmapBits(u8 *bitmap, const s16 *chars, u32 pos, u32 code)
+{
+    u32 remaining = (RULES_CODE_LENGTH - pos);
+    bool trailing_wildcards = true;
+
+    for(u32 i = pos; i < RULES_CODE_LENGTH; i++)
+    {
+        if (chars[i] == RULES_WILDCARD) continue;
+        trailing_wildcards = false;
+        break;
+    }
+
+    /* Trailing wildcards cover a contiguous, byte-aligned range of the code space. */
+    if (remaining && trailing_wildcards)
+    {
+        u32 bit_count = (1U << (remaining * 8));
+        memset(bitmap + ((code << (remaining * 8)) >> 3), 0xFF, bit_count >> 3);
+        return;
+    }
+
+    if (!remaining)
+    {
+        bitmap[code >> 3] |= (u8)(1 << (code & 7));
+        return;
+    }
+
+    if (chars[pos] != RULES_WILDCARD)
+    {
+        rulesSetBitmapBits(bitmap, chars, pos + 1, (code << 8) | (u32)chars[pos]);
+        return;
+    }
+
+    for(u32 i = 0; i < 0x100; i++) rulesSetBitmapBits(bitmap, chars, pos + 1, (code << 8) | i);
+}
+
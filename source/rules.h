@@ -0,0 +1,73 @@
+/*
+ * rules.h
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifndef __RULES_H__
+#define __RULES_H__
+
+#define RULES_FILE_PATH         "sd:/" APP_TITLE "/rules.txt"
+
+#define RULES_MATCH_BLOCK_SIZE  32  /* Maximum number of ARDB entries processed by rulesMatchEntryBlock(). */
+
+/// Rules files are plain text files with one rule per line. Everything after a '#' character is ignored.
+/// Rules apply to the database selected by the last section header: "[discdb]", "[vcadb]" or "[wwdb]".
+/// "-XXX" removes title code XXX. A '?' character matches any character at that position (e.g. "-HA?"), and a trailing '*' matches any suffix (e.g. "-W*").
+/// "+XXX" adds title code XXX. Wildcards aren't allowed in additions, and additions can't match a removal rule from the same section.
+/// The "[patch]" section holds U8 archive patch entries instead of rules. See patch.h for details.
+
+/// Adds a removal pattern to the provided rules, compiling it into the removal bitmap.
+bool rulesAddRemovalPattern(AspectRatioDatabaseRules *rules, const char *pattern);
+
+/// Adds a title code removal rule to the provided rules.
+bool rulesAddRemovalCode(AspectRatioDatabaseRules *rules, u32 code);
+
+/// Adds a title code addition rule to the provided rules.
+bool rulesAddAdditionCode(AspectRatioDatabaseRules *rules, u32 code);
+
+#ifdef BACKUP_U8_ARCHIVE
+/// Loads a rules file into the provided rules array, which must hold AspectRatioDatabaseType_Count elements.
+/// Entries from the "[patch]" section are added to the patch entry list.
+bool rulesLoadFromFile(AspectRatioDatabaseRules *rules, const char *path);
+#endif  /* BACKUP_U8_ARCHIVE */
+
+/// Returns the aspect ratio database type matching the provided section name (e.g. "wwdb"), or -1 if there's no match.
+s32 rulesGetDatabaseTypeByName(const char *name);
+
+/// Returns the section name for the provided aspect ratio database type (e.g. "wwdb"), or NULL if the type is invalid.
+const char *rulesGetDatabaseName(u8 type);
+
+/// Frees the provided rules array, which must hold AspectRatioDatabaseType_Count elements.
+void rulesFree(AspectRatioDatabaseRules *rules);
+
+/// Matches a block of up to RULES_MATCH_BLOCK_SIZE big-endian ARDB entries against the removal rules.
+/// Returns a bitmask in which bit N is set if entries[N] must be removed.
+/// If the removal rules only hold a few exact title codes (see remove_codes), host builds compare several entries at once against each code using AVX2 (up to 8 codes) or SSE2
+/// (up to 4 codes), whichever is available at build time.
+/// Otherwise, and on the console, entries are looked up in the removal bitmap.
+u32 rulesMatchEntryBlock(const AspectRatioDatabaseRules *rules, const u32 *entries, u32 count);
+
+/// Checks if the provided rules hold any edits.
+ALWAYS_INLINE bool rulesHasEdits(const AspectRatioDatabaseRules *rules)
+{
+    return (rules->remove_rule_count > 0 || rules->add_code_count > 0);
+}
+
+#endif /* __RULES_H__ */
@@ -20,20 +20,37 @@
 
 #include "utils.h"
 #include "sha1.h"
+#include "profiler.h"
 
-static bool g_sha1EngineInitialized = false;
+#define SHA1_ROTL(x, n)     (((x) << (n)) | ((x) >> (32 - (n))))
+
+/* The SHA engine is shared by every thread. It's only opened by the first user, and only closed by the last one. */
+static mutex_t g_sha1EngineMutex = LWP_MUTEX_NULL;
+static u32 g_sha1EngineUserCount = 0;
+
+static const u32 g_sha1InitialState[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
 
 static bool sha1EngineInitialize(void);
 static void sha1EngineClose(void);
 
-#define SHA_ENGINE_WRAPPER(func, ...) \
+static void sha1SoftwareProcessBlock(u32 *states, const u8 *block);
+static void sha1SoftwareAddLength(sha_context *ctx, u32 size);
+
+static bool sha1BackendContextCreate(u8 backend, sha_context *ctx);
+static bool sha1BackendContextUpdate(u8 backend, sha_context *ctx, const void *src, const u32 size);
+static bool sha1BackendContextGetHash(u8 backend, sha_context *ctx, const void *src, const u32 size, void *dst);
+
+#define SHA_ENGINE_WRAPPER_NO_RETURN(func, ...) \
     bool ret = false; \
     if (sha1EngineInitialize()) { \
         s32 rc = func(__VA_ARGS__); \
         ret = (rc >= 0); \
         if (!ret) ERROR_MSG(#func "() failed! (%d).", rc); \
-    } \
-    sha1EngineClose(); \
+        sha1EngineClose(); \
+    }
+
+#define SHA_ENGINE_WRAPPER(func, ...) \
+    SHA_ENGINE_WRAPPER_NO_RETURN(func, __VA_ARGS__); \
     return ret;
 
 bool sha1ContextCreate(sha_context *ctx)
@@ -43,23 +60,31 @@ bool sha1ContextCreate(sha_context *ctx)
 
 bool sha1ContextUpdate(sha_context *ctx, const void *src, const u32 size)
 {
-    SHA_ENGINE_WRAPPER(SHA_Input, ctx, src, size);
+    u64 start_time = profilerSpanBegin();
+    SHA_ENGINE_WRAPPER_NO_RETURN(SHA_Input, ctx, src, size);
+    profilerSpanEnd(ProfilerPhase_Sha1, start_time, size);
+    return ret;
 }
 
 bool sha1ContextGetHash(sha_context *ctx, const void *src, const u32 size, void *dst)
 {
-    SHA_ENGINE_WRAPPER(SHA_Calculate, ctx, src, size, dst);
+    u64 start_time = profilerSpanBegin();
+    SHA_ENGINE_WRAPPER_NO_RETURN(SHA_Calculate, ctx, src, size, dst);
+    profilerSpanEnd(ProfilerPhase_Sha1, start_time, size);
+    return ret;
 }
 
 #undef SHA_ENGINE_WRAPPER
+#undef SHA_ENGINE_WRAPPER_NO_RETURN
 
 bool sha1CalculateHash(const void *src, const u32 size, void *dst)
 {
     if (!src || !size || !dst) return false;
 
-    bool ret = false;
+    bool ret = false, engine_initialized = false;
 
     s32 rc = 0;
+    u64 start_time = 0;
 
     u8 *src_u8 = NULL;
     bool src_aligned = IS_ALIGNED((u32)src, 64);
@@ -85,7 +110,7 @@ bool sha1CalculateHash(const void *src, const u32 size, void *dst)
     }
 
     /* Initialize SHA engine. */
-    if (!sha1EngineInitialize()) goto end;
+    if (!(engine_initialized = sha1EngineInitialize())) goto end;
 
     /* Initialize SHA context. */
     rc = SHA_InitializeContext(&ctx);
@@ -96,6 +121,8 @@ bool sha1CalculateHash(const void *src, const u32 size, void *dst)
     }
 
     /* Calculate SHA checksum. */
+    start_time = profilerSpanBegin();
+
     rc = SHA_Calculate(&ctx, src_u8, size, hash);
     if (rc < 0)
     {
@@ -103,6 +130,8 @@ bool sha1CalculateHash(const void *src, const u32 size, void *dst)
         goto end;
     }
 
+    profilerSpanEnd(ProfilerPhase_Sha1, start_time, size);
+
     /* Copy checksum to destination pointer. */
     memcpy(dst, hash, sizeof(hash));
 
@@ -111,30 +140,314 @@ bool sha1CalculateHash(const void *src, const u32 size, void *dst)
 
 end:
     /* Close SHA engine. */
-    sha1EngineClose();
+    if (engine_initialized) sha1EngineClose();
 
     /* Free allocated buffer, if needed. */
-    if (!src_aligned && src_u8) free(src_u8);
+    if (!src_aligned && src_u8) utilsFreeMemory(src_u8);
+
+    return ret;
+}
+
+void sha1SoftwareContextCreate(sha_context *ctx)
+{
+    if (!ctx) return;
+
+    memcpy(ctx->states, g_sha1InitialState, sizeof(g_sha1InitialState));
+    ctx->upper_length = ctx->lower_length = 0;
+}
+
+bool sha1SoftwareContextUpdate(sha_context *ctx, const void *src, const u32 size)
+{
+    if (!ctx || (size && !src) || !IS_ALIGNED(size, SHA1_BLOCK_SIZE)) return false;
+
+    const u8 *src_u8 = (const u8*)src;
+    u64 start_time = profilerSpanBegin();
+
+    for(u32 offset = 0; offset < size; offset += SHA1_BLOCK_SIZE) sha1SoftwareProcessBlock(ctx->states, src_u8 + offset);
+
+    sha1SoftwareAddLength(ctx, size);
+
+    profilerSpanEnd(ProfilerPhase_Sha1, start_time, size);
+
+    return true;
+}
+
+bool sha1SoftwareContextGetHash(sha_context *ctx, const void *src, const u32 size, void *dst)
+{
+    if (!ctx || (size && !src) || !dst) return false;
+
+    const u8 *src_u8 = (const u8*)src;
+    u32 block_size = ALIGN_DOWN(size, SHA1_BLOCK_SIZE), remainder = (size - block_size), padding_size = 0;
+    u64 bit_length = 0;
+    u8 padding[SHA1_BLOCK_SIZE * 2] = {0}, *dst_u8 = (u8*)dst;
+
+    if (!sha1SoftwareContextUpdate(ctx, src_u8, block_size)) return false;
+
+    sha1SoftwareAddLength(ctx, remainder);
+    bit_length = ((((u64)ctx->upper_length << 32) | ctx->lower_length) << 3);
+
+    /* Append the 0x80 terminator and the big endian bit length, using an extra block if the remainder doesn't leave enough room for them. */
+    padding_size = (remainder < (SHA1_BLOCK_SIZE - 8) ? SHA1_BLOCK_SIZE : (SHA1_BLOCK_SIZE * 2));
+
+    memcpy(padding, src_u8 + block_size, remainder);
+    padding[remainder] = 0x80;
+
+    for(u32 i = 0; i < 8; i++) padding[padding_size - 1 - i] = (u8)(bit_length >> (i * 8));
+
+    for(u32 offset = 0; offset < padding_size; offset += SHA1_BLOCK_SIZE) sha1SoftwareProcessBlock(ctx->states, padding + offset);
+
+    for(u32 i = 0; i < 5; i++)
+    {
+        dst_u8[(i * 4) + 0] = (u8)(ctx->states[i] >> 24);
+        dst_u8[(i * 4) + 1] = (u8)(ctx->states[i] >> 16);
+        dst_u8[(i * 4) + 2] = (u8)(ctx->states[i] >> 8);
+        dst_u8[(i * 4) + 3] = (u8)ctx->states[i];
+    }
+
+    return true;
+}
+
+bool sha1CheckpointsInit(Sha1Checkpoints *cp, Sha1Backend backend, u32 interval, u32 data_size)
+{
+    if (!cp || backend > Sha1Backend_Software || !interval || !IS_ALIGNED(interval, SHA1_BLOCK_SIZE) || !data_size)
+    {
+        ERROR_MSG("Invalid parameters!");
+        return false;
+    }
+
+    sha1CheckpointsFree(cp);
+
+    /* Checkpoints are only recorded at offsets located before the end of the data. */
+    cp->capacity = ((data_size + interval - 1) / interval);
+
+    cp->midstates = (sha_context*)utilsAllocateMemory(sizeof(sha_context) * cp->capacity);
+    if (!cp->midstates)
+    {
+        ERROR_MSG("Failed to allocate memory for SHA-1 checkpoints!");
+        cp->capacity = 0;
+        return false;
+    }
+
+    cp->backend = (u8)backend;
+    cp->interval = interval;
+
+    return true;
+}
+
+void sha1CheckpointsFree(Sha1Checkpoints *cp)
+{
+    if (!cp) return;
+    if (cp->midstates) utilsFreeMemory(cp->midstates);
+    memset(cp, 0, sizeof(Sha1Checkpoints));
+}
+
+bool sha1CheckpointsExport(Sha1Checkpoints *cp, const sha_context *ctx, u32 offset)
+{
+    if (!cp || !cp->midstates || !ctx || cp->count >= cp->capacity || offset != (cp->count * cp->interval))
+    {
+        ERROR_MSG("Invalid parameters!");
+        return false;
+    }
+
+    memcpy(&(cp->midstates[cp->count++]), ctx, sizeof(sha_context));
+
+    return true;
+}
+
+bool sha1CheckpointsImport(const Sha1Checkpoints *cp, u32 offset, sha_context *out_ctx, u32 *out_offset)
+{
+    if (!cp || !cp->midstates || !cp->count || !out_ctx || !out_offset)
+    {
+        ERROR_MSG("Invalid parameters!");
+        return false;
+    }
+
+    u32 idx = (offset / cp->interval);
+    if (idx >= cp->count) idx = (cp->count - 1);
+
+    memcpy(out_ctx, &(cp->midstates[idx]), sizeof(sha_context));
+    *out_offset = (idx * cp->interval);
+
+    return true;
+}
+
+bool sha1CalculateHashWithCheckpoints(const void *src, const u32 size, Sha1Backend backend, u32 interval, Sha1Checkpoints *out_cp, void *dst)
+{
+    if (!src || !size || !dst || (backend == Sha1Backend_Hardware && !IS_ALIGNED((u32)src, 64)))
+    {
+        ERROR_MSG("Invalid parameters!");
+        return false;
+    }
+
+    const u8 *src_u8 = (const u8*)src;
+    bool ret = false;
+
+    sha_context ctx ATTRIBUTE_ALIGN(32) = {0};
+    u8 hash[SHA1_HASH_SIZE] ATTRIBUTE_ALIGN(32) = {0};
+
+    if (!sha1CheckpointsInit(out_cp, backend, interval, size) || !sha1BackendContextCreate(backend, &ctx)) goto end;
+
+    for(u32 offset = 0; offset < size; offset += interval)
+    {
+        u32 chunk_size = ((size - offset) < interval ? (size - offset) : interval);
+
+        if (!sha1CheckpointsExport(out_cp, &ctx, offset)) goto end;
+
+        if ((offset + chunk_size) < size)
+        {
+            if (!sha1BackendContextUpdate(backend, &ctx, src_u8 + offset, chunk_size)) goto end;
+        } else {
+            if (!sha1BackendContextGetHash(backend, &ctx, src_u8 + offset, chunk_size, hash)) goto end;
+        }
+    }
+
+    memcpy(dst, hash, sizeof(hash));
+    ret = true;
+
+end:
+    if (!ret) sha1CheckpointsFree(out_cp);
 
     return ret;
 }
 
+bool sha1ResumeHash(const Sha1Checkpoints *cp, const void *src, const u32 size, u32 dirty_offset, void *dst)
+{
+    if (!cp || !src || !size || !dst)
+    {
+        ERROR_MSG("Invalid parameters!");
+        return false;
+    }
+
+    const u8 *src_u8 = (const u8*)src;
+    u32 offset = 0;
+
+    sha_context ctx ATTRIBUTE_ALIGN(32) = {0};
+    u8 hash[SHA1_HASH_SIZE] ATTRIBUTE_ALIGN(32) = {0};
+
+    /* Always hash at least some data, even if nothing was modified. */
+    if (dirty_offset >= size) dirty_offset = (size - 1);
+
+    if (!sha1CheckpointsImport(cp, dirty_offset, &ctx, &offset)) return false;
+
+    if (cp->backend == Sha1Backend_Hardware && !IS_ALIGNED((u32)(src_u8 + offset), 64))
+    {
+        ERROR_MSG("Unaligned data can't be hashed using the SHA engine!");
+        return false;
+    }
+
+    if (!sha1BackendContextGetHash(cp->backend, &ctx, src_u8 + offset, size - offset, hash)) return false;
+
+    memcpy(dst, hash, sizeof(hash));
+
+    return true;
+}
+
 static bool sha1EngineInitialize(void)
 {
-    if (g_sha1EngineInitialized) return true;
+    s32 rc = 0;
+    u32 level = 0;
+    bool success = true;
+
+    /* The mutex is created on first use. Interrupts are disabled, so only a single thread can create it. */
+    _CPU_ISR_Disable(level);
+    if (g_sha1EngineMutex == LWP_MUTEX_NULL) LWP_MutexInit(&g_sha1EngineMutex, false);
+    _CPU_ISR_Restore(level);
+
+    LWP_MutexLock(g_sha1EngineMutex);
+
+    if (!g_sha1EngineUserCount)
+    {
+        rc = SHA_Init();
+        success = (rc >= 0);
+        if (!success) ERROR_MSG("SHA_Init() failed! (%d).", rc);
+    }
+
+    if (success) g_sha1EngineUserCount++;
 
-    s32 rc = SHA_Init();
-    g_sha1EngineInitialized = (rc >= 0);
-    if (!g_sha1EngineInitialized) ERROR_MSG("SHA_Init() failed! (%d).", rc);
+    LWP_MutexUnlock(g_sha1EngineMutex);
 
-    return g_sha1EngineInitialized;
+    return success;
 }
 
 static void sha1EngineClose(void)
 {
-    if (!g_sha1EngineInitialized) return;
+    LWP_MutexLock(g_sha1EngineMutex);
 
-    SHA_Close();
+    if (g_sha1EngineUserCount && !--g_sha1EngineUserCount) SHA_Close();
+
+    LWP_MutexUnlock(g_sha1EngineMutex);
+}
 
-    g_sha1EngineInitialized = false;
+static void sha1SoftwareProcessBlock(u32 *states, const u8 *block)
+{
+    u32 w[80] = {0};
+    u32 a = states[0], b = states[1], c = states[2], d = states[3], e = states[4];
+
+    for(u32 i = 0; i < 16; i++) w[i] = (((u32)block[i * 4] << 24) | ((u32)block[(i * 4) + 1] << 16) | ((u32)block[(i * 4) + 2] << 8) | (u32)block[(i * 4) + 3]);
+    for(u32 i = 16; i < 80; i++) w[i] = SHA1_ROTL(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+    for(u32 i = 0; i < 80; i++)
+    {
+        u32 f = 0, k = 0, tmp = 0;
+
+        if (i < 20)
+        {
+            f = ((b & c) | (~b & d));
+            k = 0x5A827999;
+        } else
+        if (i < 40)
+        {
+            f = (b ^ c ^ d);
+            k = 0x6ED9EBA1;
+        } else
+        if (i < 60)
+        {
+            f = ((b & c) | (b & d) | (c & d));
+            k = 0x8F1BBCDC;
+        } else {
+            f = (b ^ c ^ d);
+            k = 0xCA62C1D6;
+        }
+
+        tmp = (SHA1_ROTL(a, 5) + f + e + k + w[i]);
+        e = d;
+        d = c;
+        c = SHA1_ROTL(b, 30);
+        b = a;
+        a = tmp;
+    }
+
+    states[0] += a;
+    states[1] += b;
+    states[2] += c;
+    states[3] += d;
+    states[4] += e;
+}
+
+static void sha1SoftwareAddLength(sha_context *ctx, u32 size)
+{
+    u32 lower_length = (ctx->lower_length + size);
+    if (lower_length < ctx->lower_length) ctx->upper_length++;
+    ctx->lower_length = lower_length;
+}
+
+static bool sha1BackendContextCreate(u8 backend, sha_context *ctx)
+{
+    if (backend == Sha1Backend_Software)
+    {
+        sha1SoftwareContextCreate(ctx);
+        return true;
+    }
+
+    return sha1ContextCreate(ctx);
+}
+
+static bool sha1BackendContextUpdate(u8 backend, sha_context *ctx, const void *src, const u32 size)
+{
+    return (backend == Sha1Backend_Software ? sha1SoftwareContextUpdate(ctx, src, size) : sha1ContextUpdate(ctx, src, size));
+}
+
+static bool sha1BackendContextGetHash(u8 backend, sha_context *ctx, const void *src, const u32 size, void *dst)
+{
+    return (backend == Sha1Backend_Software ? sha1SoftwareContextGetHash(ctx, src, size, dst) : sha1ContextGetHash(ctx, src, size, dst));
 }
@@ -37,4 +37,44 @@ bool sha1ContextGetHash(sha_context *ctx, const void *src, const u32 size, void
 /// Simple all-in-one SHA-1 calculator. Handles I/O alignment if needed.
 bool sha1CalculateHash(const void *src, const u32 size, void *dst);
 
+#define SHA1_BLOCK_SIZE 64
+
+typedef enum {
+    Sha1Backend_Hardware = 0,   ///< SHA engine, through the sha1Context*() wrappers.
+    Sha1Backend_Software = 1    ///< sha1SoftwareContext*() functions.
+} Sha1Backend;
+
+/// Software SHA-1 implementation. Uses the same context layout as the SHA engine, but length fields hold the number of processed bytes.
+/// Just like with the SHA engine, sha1SoftwareContextUpdate() only takes whole blocks, and any partial block must be provided to sha1SoftwareContextGetHash().
+void sha1SoftwareContextCreate(sha_context *ctx);
+bool sha1SoftwareContextUpdate(sha_context *ctx, const void *src, const u32 size);
+bool sha1SoftwareContextGetHash(sha_context *ctx, const void *src, const u32 size, void *dst);
+
+/// SHA-1 midstates recorded at fixed intervals while hashing a buffer. Checkpoint i holds the context state right after hashing (i * interval) bytes.
+/// Midstates are stored as plain context copies, so they can only be resumed using the backend that recorded them.
+typedef struct {
+    u8 backend;                 ///< Sha1Backend.
+    u32 interval;               ///< Distance between checkpoints, in bytes. Must be a multiple of SHA1_BLOCK_SIZE.
+    u32 count;                  ///< Number of recorded checkpoints.
+    u32 capacity;               ///< Number of allocated checkpoints.
+    sha_context *midstates;     ///< Checkpoint contexts.
+} Sha1Checkpoints;
+
+/// Allocates enough checkpoints to cover data_size bytes. Any previous checkpoints are freed.
+bool sha1CheckpointsInit(Sha1Checkpoints *cp, Sha1Backend backend, u32 interval, u32 data_size);
+void sha1CheckpointsFree(Sha1Checkpoints *cp);
+
+/// Exports a context as the checkpoint for the provided offset. Checkpoints must be exported in order, so offset must match (count * interval).
+bool sha1CheckpointsExport(Sha1Checkpoints *cp, const sha_context *ctx, u32 offset);
+
+/// Imports the last checkpoint located at or before the provided offset. Its offset is saved to out_offset.
+bool sha1CheckpointsImport(const Sha1Checkpoints *cp, u32 offset, sha_context *out_ctx, u32 *out_offset);
+
+/// Calculates the SHA-1 checksum of a buffer, recording checkpoints every interval bytes. src must be 64-byte aligned if the SHA engine is used.
+bool sha1CalculateHashWithCheckpoints(const void *src, const u32 size, Sha1Backend backend, u32 interval, Sha1Checkpoints *out_cp, void *dst);
+
+/// Calculates the SHA-1 checksum of a modified buffer by resuming from the last checkpoint located at or before dirty_offset.
+/// Only the data after that checkpoint is hashed. Data before it must be unchanged. src must be 64-byte aligned if the SHA engine is used.
+bool sha1ResumeHash(const Sha1Checkpoints *cp, const void *src, const u32 size, u32 dirty_offset, void *dst);
+
 #endif /* __SHA1_H__ */
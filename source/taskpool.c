@@ -0,0 +1,132 @@
+/*
+ * taskpool.c
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils.h"
+#include "taskpool.h"
+
+#define TASK_POOL_THREAD_STACK_SIZE 0x8000
+#define TASK_POOL_THREAD_PRIORITY   64
+
+typedef struct {
+    TaskPoolFunction func;
+    void *arg;
+    u32 count;
+
+    mutex_t mutex;          ///< Protects next_idx and failed.
+    u32 next_idx;           ///< Next task to hand out.
+    bool failed;            ///< Set as soon as a task fails, which stops all workers.
+} TaskPoolContext;
+
+/* Global variables. */
+
+static u32 g_taskPoolWorkerCount = 1;
+
+/* Function prototypes. */
+
+static void *taskPoolThreadFunc(void *arg);
+
+void taskPoolSetWorkerCount(u32 count)
+{
+    g_taskPoolWorkerCount = (count < 1 ? 1 : (count > TASK_POOL_MAX_WORKERS ? TASK_POOL_MAX_WORKERS : count));
+}
+
+u32 taskPoolGetWorkerCount(void)
+{
+    return g_taskPoolWorkerCount;
+}
+
+bool taskPoolRun(u32 count, TaskPoolFunction func, void *arg)
+{
+    if (!func)
+    {
+        ERROR_MSG("Invalid parameters!");
+        return false;
+    }
+
+    TaskPoolContext ctx = { .func = func, .arg = arg, .count = count };
+    lwp_t threads[TASK_POOL_MAX_WORKERS - 1] = {0};
+    u32 thread_count = 0, worker_count = (count < g_taskPoolWorkerCount ? count : g_taskPoolWorkerCount);
+    s32 ret = 0;
+
+    if (!count) return true;
+
+    /* Don't bother with threads if there's a single worker. */
+    if (worker_count <= 1)
+    {
+        for(u32 i = 0; i < count; i++)
+        {
+            if (!func(arg, i)) return false;
+        }
+
+        return true;
+    }
+
+    LWP_MutexInit(&(ctx.mutex), false);
+
+    /* Start extra workers. Running with fewer workers than requested is fine, since the calling thread takes part as well. */
+    for(u32 i = 0; i < (worker_count - 1); i++)
+    {
+        ret = LWP_CreateThread(&(threads[thread_count]), taskPoolThreadFunc, &ctx, NULL, TASK_POOL_THREAD_STACK_SIZE, TASK_POOL_THREAD_PRIORITY);
+        if (ret < 0)
+        {
+            ERROR_MSG("LWP_CreateThread failed for worker #%u! (%d).", i + 1, ret);
+            break;
+        }
+
+        thread_count++;
+    }
+
+    taskPoolThreadFunc(&ctx);
+
+    for(u32 i = 0; i < thread_count; i++) LWP_JoinThread(threads[i], NULL);
+
+    LWP_MutexDestroy(ctx.mutex);
+
+    return !ctx.failed;
+}
+
+static void *taskPoolThreadFunc(void *arg)
+{
+    TaskPoolContext *ctx = (TaskPoolContext*)arg;
+
+    while(true)
+    {
+        u32 idx = 0;
+        bool done = false;
+
+        LWP_MutexLock(ctx->mutex);
+
+        done = (ctx->failed || ctx->next_idx >= ctx->count);
+        if (!done) idx = ctx->next_idx++;
+
+        LWP_MutexUnlock(ctx->mutex);
+
+        if (done) break;
+
+        if (!ctx->func(ctx->arg, idx))
+        {
+            LWP_MutexLock(ctx->mutex);
+            ctx->failed = true;
+            LWP_MutexUnlock(ctx->mutex);
+        }
+    }
+
+    return NULL;
+}
@@ -0,0 +1,43 @@
+/*
+ * taskpool.h
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifndef __TASKPOOL_H__
+#define __TASKPOOL_H__
+
+#define TASK_POOL_MAX_WORKERS       16
+
+/// Runs a single task. idx ranges from zero to the task count passed to taskPoolRun(), minus one. Returns false on failure.
+typedef bool (*TaskPoolFunction)(void *arg, u32 idx);
+
+/// Sets the number of worker threads used by taskPoolRun(), including the calling thread. Clamped to [1, TASK_POOL_MAX_WORKERS].
+/// Defaults to 1, which runs every task on the calling thread: the console only has a single core, and libfat serializes SD card I/O anyway.
+void taskPoolSetWorkerCount(u32 count);
+
+/// Retrieves the number of worker threads used by taskPoolRun().
+u32 taskPoolGetWorkerCount(void);
+
+/// Runs func(arg, idx) for every idx within [0, count). Tasks are handed out in order to the calling thread and up to (worker count - 1) extra threads, which are created and
+/// joined by this function. Tasks may complete in any order, so func() must only touch state that belongs to its own task, or use functions that are safe to call from any thread.
+/// No new tasks are started once a task fails. Returns false if any task failed.
+bool taskPoolRun(u32 count, TaskPoolFunction func, void *arg);
+
+#endif /* __TASKPOOL_H__ */
@@ -0,0 +1,392 @@
+/*
+ * titlemeta.c
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "utils.h"
+#include "u8.h"
+#include "titlemeta.h"
+
+#define TITLE_META_CONTENT_DIR_FORMAT   "/title/%08x/%08x/content"
+
+typedef enum {
+    TitleMetaSortKey_ContentId = 0,
+    TitleMetaSortKey_Size      = 1
+} TitleMetaSortKey;
+
+#ifdef BACKUP_U8_ARCHIVE
+/// Archive content ID for a specific title version. The content cache is a sidecar file (see UtilsSidecarHeader).
+typedef struct {
+    u64 title_id;       ///< Title ID.
+    u16 title_version;  ///< Title version from the TMD.
+    u16 reserved;       ///< Reserved.
+    u32 cid;            ///< Archive content ID.
+} TitleMetaContentCacheEntry;
+
+SIZE_ASSERT(TitleMetaContentCacheEntry, 0x10);
+#endif  /* BACKUP_U8_ARCHIVE */
+
+/* Global variables. */
+
+static TitleMetadata g_titleMeta = {0};
+static bool g_titleMetaLoaded = false;
+
+/* Function prototypes. */
+
+static bool titleMetaLoad(u64 title_id);
+static void titleMetaResolveArchiveContent(TitleMetadata *meta);
+static bool titleMetaProbeArchiveContent(const char *path, UtilsReadRangeFunction read_range);
+
+#ifdef BACKUP_U8_ARCHIVE
+static bool titleMetaLookupCachedArchiveContent(const TitleMetadata *meta, u32 *out_cid);
+static void titleMetaStoreCachedArchiveContent(const TitleMetadata *meta, u32 cid);
+#endif  /* BACKUP_U8_ARCHIVE */
+
+static u16 *titleMetaBuildOrder(const tmd *t, u8 key);
+static bool titleMetaIsContentLess(const tmd_content *a, const tmd_content *b, u8 key);
+static tmd_content *titleMetaFindContentById(const TitleMetadata *meta, u32 cid);
+
+const TitleMetadata *titleMetaGet(u64 title_id)
+{
+    if (g_titleMetaLoaded && g_titleMeta.title_id == title_id) return &g_titleMeta;
+
+    /* Drop the previous title, if any. */
+    titleMetaFree();
+
+    if (!titleMetaLoad(title_id))
+    {
+        titleMetaFree();
+        return NULL;
+    }
+
+    g_titleMetaLoaded = true;
+
+    return &g_titleMeta;
+}
+
+tmd_content *titleMetaGetContentById(const TitleMetadata *meta, u32 cid)
+{
+    if (!meta || !meta->tmd) return NULL;
+    return titleMetaFindContentById(meta, cid);
+}
+
+tmd_content *titleMetaGetContentBySizeRank(const TitleMetadata *meta, u16 rank)
+{
+    if (!meta || !meta->tmd || rank >= meta->tmd->num_contents) return NULL;
+    return &(meta->tmd->contents[meta->size_order[rank]]);
+}
+
+s32 titleMetaFindArchiveContent(const TitleMetadata *meta, const char *content_dir, UtilsReadRangeFunction read_range)
+{
+    if (!meta || !meta->tmd || !meta->size_order || !content_dir || !*content_dir || !read_range) return -1;
+
+    char path[0x200] = {0};
+
+    /* The U8 archive with resources is usually the largest content, so this normally takes a single probe. */
+    for(u16 i = 0; i < meta->tmd->num_contents; i++)
+    {
+        u16 pos = meta->size_order[i];
+        tmd_content *content = &(meta->tmd->contents[pos]);
+
+        /* Skip shared contents, as well as contents too small to hold a U8 header. */
+        if ((content->type & 0x8000) || content->size <= sizeof(U8Header)) continue;
+
+        snprintf(path, sizeof(path), "%s/%08x.app", content_dir, content->cid);
+        if (titleMetaProbeArchiveContent(path, read_range)) return (s32)pos;
+    }
+
+    return -1;
+}
+
+bool titleMetaGetContentPath(u64 title_id, const tmd_content *content, char *out_path)
+{
+    if (!content || !out_path) return false;
+
+    /* Shared contents aren't stored in the title directory. */
+    if (content->type & 0x8000) return false;
+
+    sprintf(out_path, TITLE_META_CONTENT_DIR_FORMAT "/%08x.app", TITLE_UPPER(title_id), TITLE_LOWER(title_id), content->cid);
+
+    return true;
+}
+
+void titleMetaFree(void)
+{
+    if (g_titleMeta.stmd) utilsFreeMemory(g_titleMeta.stmd);
+    if (g_titleMeta.cid_order) utilsFreeMemory(g_titleMeta.cid_order);
+    if (g_titleMeta.size_order) utilsFreeMemory(g_titleMeta.size_order);
+
+    memset(&g_titleMeta, 0, sizeof(TitleMetadata));
+    g_titleMetaLoaded = false;
+}
+
+static bool titleMetaLoad(u64 title_id)
+{
+    TitleMetadata *meta = &g_titleMeta;
+
+    meta->title_id = title_id;
+
+    /* Get signed TMD. */
+    meta->stmd = utilsGetSignedTMDFromTitle(title_id, &(meta->stmd_size));
+    if (!meta->stmd)
+    {
+        ERROR_MSG("Error retrieving TMD! (TID %08X-%08X).", TITLE_UPPER(title_id), TITLE_LOWER(title_id));
+        return false;
+    }
+
+    meta->tmd = utilsGetTMDFromSignedBlob(meta->stmd);
+    if (!meta->tmd || !meta->tmd->num_contents)
+    {
+        ERROR_MSG("Invalid TMD! (TID %08X-%08X).", TITLE_UPPER(title_id), TITLE_LOWER(title_id));
+        return false;
+    }
+
+    /* Build content record indexes. */
+    meta->cid_order = titleMetaBuildOrder(meta->tmd, TitleMetaSortKey_ContentId);
+    meta->size_order = titleMetaBuildOrder(meta->tmd, TitleMetaSortKey_Size);
+    if (!meta->cid_order || !meta->size_order)
+    {
+        ERROR_MSG("Failed to allocate memory for content record indexes!");
+        return false;
+    }
+
+    /* Locate the archive content record and its path. */
+    titleMetaResolveArchiveContent(meta);
+
+    return true;
+}
+
+static void titleMetaResolveArchiveContent(TitleMetadata *meta)
+{
+    tmd_content *content = NULL;
+    char content_dir[ISFS_MAXPATH] = {0};
+    s32 pos = -1;
+
+#ifdef BACKUP_U8_ARCHIVE
+    bool cache_available = utilsMountSdCard();
+    u32 cid = 0;
+
+    if (cache_available && titleMetaLookupCachedArchiveContent(meta, &cid)) content = titleMetaGetContentById(meta, cid);
+#endif  /* BACKUP_U8_ARCHIVE */
+
+    if (!content)
+    {
+        sprintf(content_dir, TITLE_META_CONTENT_DIR_FORMAT, TITLE_UPPER(meta->title_id), TITLE_LOWER(meta->title_id));
+
+        if ((pos = titleMetaFindArchiveContent(meta, content_dir, utilsReadFileRangeFromIsfs)) >= 0)
+        {
+            content = &(meta->tmd->contents[pos]);
+
+#ifdef BACKUP_U8_ARCHIVE
+            if (cache_available) titleMetaStoreCachedArchiveContent(meta, content->cid);
+#endif  /* BACKUP_U8_ARCHIVE */
+        } else {
+            /* Fall back to the largest content record. The U8 archive may just be corrupted, which is something a backup restore can fix. */
+            /* This is never cached. */
+            content = titleMetaGetContentBySizeRank(meta, 0);
+        }
+    }
+
+    meta->archive_content = content;
+    titleMetaGetContentPath(meta->title_id, content, meta->archive_content_path);
+}
+
+static bool titleMetaProbeArchiveContent(const char *path, UtilsReadRangeFunction read_range)
+{
+    u8 *data = NULL;
+    u32 file_size = 0, node_count = 0, node_section_size = 0, str_table_size = 0;
+    U8Header u8_header = {0};
+    U8Node root_node = {0}, *nodes = NULL;
+    const char *str_table = NULL;
+    bool found = false;
+
+    /* Read U8 header. */
+    if (!(data = (u8*)read_range(path, 0, sizeof(U8Header), &file_size))) goto out;
+
+    memcpy(&u8_header, data, sizeof(U8Header));
+    utilsSwapBigEndianWords(&u8_header, sizeof(U8Header) / sizeof(u32));
+    utilsFreeMemory(data);
+    data = NULL;
+
+    /* Same checks as u8ContextInitPartial(). Most contents aren't U8 archives, so nothing is printed. */
+    if (u8_header.magic != U8_MAGIC || u8_header.root_node_offset <= (u32)sizeof(U8Header) || u8_header.node_info_block_size <= (u32)sizeof(U8Node) || \
+        u8_header.data_offset != ALIGN_UP(u8_header.root_node_offset + u8_header.node_info_block_size, 0x40) || u8_header.data_offset >= file_size) goto out;
+
+    /* Read root U8 node. Its size field holds the node count. */
+    if (!(data = (u8*)read_range(path, u8_header.root_node_offset, sizeof(U8Node), NULL))) goto out;
+
+    memcpy(&root_node, data, sizeof(U8Node));
+    utilsSwapBigEndianWords(&root_node, sizeof(U8Node) / sizeof(u32));
+    utilsFreeMemory(data);
+    data = NULL;
+
+    if (root_node.type != U8NodeType_Directory || root_node.name_offset != 0 || root_node.data_offset != 0 || root_node.size <= 1 || \
+        ((u64)sizeof(U8Node) * root_node.size) >= u8_header.node_info_block_size) goto out;
+
+    node_count = root_node.size;
+    node_section_size = (u32)(sizeof(U8Node) * node_count);
+    str_table_size = (u8_header.node_info_block_size - node_section_size);
+
+    /* Read node info block: node table and string table. */
+    if (!(data = (u8*)read_range(path, u8_header.root_node_offset, u8_header.node_info_block_size, NULL))) goto out;
+
+    utilsSwapBigEndianWords(data, node_section_size / sizeof(u32));
+
+    nodes = (U8Node*)data;
+    str_table = (const char*)(data + node_section_size);
+
+    /* Only direct children from the root directory are checked. Subdirectories are skipped as a whole, since their size field points to the node right past them. */
+    for(u32 i = 1; i < node_count;)
+    {
+        U8Node *node = &(nodes[i]);
+
+        if (node->type != U8NodeType_Directory)
+        {
+            i++;
+            continue;
+        }
+
+        if (node->data_offset == 0 && node->name_offset < str_table_size && \
+            strnlen(str_table + node->name_offset, str_table_size - node->name_offset) == strlen(TITLE_META_ARCHIVE_DIR_NAME) && \
+            !memcmp(str_table + node->name_offset, TITLE_META_ARCHIVE_DIR_NAME, strlen(TITLE_META_ARCHIVE_DIR_NAME)))
+        {
+            found = true;
+            break;
+        }
+
+        /* Bail out on malformed directory nodes. */
+        if (node->size <= i || node->size > node_count) break;
+
+        i = node->size;
+    }
+
+out:
+    if (data) utilsFreeMemory(data);
+
+    return found;
+}
+
+#ifdef BACKUP_U8_ARCHIVE
+static bool titleMetaLookupCachedArchiveContent(const TitleMetadata *meta, u32 *out_cid)
+{
+    TitleMetaContentCacheEntry entries[TITLE_META_CONTENT_CACHE_MAX_ENTRIES] = {0};
+    u32 entry_count = 0;
+
+    /* Missing and invalid content caches aren't errors. */
+    entry_count = utilsLoadSidecarFile(TITLE_META_CONTENT_CACHE_PATH, TITLE_META_CONTENT_CACHE_MAGIC, TITLE_META_CONTENT_CACHE_VERSION, entries, sizeof(TitleMetaContentCacheEntry), \
+                                       TITLE_META_CONTENT_CACHE_MAX_ENTRIES, NULL);
+
+    for(u32 i = 0; i < entry_count; i++)
+    {
+        if (entries[i].title_id != meta->title_id || entries[i].title_version != meta->tmd->title_version) continue;
+
+        *out_cid = entries[i].cid;
+        return true;
+    }
+
+    return false;
+}
+
+static void titleMetaStoreCachedArchiveContent(const TitleMetadata *meta, u32 cid)
+{
+    TitleMetaContentCacheEntry entries[TITLE_META_CONTENT_CACHE_MAX_ENTRIES] = {0}, entry = {0};
+    u32 loaded_count = 0, entry_count = 0;
+
+    /* Keep entries from other titles and title versions. Invalid caches are just overwritten. */
+    loaded_count = utilsLoadSidecarFile(TITLE_META_CONTENT_CACHE_PATH, TITLE_META_CONTENT_CACHE_MAGIC, TITLE_META_CONTENT_CACHE_VERSION, entries, sizeof(TitleMetaContentCacheEntry), \
+                                        TITLE_META_CONTENT_CACHE_MAX_ENTRIES, NULL);
+
+    for(u32 i = 0; i < loaded_count; i++)
+    {
+        if (entries[i].title_id == meta->title_id && entries[i].title_version == meta->tmd->title_version) continue;
+        if (entry_count != i) memcpy(&(entries[entry_count]), &(entries[i]), sizeof(TitleMetaContentCacheEntry));
+        entry_count++;
+    }
+
+    entry.title_id = meta->title_id;
+    entry.title_version = meta->tmd->title_version;
+    entry.cid = cid;
+
+    entry_count = utilsAppendSidecarEntry(entries, entry_count, TITLE_META_CONTENT_CACHE_MAX_ENTRIES, sizeof(TitleMetaContentCacheEntry), &entry);
+
+    if (!utilsSaveSidecarFile(TITLE_META_CONTENT_CACHE_PATH, TITLE_META_CONTENT_CACHE_MAGIC, TITLE_META_CONTENT_CACHE_VERSION, entries, sizeof(TitleMetaContentCacheEntry), \
+                              entry_count)) ERROR_MSG("Failed to write content cache!");
+}
+#endif  /* BACKUP_U8_ARCHIVE */
+
+static u16 *titleMetaBuildOrder(const tmd *t, u8 key)
+{
+    u16 count = t->num_contents;
+    u16 *order = (u16*)utilsAllocateMemory(count * sizeof(u16));
+    if (!order) return NULL;
+
+    /* Plain insertion sort. TMDs only hold a handful of content records. */
+    /* It's also stable, so the first record wins if several of them share the same key. */
+    for(u16 i = 0; i < count; i++)
+    {
+        u16 j = i;
+
+        while(j > 0 && titleMetaIsContentLess(&(t->contents[i]), &(t->contents[order[j - 1]]), key))
+        {
+            order[j] = order[j - 1];
+            j--;
+        }
+
+        order[j] = i;
+    }
+
+    return order;
+}
+
+static bool titleMetaIsContentLess(const tmd_content *a, const tmd_content *b, u8 key)
+{
+    switch(key)
+    {
+        case TitleMetaSortKey_ContentId:
+            return (a->cid < b->cid);
+        case TitleMetaSortKey_Size:
+            return (a->size > b->size);
+        default:
+            break;
+    }
+
+    return false;
+}
+
+static tmd_content *titleMetaFindContentById(const TitleMetadata *meta, u32 cid)
+{
+    u32 low = 0, high = meta->tmd->num_contents;
+
+    /* Binary search over the sorted positions. */
+    while(low < high)
+    {
+        u32 mid = (low + ((high - low) / 2));
+        tmd_content *content = &(meta->tmd->contents[meta->cid_order[mid]]);
+
+        if (content->cid == cid) return content;
+
+        if (content->cid < cid)
+        {
+            low = (mid + 1);
+        } else {
+            high = mid;
+        }
+    }
+
+    return NULL;
+}
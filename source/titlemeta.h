@@ -0,0 +1,72 @@
+/*
+ * titlemeta.h
+ *
+ * Copyright (c) 2026, DarkMatterCore <pabloacurielz@gmail.com>.
+ *
+ * This file is part of ww-43db-patcher (https://github.com/DarkMatterCore/ww-43db-patcher).
+ *
+ * ww-43db-patcher is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 2.0.
+ *
+ * ww-43db-patcher is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#ifndef __TITLEMETA_H__
+#define __TITLEMETA_H__
+
+#ifdef BACKUP_U8_ARCHIVE
+#define TITLE_META_CONTENT_CACHE_PATH           "sd:/" APP_TITLE "/contentcache.bin"
+#define TITLE_META_CONTENT_CACHE_MAGIC          (u32)0x54434343 /* "TCCC". */
+#define TITLE_META_CONTENT_CACHE_VERSION        1
+#define TITLE_META_CONTENT_CACHE_MAX_ENTRIES    16
+#endif  /* BACKUP_U8_ARCHIVE */
+
+#define TITLE_META_ARCHIVE_DIR_NAME             "titlelist" /* Root directory that identifies the U8 archive with resources. */
+
+/// Holds a signed TMD retrieved from ES, along with lookup indexes for its content records.
+/// Content records are indexed by content ID and size, which avoids linear scans and redundant ES requests.
+typedef struct {
+    u64 title_id;                               ///< Title ID.
+    signed_blob *stmd;                          ///< Signed TMD.
+    u32 stmd_size;                              ///< Signed TMD size.
+    tmd *tmd;                                   ///< Pointer to the TMD within the signed blob.
+    u16 *cid_order;                             ///< Content record positions sorted by content ID.
+    u16 *size_order;                            ///< Content record positions sorted by size, in descending order.
+    tmd_content *archive_content;               ///< Content record holding a U8 archive with a "/titlelist" directory. For the System Menu, this is the U8 archive with resources.
+                                                ///< Falls back to the largest content record if no content matches (e.g. if the U8 archive is corrupted).
+    char archive_content_path[ISFS_MAXPATH];    ///< ISFS path to the archive content.
+} TitleMetadata;
+
+/// Returns the metadata for the provided title. The signed TMD is only retrieved from ES once per session.
+/// The archive content is located using titleMetaFindArchiveContent(). If BACKUP_U8_ARCHIVE is defined, the result is cached in the SD card for each title version.
+/// The returned pointer is owned by the cache and must not be freed.
+const TitleMetadata *titleMetaGet(u64 title_id);
+
+/// Looks up a content record by its content ID. Returns NULL if it can't be found.
+tmd_content *titleMetaGetContentById(const TitleMetadata *meta, u32 cid);
+
+/// Returns the content record with the provided size rank, where rank 0 is the largest content. Returns NULL if out of range.
+tmd_content *titleMetaGetContentBySizeRank(const TitleMetadata *meta, u16 rank);
+
+/// Looks for the content record holding a U8 archive with a "/titlelist" directory. Content files are read from content_dir (e.g. "/title/00000001/00000002/content") through read_range,
+/// and must be named after their content IDs, which means any directory-backed title can be probed (e.g. a title dump stored in a mounted device).
+/// Contents are probed from largest to smallest. Only the U8 header and root node are read from each one, plus the node info block from valid U8 archives.
+/// Returns the content record position within the TMD, or -1 if no content matches.
+s32 titleMetaFindArchiveContent(const TitleMetadata *meta, const char *content_dir, UtilsReadRangeFunction read_range);
+
+/// Generates the ISFS path to a content record from the provided title. out_path must be at least ISFS_MAXPATH bytes long. Returns false for shared contents.
+bool titleMetaGetContentPath(u64 title_id, const tmd_content *content, char *out_path);
+
+/// Frees the cached metadata. It will be retrieved from ES again the next time it's requested.
+void titleMetaFree(void);
+
+#endif /* __TITLEMETA_H__ */
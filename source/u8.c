@@ -20,14 +20,74 @@
 
 #include "utils.h"
 #include "u8.h"
+#include "sha1.h"
+#include "profiler.h"
+#include "taskpool.h"
 
 #define U8_FILE_ALIGNMENT   0x20
 
+#define U8_MAX_DIR_DEPTH    32
+#define U8_MAX_EXTRACT_PATH 0x300
+
+#define U8_PATH_HASH_SEED   (u32)0x811C9DC5 /* FNV-1a offset basis. */
+#define U8_PATH_HASH_PRIME  (u32)0x01000193 /* FNV-1a prime. */
+
+#ifdef BACKUP_U8_ARCHIVE
+/// Serialized U8 index header. It's followed by the node table, the parent node indexes, the path table and the string table, in that order.
+/// All fields are stored using the console's native byte order.
+typedef struct {
+    u32 magic;                          ///< U8_INDEX_MAGIC.
+    u32 version;                        ///< U8_INDEX_VERSION.
+    u8 archive_hash[SHA1_HASH_SIZE];    ///< SHA-1 checksum of the indexed U8 archive.
+    u8 data_hash[SHA1_HASH_SIZE];       ///< SHA-1 checksum of all the data following this header.
+    U8Header u8_header;                 ///< Header from the indexed U8 archive.
+    u32 archive_size;                   ///< Indexed U8 archive size.
+    u32 node_count;                     ///< Node count.
+    u32 str_table_size;                 ///< String table size.
+    u32 path_table_size;                ///< Path table entry count.
+} U8IndexHeader;
+
+SIZE_ASSERT(U8IndexHeader, 0x50);
+
+/// Shared state for U8 extraction tasks. Each task writes a single file node.
+typedef struct {
+    U8Context *ctx;
+    const char *out_path;   ///< Output directory, without trailing slashes.
+    u32 *parents;           ///< Parent directory node index for each node.
+    u32 *file_indexes;      ///< File node indexes, one per task.
+} U8ExtractContext;
+#endif  /* BACKUP_U8_ARCHIVE */
+
 static U8Node *u8GetChildNodeByName(U8Context *ctx, U8Node *dir_node, u32 *node_idx, const char *name, u8 type);
 
+static U8Node *u8GetNodeByPathHash(U8Context *ctx, const char *path, u8 type, u32 *out_node_idx);
+static bool u8NodeMatchesPath(U8Context *ctx, u32 node_idx, const char *path, u32 path_len);
+
+#ifdef BACKUP_U8_ARCHIVE
+static bool u8BuildPathTable(U8Context *ctx);
+
+static bool u8LoadIndex(void *buf, u32 buf_size, const void *archive_hash, const char *index_path, U8Context *ctx);
+static bool u8SaveIndex(U8Context *ctx, const void *archive_hash, const char *index_path);
+
+static bool u8ExtractFileTask(void *arg, u32 idx);
+#endif  /* BACKUP_U8_ARCHIVE */
+
+/// Hashes a path separator followed by a node name, continuing from the provided hash.
+ALWAYS_INLINE u32 u8HashPathComponent(u32 hash, const char *name, u32 name_len)
+{
+    hash = ((hash ^ (u8)'/') * U8_PATH_HASH_PRIME);
+    for(u32 i = 0; i < name_len; i++) hash = ((hash ^ (u8)name[i]) * U8_PATH_HASH_PRIME);
+    return hash;
+}
+
 bool u8ContextInit(void *buf, u32 buf_size, U8Context *ctx)
 {
-    if (!buf || buf_size <= (u32)sizeof(U8Header) || !ctx)
+    return u8ContextInitPartial(buf, buf_size, buf_size, ctx);
+}
+
+bool u8ContextInitPartial(void *buf, u32 buf_size, u32 archive_size, U8Context *ctx)
+{
+    if (!buf || buf_size <= (u32)sizeof(U8Header) || archive_size < buf_size || !ctx)
     {
         ERROR_MSG("Invalid parameters!");
         return false;
@@ -38,21 +98,31 @@ bool u8ContextInit(void *buf, u32 buf_size, U8Context *ctx)
     U8Node root_node = {0}, *nodes = NULL;
     u32 node_count = 0, node_section_size = 0, str_table_size = 0;
     char *str_table = NULL;
+    u64 start_time = profilerSpanBegin();
     bool success = false;
 
     /* Read U8 header. */
     memcpy(&u8_header, u8_buf, sizeof(U8Header));
+    utilsSwapBigEndianWords(&u8_header, sizeof(U8Header) / sizeof(u32));
 
     /* Check header fields. */
     if (u8_header.magic != U8_MAGIC || u8_header.root_node_offset <= (u32)sizeof(U8Header) || u8_header.node_info_block_size <= (u32)sizeof(U8Node) || \
-        u8_header.data_offset != ALIGN_UP(u8_header.root_node_offset + u8_header.node_info_block_size, 0x40) || u8_header.data_offset >= buf_size)
+        u8_header.data_offset != ALIGN_UP(u8_header.root_node_offset + u8_header.node_info_block_size, 0x40) || u8_header.data_offset >= archive_size)
     {
         ERROR_MSG("Invalid U8 header!");
         return false;
     }
 
+    /* Make sure the whole node info block is available. */
+    if ((u8_header.root_node_offset + u8_header.node_info_block_size) > buf_size)
+    {
+        ERROR_MSG("U8 node info block exceeds provided buffer size!");
+        return false;
+    }
+
     /* Read root U8 node. */
     memcpy(&root_node, u8_buf + u8_header.root_node_offset, sizeof(U8Node));
+    utilsSwapBigEndianWords(&root_node, sizeof(U8Node) / sizeof(u32));
 
     /* Validate root U8 node. */
     if (root_node.type != U8NodeType_Directory || root_node.name_offset != 0 || root_node.data_offset != 0 || root_node.size <= 1)
@@ -88,6 +158,7 @@ bool u8ContextInit(void *buf, u32 buf_size, U8Context *ctx)
 
     /* Read all U8 nodes. */
     memcpy(nodes, u8_buf + u8_header.root_node_offset, node_count * sizeof(U8Node));
+    utilsSwapBigEndianWords(nodes, (node_count * sizeof(U8Node)) / sizeof(u32));
 
     /* Allocate memory for the U8 string table. */
     str_table = (char*)utilsAllocateMemory(str_table_size * sizeof(char));
@@ -128,12 +199,12 @@ bool u8ContextInit(void *buf, u32 buf_size, U8Context *ctx)
         }
 
         /* Check data offset. */
-        /* Files: check if the data offset is lower than the data offset from the U8 header, or greater than our buffer size. */
+        /* Files: check if the data offset is lower than the data offset from the U8 header, or greater than the U8 archive size. */
         /* Directories: check if the data offset is equal to or greater than the node count. */
 
         /* Note: don't check if the node pointed to by the data offset field in directory nodes actually *is* a directory node. */
         /* Some custom tools don't set proper data offset values for directory nodes. */
-        if ((cur_node->type == U8NodeType_File && (cur_node->data_offset < u8_header.data_offset || cur_node->data_offset >= buf_size)) || \
+        if ((cur_node->type == U8NodeType_File && (cur_node->data_offset < u8_header.data_offset || cur_node->data_offset >= archive_size)) || \
             (cur_node->type == U8NodeType_Directory && cur_node->data_offset >= node_count))
         {
             ERROR_MSG("Invalid data offset for U8 node #%u! (0x%X).", node_number, cur_node->data_offset);
@@ -141,11 +212,11 @@ bool u8ContextInit(void *buf, u32 buf_size, U8Context *ctx)
         }
 
         /* Check size. */
-        /* Files: check if the size doesn't exceed our buffer size. */
+        /* Files: check if the size doesn't exceed the U8 archive size. */
         /* Directories: check if size value points to a node number *lower* than this directory's node number, or if it exceeds the total node count. */
 
         /* Note: we could be dealing with an empty directory, so don't check if the size value is equal to this directory's node number. */
-        if ((cur_node->type == U8NodeType_File && (cur_node->data_offset + cur_node->size) > buf_size) || \
+        if ((cur_node->type == U8NodeType_File && (cur_node->data_offset + cur_node->size) > archive_size) || \
             (cur_node->type == U8NodeType_Directory && (cur_node->size < node_number || cur_node->size > node_count)))
         {
             ERROR_MSG("Invalid size for U8 node #%u! (0x%X).", node_number, cur_node->size);
@@ -155,28 +226,66 @@ bool u8ContextInit(void *buf, u32 buf_size, U8Context *ctx)
 
     /* Update output context. */
     ctx->u8_buf = u8_buf;
+    ctx->u8_buf_size = buf_size;
+    ctx->dirty_offset = buf_size;
     memcpy(&(ctx->u8_header), &u8_header, sizeof(U8Header));
     ctx->node_count = node_count;
     ctx->nodes = nodes;
     ctx->str_table = str_table;
+    ctx->str_table_size = str_table_size;
+    ctx->parent_indexes = NULL;
+    ctx->path_table = NULL;
+    ctx->path_table_size = 0;
 
     success = true;
 
+    profilerSpanEnd(ProfilerPhase_U8Parse, start_time, u8_header.node_info_block_size);
+
 out:
     if (!success)
     {
-        if (str_table) free(str_table);
-        if (nodes) free(nodes);
+        if (str_table) utilsFreeMemory(str_table);
+        if (nodes) utilsFreeMemory(nodes);
     }
 
     return success;
 }
 
+#ifdef BACKUP_U8_ARCHIVE
+bool u8ContextInitWithIndex(void *buf, u32 buf_size, const void *archive_hash, const char *index_path, U8Context *ctx)
+{
+    if (!buf || buf_size <= (u32)sizeof(U8Header) || !archive_hash || !index_path || !*index_path || !ctx)
+    {
+        ERROR_MSG("Invalid parameters!");
+        return false;
+    }
+
+    /* Try to load an existing U8 index first. */
+    if (u8LoadIndex(buf, buf_size, archive_hash, index_path, ctx)) return true;
+
+    /* Fully parse the U8 archive. */
+    if (!u8ContextInit(buf, buf_size, ctx)) return false;
+
+    if (!u8BuildPathTable(ctx))
+    {
+        u8ContextFree(ctx);
+        return false;
+    }
+
+    /* Save a new U8 index. Failing to do so isn't fatal. */
+    u8SaveIndex(ctx, archive_hash, index_path);
+
+    return true;
+}
+#endif  /* BACKUP_U8_ARCHIVE */
+
 void u8ContextFree(U8Context *ctx)
 {
     if (!ctx) return;
-    if (ctx->nodes) free(ctx->nodes);
-    if (ctx->str_table) free(ctx->str_table);
+    if (ctx->nodes) utilsFreeMemory(ctx->nodes);
+    if (ctx->str_table) utilsFreeMemory(ctx->str_table);
+    if (ctx->parent_indexes) utilsFreeMemory(ctx->parent_indexes);
+    if (ctx->path_table) utilsFreeMemory(ctx->path_table);
     memset(ctx, 0, sizeof(U8Context));
 }
 
@@ -200,8 +309,15 @@ U8Node *u8GetDirectoryNodeByPath(U8Context *ctx, const char *path, u32 *out_node
         return dir_node;
     }
 
+    /* Use the path table, if available. */
+    if (ctx->path_table)
+    {
+        if (!(dir_node = u8GetNodeByPathHash(ctx, path, U8NodeType_Directory, out_node_idx))) ERROR_MSG("Failed to retrieve directory node by path!");
+        return dir_node;
+    }
+
     /* Duplicate path to avoid problems with strtok(). */
-    if (!(path_dup = strdup(path)))
+    if (!(path_dup = utilsDuplicateString(path)))
     {
         ERROR_MSG("Unable to duplicate input path!");
         return NULL;
@@ -229,7 +345,7 @@ U8Node *u8GetDirectoryNodeByPath(U8Context *ctx, const char *path, u32 *out_node
     *out_node_idx = node_idx;
 
 out:
-    if (path_dup) free(path_dup);
+    if (path_dup) utilsFreeMemory(path_dup);
 
     return dir_node;
 }
@@ -247,8 +363,15 @@ U8Node *u8GetFileNodeByPath(U8Context *ctx, const char *path, u32 *out_node_idx)
         return NULL;
     }
 
+    /* Use the path table, if available. */
+    if (ctx->path_table)
+    {
+        if (!(file_node = u8GetNodeByPathHash(ctx, path, U8NodeType_File, out_node_idx))) ERROR_MSG("Failed to retrieve file node by path!");
+        return file_node;
+    }
+
     /* Duplicate path. */
-    if (!(path_dup = strdup(path)))
+    if (!(path_dup = utilsDuplicateString(path)))
     {
         ERROR_MSG("Unable to duplicate input path!");
         return NULL;
@@ -289,7 +412,7 @@ U8Node *u8GetFileNodeByPath(U8Context *ctx, const char *path, u32 *out_node_idx)
     *out_node_idx = node_idx;
 
 out:
-    if (path_dup) free(path_dup);
+    if (path_dup) utilsFreeMemory(path_dup);
 
     return file_node;
 }
@@ -310,6 +433,13 @@ u8 *u8LoadFileData(U8Context *ctx, u32 file_node_idx, u32 *out_size)
         return NULL;
     }
 
+    /* Make sure file data is available in our buffer. */
+    if ((file_node->data_offset + file_node->size) > ctx->u8_buf_size)
+    {
+        ERROR_MSG("U8 file node data isn't available!");
+        return NULL;
+    }
+
     /* Allocate memory for the file buffer. */
     u8 *buf = (u8*)utilsAllocateMemory(file_node->size);
     if (!buf)
@@ -325,6 +455,24 @@ u8 *u8LoadFileData(U8Context *ctx, u32 file_node_idx, u32 *out_size)
     return buf;
 }
 
+u32 u8GetFileDataCapacity(U8Context *ctx, u32 file_node_idx)
+{
+    if (!ctx || !ctx->u8_buf || !ctx->u8_buf_size || !ctx->nodes || file_node_idx >= ctx->node_count || ctx->nodes[file_node_idx].type != U8NodeType_File) return 0;
+
+    U8Node *file_node = &(ctx->nodes[file_node_idx]);
+    u32 data_end = ctx->u8_buf_size;
+
+    /* Look for the closest file data block placed after this one. */
+    for(u32 i = 1; i < ctx->node_count; i++)
+    {
+        U8Node *cur_node = &(ctx->nodes[i]);
+        if (i == file_node_idx || cur_node->type != U8NodeType_File || cur_node->data_offset < file_node->data_offset) continue;
+        if (cur_node->data_offset < data_end) data_end = cur_node->data_offset;
+    }
+
+    return (data_end > file_node->data_offset ? (data_end - file_node->data_offset) : 0);
+}
+
 bool u8SaveFileData(U8Context *ctx, u32 file_node_idx, void *buf, u32 size)
 {
     u8 *buf_u8 = NULL;
@@ -344,28 +492,223 @@ bool u8SaveFileData(U8Context *ctx, u32 file_node_idx, void *buf, u32 size)
         return false;
     }
 
+    /* Make sure file data is available in our buffer. */
+    if ((file_node->data_offset + file_node->size) > ctx->u8_buf_size)
+    {
+        ERROR_MSG("U8 file node data isn't available!");
+        return false;
+    }
+
     /* Validate provided file size. */
-    if (size > file_node->size)
+    /* Growing a file node is only possible if the new data fits before the next file data block, since the U8 archive size must not change. */
+    if (size > file_node->size && size > u8GetFileDataCapacity(ctx, file_node_idx))
     {
-        ERROR_MSG("Provided file size exceeds U8 file node data size!");
+        ERROR_MSG("Provided file size exceeds available U8 file node data capacity!");
         return false;
     }
 
     /* Save file data. */
     memcpy(ctx->u8_buf + file_node->data_offset, buf_u8, size);
+    u8MarkModified(ctx, file_node->data_offset);
+
+    /* Clear leftover data, if needed. */
+    if (size < file_node->size) memset(ctx->u8_buf + file_node->data_offset + size, 0, file_node->size - size);
 
     /* Update U8 entry file size, if needed. */
     /* Don't forget to flush the modified U8 node to our parent buffer. */
-    if (size < file_node->size)
+    if (size != file_node->size)
     {
-        memset(ctx->u8_buf + file_node->data_offset + size, 0, file_node->size - size);
+        u32 node_offset = (ctx->u8_header.root_node_offset + (sizeof(U8Node) * file_node_idx));
         file_node->size = size;
-        memcpy(ctx->u8_buf + ctx->u8_header.root_node_offset + (sizeof(U8Node) * file_node_idx), file_node, sizeof(U8Node));
+        memcpy(ctx->u8_buf + node_offset, file_node, sizeof(U8Node));
+        utilsSwapBigEndianWords(ctx->u8_buf + node_offset, sizeof(U8Node) / sizeof(u32));
+        u8MarkModified(ctx, node_offset);
+    }
+
+    return true;
+}
+
+bool u8ResizeFileData(U8Context *ctx, u32 file_node_idx, u32 size)
+{
+    if (!ctx || !ctx->u8_buf || !ctx->u8_header.data_offset || !ctx->nodes || file_node_idx >= ctx->node_count || !size)
+    {
+        ERROR_MSG("Invalid parameters!");
+        return false;
+    }
+
+    /* Get U8 file node. */
+    U8Node *file_node = &(ctx->nodes[file_node_idx]);
+    if (file_node->type != U8NodeType_File || !file_node->size)
+    {
+        ERROR_MSG("Invalid U8 file node!");
+        return false;
+    }
+
+    /* Make sure file data is available in our buffer. */
+    if ((file_node->data_offset + file_node->size) > ctx->u8_buf_size)
+    {
+        ERROR_MSG("U8 file node data isn't available!");
+        return false;
     }
 
+    if (size == file_node->size) return true;
+
+    if (size > file_node->size)
+    {
+        /* Growing a file node is only possible if the new data fits before the next file data block, since the U8 archive size must not change. */
+        if (size > u8GetFileDataCapacity(ctx, file_node_idx))
+        {
+            ERROR_MSG("Provided file size exceeds available U8 file node data capacity!");
+            return false;
+        }
+
+        memset(ctx->u8_buf + file_node->data_offset + file_node->size, 0, size - file_node->size);
+    } else {
+        /* Clear leftover data. */
+        memset(ctx->u8_buf + file_node->data_offset + size, 0, file_node->size - size);
+    }
+
+    /* Update U8 entry file size and flush the modified U8 node to our parent buffer. */
+    u32 node_offset = (ctx->u8_header.root_node_offset + (sizeof(U8Node) * file_node_idx));
+    file_node->size = size;
+    memcpy(ctx->u8_buf + node_offset, file_node, sizeof(U8Node));
+    utilsSwapBigEndianWords(ctx->u8_buf + node_offset, sizeof(U8Node) / sizeof(u32));
+    u8MarkModified(ctx, node_offset);
+
     return true;
 }
 
+#ifdef BACKUP_U8_ARCHIVE
+bool u8ExtractArchiveToMountedDevice(U8Context *ctx, const char *out_path, u32 *out_file_count, u64 *out_data_size)
+{
+    if (!ctx || !ctx->u8_buf || !ctx->nodes || !ctx->str_table || !out_path || !*out_path || !out_file_count || !out_data_size)
+    {
+        ERROR_MSG("Invalid parameters!");
+        return false;
+    }
+
+    char path[U8_MAX_EXTRACT_PATH] = {0};
+    u32 path_len = 0, dir_end[U8_MAX_DIR_DEPTH] = {0}, dir_idx[U8_MAX_DIR_DEPTH] = {0}, dir_path_len[U8_MAX_DIR_DEPTH] = {0}, depth = 0;
+    u32 file_count = 0;
+    u64 data_size = 0, free_space = 0;
+    U8ExtractContext extract_ctx = { .ctx = ctx };
+    bool success = false;
+
+    /* Calculate the combined size of all file nodes, and make sure it fits in the target device. */
+    /* This lets us avoid a statvfs() call per written file. */
+    for(u32 i = 1; i < ctx->node_count; i++)
+    {
+        if (ctx->nodes[i].type == U8NodeType_File) data_size += ctx->nodes[i].size;
+    }
+
+    if (!utilsGetFileSystemStatsByPath(out_path, NULL, &free_space))
+    {
+        ERROR_MSG("Failed to retrieve free FS space!");
+        return false;
+    }
+
+    if (free_space < data_size)
+    {
+        ERROR_MSG("Not enough free space available! Required 0x%llX, available 0x%llX.", data_size, free_space);
+        return false;
+    }
+
+    /* Copy output path, removing any trailing slashes. */
+    path_len = (u32)snprintf(path, sizeof(path), "%s", out_path);
+    if (path_len >= sizeof(path))
+    {
+        ERROR_MSG("Output path is too long!");
+        return false;
+    }
+
+    while(path_len > 1 && path[path_len - 1] == '/') path[--path_len] = '\0';
+
+    extract_ctx.out_path = utilsDuplicateString(path);
+    extract_ctx.parents = (u32*)utilsAllocateMemory(ctx->node_count * sizeof(u32));
+    extract_ctx.file_indexes = (u32*)utilsAllocateMemory(ctx->node_count * sizeof(u32));
+    if (!extract_ctx.out_path || !extract_ctx.parents || !extract_ctx.file_indexes)
+    {
+        ERROR_MSG("Error allocating memory for U8 extraction!");
+        goto out;
+    }
+
+    /* Create output directory. */
+    mkdir(path, 0777);
+
+    /* The root directory spans the whole node table. */
+    dir_end[0] = ctx->nodes[0].size;
+    dir_path_len[0] = path_len;
+
+    /* U8 nodes are stored in depth-first order, so a single pass over the node table is enough to rebuild the whole directory tree. */
+    /* File nodes are only validated and queued here. Their data is written afterwards by the task pool, since all directories exist by then. */
+    for(u32 i = 1; i < ctx->node_count; i++)
+    {
+        U8Node *cur_node = &(ctx->nodes[i]);
+        const char *name = (ctx->str_table + cur_node->name_offset);
+        int res = 0;
+
+        /* Leave any directories we're already done with. */
+        while(depth > 0 && i >= dir_end[depth]) depth--;
+
+        /* Don't let crafted archives write outside of the output directory. */
+        if (strchr(name, '/') || !strcmp(name, ".") || !strcmp(name, ".."))
+        {
+            ERROR_MSG("Invalid name for U8 node #%u! (\"%s\").", i + 1, name);
+            goto out;
+        }
+
+        /* Generate output path for the current node. */
+        path_len = dir_path_len[depth];
+        res = snprintf(path + path_len, sizeof(path) - path_len, "/%s", name);
+        if (res < 0 || (u32)res >= (sizeof(path) - path_len))
+        {
+            ERROR_MSG("Output path for U8 node #%u is too long!", i + 1);
+            goto out;
+        }
+
+        path_len += (u32)res;
+        extract_ctx.parents[i] = dir_idx[depth];
+
+        if (cur_node->type == U8NodeType_Directory)
+        {
+            if ((depth + 1) >= U8_MAX_DIR_DEPTH)
+            {
+                ERROR_MSG("Maximum directory depth exceeded by U8 node #%u!", i + 1);
+                goto out;
+            }
+
+            if (mkdir(path, 0777) != 0 && errno != EEXIST)
+            {
+                ERROR_MSG("mkdir(\"%s\") failed! (%d).", path, errno);
+                goto out;
+            }
+
+            depth++;
+            dir_end[depth] = cur_node->size;
+            dir_idx[depth] = i;
+            dir_path_len[depth] = path_len;
+        } else {
+            extract_ctx.file_indexes[file_count++] = i;
+        }
+    }
+
+    /* Write file data. */
+    success = taskPoolRun(file_count, u8ExtractFileTask, &extract_ctx);
+    if (success)
+    {
+        *out_file_count = file_count;
+        *out_data_size = data_size;
+    }
+
+out:
+    if (extract_ctx.file_indexes) utilsFreeMemory(extract_ctx.file_indexes);
+    if (extract_ctx.parents) utilsFreeMemory(extract_ctx.parents);
+    if (extract_ctx.out_path) utilsFreeMemory((void*)extract_ctx.out_path);
+
+    return success;
+}
+#endif  /* BACKUP_U8_ARCHIVE */
+
 static U8Node *u8GetChildNodeByName(U8Context *ctx, U8Node *dir_node, u32 *node_idx, const char *name, u8 type)
 {
     if (!ctx || !ctx->nodes || !ctx->str_table || !dir_node || dir_node->type != U8NodeType_Directory || !node_idx || *node_idx >= ctx->node_count || (*node_idx + 1) >= dir_node->size || \
@@ -383,3 +726,329 @@ static U8Node *u8GetChildNodeByName(U8Context *ctx, U8Node *dir_node, u32 *node_
 
     return NULL;
 }
+
+#ifdef BACKUP_U8_ARCHIVE
+static bool u8BuildPathTable(U8Context *ctx)
+{
+    u32 dir_end[U8_MAX_DIR_DEPTH] = {0}, dir_idx[U8_MAX_DIR_DEPTH] = {0}, dir_hash[U8_MAX_DIR_DEPTH] = {0}, depth = 0;
+    u32 path_table_size = 1, mask = 0;
+    u32 *parent_indexes = NULL;
+    U8PathTableEntry *path_table = NULL;
+    u64 start_time = profilerSpanBegin();
+
+    /* Keep the load factor at or below 50%, so that probe sequences stay short. */
+    while(path_table_size < (ctx->node_count * 2)) path_table_size <<= 1;
+    mask = (path_table_size - 1);
+
+    parent_indexes = (u32*)utilsAllocateMemory(ctx->node_count * sizeof(u32));
+    path_table = (U8PathTableEntry*)utilsAllocateMemory(path_table_size * sizeof(U8PathTableEntry));
+    if (!parent_indexes || !path_table)
+    {
+        ERROR_MSG("Error allocating memory for U8 path table!");
+        goto fail;
+    }
+
+    dir_end[0] = ctx->node_count;
+    dir_hash[0] = U8_PATH_HASH_SEED;
+
+    /* Nodes are stored in depth-first order, so a stack with the directories we're in is enough to calculate full path hashes in a single pass. */
+    for(u32 i = 1; i < ctx->node_count; i++)
+    {
+        U8Node *cur_node = &(ctx->nodes[i]);
+        const char *name = (ctx->str_table + cur_node->name_offset);
+        u32 hash = 0, pos = 0;
+
+        /* Leave any directories we're done with. */
+        while(depth && i >= dir_end[depth]) depth--;
+
+        parent_indexes[i] = dir_idx[depth];
+        hash = u8HashPathComponent(dir_hash[depth], name, strnlen(name, ctx->str_table_size - cur_node->name_offset));
+
+        for(pos = (hash & mask); path_table[pos].node_idx; pos = ((pos + 1) & mask));
+        path_table[pos].hash = hash;
+        path_table[pos].node_idx = i;
+
+        if (cur_node->type != U8NodeType_Directory) continue;
+
+        if ((depth + 1) >= U8_MAX_DIR_DEPTH)
+        {
+            ERROR_MSG("U8 directory depth limit exceeded!");
+            goto fail;
+        }
+
+        depth++;
+        dir_end[depth] = cur_node->size;
+        dir_idx[depth] = i;
+        dir_hash[depth] = hash;
+    }
+
+    ctx->parent_indexes = parent_indexes;
+    ctx->path_table = path_table;
+    ctx->path_table_size = path_table_size;
+
+    profilerSpanEnd(ProfilerPhase_U8Parse, start_time, ctx->node_count * sizeof(U8Node));
+
+    return true;
+
+fail:
+    if (path_table) utilsFreeMemory(path_table);
+    if (parent_indexes) utilsFreeMemory(parent_indexes);
+
+    return false;
+}
+#endif  /* BACKUP_U8_ARCHIVE */
+
+static U8Node *u8GetNodeByPathHash(U8Context *ctx, const char *path, u8 type, u32 *out_node_idx)
+{
+    u32 path_len = strlen(path), hash = U8_PATH_HASH_SEED, component_count = 0, mask = (ctx->path_table_size - 1);
+
+    /* Hash all path components. Repeated and trailing slashes are ignored. */
+    for(const char *pch = path; *pch;)
+    {
+        u32 len = 0;
+
+        while(*pch == '/') pch++;
+        if (!*pch) break;
+
+        len = (u32)strcspn(pch, "/");
+        hash = u8HashPathComponent(hash, pch, len);
+        pch += len;
+
+        component_count++;
+    }
+
+    /* Check if the root directory was requested. */
+    if (!component_count)
+    {
+        if (type != U8NodeType_Directory) return NULL;
+        *out_node_idx = 0;
+        return &(ctx->nodes[0]);
+    }
+
+    /* The path table is never full, so there's always an empty entry to stop at. */
+    for(u32 i = (hash & mask); ctx->path_table[i].node_idx; i = ((i + 1) & mask))
+    {
+        U8PathTableEntry *entry = &(ctx->path_table[i]);
+
+        if (entry->hash != hash || ctx->nodes[entry->node_idx].type != type || !u8NodeMatchesPath(ctx, entry->node_idx, path, path_len)) continue;
+
+        *out_node_idx = entry->node_idx;
+        return &(ctx->nodes[entry->node_idx]);
+    }
+
+    return NULL;
+}
+
+static bool u8NodeMatchesPath(U8Context *ctx, u32 node_idx, const char *path, u32 path_len)
+{
+    u32 end = path_len;
+
+    /* Compare node names against path components, from the last one to the first one. */
+    while(node_idx)
+    {
+        U8Node *cur_node = &(ctx->nodes[node_idx]);
+        const char *name = (ctx->str_table + cur_node->name_offset);
+        u32 name_len = strnlen(name, ctx->str_table_size - cur_node->name_offset);
+
+        while(end && path[end - 1] == '/') end--;
+
+        if (end < (name_len + 1) || path[end - name_len - 1] != '/' || strncmp(path + end - name_len, name, name_len) != 0) return false;
+
+        end -= name_len;
+        node_idx = ctx->parent_indexes[node_idx];
+    }
+
+    while(end && path[end - 1] == '/') end--;
+
+    return !end;
+}
+
+#ifdef BACKUP_U8_ARCHIVE
+static bool u8LoadIndex(void *buf, u32 buf_size, const void *archive_hash, const char *index_path, U8Context *ctx)
+{
+    struct stat st = {0};
+    u8 *index = NULL, *index_data = NULL;
+    u32 index_size = 0, nodes_size = 0, parent_indexes_size = 0, path_table_size = 0;
+    U8IndexHeader header = {0};
+    U8Header u8_header = {0};
+    u8 data_hash[SHA1_HASH_SIZE] = {0};
+
+    U8Node *nodes = NULL;
+    char *str_table = NULL;
+    u32 *parent_indexes = NULL;
+    U8PathTableEntry *path_table = NULL;
+
+    u64 start_time = 0;
+    bool success = false;
+
+    /* Don't bother if there's no U8 index. */
+    if (stat(index_path, &st) != 0 || (u32)st.st_size <= (u32)sizeof(U8IndexHeader)) return false;
+
+    start_time = profilerSpanBegin();
+
+    index = (u8*)utilsReadFileFromMountedDevice(index_path, &index_size);
+    if (!index || index_size <= (u32)sizeof(U8IndexHeader)) goto out;
+
+    memcpy(&header, index, sizeof(U8IndexHeader));
+    index_data = (index + sizeof(U8IndexHeader));
+
+    /* The U8 index holds a native byte order copy of the U8 header. */
+    memcpy(&u8_header, buf, sizeof(U8Header));
+    utilsSwapBigEndianWords(&u8_header, sizeof(U8Header) / sizeof(u32));
+
+    /* Stale U8 indexes are silently discarded. */
+    /* Nodes must fit within the U8 archive, and the path table load factor is fixed, which keeps all size calculations from overflowing. */
+    if (header.magic != U8_INDEX_MAGIC || header.version != U8_INDEX_VERSION || memcmp(header.archive_hash, archive_hash, SHA1_HASH_SIZE) != 0 || \
+        header.archive_size != buf_size || memcmp(&(header.u8_header), &u8_header, sizeof(U8Header)) != 0 || header.node_count <= 1 || \
+        header.node_count > (buf_size / sizeof(U8Node)) || !header.str_table_size || header.str_table_size >= header.u8_header.node_info_block_size || \
+        header.path_table_size < (header.node_count * 2) || header.path_table_size >= (header.node_count * 4) || \
+        (header.path_table_size & (header.path_table_size - 1)) != 0) goto out;
+
+    nodes_size = (header.node_count * sizeof(U8Node));
+    parent_indexes_size = (header.node_count * sizeof(u32));
+    path_table_size = (header.path_table_size * sizeof(U8PathTableEntry));
+
+    if (index_size != ((u32)sizeof(U8IndexHeader) + nodes_size + parent_indexes_size + path_table_size + header.str_table_size)) goto out;
+
+    /* Verify U8 index data. */
+    if (!sha1CalculateHash(index_data, index_size - sizeof(U8IndexHeader), data_hash) || memcmp(data_hash, header.data_hash, SHA1_HASH_SIZE) != 0)
+    {
+        ERROR_MSG("U8 index checksum mismatch!");
+        goto out;
+    }
+
+    nodes = (U8Node*)utilsAllocateMemory(nodes_size);
+    parent_indexes = (u32*)utilsAllocateMemory(parent_indexes_size);
+    path_table = (U8PathTableEntry*)utilsAllocateMemory(path_table_size);
+    str_table = (char*)utilsAllocateMemory(header.str_table_size);
+    if (!nodes || !parent_indexes || !path_table || !str_table)
+    {
+        ERROR_MSG("Error allocating memory for U8 index!");
+        goto out;
+    }
+
+    memcpy(nodes, index_data, nodes_size);
+    memcpy(parent_indexes, index_data + nodes_size, parent_indexes_size);
+    memcpy(path_table, index_data + nodes_size + parent_indexes_size, path_table_size);
+    memcpy(str_table, index_data + nodes_size + parent_indexes_size + path_table_size, header.str_table_size);
+
+    /* Make sure path lookups can't go out of bounds. Parent directories always come before their children. */
+    for(u32 i = 1; i < header.node_count; i++)
+    {
+        if (parent_indexes[i] >= i || nodes[i].name_offset >= header.str_table_size) goto out;
+    }
+
+    for(u32 i = 0; i < header.path_table_size; i++)
+    {
+        if (path_table[i].node_idx >= header.node_count) goto out;
+    }
+
+    /* Update output context. */
+    ctx->u8_buf = (u8*)buf;
+    ctx->u8_buf_size = buf_size;
+    ctx->dirty_offset = buf_size;
+    memcpy(&(ctx->u8_header), &(header.u8_header), sizeof(U8Header));
+    ctx->node_count = header.node_count;
+    ctx->nodes = nodes;
+    ctx->str_table = str_table;
+    ctx->str_table_size = header.str_table_size;
+    ctx->parent_indexes = parent_indexes;
+    ctx->path_table = path_table;
+    ctx->path_table_size = header.path_table_size;
+
+    success = true;
+
+    profilerSpanEnd(ProfilerPhase_U8Parse, start_time, index_size);
+
+out:
+    if (!success)
+    {
+        if (str_table) utilsFreeMemory(str_table);
+        if (path_table) utilsFreeMemory(path_table);
+        if (parent_indexes) utilsFreeMemory(parent_indexes);
+        if (nodes) utilsFreeMemory(nodes);
+    }
+
+    if (index) utilsFreeMemory(index);
+
+    return success;
+}
+
+static bool u8SaveIndex(U8Context *ctx, const void *archive_hash, const char *index_path)
+{
+    u8 *index = NULL, *index_data = NULL;
+    u32 index_size = 0, nodes_size = (ctx->node_count * sizeof(U8Node)), parent_indexes_size = (ctx->node_count * sizeof(u32));
+    u32 path_table_size = (ctx->path_table_size * sizeof(U8PathTableEntry));
+    U8IndexHeader *header = NULL;
+    char dir_path[U8_MAX_EXTRACT_PATH] = {0}, *pch = NULL;
+    bool success = false;
+
+    index_size = ((u32)sizeof(U8IndexHeader) + nodes_size + parent_indexes_size + path_table_size + ctx->str_table_size);
+
+    index = (u8*)utilsAllocateMemory(index_size);
+    if (!index)
+    {
+        ERROR_MSG("Error allocating memory for U8 index!");
+        return false;
+    }
+
+    header = (U8IndexHeader*)index;
+    index_data = (index + sizeof(U8IndexHeader));
+
+    memcpy(index_data, ctx->nodes, nodes_size);
+    memcpy(index_data + nodes_size, ctx->parent_indexes, parent_indexes_size);
+    memcpy(index_data + nodes_size + parent_indexes_size, ctx->path_table, path_table_size);
+    memcpy(index_data + nodes_size + parent_indexes_size + path_table_size, ctx->str_table, ctx->str_table_size);
+
+    header->magic = U8_INDEX_MAGIC;
+    header->version = U8_INDEX_VERSION;
+    memcpy(header->archive_hash, archive_hash, SHA1_HASH_SIZE);
+    memcpy(&(header->u8_header), &(ctx->u8_header), sizeof(U8Header));
+    header->archive_size = ctx->u8_buf_size;
+    header->node_count = ctx->node_count;
+    header->str_table_size = ctx->str_table_size;
+    header->path_table_size = ctx->path_table_size;
+
+    if (!sha1CalculateHash(index_data, index_size - sizeof(U8IndexHeader), header->data_hash)) goto out;
+
+    /* Create output directory. */
+    snprintf(dir_path, sizeof(dir_path), "%s", index_path);
+    if ((pch = strrchr(dir_path, '/')))
+    {
+        *pch = '\0';
+        mkdir(dir_path, 0777);
+    }
+
+    success = utilsWriteFileToMountedDevice(index_path, index, index_size, true);
+    if (!success) ERROR_MSG("Failed to write U8 index!");
+
+out:
+    utilsFreeMemory(index);
+
+    return success;
+}
+
+static bool u8ExtractFileTask(void *arg, u32 idx)
+{
+    U8ExtractContext *extract_ctx = (U8ExtractContext*)arg;
+    U8Context *ctx = extract_ctx->ctx;
+    u32 file_node_idx = extract_ctx->file_indexes[idx], chain[U8_MAX_DIR_DEPTH] = {0}, chain_len = 0, path_len = 0;
+    U8Node *file_node = &(ctx->nodes[file_node_idx]);
+    char path[U8_MAX_EXTRACT_PATH] = {0};
+
+    /* Walk up to the root node. Path lengths and directory depths have already been validated. */
+    for(u32 node_idx = file_node_idx; node_idx && chain_len < U8_MAX_DIR_DEPTH; node_idx = extract_ctx->parents[node_idx]) chain[chain_len++] = node_idx;
+
+    path_len = (u32)snprintf(path, sizeof(path), "%s", extract_ctx->out_path);
+    while(chain_len--) path_len += (u32)snprintf(path + path_len, sizeof(path) - path_len, "/%s", ctx->str_table + ctx->nodes[chain[chain_len]].name_offset);
+
+    /* Write file data straight from the U8 archive buffer. */
+    if (!utilsWriteFileToMountedDevice(path, ctx->u8_buf + file_node->data_offset, file_node->size, false))
+    {
+        ERROR_MSG("Failed to write U8 node #%u to \"%s\"!", file_node_idx + 1, path);
+        return false;
+    }
+
+    return true;
+}
+#endif  /* BACKUP_U8_ARCHIVE */
@@ -23,7 +23,11 @@
 #ifndef __U8_H__
 #define __U8_H__
 
-#define U8_MAGIC    (u32)0x55AA382D /* "U.8-". */
+#define U8_MAGIC            (u32)0x55AA382D /* "U.8-". */
+
+#define U8_INDEX_PATH       "sd:/" APP_TITLE "/u8index.bin"
+#define U8_INDEX_MAGIC      (u32)0x55384958 /* "U8IX". */
+#define U8_INDEX_VERSION    1
 
 typedef struct {
     u32 magic;                  ///< U8_MAGIC.
@@ -39,10 +43,17 @@ typedef enum {
     U8NodeType_Directory = 1
 } U8NodeType;
 
+/// U8 archives store nodes in big-endian byte order. Node tables copied from a U8 archive must be converted with utilsSwapBigEndianWords() before using them.
+/// Bitfield order is reversed on little-endian hosts, so that the node type is always held in the most significant byte from the first word.
 typedef struct {
     struct {
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+        u32 name_offset : 24;   ///< Offset to node name. Relative to the start of the string table.
+        u32 type        : 8;    ///< U8NodeType.
+#else
         u32 type        : 8;    ///< U8NodeType.
         u32 name_offset : 24;   ///< Offset to node name. Relative to the start of the string table.
+#endif
     };
     u32 data_offset;            ///< Files: offset to file data (relative to the start of the U8 header). Directories: parent dir node index (0-based).
     u32 size;                   ///< Files: data size. Directories: node number from the last file inside this directory (root node is number 1).
@@ -50,17 +61,42 @@ typedef struct {
 
 SIZE_ASSERT(U8Node, 0xC);
 
+/// Path table entry. Path hashes are calculated over full node paths (e.g. "/dir/file"), without trailing slashes.
+typedef struct {
+    u32 hash;                   ///< FNV-1a hash of the full node path.
+    u32 node_idx;               ///< Node index. Zero if this entry is empty, since the root node is never added to the path table.
+} U8PathTableEntry;
+
+SIZE_ASSERT(U8PathTableEntry, 0x8);
+
 typedef struct {
     u8 *u8_buf;
+    u32 u8_buf_size;
     U8Header u8_header;
     u32 node_count;
     U8Node *nodes;
     char *str_table;
+    u32 str_table_size;
+    u32 *parent_indexes;            ///< Parent directory node index for each node. NULL if the path table isn't available.
+    U8PathTableEntry *path_table;   ///< Open addressing hash table used for path lookups. NULL if unavailable.
+    u32 path_table_size;            ///< Number of path table entries. Always a power of two.
+    u32 dirty_offset;               ///< Lowest modified offset within the U8 archive buffer. Equal to u8_buf_size if nothing has been modified.
 } U8Context;
 
 /// Initializes a U8 context.
 bool u8ContextInit(void *buf, u32 buf_size, U8Context *ctx);
 
+/// Initializes a U8 context using a buffer that only holds the first part of a U8 archive, which must at least span up to the data offset from the U8 header.
+/// Useful to look up nodes without loading the whole U8 archive. File data can only be loaded if it's available within the provided buffer.
+bool u8ContextInitPartial(void *buf, u32 buf_size, u32 archive_size, U8Context *ctx);
+
+#ifdef BACKUP_U8_ARCHIVE
+/// Initializes a U8 context using a serialized U8 index stored at index_path, as long as it was generated for a U8 archive with the provided SHA-1 checksum.
+/// This skips node validation and path table generation altogether. If the U8 index is missing or stale, the U8 archive is fully parsed, and a new U8 index is saved.
+/// Path lookups made through the initialized context use the path table in both cases.
+bool u8ContextInitWithIndex(void *buf, u32 buf_size, const void *archive_hash, const char *index_path, U8Context *ctx);
+#endif  /* BACKUP_U8_ARCHIVE */
+
 /// Frees a U8 context.
 void u8ContextFree(U8Context *ctx);
 
@@ -76,9 +112,31 @@ U8Node *u8GetFileNodeByPath(U8Context *ctx, const char *path, u32 *out_node_idx)
 /// The returned pointer must be freed by the user.
 u8 *u8LoadFileData(U8Context *ctx, u32 file_node_idx, u32 *out_size);
 
+/// Returns the maximum amount of data that can be stored in a U8 file node without relocating any other data within the U8 archive.
+/// This includes any padding between the current file data and the next file data block (or the end of the U8 archive).
+u32 u8GetFileDataCapacity(U8Context *ctx, u32 file_node_idx);
+
 /// Saves file data into a U8 archive loaded into memory.
+/// The provided size may exceed the current file node size, as long as it doesn't exceed the value returned by u8GetFileDataCapacity().
 bool u8SaveFileData(U8Context *ctx, u32 file_node_idx, void *buf, u32 size);
 
+/// Changes the size of a U8 file node within a U8 archive loaded into memory, leaving its current data in place. Useful to modify file data in place.
+/// Growing a file node zero-fills the new area, and is only possible up to the value returned by u8GetFileDataCapacity(). Shrinking a file node clears leftover data.
+bool u8ResizeFileData(U8Context *ctx, u32 file_node_idx, u32 size);
+
+#ifdef BACKUP_U8_ARCHIVE
+/// Extracts the full contents of a U8 archive to the provided directory within a mounted device, recreating its directory structure.
+/// File data is written straight from the U8 archive buffer. Directories are created first, then files are written using the task pool (see taskpool.h).
+/// The number of extracted files and their combined size are saved to the output pointers.
+bool u8ExtractArchiveToMountedDevice(U8Context *ctx, const char *out_path, u32 *out_file_count, u64 *out_data_size);
+#endif  /* BACKUP_U8_ARCHIVE */
+
+/// Records a modification to the U8 archive buffer at the provided offset. Only needed when writing to the buffer directly.
+ALWAYS_INLINE void u8MarkModified(U8Context *ctx, u32 offset)
+{
+    if (ctx && offset < ctx->dirty_offset) ctx->dirty_offset = offset;
+}
+
 /// Retrieves a U8 node by its offset.
 ALWAYS_INLINE U8Node *u8GetNodeByOffset(U8Context *ctx, u32 offset)
 {
@@ -18,20 +18,42 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <fcntl.h>
 #include <fat.h>
 #include <sdcard/wiisd_io.h>
 
 #include "utils.h"
+#include "sha1.h"
+#include "profiler.h"
+#include "iotrace.h"
 
-#define BC_NAND_TID TITLE_ID(1, 0x200)
+#define BC_NAND_TID                 TITLE_ID(1, 0x200)
+
+#define ISFS_HASH_CHUNK_SIZE        0x40000 /* Must be a multiple of the SHA-1 block size. */
+
+#define ISFS_CLUSTER_SIZE           0x4000  /* NAND FS cluster size. Smaller writes still rewrite a whole cluster. */
+#define ISFS_DIFF_CHUNK_SIZE        0x40000 /* Must be a multiple of ISFS_CLUSTER_SIZE. */
+
+#define SD_MOUNT_THREAD_STACK_SIZE  0x8000
+#define SD_MOUNT_THREAD_PRIORITY    64
+
+typedef struct {
+    volatile bool done;
+    volatile s32 result;
+    lwpq_t queue;
+} UtilsIsfsAsyncRequest;
 
 /* Global variables. */
 
 static void *g_xfb = NULL;
 static GXRModeObj *g_rmode = NULL;
 
-static u64 g_tmdTitleId ATTRIBUTE_ALIGN(32) = 0;
-static u32 g_tmdSize ATTRIBUTE_ALIGN(32) = 0;
+static u32 g_allocationCount = 0;
+static u32 g_allocatedBytes = 0, g_peakAllocatedBytes = 0;
+
+static bool g_padsInitialized = false;
+
+static UtilsIoChunkSizes g_ioChunkSizes = { UTILS_DEFAULT_IO_CHUNK_SIZE, UTILS_DEFAULT_IO_CHUNK_SIZE, UTILS_DEFAULT_IO_CHUNK_SIZE, UTILS_DEFAULT_IO_CHUNK_SIZE };
 
 static s32 g_isfsFd ATTRIBUTE_ALIGN(32) = 0;
 static char g_isfsFilePath[ISFS_MAXPATH] ATTRIBUTE_ALIGN(32) = {0};
@@ -39,6 +61,10 @@ static fstats g_isfsFileStats ATTRIBUTE_ALIGN(32) = {0};
 
 #ifdef BACKUP_U8_ARCHIVE
 static bool g_sdCardMounted = false;
+static lwp_t g_sdCardMountThread = LWP_THREAD_NULL;
+
+static u32 g_mountedDeviceClusterSize = 0;
+static UtilsIoCounters g_mountedDeviceReadCounters = {0}, g_mountedDeviceWriteCounters = {0};
 #endif  /* BACKUP_U8_ARCHIVE */
 
 /* Function prototypes. */
@@ -46,17 +72,96 @@ static bool g_sdCardMounted = false;
 static u32 utilsButtonsDownAll(void);
 static u32 utilsButtonsHeldAll(void);
 
+static u32 utilsValidateIoChunkSize(u32 chunk_size);
+
+static bool utilsRecreateIsfsFile(const char *path);
+
+static s32 utilsIsfsAsyncCallback(s32 result, void *usrdata);
+static s32 utilsWaitForIsfsAsyncRequest(UtilsIsfsAsyncRequest *req);
+
+#ifdef BACKUP_U8_ARCHIVE
+static void *utilsSdCardMountThreadFunc(void *arg);
+
+static u32 utilsGetMountedDeviceChunkSize(u32 chunk_size);
+static void utilsUpdateIoCounters(UtilsIoCounters *counters, u32 size, u64 start_time);
+#endif  /* BACKUP_U8_ARCHIVE */
+
 void *utilsAllocateMemory(size_t size)
 {
     void *ptr = NULL;
     size_t aligned_size = ALIGN_UP(size, 64);
 
     ptr = memalign(64, aligned_size);
-    if (ptr) memset(ptr, 0, aligned_size);
+    if (ptr)
+    {
+        /* Use the real block size, so utilsFreeMemory() can subtract the exact same value. */
+        u32 block_size = (u32)malloc_usable_size(ptr), level = 0;
+
+        memset(ptr, 0, aligned_size);
+
+        /* Allocations may take place on worker threads, so counters are only updated with interrupts disabled. */
+        _CPU_ISR_Disable(level);
+
+        g_allocationCount++;
+
+        g_allocatedBytes += block_size;
+        if (g_allocatedBytes > g_peakAllocatedBytes) g_peakAllocatedBytes = g_allocatedBytes;
+
+        profilerRecordAllocation(block_size, g_allocatedBytes);
+
+        _CPU_ISR_Restore(level);
+    }
 
     return ptr;
 }
 
+void utilsFreeMemory(void *ptr)
+{
+    if (!ptr) return;
+
+    u32 block_size = (u32)malloc_usable_size(ptr), level = 0;
+
+    _CPU_ISR_Disable(level);
+    g_allocatedBytes = (block_size < g_allocatedBytes ? (g_allocatedBytes - block_size) : 0);
+    _CPU_ISR_Restore(level);
+
+    free(ptr);
+}
+
+char *utilsDuplicateString(const char *str)
+{
+    if (!str) return NULL;
+
+    size_t len = strlen(str);
+    char *dup = (char*)utilsAllocateMemory(len + 1);
+    if (dup) memcpy(dup, str, len);
+
+    return dup;
+}
+
+u32 utilsGetAllocationCount(void)
+{
+    return g_allocationCount;
+}
+
+void utilsGetMemoryUsage(u32 *out_current, u32 *out_peak)
+{
+    if (out_current) *out_current = g_allocatedBytes;
+    if (out_peak) *out_peak = g_peakAllocatedBytes;
+}
+
+char *utilsTrimString(char *str)
+{
+    char *end = NULL;
+
+    while(*str == ' ' || *str == '\t' || *str == '\r' || *str == '\n') str++;
+
+    end = (str + strlen(str));
+    while(end > str && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r' || end[-1] == '\n')) *--end = '\0';
+
+    return str;
+}
+
 __attribute__((format(printf, 2, 3))) void utilsPrintErrorMessage(const char *func_name, const char *fmt, ...)
 {
     va_list args;
@@ -89,8 +194,10 @@ void utilsReboot(void)
 
 void utilsInitPads(void)
 {
+    if (g_padsInitialized) return;
     WPAD_Init();
     WPAD_SetDataFormat(WPAD_CHAN_ALL, WPAD_FMT_BTNS_ACC_IR);
+    g_padsInitialized = true;
 }
 
 u32 utilsGetInput(int type)
@@ -214,57 +321,82 @@ void utilsPrintHeadline(void)
     printf(APP_TITLE " v" APP_VERSION " (" GIT_REV ").");
 
     sprintf(ios_info, "IOS%d (v%d)", IOS_GetVersion(), IOS_GetRevision());
-    printf("\x1b[%d;%dH", 0, cols - strlen(ios_info) - 1);
+    printf("\x1b[%d;%dH", 0, (int)(cols - strlen(ios_info) - 1));
     printf(ios_info);
 
     printf("\nBuilt on " BUILD_TIMESTAMP ".\n");
     printf("Made by " APP_AUTHOR ".\n\n");
 }
 
+void utilsSetIoChunkSizes(const UtilsIoChunkSizes *chunk_sizes)
+{
+    if (!chunk_sizes) return;
+
+    g_ioChunkSizes.isfs_read = utilsValidateIoChunkSize(chunk_sizes->isfs_read);
+    g_ioChunkSizes.isfs_write = utilsValidateIoChunkSize(chunk_sizes->isfs_write);
+    g_ioChunkSizes.sd_read = utilsValidateIoChunkSize(chunk_sizes->sd_read);
+    g_ioChunkSizes.sd_write = utilsValidateIoChunkSize(chunk_sizes->sd_write);
+}
+
+void utilsGetIoChunkSizes(UtilsIoChunkSizes *out_chunk_sizes)
+{
+    if (out_chunk_sizes) memcpy(out_chunk_sizes, &g_ioChunkSizes, sizeof(UtilsIoChunkSizes));
+}
+
 signed_blob *utilsGetSignedTMDFromTitle(u64 title_id, u32 *out_size)
 {
     if (!out_size) return NULL;
 
     s32 ret = 0;
     signed_blob *stmd = NULL;
+
+    /* ES request buffers are kept on the stack, so that several TMDs can be retrieved at once from different threads. */
+    u64 tid ATTRIBUTE_ALIGN(32) = title_id;
+    u32 stmd_size ATTRIBUTE_ALIGN(32) = 0;
     bool success = false;
 
-    g_tmdTitleId = title_id;
+    u64 start_time = profilerSpanBegin(), trace_time = 0;
 
-    ret = ES_GetStoredTMDSize(g_tmdTitleId, &g_tmdSize);
+    trace_time = ioTraceBegin();
+    ret = ES_GetStoredTMDSize(tid, &stmd_size);
+    ioTraceRecord(IoTraceOp_EsGetTmdSize, NULL, 0, stmd_size, ret, trace_time);
     if (ret < 0)
     {
-        ERROR_MSG("ES_GetStoredTMDSize failed! (%d) (TID %08X-%08X).", ret, TITLE_UPPER(g_tmdTitleId), TITLE_LOWER(g_tmdTitleId));
+        ERROR_MSG("ES_GetStoredTMDSize failed! (%d) (TID %08X-%08X).", ret, TITLE_UPPER(tid), TITLE_LOWER(tid));
         return NULL;
     }
 
-    stmd = (signed_blob*)utilsAllocateMemory(g_tmdSize);
+    stmd = (signed_blob*)utilsAllocateMemory(stmd_size);
     if (!stmd)
     {
-        ERROR_MSG("Failed to allocate memory for TMD! (TID %08X-%08X).", TITLE_UPPER(g_tmdTitleId), TITLE_LOWER(g_tmdTitleId));
+        ERROR_MSG("Failed to allocate memory for TMD! (TID %08X-%08X).", TITLE_UPPER(tid), TITLE_LOWER(tid));
         return NULL;
     }
 
-    ret = ES_GetStoredTMD(g_tmdTitleId, stmd, g_tmdSize);
+    trace_time = ioTraceBegin();
+    ret = ES_GetStoredTMD(tid, stmd, stmd_size);
+    ioTraceRecord(IoTraceOp_EsGetTmd, NULL, 0, stmd_size, ret, trace_time);
     if (ret < 0)
     {
-        ERROR_MSG("ES_GetStoredTMD failed! (%d) (TID %08X-%08X).", ret, TITLE_UPPER(g_tmdTitleId), TITLE_LOWER(g_tmdTitleId));
+        ERROR_MSG("ES_GetStoredTMD failed! (%d) (TID %08X-%08X).", ret, TITLE_UPPER(tid), TITLE_LOWER(tid));
         goto out;
     }
 
     if (!IS_VALID_SIGNATURE(stmd))
     {
-        ERROR_MSG("Invalid TMD signature! (TID %08X-%08X).", TITLE_UPPER(g_tmdTitleId), TITLE_LOWER(g_tmdTitleId));
+        ERROR_MSG("Invalid TMD signature! (TID %08X-%08X).", TITLE_UPPER(tid), TITLE_LOWER(tid));
         goto out;
     }
 
-    *out_size = g_tmdSize;
+    *out_size = stmd_size;
     success = true;
 
+    profilerSpanEnd(ProfilerPhase_TmdFetch, start_time, stmd_size);
+
 out:
     if (!success && stmd)
     {
-        free(stmd);
+        utilsFreeMemory(stmd);
         stmd = NULL;
     }
 
@@ -277,12 +409,15 @@ void *utilsReadFileFromIsfs(const char *path, u32 *out_size)
 
     s32 ret = 0;
     u8 *buf = NULL;
-    u32 file_size = 0;
+    u32 file_size = 0, chunk_size = g_ioChunkSizes.isfs_read, offset = 0;
+    u64 start_time = 0, trace_time = 0;
     bool success = false;
 
     snprintf(g_isfsFilePath, ISFS_MAXPATH, "%s", path);
 
+    trace_time = ioTraceBegin();
     g_isfsFd = ISFS_Open(g_isfsFilePath, ISFS_OPEN_READ);
+    ioTraceRecord(IoTraceOp_IsfsOpen, g_isfsFilePath, 0, 0, g_isfsFd, trace_time);
     if (g_isfsFd < 0)
     {
         ERROR_MSG("ISFS_Open(\"%s\") failed! (%d).", g_isfsFilePath, g_isfsFd);
@@ -310,20 +445,248 @@ void *utilsReadFileFromIsfs(const char *path, u32 *out_size)
         goto out;
     }
 
-    ret = ISFS_Read(g_isfsFd, buf, file_size);
+    start_time = profilerSpanBegin();
+
+    /* Read data in chunks. The chunk size may have been calibrated for this console. */
+    while(offset < file_size)
+    {
+        u32 cur_size = ((file_size - offset) < chunk_size ? (file_size - offset) : chunk_size);
+
+        trace_time = ioTraceBegin();
+        ret = ISFS_Read(g_isfsFd, buf + offset, cur_size);
+        ioTraceRecord(IoTraceOp_IsfsRead, g_isfsFilePath, offset, cur_size, ret, trace_time);
+        if (ret != (s32)cur_size)
+        {
+            ERROR_MSG("ISFS_Read(\"%s\", 0x%X, 0x%X) failed! (%d).", g_isfsFilePath, offset, cur_size, ret);
+            goto out;
+        }
+
+        offset += cur_size;
+    }
+
+    profilerSpanEnd(ProfilerPhase_IsfsRead, start_time, file_size);
+
+    *out_size = file_size;
+    success = true;
+
+out:
+    if (!success && buf)
+    {
+        utilsFreeMemory(buf);
+        buf = NULL;
+    }
+
+    ISFS_Close(g_isfsFd);
+    g_isfsFd = 0;
+
+    return (void*)buf;
+}
+
+bool utilsCalculateIsfsFileHash(const char *path, void *out_hash, u32 *out_size)
+{
+    if (!path || !*path || !out_hash || !out_size) return false;
+
+    s32 ret = 0, isfs_fd = -1;
+    u8 *buf[2] = { NULL, NULL };
+    u32 file_size = 0, offset = 0, buf_idx = 0, read_size = 0;
+    u64 wait_start_time = 0, trace_time = 0;
+    bool read_pending = false, success = false;
+
+    sha_context sha_ctx ATTRIBUTE_ALIGN(32) = {0};
+    u8 hash[SHA1_HASH_SIZE] ATTRIBUTE_ALIGN(32) = {0};
+
+    /* ISFS state is kept on the stack, so that several files can be hashed at once from different threads. */
+    char isfs_path[ISFS_MAXPATH] ATTRIBUTE_ALIGN(32) = {0};
+    fstats file_stats ATTRIBUTE_ALIGN(32) = {0};
+
+    UtilsIsfsAsyncRequest req = {0};
+
+    snprintf(isfs_path, ISFS_MAXPATH, "%s", path);
+
+    trace_time = ioTraceBegin();
+    isfs_fd = ISFS_Open(isfs_path, ISFS_OPEN_READ);
+    ioTraceRecord(IoTraceOp_IsfsOpen, isfs_path, 0, 0, isfs_fd, trace_time);
+    if (isfs_fd < 0)
+    {
+        ERROR_MSG("ISFS_Open(\"%s\") failed! (%d).", isfs_path, isfs_fd);
+        return false;
+    }
+
+    ret = ISFS_GetFileStats(isfs_fd, &file_stats);
+    if (ret < 0)
+    {
+        ERROR_MSG("ISFS_GetFileStats(\"%s\") failed! (%d).", isfs_path, ret);
+        goto out;
+    }
+
+    file_size = file_stats.file_length;
+    if (!file_size)
+    {
+        ERROR_MSG("\"%s\" is empty!", isfs_path);
+        goto out;
+    }
+
+    /* Allocate double buffer. */
+    for(u32 i = 0; i < 2; i++)
+    {
+        buf[i] = (u8*)utilsAllocateMemory(ISFS_HASH_CHUNK_SIZE);
+        if (!buf[i])
+        {
+            ERROR_MSG("Failed to allocate memory for \"%s\" read buffer!", isfs_path);
+            goto out;
+        }
+    }
+
+    if (!sha1ContextCreate(&sha_ctx)) goto out;
+
+    LWP_InitQueue(&(req.queue));
+
+    /* Issue first read. */
+    read_size = (file_size < ISFS_HASH_CHUNK_SIZE ? file_size : ISFS_HASH_CHUNK_SIZE);
+    trace_time = ioTraceBegin();
+    ret = ISFS_ReadAsync(isfs_fd, buf[buf_idx], read_size, utilsIsfsAsyncCallback, &req);
     if (ret < 0)
     {
-        ERROR_MSG("ISFS_Read(\"%s\") failed! (%d).", g_isfsFilePath, ret);
+        ERROR_MSG("ISFS_ReadAsync(\"%s\") failed! (%d).", isfs_path, ret);
         goto out;
     }
 
+    read_pending = true;
+
+    while(offset < file_size)
+    {
+        u32 cur_size = read_size;
+        u8 *cur_buf = buf[buf_idx];
+
+        /* Wait for the current chunk. Only the time spent waiting is accounted for, since reads overlap with hashing. */
+        wait_start_time = profilerSpanBegin();
+        ret = utilsWaitForIsfsAsyncRequest(&req);
+        read_pending = false;
+        profilerSpanEnd(ProfilerPhase_IsfsRead, wait_start_time, cur_size);
+
+        /* Traced from the moment the read was issued, which is the actual IOS latency. */
+        ioTraceRecord(IoTraceOp_IsfsRead, isfs_path, offset, cur_size, ret, trace_time);
+
+        if (ret != (s32)cur_size)
+        {
+            ERROR_MSG("ISFS_ReadAsync(\"%s\", 0x%X) failed! (%d).", isfs_path, offset, ret);
+            goto out;
+        }
+
+        offset += cur_size;
+        buf_idx ^= 1;
+
+        /* Issue the next read before hashing the current chunk, so that both operations overlap. */
+        if (offset < file_size)
+        {
+            read_size = ((file_size - offset) < ISFS_HASH_CHUNK_SIZE ? (file_size - offset) : ISFS_HASH_CHUNK_SIZE);
+
+            req.done = false;
+            trace_time = ioTraceBegin();
+            ret = ISFS_ReadAsync(isfs_fd, buf[buf_idx], read_size, utilsIsfsAsyncCallback, &req);
+            if (ret < 0)
+            {
+                ERROR_MSG("ISFS_ReadAsync(\"%s\", 0x%X) failed! (%d).", isfs_path, offset, ret);
+                goto out;
+            }
+
+            read_pending = true;
+
+            if (!sha1ContextUpdate(&sha_ctx, cur_buf, cur_size)) goto out;
+        } else {
+            if (!sha1ContextGetHash(&sha_ctx, cur_buf, cur_size, hash)) goto out;
+        }
+    }
+
+    memcpy(out_hash, hash, SHA1_HASH_SIZE);
     *out_size = file_size;
     success = true;
 
+out:
+    /* Don't free any buffers while IOS may still be writing to them. */
+    if (read_pending) utilsWaitForIsfsAsyncRequest(&req);
+
+    if (req.queue) LWP_CloseQueue(req.queue);
+
+    for(u32 i = 0; i < 2; i++)
+    {
+        if (buf[i]) utilsFreeMemory(buf[i]);
+    }
+
+    ISFS_Close(isfs_fd);
+
+    return success;
+}
+
+void *utilsReadFileRangeFromIsfs(const char *path, u32 offset, u32 size, u32 *out_file_size)
+{
+    if (!path || !*path || !size) return NULL;
+
+    s32 ret = 0;
+    u8 *buf = NULL;
+    u64 start_time = 0, trace_time = 0;
+    bool success = false;
+
+    snprintf(g_isfsFilePath, ISFS_MAXPATH, "%s", path);
+
+    trace_time = ioTraceBegin();
+    g_isfsFd = ISFS_Open(g_isfsFilePath, ISFS_OPEN_READ);
+    ioTraceRecord(IoTraceOp_IsfsOpen, g_isfsFilePath, 0, 0, g_isfsFd, trace_time);
+    if (g_isfsFd < 0)
+    {
+        ERROR_MSG("ISFS_Open(\"%s\") failed! (%d).", g_isfsFilePath, g_isfsFd);
+        return NULL;
+    }
+
+    ret = ISFS_GetFileStats(g_isfsFd, &g_isfsFileStats);
+    if (ret < 0)
+    {
+        ERROR_MSG("ISFS_GetFileStats(\"%s\") failed! (%d).", g_isfsFilePath, ret);
+        goto out;
+    }
+
+    if (offset >= g_isfsFileStats.file_length || size > (g_isfsFileStats.file_length - offset))
+    {
+        ERROR_MSG("Invalid block for \"%s\"! (0x%X, 0x%X).", g_isfsFilePath, offset, size);
+        goto out;
+    }
+
+    buf = (u8*)utilsAllocateMemory(size);
+    if (!buf)
+    {
+        ERROR_MSG("Failed to allocate memory for \"%s\" data block!", g_isfsFilePath);
+        goto out;
+    }
+
+    trace_time = ioTraceBegin();
+    ret = ISFS_Seek(g_isfsFd, (s32)offset, SEEK_SET);
+    ioTraceRecord(IoTraceOp_IsfsSeek, g_isfsFilePath, offset, 0, ret, trace_time);
+    if (ret < 0)
+    {
+        ERROR_MSG("ISFS_Seek(\"%s\", 0x%X) failed! (%d).", g_isfsFilePath, offset, ret);
+        goto out;
+    }
+
+    start_time = profilerSpanBegin();
+
+    trace_time = ioTraceBegin();
+    ret = ISFS_Read(g_isfsFd, buf, size);
+    ioTraceRecord(IoTraceOp_IsfsRead, g_isfsFilePath, offset, size, ret, trace_time);
+    if (ret != (s32)size)
+    {
+        ERROR_MSG("ISFS_Read(\"%s\", 0x%X, 0x%X) failed! (%d).", g_isfsFilePath, offset, size, ret);
+        goto out;
+    }
+
+    profilerSpanEnd(ProfilerPhase_IsfsRead, start_time, size);
+
+    if (out_file_size) *out_file_size = g_isfsFileStats.file_length;
+    success = true;
+
 out:
     if (!success && buf)
     {
-        free(buf);
+        utilsFreeMemory(buf);
         buf = NULL;
     }
 
@@ -338,36 +701,239 @@ bool utilsWriteFileToIsfs(const char *path, void *buf, u32 size)
     if (!path || !*path || !buf || !size) return false;
 
     s32 ret = 0;
+    u8 *buf_u8 = (u8*)buf;
+    u32 chunk_size = g_ioChunkSizes.isfs_write, offset = 0;
+    u64 start_time = 0, trace_time = 0;
     bool success = false;
 
     snprintf(g_isfsFilePath, ISFS_MAXPATH, "%s", path);
 
+    trace_time = ioTraceBegin();
     g_isfsFd = ISFS_Open(g_isfsFilePath, ISFS_OPEN_WRITE);
+    ioTraceRecord(IoTraceOp_IsfsOpen, g_isfsFilePath, 0, 0, g_isfsFd, trace_time);
+    if (g_isfsFd < 0)
+    {
+        ERROR_MSG("ISFS_Open(\"%s\") failed! (%d).", g_isfsFilePath, g_isfsFd);
+        return false;
+    }
+
+    start_time = profilerSpanBegin();
+
+    /* Write data in chunks. The chunk size may have been calibrated for this console. */
+    while(offset < size)
+    {
+        u32 cur_size = ((size - offset) < chunk_size ? (size - offset) : chunk_size);
+
+        trace_time = ioTraceBegin();
+        ret = ISFS_Write(g_isfsFd, buf_u8 + offset, cur_size);
+        ioTraceRecord(IoTraceOp_IsfsWrite, g_isfsFilePath, offset, cur_size, ret, trace_time);
+        if (ret != (s32)cur_size)
+        {
+            ERROR_MSG("ISFS_Write(\"%s\", 0x%X, 0x%X) failed! (%d).", g_isfsFilePath, offset, cur_size, ret);
+            goto out;
+        }
+
+        offset += cur_size;
+    }
+
+    profilerSpanEnd(ProfilerPhase_IsfsWrite, start_time, size);
+
+    success = true;
+
+out:
+    ISFS_Close(g_isfsFd);
+    g_isfsFd = 0;
+
+    return success;
+}
+
+bool utilsWriteFileDifferencesToIsfs(const char *path, const void *buf, u32 size, u32 *out_written)
+{
+    if (!path || !*path || !buf || !size || !IS_ALIGNED((u32)buf, 32) || !out_written) return false;
+
+    s32 ret = 0;
+    const u8 *buf_u8 = (const u8*)buf;
+    u8 *chunk = NULL;
+    u32 offset = 0, written = 0;
+    u64 start_time = 0, trace_time = 0;
+    bool success = false;
+
+    snprintf(g_isfsFilePath, ISFS_MAXPATH, "%s", path);
+
+    trace_time = ioTraceBegin();
+    g_isfsFd = ISFS_Open(g_isfsFilePath, ISFS_OPEN_RW);
+    ioTraceRecord(IoTraceOp_IsfsOpen, g_isfsFilePath, 0, 0, g_isfsFd, trace_time);
     if (g_isfsFd < 0)
     {
         ERROR_MSG("ISFS_Open(\"%s\") failed! (%d).", g_isfsFilePath, g_isfsFd);
         return false;
     }
 
-    ret = ISFS_Write(g_isfsFd, buf, size);
+    ret = ISFS_GetFileStats(g_isfsFd, &g_isfsFileStats);
     if (ret < 0)
     {
-        ERROR_MSG("ISFS_Write(\"%s\") failed! (%d).", g_isfsFilePath, ret);
+        ERROR_MSG("ISFS_GetFileStats(\"%s\") failed! (%d).", g_isfsFilePath, ret);
+        goto out;
+    }
+
+    /* Nothing can be compared if the file size differs. Writing over the existing file would leave a stale tail behind if the new data is shorter, */
+    /* so the file is recreated with its original attributes and fully rewritten instead. */
+    if (g_isfsFileStats.file_length != size)
+    {
+        ISFS_Close(g_isfsFd);
+        g_isfsFd = 0;
+
+        if (!utilsRecreateIsfsFile(g_isfsFilePath) || !utilsWriteFileToIsfs(path, (void*)buf, size)) return false;
+
+        *out_written = size;
+        return true;
+    }
+
+    chunk = (u8*)utilsAllocateMemory(ISFS_DIFF_CHUNK_SIZE);
+    if (!chunk)
+    {
+        ERROR_MSG("Failed to allocate memory for \"%s\" read buffer!", g_isfsFilePath);
         goto out;
     }
 
+    while(offset < size)
+    {
+        u32 chunk_size = ((size - offset) < ISFS_DIFF_CHUNK_SIZE ? (size - offset) : ISFS_DIFF_CHUNK_SIZE);
+        u32 range_start = 0, range_end = 0;
+
+        trace_time = ioTraceBegin();
+        ret = ISFS_Seek(g_isfsFd, (s32)offset, SEEK_SET);
+        ioTraceRecord(IoTraceOp_IsfsSeek, g_isfsFilePath, offset, 0, ret, trace_time);
+        if (ret < 0)
+        {
+            ERROR_MSG("ISFS_Seek(\"%s\", 0x%X) failed! (%d).", g_isfsFilePath, offset, ret);
+            goto out;
+        }
+
+        start_time = profilerSpanBegin();
+
+        trace_time = ioTraceBegin();
+        ret = ISFS_Read(g_isfsFd, chunk, chunk_size);
+        ioTraceRecord(IoTraceOp_IsfsRead, g_isfsFilePath, offset, chunk_size, ret, trace_time);
+        if (ret != (s32)chunk_size)
+        {
+            ERROR_MSG("ISFS_Read(\"%s\", 0x%X, 0x%X) failed! (%d).", g_isfsFilePath, offset, chunk_size, ret);
+            goto out;
+        }
+
+        profilerSpanEnd(ProfilerPhase_IsfsRead, start_time, chunk_size);
+
+        /* Coalesce consecutive differing clusters into a single write. The extra iteration flushes the last range. */
+        for(u32 i = 0; i < (chunk_size + ISFS_CLUSTER_SIZE); i += ISFS_CLUSTER_SIZE)
+        {
+            u32 cluster_size = (i < chunk_size ? ((chunk_size - i) < ISFS_CLUSTER_SIZE ? (chunk_size - i) : ISFS_CLUSTER_SIZE) : 0);
+            bool differs = (cluster_size && memcmp(chunk + i, buf_u8 + offset + i, cluster_size) != 0);
+
+            if (differs)
+            {
+                if (range_end == range_start) range_start = range_end = i;
+                range_end += cluster_size;
+                continue;
+            }
+
+            if (range_end == range_start) continue;
+
+            u32 range_offset = (offset + range_start), range_size = (range_end - range_start);
+
+            trace_time = ioTraceBegin();
+            ret = ISFS_Seek(g_isfsFd, (s32)range_offset, SEEK_SET);
+            ioTraceRecord(IoTraceOp_IsfsSeek, g_isfsFilePath, range_offset, 0, ret, trace_time);
+            if (ret < 0)
+            {
+                ERROR_MSG("ISFS_Seek(\"%s\", 0x%X) failed! (%d).", g_isfsFilePath, range_offset, ret);
+                goto out;
+            }
+
+            start_time = profilerSpanBegin();
+
+            trace_time = ioTraceBegin();
+            ret = ISFS_Write(g_isfsFd, buf_u8 + range_offset, range_size);
+            ioTraceRecord(IoTraceOp_IsfsWrite, g_isfsFilePath, range_offset, range_size, ret, trace_time);
+            if (ret != (s32)range_size)
+            {
+                ERROR_MSG("ISFS_Write(\"%s\", 0x%X, 0x%X) failed! (%d).", g_isfsFilePath, range_offset, range_size, ret);
+                goto out;
+            }
+
+            profilerSpanEnd(ProfilerPhase_IsfsWrite, start_time, range_size);
+
+            written += range_size;
+            range_start = range_end = 0;
+        }
+
+        offset += chunk_size;
+    }
+
+    *out_written = written;
     success = true;
 
 out:
+    if (chunk) utilsFreeMemory(chunk);
+
     ISFS_Close(g_isfsFd);
     g_isfsFd = 0;
 
     return success;
 }
 
+bool utilsVerifyIsfsFileHash(const char *path, const void *expected_hash, u32 expected_size)
+{
+    if (!path || !*path || !expected_hash || !expected_size) return false;
+
+    u8 hash[SHA1_HASH_SIZE] ATTRIBUTE_ALIGN(32) = {0};
+    u32 size = 0;
+
+    /* Data is streamed in chunks, so no full-size buffer is needed. */
+    if (!utilsCalculateIsfsFileHash(path, hash, &size)) return false;
+
+    if (size != expected_size)
+    {
+        ERROR_MSG("\"%s\" size mismatch! (got 0x%X, expected 0x%X).", path, size, expected_size);
+        return false;
+    }
+
+    if (memcmp(hash, expected_hash, SHA1_HASH_SIZE) != 0)
+    {
+        ERROR_MSG("\"%s\" hash mismatch!", path);
+        return false;
+    }
+
+    return true;
+}
+
 #ifdef BACKUP_U8_ARCHIVE
+bool utilsMountSdCardAsync(void)
+{
+    s32 ret = 0;
+
+    if (g_sdCardMounted || g_sdCardMountThread != LWP_THREAD_NULL) return true;
+
+    ret = LWP_CreateThread(&g_sdCardMountThread, utilsSdCardMountThreadFunc, NULL, NULL, SD_MOUNT_THREAD_STACK_SIZE, SD_MOUNT_THREAD_PRIORITY);
+    if (ret < 0)
+    {
+        ERROR_MSG("LWP_CreateThread failed! (%d).", ret);
+        g_sdCardMountThread = LWP_THREAD_NULL;
+        return false;
+    }
+
+    return true;
+}
+
 bool utilsMountSdCard(void)
 {
+    /* Wait for a background mount. Don't retry right away if it failed. */
+    if (g_sdCardMountThread != LWP_THREAD_NULL)
+    {
+        LWP_JoinThread(g_sdCardMountThread, NULL);
+        g_sdCardMountThread = LWP_THREAD_NULL;
+        return g_sdCardMounted;
+    }
+
     if (g_sdCardMounted) return true;
     g_sdCardMounted = fatMountSimple("sd", &__io_wiisd);
     return g_sdCardMounted;
@@ -375,6 +941,9 @@ bool utilsMountSdCard(void)
 
 void utilsUnmountSdCard(void)
 {
+    /* Make sure no background mount is still in progress. */
+    if (g_sdCardMountThread != LWP_THREAD_NULL) utilsMountSdCard();
+
     if (!g_sdCardMounted) return;
     fatUnmount("sd");
     __io_wiisd.shutdown();
@@ -405,6 +974,9 @@ bool utilsGetFileSystemStatsByPath(const char *path, u64 *out_total, u64 *out_fr
     if (out_total) *out_total = ((u64)info.f_blocks * (u64)info.f_frsize);
     if (out_free) *out_free = ((u64)info.f_bfree * (u64)info.f_frsize);
 
+    /* libfat reports its cluster size as the block size. Keep it around to align our transfers. */
+    if (info.f_bsize && IS_ALIGNED(info.f_bsize, 0x200) && !(info.f_bsize & (info.f_bsize - 1))) g_mountedDeviceClusterSize = (u32)info.f_bsize;
+
     return true;
 }
 
@@ -412,22 +984,29 @@ void *utilsReadFileFromMountedDevice(const char *path, u32 *out_size)
 {
     if (!path || !*path || !out_size) return NULL;
 
-    FILE *fd = NULL;
-    size_t filesize = 0, res = 0;
+    int fd = -1;
+    struct stat st = {0};
+    u32 filesize = 0, chunk_size = 0, offset = 0;
     u8 *buf = NULL;
+    u64 start_time = 0, trace_time = 0;
     bool success = false;
 
-    fd = fopen(path, "rb");
-    if (!fd)
+    trace_time = ioTraceBegin();
+    fd = open(path, O_RDONLY);
+    ioTraceRecord(IoTraceOp_SdOpen, path, 0, 0, fd, trace_time);
+    if (fd < 0)
     {
-        ERROR_MSG("fopen(\"%s\") failed! (%d).", path, errno);
+        ERROR_MSG("open(\"%s\") failed! (%d).", path, errno);
         return NULL;
     }
 
-    fseek(fd, 0, SEEK_END);
-    filesize = (u32)ftell(fd);
-    rewind(fd);
+    if (fstat(fd, &st) != 0)
+    {
+        ERROR_MSG("fstat(\"%s\") failed! (%d).", path, errno);
+        goto out;
+    }
 
+    filesize = (u32)st.st_size;
     if (!filesize)
     {
         ERROR_MSG("\"%s\" is empty!", path);
@@ -441,72 +1020,396 @@ void *utilsReadFileFromMountedDevice(const char *path, u32 *out_size)
         goto out;
     }
 
-    res = fread(buf, 1, filesize, fd);
-    if (res != filesize)
+    /* Read data in cluster-aligned chunks straight into our aligned buffer. */
+    chunk_size = utilsGetMountedDeviceChunkSize(g_ioChunkSizes.sd_read);
+    start_time = gettime();
+
+    while(offset < filesize)
     {
-        ERROR_MSG("fread(\"%s\") failed! (%d). Read 0x%X, expected 0x%X.", path, errno, res, filesize);
-        goto out;
+        u32 cur_size = ((filesize - offset) < chunk_size ? (filesize - offset) : chunk_size);
+        ssize_t res = 0;
+
+        trace_time = ioTraceBegin();
+        res = read(fd, buf + offset, cur_size);
+        ioTraceRecord(IoTraceOp_SdRead, path, offset, cur_size, (s32)res, trace_time);
+
+        if (res != (ssize_t)cur_size)
+        {
+            ERROR_MSG("read(\"%s\") failed! (%d). Read 0x%X, expected 0x%X.", path, errno, (u32)res, cur_size);
+            goto out;
+        }
+
+        offset += cur_size;
     }
 
+    utilsUpdateIoCounters(&g_mountedDeviceReadCounters, filesize, start_time);
+    profilerSpanEnd(ProfilerPhase_SdRead, start_time, filesize);
+
     *out_size = filesize;
     success = true;
 
 out:
     if (!success && buf)
     {
-        free(buf);
+        utilsFreeMemory(buf);
         buf = NULL;
     }
 
-    fclose(fd);
+    close(fd);
 
     return (void*)buf;
 }
 
-bool utilsWriteFileToMountedDevice(const char *path, const void *buf, u32 size)
+void *utilsReadFileRangeFromMountedDevice(const char *path, u32 offset, u32 size, u32 *out_file_size)
 {
-    if (!path || !*path || !buf || !size) return false;
+    if (!path || !*path || !size) return NULL;
 
-    FILE *fd = NULL;
-    size_t res = 0;
+    int fd = -1;
+    struct stat st = {0};
+    u32 filesize = 0, chunk_size = 0, cur_offset = 0;
+    u8 *buf = NULL;
+    u64 start_time = 0, trace_time = 0;
     bool success = false;
-    u64 free_space = 0;
 
-    if (!utilsGetFileSystemStatsByPath(path, NULL, &free_space))
+    trace_time = ioTraceBegin();
+    fd = open(path, O_RDONLY);
+    ioTraceRecord(IoTraceOp_SdOpen, path, 0, 0, fd, trace_time);
+    if (fd < 0)
     {
-        ERROR_MSG("Failed to retrieve free FS space!");
-        return false;
+        ERROR_MSG("open(\"%s\") failed! (%d).", path, errno);
+        return NULL;
     }
 
-    if (free_space < (u64)size)
+    if (fstat(fd, &st) != 0)
     {
-        ERROR_MSG("Not enough free space available! Required 0x%X, available 0x%llX.", size, free_space);
-        return false;
+        ERROR_MSG("fstat(\"%s\") failed! (%d).", path, errno);
+        goto out;
     }
 
-    fd = fopen(path, "wb");
-    if (!fd)
+    filesize = (u32)st.st_size;
+    if (offset >= filesize || size > (filesize - offset))
     {
-        ERROR_MSG("fopen(\"%s\") failed! (%d).", path, errno);
-        return false;
+        ERROR_MSG("Invalid block for \"%s\"! (0x%X, 0x%X).", path, offset, size);
+        goto out;
+    }
+
+    buf = (u8*)utilsAllocateMemory(size);
+    if (!buf)
+    {
+        ERROR_MSG("Failed to allocate memory for \"%s\" data block!", path);
+        goto out;
     }
 
-    res = fwrite(buf, 1, size, fd);
-    if (res != size)
+    if (lseek(fd, (off_t)offset, SEEK_SET) != (off_t)offset)
     {
-        ERROR_MSG("fwrite(\"%s\") failed! (%d). Wrote 0x%X, expected 0x%X.", path, errno, res, size);
+        ERROR_MSG("lseek(\"%s\", 0x%X) failed! (%d).", path, offset, errno);
         goto out;
     }
 
+    chunk_size = utilsGetMountedDeviceChunkSize(g_ioChunkSizes.sd_read);
+    start_time = gettime();
+
+    while(cur_offset < size)
+    {
+        u32 cur_size = ((size - cur_offset) < chunk_size ? (size - cur_offset) : chunk_size);
+        ssize_t res = 0;
+
+        trace_time = ioTraceBegin();
+        res = read(fd, buf + cur_offset, cur_size);
+        ioTraceRecord(IoTraceOp_SdRead, path, offset + cur_offset, cur_size, (s32)res, trace_time);
+
+        if (res != (ssize_t)cur_size)
+        {
+            ERROR_MSG("read(\"%s\") failed! (%d). Read 0x%X, expected 0x%X.", path, errno, (u32)res, cur_size);
+            goto out;
+        }
+
+        cur_offset += cur_size;
+    }
+
+    utilsUpdateIoCounters(&g_mountedDeviceReadCounters, size, start_time);
+    profilerSpanEnd(ProfilerPhase_SdRead, start_time, size);
+
+    if (out_file_size) *out_file_size = filesize;
     success = true;
 
 out:
-    fclose(fd);
+    if (!success && buf)
+    {
+        utilsFreeMemory(buf);
+        buf = NULL;
+    }
+
+    close(fd);
+
+    return (void*)buf;
+}
+
+char *utilsReadTextFileFromMountedDevice(const char *path)
+{
+    u8 *data = NULL;
+    char *text = NULL;
+    u32 data_size = 0;
+
+    data = (u8*)utilsReadFileFromMountedDevice(path, &data_size);
+    if (!data) return NULL;
+
+    if (memchr(data, 0, data_size))
+    {
+        ERROR_MSG("\"%s\" holds NULL characters!", path);
+        goto out;
+    }
+
+    /* Generate a NULL-terminated copy callers can tokenize. */
+    text = (char*)utilsAllocateMemory(data_size + 1);
+    if (!text)
+    {
+        ERROR_MSG("Failed to allocate memory for \"%s\" text!", path);
+        goto out;
+    }
+
+    memcpy(text, data, data_size);
+
+out:
+    utilsFreeMemory(data);
+
+    return text;
+}
+
+bool utilsWriteFileToMountedDevice(const char *path, const void *buf, u32 size, bool check_free_space)
+{
+    if (!path || !*path || (size && !buf)) return false;
+
+    int fd = -1, ret = 0;
+    const u8 *buf_u8 = (const u8*)buf;
+    u8 *bounce_buf = NULL;
+    u32 chunk_size = 0, offset = 0;
+    u64 free_space = 0, start_time = 0, trace_time = 0;
+    bool success = false;
+
+    /* Free space checks can be skipped by callers that write lots of files, since statvfs() is expensive under libfat. */
+    if (check_free_space)
+    {
+        if (!utilsGetFileSystemStatsByPath(path, NULL, &free_space))
+        {
+            ERROR_MSG("Failed to retrieve free FS space!");
+            return false;
+        }
+
+        if (free_space < (u64)size)
+        {
+            ERROR_MSG("Not enough free space available! Required 0x%X, available 0x%llX.", size, free_space);
+            return false;
+        }
+    }
+
+    chunk_size = utilsGetMountedDeviceChunkSize(g_ioChunkSizes.sd_write);
+
+    /* The SD card driver bounces unaligned buffers sector by sector. Use our own aligned bounce buffer instead. */
+    if (size && !IS_ALIGNED((u32)buf_u8, 32))
+    {
+        bounce_buf = (u8*)utilsAllocateMemory(size < chunk_size ? size : chunk_size);
+        if (!bounce_buf)
+        {
+            ERROR_MSG("Failed to allocate memory for bounce buffer!");
+            return false;
+        }
+    }
+
+    trace_time = ioTraceBegin();
+    fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    ioTraceRecord(IoTraceOp_SdOpen, path, 0, 0, fd, trace_time);
+    if (fd < 0)
+    {
+        ERROR_MSG("open(\"%s\") failed! (%d).", path, errno);
+        goto out;
+    }
+
+    /* Write data in cluster-aligned chunks, bypassing stdio buffering. */
+    /* Each chunk spans whole clusters, which lets libfat grow the FAT chain several clusters at a time. */
+    /* Note: ftruncate() isn't used to preallocate the file, since libfat zero-fills extended files, which would double the amount of written data. */
+    start_time = gettime();
+
+    while(offset < size)
+    {
+        u32 cur_size = ((size - offset) < chunk_size ? (size - offset) : chunk_size);
+        const u8 *src = (buf_u8 + offset);
+        ssize_t res = 0;
+
+        if (bounce_buf)
+        {
+            memcpy(bounce_buf, src, cur_size);
+            src = bounce_buf;
+        }
+
+        trace_time = ioTraceBegin();
+        res = write(fd, src, cur_size);
+        ioTraceRecord(IoTraceOp_SdWrite, path, offset, cur_size, (s32)res, trace_time);
+        if (res != (ssize_t)cur_size)
+        {
+            ERROR_MSG("write(\"%s\") failed! (%d). Wrote 0x%X, expected 0x%X.", path, errno, (u32)res, cur_size);
+            goto out;
+        }
+
+        offset += cur_size;
+    }
+
+    /* libfat flushes its cache on close(), so it must be accounted for. */
+    trace_time = ioTraceBegin();
+    ret = close(fd);
+    ioTraceRecord(IoTraceOp_SdClose, path, 0, size, ret, trace_time);
+
+    if (ret != 0)
+    {
+        fd = -1;
+        ERROR_MSG("close(\"%s\") failed! (%d).", path, errno);
+        goto out;
+    }
+
+    fd = -1;
+
+    utilsUpdateIoCounters(&g_mountedDeviceWriteCounters, size, start_time);
+    profilerSpanEnd(ProfilerPhase_SdWrite, start_time, size);
+
+    success = true;
+
+out:
+    if (fd >= 0) close(fd);
+
+    if (bounce_buf) utilsFreeMemory(bounce_buf);
+
+    return success;
+}
+
+void utilsGetMountedDeviceIoCounters(UtilsIoCounters *out_read, UtilsIoCounters *out_write)
+{
+    if (out_read) memcpy(out_read, &g_mountedDeviceReadCounters, sizeof(UtilsIoCounters));
+    if (out_write) memcpy(out_write, &g_mountedDeviceWriteCounters, sizeof(UtilsIoCounters));
+}
+
+u32 utilsLoadSidecarFile(const char *path, u32 magic, u32 version, void *out_entries, u32 entry_size, u32 max_entry_count, bool *out_invalid)
+{
+    struct stat st = {0};
+    u8 *data = NULL;
+    u32 data_size = 0, entry_count = 0;
+    UtilsSidecarHeader *header = NULL;
+
+    if (out_invalid) *out_invalid = false;
+
+    /* A missing sidecar file isn't an error. */
+    if (!path || !*path || !out_entries || !entry_size || stat(path, &st) != 0 || !(data = (u8*)utilsReadFileFromMountedDevice(path, &data_size))) return 0;
+
+    header = (UtilsSidecarHeader*)data;
+
+    /* Discard the whole file if anything looks off. */
+    if (data_size < sizeof(UtilsSidecarHeader) || header->magic != magic || header->version != version || header->entry_count > max_entry_count || \
+        data_size != (sizeof(UtilsSidecarHeader) + (entry_size * header->entry_count)))
+    {
+        if (out_invalid) *out_invalid = true;
+        goto out;
+    }
+
+    entry_count = header->entry_count;
+    memcpy(out_entries, data + sizeof(UtilsSidecarHeader), entry_size * entry_count);
+
+out:
+    utilsFreeMemory(data);
+
+    return entry_count;
+}
+
+u32 utilsAppendSidecarEntry(void *entries, u32 entry_count, u32 max_entry_count, u32 entry_size, const void *entry)
+{
+    u8 *entries_u8 = (u8*)entries;
+
+    if (!entries || !max_entry_count || !entry_size || !entry) return entry_count;
+
+    /* Drop the oldest entry if the array is full. */
+    if (entry_count >= max_entry_count)
+    {
+        memmove(entries_u8, entries_u8 + entry_size, entry_size * (max_entry_count - 1));
+        entry_count = (max_entry_count - 1);
+    }
+
+    memcpy(entries_u8 + (entry_size * entry_count), entry, entry_size);
+
+    return (entry_count + 1);
+}
+
+bool utilsSaveSidecarFile(const char *path, u32 magic, u32 version, const void *entries, u32 entry_size, u32 entry_count)
+{
+    u8 *data = NULL;
+    u32 data_size = (sizeof(UtilsSidecarHeader) + (entry_size * entry_count));
+    UtilsSidecarHeader *header = NULL;
+    bool success = false;
+
+    if (!path || !*path || (entry_count && (!entries || !entry_size)))
+    {
+        ERROR_MSG("Invalid parameters!");
+        return false;
+    }
+
+    if (!(data = (u8*)utilsAllocateMemory(data_size)))
+    {
+        ERROR_MSG("Failed to allocate memory for \"%s\"!", path);
+        return false;
+    }
+
+    header = (UtilsSidecarHeader*)data;
+    header->magic = magic;
+    header->version = version;
+    header->entry_count = entry_count;
+    header->reserved = 0;
+
+    if (entry_count) memcpy(data + sizeof(UtilsSidecarHeader), entries, entry_size * entry_count);
+
+    /* Create output directory. */
+    mkdir("sd:/" APP_TITLE, 0777);
+
+    success = utilsWriteFileToMountedDevice(path, data, data_size, false);
+
+    utilsFreeMemory(data);
 
     return success;
 }
+
+static void *utilsSdCardMountThreadFunc(void *arg)
+{
+    (void)arg;
+
+    /* Nothing else touches this flag until utilsMountSdCard() joins this thread. */
+    g_sdCardMounted = fatMountSimple("sd", &__io_wiisd);
+
+    return NULL;
+}
+
+static u32 utilsGetMountedDeviceChunkSize(u32 chunk_size)
+{
+    /* Use the provided chunk size as-is if the cluster size is still unknown. */
+    if (!g_mountedDeviceClusterSize) return chunk_size;
+    return ALIGN_UP(chunk_size, g_mountedDeviceClusterSize);
+}
+
+static void utilsUpdateIoCounters(UtilsIoCounters *counters, u32 size, u64 start_time)
+{
+    u64 elapsed_usec = diff_usec(start_time, gettime());
+    u32 level = 0;
+
+    _CPU_ISR_Disable(level);
+    counters->op_count++;
+    counters->byte_count += size;
+    counters->elapsed_usec += elapsed_usec;
+    _CPU_ISR_Restore(level);
+}
 #endif  /* BACKUP_U8_ARCHIVE */
 
+static u32 utilsValidateIoChunkSize(u32 chunk_size)
+{
+    /* ISFS transfers need 32-byte aligned buffers, so every chunk must start at an aligned offset. */
+    if (!chunk_size || !IS_ALIGNED(chunk_size, 0x20) || chunk_size > UTILS_MAX_IO_CHUNK_SIZE) return UTILS_DEFAULT_IO_CHUNK_SIZE;
+    return chunk_size;
+}
+
 static u32 utilsButtonsDownAll(void)
 {
     int chan = 0;
@@ -526,3 +1429,64 @@ static u32 utilsButtonsHeldAll(void)
 
     return pressed;
 }
+
+static bool utilsRecreateIsfsFile(const char *path)
+{
+    u32 owner_id = 0;
+    u16 group_id = 0;
+    u8 attributes = 0, owner_perm = 0, group_perm = 0, other_perm = 0;
+    s32 ret = 0;
+
+    ret = ISFS_GetAttr(path, &owner_id, &group_id, &attributes, &owner_perm, &group_perm, &other_perm);
+    if (ret < 0)
+    {
+        ERROR_MSG("ISFS_GetAttr(\"%s\") failed! (%d).", path, ret);
+        return false;
+    }
+
+    ret = ISFS_Delete(path);
+    if (ret < 0)
+    {
+        ERROR_MSG("ISFS_Delete(\"%s\") failed! (%d).", path, ret);
+        return false;
+    }
+
+    ret = ISFS_CreateFile(path, attributes, owner_perm, group_perm, other_perm);
+    if (ret < 0)
+    {
+        ERROR_MSG("ISFS_CreateFile(\"%s\") failed! (%d).", path, ret);
+        return false;
+    }
+
+    /* ISFS_CreateFile() assigns the new file to the caller, so restore the original owner as well. */
+    ret = ISFS_SetAttr(path, owner_id, group_id, attributes, owner_perm, group_perm, other_perm);
+    if (ret < 0)
+    {
+        ERROR_MSG("ISFS_SetAttr(\"%s\") failed! (%d).", path, ret);
+        return false;
+    }
+
+    return true;
+}
+
+static s32 utilsIsfsAsyncCallback(s32 result, void *usrdata)
+{
+    UtilsIsfsAsyncRequest *req = (UtilsIsfsAsyncRequest*)usrdata;
+
+    req->result = result;
+    req->done = true;
+
+    LWP_ThreadSignal(req->queue);
+
+    return 0;
+}
+
+static s32 utilsWaitForIsfsAsyncRequest(UtilsIsfsAsyncRequest *req)
+{
+    /* Disable interrupts to avoid missing the wakeup signal from the IPC callback. */
+    u32 level = IRQ_Disable();
+    while(!req->done) LWP_ThreadSleep(req->queue);
+    IRQ_Restore(level);
+
+    return req->result;
+}
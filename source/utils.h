@@ -31,8 +31,10 @@
 #include <malloc.h>
 #include <errno.h>
 #include <dirent.h>
+#include <time.h>
 #include <gccore.h>
 #include <ogc/machine/processor.h>
+#include <ogc/lwp_watchdog.h>
 #include <wiiuse/wpad.h>
 #include <assert.h>
 
@@ -40,6 +42,16 @@
 #define BACKUP_U8_ARCHIVE
 //#define DISPLAY_ARDB_ENTRIES
 
+/* These macros control per-phase timing instrumentation. Saving to CSV requires BACKUP_U8_ARCHIVE. */
+#define PROFILE_PHASES
+//#define SAVE_PROFILE_CSV
+
+/* This macro adds a menu option to benchmark the U8 parser using synthetic archives. */
+//#define BENCHMARK_U8
+
+/* This macro records the timing of every ES, ISFS and SD card call, and saves it to a CSV file. Saving requires BACKUP_U8_ARCHIVE. */
+//#define RECORD_IO_TRACE
+
 #define ERROR_MSG(...)                  utilsPrintErrorMessage(__func__, __VA_ARGS__)
 
 #define MEMBER_SIZE(type, member)       sizeof(((type*)NULL)->member)
@@ -56,6 +68,9 @@
 
 #define SYSTEM_MENU_TID                 TITLE_ID(1, 2)
 
+#define UTILS_DEFAULT_IO_CHUNK_SIZE     0x40000
+#define UTILS_MAX_IO_CHUNK_SIZE         0x100000
+
 /// Flags a function as (always) inline.
 #ifndef ALWAYS_INLINE
 #define ALWAYS_INLINE                   __attribute__((always_inline)) static inline
@@ -63,13 +78,90 @@
 
 #define SIZE_ASSERT(name, size)         static_assert(sizeof(name) == (size), "Bad size for " #name "! Expected " #size ".")
 
+/* Wii data structures are stored in big-endian byte order, which is also the native byte order on Broadway. */
+/* These macros convert between both byte orders, so the same code also works on little-endian hosts (see the host directory). */
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define BE16(x)                         __builtin_bswap16((u16)(x))
+#define BE32(x)                         __builtin_bswap32((u32)(x))
+#define BE64(x)                         __builtin_bswap64((u64)(x))
+#else
+#define BE16(x)                         ((u16)(x))
+#define BE32(x)                         ((u32)(x))
+#define BE64(x)                         ((u64)(x))
+#endif
+
 typedef enum {
     UtilsInputType_Down = 0,
     UtilsInputType_Held = 1
 } UtilsInputType;
 
+/// Cumulative I/O counters. Throughput can be calculated using byte_count and elapsed_usec.
+typedef struct {
+    u32 op_count;       ///< Number of completed operations.
+    u64 byte_count;     ///< Number of transferred bytes.
+    u64 elapsed_usec;   ///< Time spent on transfers, in microseconds.
+} UtilsIoCounters;
+
+/// Chunk sizes used by whole-file ISFS and mounted device transfers.
+typedef struct {
+    u32 isfs_read;      ///< ISFS read chunk size.
+    u32 isfs_write;     ///< ISFS write chunk size.
+    u32 sd_read;        ///< Mounted device read chunk size. Rounded up to the cluster size, if needed.
+    u32 sd_write;       ///< Mounted device write chunk size. Rounded up to the cluster size, if needed.
+} UtilsIoChunkSizes;
+
+/// Reads a data block from a file. Both utilsReadFileRangeFromIsfs() and utilsReadFileRangeFromMountedDevice() match this signature.
+typedef void *(*UtilsReadRangeFunction)(const char *path, u32 offset, u32 size, u32 *out_file_size);
+
+/// Header for sidecar files: small binary files stored in a mounted device, holding a fixed-size entry array right after this header.
+/// Used by the hash cache, the content cache and the I/O calibration data.
+typedef struct {
+    u32 magic;          ///< File-specific magic word.
+    u32 version;        ///< File-specific version.
+    u32 entry_count;    ///< Entry count.
+    u32 reserved;       ///< Reserved.
+} UtilsSidecarHeader;
+
+SIZE_ASSERT(UtilsSidecarHeader, 0x10);
+
 void *utilsAllocateMemory(size_t size);
 
+/// Frees a buffer allocated by utilsAllocateMemory(), updating the allocated byte counters.
+void utilsFreeMemory(void *ptr);
+
+/// Duplicates a NULL-terminated string using utilsAllocateMemory(). The returned pointer must be freed by the user.
+char *utilsDuplicateString(const char *str);
+
+/// Returns the number of successful allocations made through utilsAllocateMemory() so far.
+u32 utilsGetAllocationCount(void);
+
+/// Retrieves the number of bytes currently allocated through utilsAllocateMemory(), as well as the highest value reached so far.
+/// Values are based on the real heap block sizes, so they include any alignment overhead.
+void utilsGetMemoryUsage(u32 *out_current, u32 *out_peak);
+
+/// Converts an array of big-endian 32-bit words to the native byte order in place, or vice versa. Does nothing on big-endian hosts.
+/// Meant for Wii data structures made up of 32-bit fields (e.g. U8 headers and nodes). buf doesn't need to be aligned.
+ALWAYS_INLINE void utilsSwapBigEndianWords(void *buf, u32 word_count)
+{
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+    u8 *ptr = (u8*)buf;
+
+    for(u32 i = 0; i < word_count; i++, ptr += sizeof(u32))
+    {
+        u32 val = 0;
+        memcpy(&val, ptr, sizeof(u32));
+        val = BE32(val);
+        memcpy(ptr, &val, sizeof(u32));
+    }
+#else
+    (void)buf;
+    (void)word_count;
+#endif
+}
+
+/// Strips leading and trailing whitespace from the provided string in place. Returns a pointer to the first non-whitespace character.
+char *utilsTrimString(char *str);
+
 __attribute__((format(printf, 2, 3))) void utilsPrintErrorMessage(const char *func_name, const char *fmt, ...);
 
 bool utilsIsWiiU(void);
@@ -95,6 +187,7 @@ ALWAYS_INLINE void utilsClearScreen(void)
 void utilsInitConsole(bool vwii);
 void utilsPrintHeadline(void);
 
+/// Retrieves the signed TMD for the provided title from ES. The returned pointer must be freed by the user. Safe to call from any thread.
 signed_blob *utilsGetSignedTMDFromTitle(u64 title_id, u32 *out_size);
 
 ALWAYS_INLINE tmd *utilsGetTMDFromSignedBlob(signed_blob *stmd)
@@ -103,18 +196,69 @@ ALWAYS_INLINE tmd *utilsGetTMDFromSignedBlob(signed_blob *stmd)
     return (tmd*)((u8*)stmd + SIGNATURE_SIZE(stmd));
 }
 
+/// Sets the chunk sizes used by whole-file ISFS and mounted device transfers. Zero selects UTILS_DEFAULT_IO_CHUNK_SIZE.
+/// Values that aren't multiples of 32 bytes or exceed UTILS_MAX_IO_CHUNK_SIZE are also replaced with the default chunk size.
+void utilsSetIoChunkSizes(const UtilsIoChunkSizes *chunk_sizes);
+
+/// Retrieves the chunk sizes currently used by whole-file ISFS and mounted device transfers.
+void utilsGetIoChunkSizes(UtilsIoChunkSizes *out_chunk_sizes);
+
 /* Hint: ISFS means "Internal Storage File System". */
 void *utilsReadFileFromIsfs(const char *path, u32 *out_size);
+
+/// Calculates the SHA-1 checksum of a file stored in the ISFS without loading it into memory.
+/// Data is streamed through the SHA engine in big chunks, while the next chunk is read in the background. The file size is saved to out_size. Safe to call from any thread.
+bool utilsCalculateIsfsFileHash(const char *path, void *out_hash, u32 *out_size);
+
+/// Reads a data block from a file stored in the ISFS. Useful to avoid loading whole files into memory.
+/// The returned pointer must be freed by the user. If out_file_size is provided, the full file size is saved to it.
+void *utilsReadFileRangeFromIsfs(const char *path, u32 offset, u32 size, u32 *out_file_size);
 bool utilsWriteFileToIsfs(const char *path, void *buf, u32 size);
 
+/// Compares a file stored in the ISFS against the provided buffer, and only writes the NAND clusters that differ from it.
+/// If the file size doesn't match, the file is recreated with its original attributes and the whole buffer is written. buf must be 32-byte aligned. The number of written bytes is saved to out_written.
+bool utilsWriteFileDifferencesToIsfs(const char *path, const void *buf, u32 size, u32 *out_written);
+
+/// Checks the size and SHA-1 checksum of a file stored in the ISFS against the provided values, using utilsCalculateIsfsFileHash().
+/// Meant to verify writes by reading them back, without allocating a second full-size buffer.
+bool utilsVerifyIsfsFileHash(const char *path, const void *expected_hash, u32 expected_size);
+
 #ifdef BACKUP_U8_ARCHIVE
+/// Starts mounting the SD card on a background thread, so it can overlap with other initialization steps.
+/// utilsMountSdCard() waits for it to finish.
+bool utilsMountSdCardAsync(void);
+
+/// Mounts the SD card, or waits for a background mount started by utilsMountSdCardAsync() and returns its result.
 bool utilsMountSdCard(void);
+
 void utilsUnmountSdCard(void);
 
 bool utilsGetFileSystemStatsByPath(const char *path, u64 *out_total, u64 *out_free);
 
 void *utilsReadFileFromMountedDevice(const char *path, u32 *out_size);
-bool utilsWriteFileToMountedDevice(const char *path, const void *buf, u32 size);
+
+/// Reads a data block from a file stored in a mounted device. Mirrors utilsReadFileRangeFromIsfs().
+/// The returned pointer must be freed by the user. If out_file_size is provided, the full file size is saved to it.
+void *utilsReadFileRangeFromMountedDevice(const char *path, u32 offset, u32 size, u32 *out_file_size);
+
+/// Reads a whole text file from a mounted device into a NULL-terminated buffer. Files holding NULL characters are rejected.
+/// The returned pointer must be freed by the user.
+char *utilsReadTextFileFromMountedDevice(const char *path);
+bool utilsWriteFileToMountedDevice(const char *path, const void *buf, u32 size, bool check_free_space);
+
+/// Retrieves cumulative read and write counters for all mounted device transfers.
+void utilsGetMountedDeviceIoCounters(UtilsIoCounters *out_read, UtilsIoCounters *out_write);
+
+/// Loads up to max_entry_count entries from a sidecar file stored in a mounted device into out_entries, and returns the number of loaded entries.
+/// Missing files yield zero entries. Files with a mismatching magic word, version or size are discarded as a whole, in which case out_invalid is set to true (if provided).
+u32 utilsLoadSidecarFile(const char *path, u32 magic, u32 version, void *out_entries, u32 entry_size, u32 max_entry_count, bool *out_invalid);
+
+/// Appends an entry to a sidecar entry array holding entry_count entries, and returns the updated entry count.
+/// The oldest entry is dropped if the array already holds max_entry_count entries.
+u32 utilsAppendSidecarEntry(void *entries, u32 entry_count, u32 max_entry_count, u32 entry_size, const void *entry);
+
+/// Saves a sidecar entry array to a file stored in a mounted device. The application directory is created, if needed.
+bool utilsSaveSidecarFile(const char *path, u32 magic, u32 version, const void *entries, u32 entry_size, u32 entry_count);
 #endif  /* BACKUP_U8_ARCHIVE */
 
 #endif /* __UTILS_H__ */